@@ -0,0 +1,33 @@
+# Usage: cmake -DOUTPUT=<file.c> -DINPUTS=<a|b|...> -P embed_shaders.cmake
+# Writes every input as a 4 byte aligned uint32_t array plus an index by file name,
+# see src/shaders.h. Words are assembled little endian, like SPIR-V files on disk.
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+
+set(SOURCE "// Generated by cmake/embed_shaders.cmake, do not edit\n#include \"shaders.h\"\n\n")
+set(INDEX "")
+set(COUNT 0)
+foreach(INPUT ${INPUTS})
+	get_filename_component(NAME ${INPUT} NAME)
+	string(MAKE_C_IDENTIFIER "embedded_${NAME}" SYMBOL)
+	file(READ ${INPUT} HEX HEX)
+	string(LENGTH "${HEX}" HEX_LENGTH)
+	math(EXPR SIZE "${HEX_LENGTH} / 2")
+
+	# Pad to whole words, plus a zero word so text (GLSL) is NUL terminated
+	math(EXPR PADDING "(4 - ${SIZE} % 4) % 4 + 4")
+	foreach(I RANGE 1 ${PADDING})
+		string(APPEND HEX "00")
+	endforeach()
+	string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1," WORDS "${HEX}")
+	# 8 words per line, CMake regexes have no {n}
+	set(W "0x........,")
+	string(REGEX REPLACE "(${W}${W}${W}${W}${W}${W}${W}${W})" "\\1\n\t" WORDS "${WORDS}")
+
+	string(APPEND SOURCE "static const uint32_t ${SYMBOL}[] = {\n\t${WORDS}\n};\n\n")
+	string(APPEND INDEX "\t{\"${NAME}\", ${SYMBOL}, ${SIZE}},\n")
+	math(EXPR COUNT "${COUNT} + 1")
+endforeach()
+
+string(APPEND SOURCE "const EmbeddedShader embedded_shaders[] = {\n${INDEX}};\n")
+string(APPEND SOURCE "const uint32_t embedded_shaders_count = ${COUNT};\n")
+file(WRITE ${OUTPUT} "${SOURCE}")
@@ -0,0 +1,25 @@
+#version 300 es
+// Instanced sprite quad, attributes match Sprite in src/sprites.h
+layout(location = 0) in vec2 a_position;
+layout(location = 1) in vec2 a_half_size;
+layout(location = 2) in vec4 a_color;
+
+layout(std140) uniform View
+{
+	vec4 view;
+};
+
+out vec4 color;
+
+const vec2 corners[6] = vec2[6](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main()
+{
+	vec2 world = a_position + corners[gl_VertexID] * a_half_size;
+	vec2 clip = world * view.xy + view.zw;
+	// Same view as the Vulkan path, where clip space y points down
+	gl_Position = vec4(clip.x, -clip.y, 0.0, 1.0);
+	color = a_color;
+}
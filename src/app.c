@@ -14,6 +14,9 @@ static constexpr bool ENABLE_VALIDATION_LAYERS =
 	false;
 #endif
 
+// In a house, the dynamic light that follows the mouse
+static constexpr uint32_t FLASHLIGHT_LIGHT = 1;
+
 static void show_available_instance_extensions()
 {
     uint32_t count;
@@ -45,11 +48,10 @@ static VkResult create_debug_messenger_util(VkInstance instance,
 		const VkAllocationCallbacks *allocator,
 		VkDebugUtilsMessengerEXT *debug_messenger)
 {
-	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance,
-			"vkCreateDebugUtilsMessengerEXT");
-	if (func != nullptr)
+	// Loaded with the instance, nullptr without VK_EXT_debug_utils
+	if (vkCreateDebugUtilsMessengerEXT != nullptr)
 	{
-		return func(instance, create_info, allocator, debug_messenger);
+		return vkCreateDebugUtilsMessengerEXT(instance, create_info, allocator, debug_messenger);
 	}
 	else return VK_ERROR_EXTENSION_NOT_PRESENT;
 };
@@ -58,52 +60,34 @@ static void destroy_debug_messenter_util(VkInstance instance,
 		VkDebugUtilsMessengerEXT debug_messenger,
 		const VkAllocationCallbacks *allocator)
 {
-	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance,
-		"vkDestroyDebugUtilsMessengerEXT");
-	
-	if (func != nullptr)
+	if (vkDestroyDebugUtilsMessengerEXT != nullptr)
 	{
-		func(instance, debug_messenger, allocator);
+		vkDestroyDebugUtilsMessengerEXT(instance, debug_messenger, allocator);
 	};
 };
 
-static Result pick_physical_device(VulkanState *vk)
+static bool find_graphic_queue_family(VkPhysicalDevice physical_device, uint32_t* index)
 {
-	uint32_t count = 0;
-	vkEnumeratePhysicalDevices(vk->_instance, &count, nullptr);
-
-	if (count == 0)
-	{
-		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to find GPU support Vulkan\n");
-		return FAILURE;
-	};
+	uint32_t count;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, nullptr);
 
-	VkPhysicalDevice physical_devices[count];
-	vkEnumeratePhysicalDevices(vk->_instance, &count, physical_devices);
-	
-	vk->_physical_device = VK_NULL_HANDLE;
+	VkQueueFamilyProperties properties[count];
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, properties);
 
-	// Choose whatever possible, but prioritise discrete_gpu
 	for (int i = 0; i < count; i++)
 	{
-		if (vk->_physical_device == VK_NULL_HANDLE) vk->_physical_device = physical_devices[i];
-		else
+		if (properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
 		{
-			VkPhysicalDeviceProperties properties;
-			vkGetPhysicalDeviceProperties(physical_devices[i], &properties);
-			if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-				vk->_physical_device = physical_devices[i];
+			*index = i;
+			SDL_Log("Graphics Queue family: %d\n", i);
+			return true;
 		};
 	};
-	
-	VkPhysicalDeviceProperties properties;
-	vkGetPhysicalDeviceProperties(vk->_physical_device, &properties);
-	SDL_Log("Choosen Physical Device: %s\n", properties.deviceName);
-
-	return SUCCESS;
+	return false;
 };
 
-static bool find_graphic_queue_family(VkPhysicalDevice physical_device, uint32_t* index)
+// A family without graphics, its work runs next to the graphics queue instead of between its submits
+static bool find_compute_queue_family(VkPhysicalDevice physical_device, uint32_t* index)
 {
 	uint32_t count;
 	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, nullptr);
@@ -111,12 +95,12 @@ static bool find_graphic_queue_family(VkPhysicalDevice physical_device, uint32_t
 	VkQueueFamilyProperties properties[count];
 	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, properties);
 
-	for (int i = 0; i < count; i++)
+	for (uint32_t i = 0; i < count; i++)
 	{
-		if (properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		if ((properties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
 		{
 			*index = i;
-			SDL_Log("Graphics Queue family: %d\n", i);
+			SDL_Log("Compute Queue family: %u\n", i);
 			return true;
 		};
 	};
@@ -144,7 +128,7 @@ static bool find_present_queue_family(VkPhysicalDevice physical_device, VkSurfac
 	};
 	return false;
 };
-static bool check_device_extension_support(VkPhysicalDevice device, const char **required_extensions, uint32_t required_count)
+static bool has_device_extensions(VkPhysicalDevice device, const char **required_extensions, uint32_t required_count)
 {
 	uint32_t extension_count;
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
@@ -157,20 +141,179 @@ static bool check_device_extension_support(VkPhysicalDevice device, const char *
 	{
 		for (int j = 0; j < extension_count; j++)
 		{
-			if (strcmp(required_extensions[i], ext_properties[j].extensionName))
+			if (strcmp(required_extensions[i], ext_properties[j].extensionName) == 0)
 			{
 				found++;
 				break;
 			};
 		};
 	};
-	if (found != required_count)
+	return found == required_count;
+};
+
+static bool check_device_extension_support(VkPhysicalDevice device, const char **required_extensions, uint32_t required_count)
+{
+	if (!has_device_extensions(device, required_extensions, required_count))
 	{
 		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Missing required device extensions\n");
 		return false;
 	};
 	return true;
 };
+// Why a device can't run the game, or its score. Everything create_logical_device enables is checked here
+static int64_t score_physical_device(VulkanState *vk, VkPhysicalDevice device, char *report, size_t report_size)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_3)
+	{
+		SDL_snprintf(report, report_size, "unusable, Vulkan %u.%u", VK_API_VERSION_MAJOR(properties.apiVersion),
+				VK_API_VERSION_MINOR(properties.apiVersion));
+		return -1;
+	};
+
+	const char *swapchain_extension = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+	if (!has_device_extensions(device, &swapchain_extension, 1))
+	{
+		SDL_snprintf(report, report_size, "unusable, no swapchain");
+		return -1;
+	};
+
+	VkPhysicalDeviceVulkan13Features v13_features = {};
+	v13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	VkPhysicalDeviceVulkan12Features v12_features = {};
+	v12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	v12_features.pNext = &v13_features;
+	VkPhysicalDeviceVulkan11Features v11_features = {};
+	v11_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+	v11_features.pNext = &v12_features;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &v11_features;
+	vkGetPhysicalDeviceFeatures2(device, &features);
+	const char *missing = !v13_features.dynamicRendering ? "dynamicRendering"
+		: !v13_features.synchronization2 ? "synchronization2"
+		: !v12_features.drawIndirectCount ? "drawIndirectCount"
+		: !v12_features.timelineSemaphore ? "timelineSemaphore"
+		: !v11_features.shaderDrawParameters ? "shaderDrawParameters"
+		: !features.features.vertexPipelineStoresAndAtomics ? "vertexPipelineStoresAndAtomics"
+		: nullptr;
+	if (missing != nullptr)
+	{
+		SDL_snprintf(report, report_size, "unusable, no %s", missing);
+		return -1;
+	};
+
+	uint32_t families_count;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &families_count, nullptr);
+	VkQueueFamilyProperties families[families_count];
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &families_count, families);
+	bool graphics = false, present = false, shared = false, compute_only = false;
+	for (uint32_t i = 0; i < families_count; i++)
+	{
+		VkBool32 present_support = VK_FALSE;
+		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vk->_surface, &present_support);
+		bool has_graphics = families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT;
+		graphics |= has_graphics;
+		present |= present_support == VK_TRUE;
+		shared |= has_graphics && present_support == VK_TRUE;
+		compute_only |= (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !has_graphics;
+	};
+	if (!graphics || !present)
+	{
+		SDL_snprintf(report, report_size, "unusable, no %s queue", graphics ? "present" : "graphics");
+		return -1;
+	};
+
+	VkPhysicalDeviceMemoryProperties memory;
+	vkGetPhysicalDeviceMemoryProperties(device, &memory);
+	VkDeviceSize local_size = 0;
+	for (uint32_t i = 0; i < memory.memoryHeapCount; i++)
+	{
+		if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) local_size += memory.memoryHeaps[i].size;
+	};
+	uint32_t local_mib = (uint32_t)(local_size >> 20);
+
+	// The device type dominates, memory and queue layout break ties between similar devices
+	int64_t score = 0;
+	const char *type = "other";
+	switch (properties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score = 100000; type = "discrete"; break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score = 50000; type = "integrated"; break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score = 20000; type = "virtual"; break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: score = 1000; type = "cpu"; break;
+	default: score = 10000; break;
+	};
+	score += SDL_min(local_mib / 64, 1024u);
+	if (shared) score += 500;
+	if (compute_only) score += 200;
+
+	SDL_snprintf(report, report_size, "%s, %u MiB local, %s graphics/present queue%s, score %lld", type, local_mib,
+			shared ? "shared" : "separate", compute_only ? ", async compute" : "", (long long)score);
+	return score;
+};
+
+// --gpu / HOMEINVASION_GPU: a device index or part of its name. Only honoured if that device is usable
+static Result pick_physical_device(VulkanState *vk)
+{
+	uint32_t count = 0;
+	vkEnumeratePhysicalDevices(vk->_instance, &count, nullptr);
+
+	if (count == 0)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to find GPU support Vulkan\n");
+		return FAILURE;
+	};
+
+	VkPhysicalDevice physical_devices[count];
+	vkEnumeratePhysicalDevices(vk->_instance, &count, physical_devices);
+
+	const char *override = vk->_gpu_override != nullptr ? vk->_gpu_override : SDL_getenv("HOMEINVASION_GPU");
+	char *override_end = nullptr;
+	long override_index = override != nullptr ? SDL_strtol(override, &override_end, 10) : -1;
+	bool override_is_index = override != nullptr && override_end != override && *override_end == '\0';
+
+	vk->_physical_device = VK_NULL_HANDLE;
+	int64_t best_score = -1;
+	int32_t chosen = -1, overridden = -1;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physical_devices[i], &properties);
+		char report[256];
+		int64_t score = score_physical_device(vk, physical_devices[i], report, sizeof(report));
+		SDL_Log("GPU %u: %s, %s\n", i, properties.deviceName, report);
+		if (score < 0) continue;
+
+		if (override != nullptr && overridden < 0
+			&& (override_is_index ? override_index == (long)i : SDL_strcasestr(properties.deviceName, override) != nullptr))
+			overridden = (int32_t)i;
+		if (score > best_score)
+		{
+			best_score = score;
+			chosen = (int32_t)i;
+		};
+	};
+
+	if (chosen < 0)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "No usable GPU\n");
+		return FAILURE;
+	};
+	if (override != nullptr && overridden < 0)
+		SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "GPU override \"%s\" matches no usable device, ignored\n", override);
+	if (overridden >= 0) chosen = overridden;
+	vk->_physical_device = physical_devices[chosen];
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(vk->_physical_device, &properties);
+	SDL_Log("Choosen Physical Device: %s (GPU %d, %s)\n", properties.deviceName, chosen,
+			overridden >= 0 ? "override" : "highest score");
+
+	return SUCCESS;
+};
+
 static Result create_logical_device(VulkanState *vk)
 {
 	uint32_t graphic_queue_family;
@@ -180,14 +323,22 @@ static Result create_logical_device(VulkanState *vk)
 		SDL_LogError(SDL_LOG_CATEGORY_GPU, "No queue family with graphic support\n");
 		return FAILURE;
 	};
-	if (!find_present_queue_family(vk->_physical_device, vk->_surface, &present_queue_family))
+	// Prefer the graphics family when it can present, the swapchain images then never change family
+	VkBool32 shared_present = VK_FALSE;
+	vkGetPhysicalDeviceSurfaceSupportKHR(vk->_physical_device, graphic_queue_family, vk->_surface, &shared_present);
+	if (shared_present == VK_TRUE) present_queue_family = graphic_queue_family;
+	else if (!find_present_queue_family(vk->_physical_device, vk->_surface, &present_queue_family))
 	{
 		SDL_LogError(SDL_LOG_CATEGORY_GPU, "No present family with graphic support\n");
 		return FAILURE;
 	};
 
+	uint32_t compute_queue_family = graphic_queue_family;
+	vk->_async_compute = !vk->_no_async_compute && find_compute_queue_family(vk->_physical_device, &compute_queue_family);
+	if (!vk->_async_compute) compute_queue_family = graphic_queue_family;
+
 	float priority = 1.0f;
-	VkDeviceQueueCreateInfo queue_create_infos[2];
+	VkDeviceQueueCreateInfo queue_create_infos[3];
 	uint32_t queue_count = 0;
 	queue_create_infos[queue_count++] = (VkDeviceQueueCreateInfo){
 		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
@@ -204,7 +355,19 @@ static Result create_logical_device(VulkanState *vk)
 			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
 			.pQueuePriorities = &priority,
 			.queueCount = 1,
-			.queueFamilyIndex = graphic_queue_family,
+			.queueFamilyIndex = present_queue_family,
+			.pNext = nullptr,
+			.flags = 0
+		};
+	};
+
+	if (compute_queue_family != graphic_queue_family && compute_queue_family != present_queue_family)
+	{
+		queue_create_infos[queue_count++] = (VkDeviceQueueCreateInfo){
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.pQueuePriorities = &priority,
+			.queueCount = 1,
+			.queueFamilyIndex = compute_queue_family,
 			.pNext = nullptr,
 			.flags = 0
 		};
@@ -212,6 +375,7 @@ static Result create_logical_device(VulkanState *vk)
 
 	vk->_queue_indicies._graphics = graphic_queue_family;
 	vk->_queue_indicies._present = present_queue_family;
+	vk->_queue_indicies._compute = compute_queue_family;
 
 	VkDeviceCreateInfo device_create_info = {};
 	device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -224,8 +388,55 @@ static Result create_logical_device(VulkanState *vk)
 	uint32_t required_extensions_count = sizeof(required_extensions) / sizeof(required_extensions[0]);
 	
 	check_device_extension_support(vk->_physical_device, required_extensions, required_extensions_count);
-	device_create_info.ppEnabledExtensionNames = required_extensions;
-	device_create_info.enabledExtensionCount = required_extensions_count;
+
+	// Optional: pipelines fast-linked from precompiled parts, see create_graphics_pipeline_part
+	const char *library_extensions[] = {VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME};
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT library_features = {};
+	library_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	vk->_pipeline_library = false;
+	if (!vk->_no_pipeline_library && has_device_extensions(vk->_physical_device, library_extensions, 2))
+	{
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &library_features;
+		vkGetPhysicalDeviceFeatures2(vk->_physical_device, &supported);
+		vk->_pipeline_library = library_features.graphicsPipelineLibrary == VK_TRUE;
+	};
+
+	// Optional: when presents reach the display, see pacing.h
+	const char *present_extensions[] = {VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME};
+	VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {};
+	present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {};
+	present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	vk->_present_wait = false;
+	if (has_device_extensions(vk->_physical_device, present_extensions, 2))
+	{
+		present_id_features.pNext = &present_wait_features;
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &present_id_features;
+		vkGetPhysicalDeviceFeatures2(vk->_physical_device, &supported);
+		vk->_present_wait = present_id_features.presentId == VK_TRUE && present_wait_features.presentWait == VK_TRUE;
+	};
+
+	const char *extensions[5] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+	uint32_t extensions_count = 1;
+	if (vk->_pipeline_library)
+	{
+		extensions[extensions_count++] = library_extensions[0];
+		extensions[extensions_count++] = library_extensions[1];
+	};
+	if (vk->_present_wait)
+	{
+		extensions[extensions_count++] = present_extensions[0];
+		extensions[extensions_count++] = present_extensions[1];
+	};
+	device_create_info.ppEnabledExtensionNames = extensions;
+	device_create_info.enabledExtensionCount = extensions_count;
+	SDL_Log("Graphics pipeline library: %s\n", vk->_pipeline_library ? "yes" : "no");
+	SDL_Log("Present wait: %s\n", vk->_present_wait ? "yes" : "no");
+	SDL_Log("Async compute: %s\n", vk->_async_compute ? "yes" : "no");
 
 	// Use dynamic rendering instead of renderpass
 	// https://docs.vulkan.org/samples/latest/samples/extensions/dynamic_rendering/README.html
@@ -234,18 +445,41 @@ static Result create_logical_device(VulkanState *vk)
 	v13_features.dynamicRendering = VK_TRUE;
 	// https://docs.vulkan.org/guide/latest/extensions/VK_KHR_synchronization2.html
 	v13_features.synchronization2 = VK_TRUE;
+	// Optional feature structs are chained in front of the 1.3 ones
+	library_features.pNext = nullptr;
+	present_wait_features.pNext = nullptr;
+	if (vk->_present_wait)
+	{
+		present_id_features.pNext = &present_wait_features;
+		v13_features.pNext = &present_id_features;
+	};
+	if (vk->_pipeline_library)
+	{
+		library_features.pNext = v13_features.pNext;
+		v13_features.pNext = &library_features;
+	};
+
+	// GPU culling writes the number of draws, consumed by vkCmdDrawIndirectCount
+	VkPhysicalDeviceVulkan12Features v12_features = {};
+	v12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	v12_features.drawIndirectCount = VK_TRUE;
+	// Frames in flight on two queues are ordered by frame number, see vulkan_draw
+	v12_features.timelineSemaphore = VK_TRUE;
+	v12_features.pNext = &v13_features;
 
 	// Use DrawParameters feature of spirv 1.5
 	
 	VkPhysicalDeviceVulkan11Features v11_features = {};
 	v11_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
 	v11_features.shaderDrawParameters = VK_TRUE;
-	v11_features.pNext = &v13_features;
+	v11_features.pNext = &v12_features;
 
 	// VkPhysicalDeviceFeatures2 provide a pNext chain to enable features on the device.
-	// The features member of this structs is 1.0 features. No features needed for now
+	// The features member of this structs is 1.0 features.
 	VkPhysicalDeviceFeatures2 device_features = {};
 	device_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	// Particle vertex shader reads the storage buffers written by compute
+	device_features.features.vertexPipelineStoresAndAtomics = VK_TRUE;
 	device_features.pNext = &v11_features;
 	
 	// pEnabledFeatures is legacy. Use pNext chain to enable features
@@ -259,8 +493,12 @@ static Result create_logical_device(VulkanState *vk)
 		return FAILURE;
 	};
 
+	// Everything past this point calls the driver directly, see vkload.h
+	if (vk_load_device(vk->_device) != SUCCESS) return FAILURE;
+
 	vkGetDeviceQueue(vk->_device, graphic_queue_family, 0, &vk->_graphics_queue);
 	vkGetDeviceQueue(vk->_device, present_queue_family, 0, &vk->_present_queue);
+	vkGetDeviceQueue(vk->_device, compute_queue_family, 0, &vk->_compute_queue);
 
 	return SUCCESS;
 };
@@ -358,6 +596,9 @@ static Result create_swapchain(VulkanState *vk, SDL_Window *window)
 	create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
 	create_info.surface = vk->_surface;
 	create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// Screenshots and recording copy out of the swapchain image
+	vk->_swapchain_transfer_src = (surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+	if (vk->_swapchain_transfer_src) create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 	create_info.presentMode = present_mode;
 	create_info.imageExtent = extent;
 	create_info.imageFormat = surface_format.format;
@@ -430,12 +671,13 @@ static Result create_image_view(VulkanState *vk)
 static Result create_vulkan_instance(VulkanState *vk)
 {
 	uint32_t instanceVersion = VK_API_VERSION_1_0;
-	vkEnumerateInstanceVersion(&instanceVersion);
+	// Vulkan 1.0 loaders don't have it
+	if (vkEnumerateInstanceVersion != nullptr) vkEnumerateInstanceVersion(&instanceVersion);
 	SDL_LogInfo(SDL_LOG_CATEGORY_GPU,"Instance supported version: %u.%u.%u\n",
 		   VK_VERSION_MAJOR(instanceVersion),
 		   VK_VERSION_MINOR(instanceVersion),
 		   VK_VERSION_PATCH(instanceVersion));
-    show_available_instance_extensions();
+    if (SDL_GetLogPriority(SDL_LOG_CATEGORY_GPU) <= SDL_LOG_PRIORITY_VERBOSE) show_available_instance_extensions();
     VkApplicationInfo app_info = {};
     app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     app_info.pApplicationName = "Home Invasion";
@@ -522,6 +764,7 @@ static Result create_vulkan_instance(VulkanState *vk)
         SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create vulkan instance\n");
 		return FAILURE;
     };
+	vk_load_instance(vk->_instance);
 
 
     SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "# Created Vulkan Instance, version\n");
@@ -546,7 +789,19 @@ static Result init_sdl(AppState *app)
         return FAILURE;
 	};
 	
-	app->_window = SDL_CreateWindow("Test", 800, 600, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+	// No Vulkan loader on this machine, GLES is the only way to get a picture
+	if (app->_renderer == &vulkan_renderer && (!SDL_Vulkan_LoadLibrary(nullptr) || vk_load_loader() != SUCCESS))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Vulkan unavailable (%s), falling back to GLES\n", SDL_GetError());
+		app->_renderer = &gles_renderer;
+	};
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "# Renderer: %s\n", app->_renderer->_name);
+	return SUCCESS;
+};
+
+static Result create_window(AppState *app)
+{
+	app->_window = SDL_CreateWindow("Test", 800, 600, app->_renderer->_window_flags | SDL_WINDOW_RESIZABLE);
 
 	if (app->_window == nullptr)
 	{
@@ -571,43 +826,6 @@ static Result create_vulkan_surface(AppState *app)
 	return SUCCESS;
 };
 
-#include <stdio.h>
-static char *read_shader_file(const char *path, uint32_t *out_size)
-{
-	FILE *file = fopen(path, "rb");
-	if (!file) {SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "fopen\n");exit(0);};
-
-	size_t size = 0;
-	fseek(file, 0, SEEK_END);
-	size = ftell(file);
-
-	char *content = malloc(size);
-	fseek(file, 0, SEEK_SET);
-	fread(content, sizeof(char), size, file);
-
-	fclose(file);
-	*out_size = size;
-	return content;
-};
-
-VkShaderModule create_shader_module(VkDevice device, const char *src, size_t size)
-{
-	VkShaderModuleCreateInfo create_info = {};
-	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	create_info.pCode = (const uint32_t *)src;
-	create_info.codeSize = size;
-
-	VkShaderModule shader_module;
-
-	if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
-	{
-		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create shader module\n");
-		exit(0);
-	};
-
-	return shader_module;
-};
-
 // TODO: Make this as a fallback
 //If not using Dynamic Rendering, draw commands must be recorded within a render pass instance.
 //Each render pass instance defines a set of image resources,
@@ -616,102 +834,31 @@ VkShaderModule create_shader_module(VkDevice device, const char *src, size_t siz
 //{
 //};
 
-static Result create_graphics_pipeline(VulkanState *vk, const char *shader_path)
+static Result create_pipeline_cache(VulkanState *vk)
 {
-	uint32_t shader_size;
-	const char* shader_src = read_shader_file(shader_path, &shader_size);
-	vk->_shader_module = create_shader_module(vk->_device, shader_src, shader_size);
-
-	VkPipelineShaderStageCreateInfo shader_stage_create_info[2] = {0};
-	shader_stage_create_info[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shader_stage_create_info[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	shader_stage_create_info[0].module = vk->_shader_module;
-	shader_stage_create_info[0].pName = "vert_main" ;
-
-	shader_stage_create_info[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shader_stage_create_info[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	shader_stage_create_info[1].module = vk->_shader_module;
-	shader_stage_create_info[1].pName = "frag_main";
-
-	VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
-	vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-	VkPipelineInputAssemblyStateCreateInfo input_assembly_create_info = {};
-
-	input_assembly_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	input_assembly_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	input_assembly_create_info.primitiveRestartEnable = VK_FALSE;
-
-
+	VkPipelineCacheCreateInfo cache_create_info = {};
+	cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (vkCreatePipelineCache(vk->_device, &cache_create_info, nullptr, &vk->_pipeline_cache) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline cache\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
 
-	VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_VIEWPORT};
-	uint32_t dynamic_states_size = sizeof(dynamic_states) / sizeof(dynamic_states[0]);
-	VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {};
-	dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamic_state_create_info.pDynamicStates = dynamic_states;
-	dynamic_state_create_info.dynamicStateCount = dynamic_states_size;
-	
-	// With dynamic state, the actual viewport and scissor will be later set at drawing time
-	// Without dynamic state, they need to be set here, which makes them immutable - any changes needed require
-	// creating a new pipeline
-	// Can create multiple viewport and scissor on some GPU, need to enable in GPU features when creating
-	// logical device
-	VkPipelineViewportStateCreateInfo viewport_state_create_info = {};
-	viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewport_state_create_info.scissorCount = 1;
-	viewport_state_create_info.viewportCount = 1;
-
-	// # Rasterizer
-	// The rasterizer takes the geometry shaped by the vertices from the vertex shader
-	// and turns it into fragments to be colored by the fragment shader. 
-	// It also performs depth testing, face culling and the scissor test, and it can be
-	// configured to output fragments that fill entire polygons or just the edges (wireframe rendering)
-
-	VkPipelineRasterizationStateCreateInfo rasterizer_create_info = {};
-	rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer_create_info.depthClampEnable = VK_FALSE;
-	rasterizer_create_info.depthBiasSlopeFactor = 1.0f;
-	rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer_create_info.lineWidth = 1.0f;
-	rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizer_create_info.depthBiasEnable = VK_FALSE;
-
-	// # Multisampling
-	// Disable for now
-	VkPipelineMultisampleStateCreateInfo multisample_create_info = {};
-	multisample_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisample_create_info.sampleShadingEnable = VK_FALSE;
-	multisample_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-	// # Color blending
-	
-	// config per attched framebuffer
-	VkPipelineColorBlendAttachmentState colorblend_attachment = {};
-	colorblend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT
-		| VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
-		| VK_COLOR_COMPONENT_A_BIT;
-	// if false, new color from fragment shader is passed through unmodified.
-	// below is alpha-blending
-	// `	finalColor.rgb = newAlpha * newColor + (1 - newAlpha) * oldColor;
-	// `	finalColor.a = newAlpha.a
-	colorblend_attachment.blendEnable = VK_TRUE;
-	colorblend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorblend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	colorblend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorblend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorblend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-
-	VkPipelineColorBlendStateCreateInfo colorblend_state_create_info = {};
-	colorblend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	// If true, use bitwise combination of color, ignore the colorblend attachment above
-	colorblend_state_create_info.logicOpEnable = VK_FALSE;
-	colorblend_state_create_info.attachmentCount = 1;
-	colorblend_state_create_info.pAttachments = &colorblend_attachment;
+// Layout and variant table only, the variants themselves are compiled by build_triangle_pipelines
+static Result create_graphics_pipeline(AppState *app, const char *shader_name)
+{
+	VulkanState *vk = &app->_vk;
+	vk->_shader_module = load_shader_module(vk->_device, shader_name);
+	if (vk->_shader_module == VK_NULL_HANDLE) return FAILURE;
 
+	// Everything the scene shaders read comes from the frame ring, set 0, but the baked lighting, set 1
+	VkDescriptorSetLayout set_layouts[2] = {app->_ring._set_layout, app->_lightmap._set_layout};
 	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
 	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 2;
+	pipeline_layout_create_info.pSetLayouts = set_layouts;
 
 	if (vkCreatePipelineLayout(vk->_device, &pipeline_layout_create_info, nullptr, &vk->_pipeline_layout) != VK_SUCCESS)
 	{
@@ -719,39 +866,20 @@ static Result create_graphics_pipeline(VulkanState *vk, const char *shader_path)
 		return FAILURE;
 	};
 
-	// If use dynamic rendering, pass this to pNext of VkGraphicsPipelineCreateInfo and renderpass set to nullptr. This will specify the viewmask and
-	// color attachment info. If use a valid RenderPass, value of this structure is ignored
-	VkPipelineRenderingCreateInfo pipeline_rendering_create_info = {};
-	pipeline_rendering_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-	pipeline_rendering_create_info.colorAttachmentCount = 1;
-	pipeline_rendering_create_info.pColorAttachmentFormats = &vk->_swapchain_format;
-
-	VkGraphicsPipelineCreateInfo graphics_pipeline_create_info = {
-		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-		.pNext = &pipeline_rendering_create_info,
-		.stageCount = 2,
-		.pStages = shader_stage_create_info,
-		.pVertexInputState = &vertex_input_info,
-		.pInputAssemblyState = &input_assembly_create_info,
-		.pRasterizationState = &rasterizer_create_info,
-		.pColorBlendState = &colorblend_state_create_info,
-		.pMultisampleState = &multisample_create_info,
-		.pViewportState = &viewport_state_create_info,
-		.pDynamicState = &dynamic_state_create_info,
-		.renderPass = nullptr,
-		.layout = vk->_pipeline_layout,
-		.basePipelineHandle = VK_NULL_HANDLE,
-		.basePipelineIndex = -1,
-	};
-
-
-	if (vkCreateGraphicsPipelines(vk->_device, VK_NULL_HANDLE, 1, &graphics_pipeline_create_info, nullptr, &vk->_graphics_pipeline) != VK_SUCCESS)
-	{
-		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create graphics pipeline\n");
+	if (pipeline_variants_init(&app->_variants, vk->_device, vk->_pipeline_cache, vk->_pipeline_library) != SUCCESS)
 		return FAILURE;
-	};
 
-	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Created Graphics Pipeline\n");
+	app->_triangle_desc = (PipelineDesc){
+		._module = vk->_shader_module,
+		._vert_entry = "vert_main",
+		._frag_entry = "frag_main",
+		._layout = vk->_pipeline_layout,
+		._color_format = vk->_swapchain_format,
+		._topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		._cull_mode = VK_CULL_MODE_BACK_BIT,
+		._blend = PIPELINE_BLEND_ALPHA,
+		._features = PIPELINE_FEATURE_LIGHTING,
+	};
 	return SUCCESS;
 };
 
@@ -768,6 +896,13 @@ static Result create_command_pool(VulkanState *vk)
 		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create command pool\n");
 		return FAILURE;
 	};
+
+	cmdpool_create_info.queueFamilyIndex = vk->_queue_indicies._compute;
+	if (vk->_async_compute && vkCreateCommandPool(vk->_device, &cmdpool_create_info, nullptr, &vk->_compute_commandpool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create compute command pool\n");
+		return FAILURE;
+	};
 	
 	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Created Command pool\n");
 	return SUCCESS;
@@ -781,129 +916,357 @@ static Result create_command_buffer(VulkanState *vk)
 	cmdbuffer_create_info.commandPool = vk->_commandpool;
 	cmdbuffer_create_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 	
-	if (vkAllocateCommandBuffers(vk->_device, &cmdbuffer_create_info, vk->_commandbuffers) != VK_SUCCESS)
+	if (vkAllocateCommandBuffers(vk->_device, &cmdbuffer_create_info, vk->_commandbuffers) != VK_SUCCESS
+		|| vkAllocateCommandBuffers(vk->_device, &cmdbuffer_create_info, vk->_output_commandbuffers) != VK_SUCCESS)
 	{
 		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate command buffer\n");
 		return FAILURE;
 	};
+
+	cmdbuffer_create_info.commandPool = vk->_compute_commandpool;
+	if (vk->_async_compute && vkAllocateCommandBuffers(vk->_device, &cmdbuffer_create_info, vk->_compute_commandbuffers) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate compute command buffer\n");
+		return FAILURE;
+	};
 	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Allocated command buffer\n");
 	
 	return SUCCESS;
 };
 
-static void transition_image_layout(VulkanState *vk,
-		uint32_t image_idx,
-		VkImageLayout old_layout,
-		VkImageLayout new_layout,
-		VkAccessFlags2 src_access_mask,
-		VkAccessFlags2 dst_access_mask,
-		VkPipelineStageFlags2 src_stage_mask,
-		VkPipelineStageFlags2 dst_stage_mask)
-{
-	VkImageMemoryBarrier2 img_memory_barrier = {};
-	img_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
-	img_memory_barrier.srcStageMask = src_stage_mask;
-	img_memory_barrier.dstStageMask = dst_stage_mask;
-	img_memory_barrier.srcAccessMask = src_access_mask;
-	img_memory_barrier.dstAccessMask = dst_access_mask;
-	img_memory_barrier.oldLayout = old_layout;
-	img_memory_barrier.newLayout = new_layout;
-	img_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	img_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	img_memory_barrier.image = vk->_swapchain_images[image_idx];
-	img_memory_barrier.subresourceRange = (VkImageSubresourceRange){
-		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-		.baseMipLevel = 0,
-		.levelCount = 1,
-		.layerCount = 1,
-		.baseArrayLayer = 0
-	};
-
-	VkDependencyInfo dependency_info = {};
-	dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-	dependency_info.imageMemoryBarrierCount = 1;
-	dependency_info.pImageMemoryBarriers = &img_memory_barrier;
-
-	vkCmdPipelineBarrier2(vk->_commandbuffers[vk->_current_frame], &dependency_info);
-};
-static void record_command_buffer(VulkanState *vk, uint32_t image_idx)
+// Timestamps are only compared with ones of the same frame, on either queue
+static Result create_gpu_times(VulkanState *vk)
 {
-	VkCommandBuffer cmdbuffer = vk->_commandbuffers[vk->_current_frame];
+	GpuTimes *times = &vk->_gpu_times;
+	*times = (GpuTimes){};
+
+	uint32_t count;
+	vkGetPhysicalDeviceQueueFamilyProperties(vk->_physical_device, &count, nullptr);
+	VkQueueFamilyProperties families[count];
+	vkGetPhysicalDeviceQueueFamilyProperties(vk->_physical_device, &count, families);
+	if (families[vk->_queue_indicies._graphics].timestampValidBits == 0
+		|| families[vk->_queue_indicies._compute].timestampValidBits == 0)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "No timestamp support, GPU times are off\n");
+		return SUCCESS;
+	};
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(vk->_physical_device, &properties);
+	times->_period_ns = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	pool_create_info.queryCount = MAX_FRAMES_IN_FLIGHT * GPU_TIMESTAMPS_PER_FRAME;
+	if (vkCreateQueryPool(vk->_device, &pool_create_info, nullptr, &times->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create timestamp query pool\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+static void write_timestamp(VulkanState *vk, VkCommandBuffer cmdbuffer, GpuTimestamp timestamp, VkPipelineStageFlags2 stage)
+{
+	GpuTimes *times = &vk->_gpu_times;
+	if (times->_pool == VK_NULL_HANDLE) return;
+	uint32_t query = vk->_current_frame * GPU_TIMESTAMPS_PER_FRAME + timestamp;
+	vkCmdResetQueryPool(cmdbuffer, times->_pool, query, 1);
+	vkCmdWriteTimestamp2(cmdbuffer, stage, times->_pool, query);
+	times->_written[vk->_current_frame] |= 1u << timestamp;
+};
+
+// Called once the fence of the current frame slot has signaled, its queries are all available
+static void read_gpu_times(VulkanState *vk)
+{
+	constexpr uint32_t LOG_FRAMES = 600;
+	constexpr uint32_t GRAPHICS = 1u << GPU_TIMESTAMP_GRAPHICS_BEGIN | 1u << GPU_TIMESTAMP_CCTV_END
+		| 1u << GPU_TIMESTAMP_SCENE_END | 1u << GPU_TIMESTAMP_GRAPHICS_END;
+	constexpr uint32_t COMPUTE = 1u << GPU_TIMESTAMP_COMPUTE_BEGIN | 1u << GPU_TIMESTAMP_COMPUTE_END;
+	GpuTimes *times = &vk->_gpu_times;
+	uint32_t written = times->_written[vk->_current_frame];
+	times->_written[vk->_current_frame] = 0;
+	times->_scene_ns = 0;
+	if ((written & GRAPHICS) != GRAPHICS) return;
+
+	uint64_t values[GPU_TIMESTAMPS_PER_FRAME];
+	uint32_t first = vk->_current_frame * GPU_TIMESTAMPS_PER_FRAME;
+	uint32_t count = (written & COMPUTE) == COMPUTE ? GPU_TIMESTAMPS_PER_FRAME : GPU_TIMESTAMP_COMPUTE_BEGIN;
+	if (vkGetQueryPoolResults(vk->_device, times->_pool, first, count, sizeof(values), values, sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	uint64_t graphics_begin = values[GPU_TIMESTAMP_GRAPHICS_BEGIN], graphics_end = values[GPU_TIMESTAMP_GRAPHICS_END];
+	times->_graphics_ns += (uint64_t)((double)(graphics_end - graphics_begin) * times->_period_ns);
+	times->_scene_ns = (uint64_t)((double)(values[GPU_TIMESTAMP_SCENE_END] - graphics_begin) * times->_period_ns);
+	times->_frame_ns = (uint64_t)((double)(graphics_end - graphics_begin) * times->_period_ns);
+	times->_cctv_ns += (uint64_t)((double)(values[GPU_TIMESTAMP_CCTV_END] - graphics_begin) * times->_period_ns);
+	if (count == GPU_TIMESTAMPS_PER_FRAME)
+	{
+		uint64_t compute_begin = values[GPU_TIMESTAMP_COMPUTE_BEGIN], compute_end = values[GPU_TIMESTAMP_COMPUTE_END];
+		times->_compute_ns += (uint64_t)((double)(compute_end - compute_begin) * times->_period_ns);
+		uint64_t overlap_begin = SDL_max(graphics_begin, compute_begin), overlap_end = SDL_min(graphics_end, compute_end);
+		if (overlap_end > overlap_begin) times->_overlap_ns += (uint64_t)((double)(overlap_end - overlap_begin) * times->_period_ns);
+	};
+
+	if (++times->_frames < LOG_FRAMES) return;
+	double frames = (double)times->_frames * (double)SDL_NS_PER_MS;
+	SDL_LogDebug(SDL_LOG_CATEGORY_GPU, "GPU per frame: graphics %.3f ms (security cameras %.3f ms), compute %.3f ms, %.3f ms of it overlapped\n",
+			(double)times->_graphics_ns / frames, (double)times->_cctv_ns / frames, (double)times->_compute_ns / frames,
+			(double)times->_overlap_ns / frames);
+	times->_graphics_ns = times->_compute_ns = times->_overlap_ns = times->_cctv_ns = 0;
+	times->_frames = 0;
+};
+
+// Async compute: the particle update goes to the compute queue before the graphics submit of the same frame
+static void submit_compute(AppState *app, float dt)
+{
+	VulkanState *vk = &app->_vk;
+	VkCommandBuffer cmdbuffer = vk->_compute_commandbuffers[vk->_current_frame];
 
 	VkCommandBufferBeginInfo cmdbuffer_begin_info = {};
 	cmdbuffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	vkBeginCommandBuffer(cmdbuffer, &cmdbuffer_begin_info);
+	write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_COMPUTE_BEGIN, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
+	particles_record_update(&app->_particles, vk, cmdbuffer, dt);
+	write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_COMPUTE_END, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+	vkEndCommandBuffer(cmdbuffer);
 
-	//Before rendering, transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL
-	
-	transition_image_layout(vk, image_idx,
-			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_ACCESS_2_NONE, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+	// The last graphics submit still draws the particles this rewrites
+	VkSemaphoreSubmitInfo wait_smps_submit_info = {};
+	wait_smps_submit_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	wait_smps_submit_info.semaphore = vk->_graphics_timeline;
+	wait_smps_submit_info.value = vk->_graphics_value;
+	wait_smps_submit_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+	VkSemaphoreSubmitInfo signal_smps_submit_info = {};
+	signal_smps_submit_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	signal_smps_submit_info.semaphore = vk->_compute_timeline;
+	signal_smps_submit_info.value = ++vk->_compute_value;
+	signal_smps_submit_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+	VkCommandBufferSubmitInfo cmd_submit_info = {};
+	cmd_submit_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	cmd_submit_info.commandBuffer = cmdbuffer;
+
+	VkSubmitInfo2 submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submit_info.waitSemaphoreInfoCount = vk->_graphics_value > 0 ? 1 : 0;
+	submit_info.pWaitSemaphoreInfos = &wait_smps_submit_info;
+	submit_info.signalSemaphoreInfoCount = 1;
+	submit_info.pSignalSemaphoreInfos = &signal_smps_submit_info;
+	submit_info.commandBufferInfoCount = 1;
+	submit_info.pCommandBufferInfos = &cmd_submit_info;
+	vkQueueSubmit2(vk->_compute_queue, 1, &submit_info, VK_NULL_HANDLE);
+};
+
+// One view of the scene into area of target (COLOR_ATTACHMENT_OPTIMAL). Sprites are culled again
+// for every view, so this is called outside of rendering. The monitors are only in the main view,
+// cameras filming monitors would read the atlas they render into. So is the fog, cameras see
+// what they film whatever the player sees
+static void record_view(AppState *app, VkCommandBuffer cmdbuffer, const float4 view, VkImageView target, VkRect2D area,
+		float time, bool main_view)
+{
+	VulkanState *vk = &app->_vk;
+	sprites_record_cull(&app->_sprites, cmdbuffer, view);
 
 	VkClearValue clear_color = {};
 	clear_color.color = (VkClearColorValue){0.0f, 0.0f, 0.0f, 1.0f};
 	VkRenderingAttachmentInfo rendering_attachment_info = {};
 	rendering_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	rendering_attachment_info.imageView = vk->_swapchain_imageviews[image_idx];
+	rendering_attachment_info.imageView = target;
 	rendering_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	// Only clears the render area, the other atlas tiles are kept
 	rendering_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	rendering_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	rendering_attachment_info.clearValue = clear_color;
 
 	VkRenderingInfo rendering_info = {};
 	rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-	rendering_info.renderArea = (VkRect2D){.offset = {0, 0}, .extent = vk->_swapchain_extent};
+	rendering_info.renderArea = area;
 	rendering_info.layerCount = 1;
 	rendering_info.colorAttachmentCount = 1;
 	rendering_info.pColorAttachments = &rendering_attachment_info;
 
 	vkCmdBeginRendering(cmdbuffer, &rendering_info);
 
-	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->_graphics_pipeline);
+	VkPipeline triangle_pipeline = pipeline_variant_get(&app->_variants, &app->_triangle_desc);
 
 	VkViewport viewport = {};
-	viewport.x = 0;
-	viewport.y = 0;
-	viewport.width = (float)vk->_swapchain_extent.width;
-	viewport.height = (float)vk->_swapchain_extent.height;
+	viewport.x = (float)area.offset.x;
+	viewport.y = (float)area.offset.y;
+	viewport.width = (float)area.extent.width;
+	viewport.height = (float)area.extent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 
-	VkRect2D scissor = {};
-	scissor.offset = (VkOffset2D){0, 0};
-	scissor.extent = vk->_swapchain_extent;
+	VkRect2D scissor = area;
 	vkCmdSetViewport(cmdbuffer, 0, 1, &viewport);
 	vkCmdSetScissor(cmdbuffer, 0, 1, &scissor);
 
-	vkCmdDraw(cmdbuffer, 3, 1, 0, 0);
-
+	// Frame data and lights once per view, draw data per draw, all through the ring
+	uint32_t offsets[FRAME_RING_BINDINGS];
+	FrameData frame = {};
+	SDL_memcpy(frame._view, view, sizeof(float4));
+	frame._time = time;
+	frame._lights_count = app->_frame_lights_count;
+	lightmap_transform(&app->_lightmap, frame._lightmap);
+	offsets[FRAME_RING_FRAME] = frame_ring_push(&app->_ring, &frame, sizeof(frame));
+	offsets[FRAME_RING_LISTS] = frame_ring_push(&app->_ring, app->_frame_lights, app->_frame_lights_count * sizeof(FrameLight));
+	DrawData draw = {._transform = {0.0f, 0.0f, 1.0f, 1.0f}, ._tint = {1.0f, 1.0f, 1.0f, 1.0f}};
+	offsets[FRAME_RING_DRAW] = frame_ring_push(&app->_ring, &draw, sizeof(draw));
+	bool ring_full = offsets[FRAME_RING_FRAME] == UINT32_MAX || offsets[FRAME_RING_LISTS] == UINT32_MAX
+		|| offsets[FRAME_RING_DRAW] == UINT32_MAX;
+
+	if (triangle_pipeline != VK_NULL_HANDLE && !ring_full)
+	{
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, triangle_pipeline);
+		vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->_pipeline_layout, 0, 1, &app->_ring._set,
+				FRAME_RING_BINDINGS, offsets);
+		vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->_pipeline_layout, 1, 1, &app->_lightmap._set,
+				0, nullptr);
+		vkCmdDraw(cmdbuffer, 3, 1, 0, 0);
+	};
+	decals_record_draw(&app->_decals, cmdbuffer, view);
+	sprites_record_draw(&app->_sprites, cmdbuffer, view);
+	if (main_view) cctv_record_monitors(&app->_cctv, cmdbuffer, view, time);
+	particles_record_draw(&app->_particles, cmdbuffer, view);
+	if (main_view) fog_record_draw(&app->_fog, cmdbuffer, view);
 
 	vkCmdEndRendering(cmdbuffer);
-	//After drawing, transition the image back to PRESENT_SRC
-	
-	transition_image_layout(vk, image_idx,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_2_NONE,
-			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
-
-	vkEndCommandBuffer(cmdbuffer);
-
 };
 
-static Result create_sync_objects(VulkanState *vk)
+// The scene, into the offscreen target at the scaled resolution. Doesn't touch the swapchain image,
+// so it doesn't wait for the acquire and its GPU time is only the scene's
+static void record_command_buffer(AppState *app, float dt)
 {
-	VkSemaphoreCreateInfo smp_create_info = {};
-	smp_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	VulkanState *vk = &app->_vk;
+	ResolutionScaler *rs = &app->_resolution;
+	Cctv *cctv = &app->_cctv;
+	VkCommandBuffer cmdbuffer = vk->_commandbuffers[vk->_current_frame];
 
-	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	VkCommandBufferBeginInfo cmdbuffer_begin_info = {};
+	cmdbuffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	vkBeginCommandBuffer(cmdbuffer, &cmdbuffer_begin_info);
+	write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_GRAPHICS_BEGIN, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT);
+
+	// The loading screen is only a clear, done by the output pass
+	if (!app->_loaded)
 	{
-		if (vkCreateSemaphore(vk->_device, &smp_create_info,
-			nullptr, &vk->_smps_present_complete[i]) != VK_SUCCESS)
+		write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_CCTV_END, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+		write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_SCENE_END, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+		vkEndCommandBuffer(cmdbuffer);
+		return;
+	};
+
+	// Compute work can't be recorded inside dynamic rendering
+	if (!vk->_async_compute) particles_record_update(&app->_particles, vk, cmdbuffer, dt);
+	particles_record_draw_acquire(&app->_particles, vk, cmdbuffer);
+	lightmap_record_upload(&app->_lightmap, cmdbuffer);
+	sdf_record(&app->_sdf, cmdbuffer, vk->_current_frame);
+	decals_record_stamp(&app->_decals, cmdbuffer, vk->_current_frame);
+	fog_record_mask(&app->_fog, cmdbuffer, vk->_current_frame);
+	float time = (float)(SDL_GetTicksNS() - app->_start_ns) / (float)SDL_NS_PER_SECOND;
+
+	// This frame's share of the security cameras, before the main view that shows them
+	if (cctv->_scheduled_count > 0)
+	{
+		cctv_record_begin(cctv, cmdbuffer);
+		for (uint32_t i = 0; i < cctv->_scheduled_count; i++)
 		{
-			SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create present semaphore\n");
-			return FAILURE;
+			uint32_t camera = cctv->_scheduled[i];
+			record_view(app, cmdbuffer, cctv->_cameras[camera]._view, cctv->_atlas_view, cctv_tile(cctv, camera), time, false);
 		};
+		cctv_record_end(cctv, cmdbuffer);
+	};
+	write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_CCTV_END, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+
+	// Contents are discarded, last frame's post-processing may still be reading it
+	image_barrier(cmdbuffer, rs->_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+	record_view(app, cmdbuffer, app->_sprites._view, rs->_view, (VkRect2D){.offset = {0, 0}, .extent = rs->_extent}, time, true);
+	particles_record_draw_release(&app->_particles, vk, cmdbuffer);
+
+	image_barrier(cmdbuffer, rs->_image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	// Post-processing scales with the scene, so it counts towards its time
+	post_record(&app->_post, cmdbuffer, rs->_extent, time);
+	// What the resolution controller measures
+	write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_SCENE_END, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+	vkEndCommandBuffer(cmdbuffer);
+};
+
+// Upscale into the swapchain image, or the loading screen. Costs the same at any scene resolution
+static void record_output_command_buffer(AppState *app, uint32_t image_idx)
+{
+	VulkanState *vk = &app->_vk;
+	VkCommandBuffer cmdbuffer = vk->_output_commandbuffers[vk->_current_frame];
+	VkImage image = vk->_swapchain_images[image_idx];
+
+	VkCommandBufferBeginInfo cmdbuffer_begin_info = {};
+	cmdbuffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	vkBeginCommandBuffer(cmdbuffer, &cmdbuffer_begin_info);
+
+	//Before rendering, transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL
+	image_barrier(cmdbuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+	if (app->_loaded) resolution_record_upscale(&app->_resolution, cmdbuffer, vk->_swapchain_imageviews[image_idx], vk->_swapchain_extent);
+	else
+	{
+		// Loading screen: a slow pulse, nothing else is drawn until the pipelines are in
+		float pulse = 0.06f + 0.04f * SDL_sinf((float)SDL_GetTicks() * 0.004f);
+		VkRenderingAttachmentInfo rendering_attachment_info = {};
+		rendering_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		rendering_attachment_info.imageView = vk->_swapchain_imageviews[image_idx];
+		rendering_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		rendering_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		rendering_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		rendering_attachment_info.clearValue.color = (VkClearColorValue){pulse, pulse, pulse, 1.0f};
+
+		VkRenderingInfo rendering_info = {};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		rendering_info.renderArea = (VkRect2D){.offset = {0, 0}, .extent = vk->_swapchain_extent};
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments = &rendering_attachment_info;
+		vkCmdBeginRendering(cmdbuffer, &rendering_info);
+		vkCmdEndRendering(cmdbuffer);
+	};
+
+	// Screenshot or recorded frame: a copy into the capture ring, read once this slot's fence signaled
+	if (app->_loaded && vk->_swapchain_transfer_src
+		&& capture_record(&app->_capture, vk, cmdbuffer, image, vk->_swapchain_extent, vk->_swapchain_format, vk->_current_frame))
+	{
+		image_barrier(cmdbuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+				VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, VK_ACCESS_2_NONE);
+	}
+	else
+	{
+		//After drawing, transition the image back to PRESENT_SRC
+		image_barrier(cmdbuffer, image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, VK_ACCESS_2_NONE);
+	};
+
+	write_timestamp(vk, cmdbuffer, GPU_TIMESTAMP_GRAPHICS_END, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+	vkEndCommandBuffer(cmdbuffer);
+};
+
+// One per swapchain image, made again when the swapchain is recreated with another image count
+static Result create_render_semaphores(VulkanState *vk)
+{
+	VkSemaphoreCreateInfo smp_create_info = {};
+	smp_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	vk->_smps_render_complete = calloc(vk->_swapchain_images_count, sizeof(VkSemaphore));
+	if (vk->_smps_render_complete == nullptr) return FAILURE;
+	for (uint32_t i = 0; i < vk->_swapchain_images_count; i++)
+	{
 		if (vkCreateSemaphore(vk->_device, &smp_create_info,
 			nullptr, &vk->_smps_render_complete[i]) != VK_SUCCESS)
 		{
@@ -911,11 +1274,57 @@ static Result create_sync_objects(VulkanState *vk)
 			return FAILURE;
 		};
 	};
+	return SUCCESS;
+};
+
+// Before the image count changes
+static void destroy_render_semaphores(VulkanState *vk)
+{
+	for (uint32_t i = 0; i < vk->_swapchain_images_count && vk->_smps_render_complete != nullptr; i++)
+	{
+		vkDestroySemaphore(vk->_device, vk->_smps_render_complete[i], nullptr);
+	};
+	free(vk->_smps_render_complete);
+	vk->_smps_render_complete = nullptr;
+};
+
+static Result create_sync_objects(VulkanState *vk)
+{
+	VkSemaphoreCreateInfo smp_create_info = {};
+	smp_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (vkCreateSemaphore(vk->_device, &smp_create_info,
+			nullptr, &vk->_smps_present_complete[i]) != VK_SUCCESS)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create present semaphore\n");
+			return FAILURE;
+		};
+	};
+
+	if (create_render_semaphores(vk) != SUCCESS) return FAILURE;
+
+	VkSemaphoreTypeCreateInfo timeline_create_info = {};
+	timeline_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timeline_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timeline_create_info.initialValue = 0;
+	smp_create_info.pNext = &timeline_create_info;
+	if (vkCreateSemaphore(vk->_device, &smp_create_info, nullptr, &vk->_graphics_timeline) != VK_SUCCESS
+		|| vkCreateSemaphore(vk->_device, &smp_create_info, nullptr, &vk->_compute_timeline) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create timeline semaphores\n");
+		return FAILURE;
+	};
+	vk->_graphics_value = 0;
+	vk->_compute_value = 0;
 	
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		VkFenceCreateInfo fence_create_info = {};
 		fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		// Nothing to wait for the first time a frame slot is used
+		fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 		if (vkCreateFence(vk->_device, &fence_create_info, nullptr, &vk->_fences_draw[i]) != VK_SUCCESS)
 		{
 			SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create fence for drawing\n");
@@ -926,6 +1335,23 @@ static Result create_sync_objects(VulkanState *vk)
 	return SUCCESS;
 };
 
+// The swapchain may come back with another image count, both arrays follow it
+static Result get_swapchain_images(VulkanState *vk)
+{
+	vkGetSwapchainImagesKHR(vk->_device, vk->_swapchain, &vk->_swapchain_images_count, nullptr);
+	free(vk->_swapchain_images);
+	free(vk->_swapchain_imageviews);
+	vk->_swapchain_images = calloc(vk->_swapchain_images_count, sizeof(VkImage));
+	vk->_swapchain_imageviews = calloc(vk->_swapchain_images_count, sizeof(VkImageView));
+	if (vk->_swapchain_images == nullptr || vk->_swapchain_imageviews == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate swapchain images\n");
+		return FAILURE;
+	};
+	vkGetSwapchainImagesKHR(vk->_device, vk->_swapchain, &vk->_swapchain_images_count, vk->_swapchain_images);
+	return SUCCESS;
+};
+
 static void cleanup_swapchain(VkDevice device, VkSwapchainKHR swapchain, uint32_t imageview_count, VkImageView* imageviews)
 {
 	for (uint32_t i = 0; i < imageview_count; i++)
@@ -936,53 +1362,492 @@ static void cleanup_swapchain(VkDevice device, VkSwapchainKHR swapchain, uint32_
 	vkDestroySwapchainKHR(device, swapchain,nullptr);
 };
 
-static void recreate_swapchain(VulkanState* vk, SDL_Window* window)
+// Post-processing reads the scene target and the upscale reads the post output
+static Result resize_post(AppState *app)
+{
+	ResolutionScaler *rs = &app->_resolution;
+	if (post_resize(&app->_post, &app->_vk, rs->_target_extent, rs->_view) != SUCCESS) return FAILURE;
+	resolution_set_source(rs, &app->_vk, app->_post._output_view);
+	return SUCCESS;
+};
+
+static void recreate_swapchain(AppState *app)
 {
+	VulkanState *vk = &app->_vk;
 	vkDeviceWaitIdle(vk->_device);
+	// The ring is sized for the old extent
+	capture_flush(&app->_capture, vk);
+	pacing_detach(&app->_pacer);
 	
+	destroy_render_semaphores(vk);
 	cleanup_swapchain(vk->_device, vk->_swapchain, vk->_swapchain_images_count, vk->_swapchain_imageviews);
-	create_swapchain(vk, window);
-	vkGetSwapchainImagesKHR(vk->_device, vk->_swapchain, &vk->_swapchain_images_count, vk->_swapchain_images);
+	create_swapchain(vk, app->_window);
+	pacing_attach(&app->_pacer, vk->_swapchain);
+	get_swapchain_images(vk);
 	create_image_view(vk);
+	create_render_semaphores(vk);
+	resolution_resize(&app->_resolution, vk);
+	resize_post(app);
 };
-Result app_init(AppState *app)
+static Result reload_triangle(void *user, const char *spv_path)
 {
-	if (init_sdl(app) != SUCCESS) return FAILURE;
-	if (create_vulkan_instance(&app->_vk) != SUCCESS) return FAILURE;
+	AppState *app = user;
+	app->_pending_shader_module = load_shader_module_file(app->_vk._device, spv_path);
+
+	// Only the variant in use is rebuilt here, the others come back on demand
+	PipelineDesc desc = app->_triangle_desc;
+	desc._module = app->_pending_shader_module;
+	if (app->_pending_shader_module == VK_NULL_HANDLE
+		|| create_graphics_pipeline_desc(app->_vk._device, app->_variants._cache, &desc,
+			&app->_pending_graphics_pipeline) != SUCCESS)
+	{
+		vkDestroyShaderModule(app->_vk._device, app->_pending_shader_module, nullptr);
+		app->_pending_shader_module = VK_NULL_HANDLE;
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+static void swap_triangle(void *user)
+{
+	AppState *app = user;
+	pipeline_variants_evict_module(&app->_variants, app->_vk._shader_module);
+	vkDestroyShaderModule(app->_vk._device, app->_vk._shader_module, nullptr);
+	app->_vk._shader_module = app->_pending_shader_module;
+	app->_triangle_desc._module = app->_pending_shader_module;
+	pipeline_variant_insert(&app->_variants, &app->_triangle_desc, app->_pending_graphics_pipeline);
+	app->_pending_graphics_pipeline = VK_NULL_HANDLE;
+	app->_pending_shader_module = VK_NULL_HANDLE;
+};
+
+static Result reload_particles(void *user, const char *spv_path)
+{
+	AppState *app = user;
+	return particles_reload(&app->_particles, &app->_vk, spv_path);
+};
+
+static void swap_particles(void *user)
+{
+	AppState *app = user;
+	particles_swap(&app->_particles, &app->_vk);
+};
+
+static Result reload_sprites(void *user, const char *spv_path)
+{
+	AppState *app = user;
+	return sprites_reload(&app->_sprites, &app->_vk, spv_path);
+};
+
+static void swap_sprites(void *user)
+{
+	AppState *app = user;
+	sprites_swap(&app->_sprites, &app->_vk);
+};
+
+static void start_hot_reload(AppState *app)
+{
+	static const char *const triangle_entries[] = {"vert_main", "frag_main"};
+	static const char *const particles_entries[] = {
+		"init_main", "begin_main", "emit_main", "prepare_main", "simulate_main", "vert_main", "frag_main"};
+	static const char *const sprites_entries[] = {"cull_main", "build_main", "vert_main", "frag_main"};
+
+	// The source tree's, whatever directory the game was started from
+	hotreload_init(&app->_hotreload, GAMEPATH "/shader");
+	hotreload_watch(&app->_hotreload, "test1.slang", "slang_compiled.spv", triangle_entries, 2,
+			reload_triangle, swap_triangle, app);
+	hotreload_watch(&app->_hotreload, "particles.slang", "particles.spv", particles_entries, 7,
+			reload_particles, swap_particles, app);
+	hotreload_watch(&app->_hotreload, "sprites.slang", "sprites.spv", sprites_entries, 4,
+			reload_sprites, swap_sprites, app);
+	hotreload_start(&app->_hotreload);
+};
+
+static Result build_triangle_pipelines(AppState *app)
+{
+	// Every variant the lighting toggle can ask for
+	PipelineDesc variants[2] = {app->_triangle_desc, app->_triangle_desc};
+	variants[1]._features = 0;
+	return pipeline_variants_prewarm(&app->_variants, variants, 2);
+};
+
+static Result build_particle_pipelines(AppState *app)
+{
+	return particles_build(&app->_particles, &app->_vk, "particles.spv");
+};
+
+static Result build_sprite_pipelines(AppState *app)
+{
+	return sprites_build(&app->_sprites, &app->_vk, "sprites.spv");
+};
+
+static Result build_upscale_pipeline(AppState *app)
+{
+	return resolution_build(&app->_resolution, &app->_vk, "upscale.spv");
+};
+
+static Result build_post_pipelines(AppState *app)
+{
+	return post_build(&app->_post, &app->_vk, "post.spv");
+};
+
+static Result build_cctv_pipeline(AppState *app)
+{
+	return cctv_build(&app->_cctv, &app->_vk, "cctv.spv");
+};
+
+static Result build_sdf_pipelines(AppState *app)
+{
+	if (!app->_house) return SUCCESS;
+	return sdf_build(&app->_sdf, &app->_vk, "sdf.spv");
+};
+
+static Result build_decal_pipelines(AppState *app)
+{
+	if (!app->_house) return SUCCESS;
+	return decals_build(&app->_decals, &app->_vk, "decals.spv", app->_vk._swapchain_format);
+};
+
+static Result build_fog_pipelines(AppState *app)
+{
+	if (!app->_house) return SUCCESS;
+	return fog_build(&app->_fog, &app->_vk, "fog.spv", app->_vk._swapchain_format);
+};
+
+// Phases can start on any thread, each one takes its own slot
+static uint32_t startup_phase_begin(AppState *app, const char *name, bool worker)
+{
+	uint32_t idx = (uint32_t)SDL_AddAtomicInt(&app->_phases_count, 1);
+	if (idx >= STARTUP_MAX_PHASES) return UINT32_MAX;
+	app->_phases[idx] = (StartupPhase){._name = name, ._begin_ns = SDL_GetTicksNS(), ._worker = worker};
+	return idx;
+};
+
+static void startup_phase_end(AppState *app, uint32_t idx)
+{
+	if (idx != UINT32_MAX) app->_phases[idx]._end_ns = SDL_GetTicksNS();
+};
+
+static double startup_ms(const AppState *app, uint64_t ns)
+{
+	return (double)(ns - app->_start_ns) / (double)SDL_NS_PER_MS;
+};
+
+static void report_startup(const AppState *app)
+{
+	uint32_t count = SDL_min((uint32_t)SDL_GetAtomicInt((SDL_AtomicInt *)&app->_phases_count), STARTUP_MAX_PHASES);
+	uint64_t total_ns = 0;
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "# Startup\n");
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const StartupPhase *phase = &app->_phases[i];
+		total_ns += phase->_end_ns - phase->_begin_ns;
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%-32s at %8.1f ms, %8.1f ms on %s\n", phase->_name,
+				startup_ms(app, phase->_begin_ns), (double)(phase->_end_ns - phase->_begin_ns) / (double)SDL_NS_PER_MS,
+				phase->_worker ? "worker" : "main");
+	};
+	// Sum over wall time is how much of the work overlapped
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "First frame %.1f ms, ready %.1f ms, phases sum to %.1f ms, %u loading frames\n",
+			startup_ms(app, app->_first_frame_ns), startup_ms(app, app->_ready_ns),
+			(double)total_ns / (double)SDL_NS_PER_MS, app->_loading_frames);
+};
+
+typedef struct
+{
+	const char *_name;
+	Result (*_build)(AppState *app);
+} StartupTask;
+
+// Compiled in parallel on the workers, frames show a loading screen until all of them are done
+static const StartupTask startup_pipelines[] = {
+	{"triangle pipelines", build_triangle_pipelines},
+	{"particle pipelines", build_particle_pipelines},
+	{"sprite pipelines", build_sprite_pipelines},
+	{"upscale pipeline", build_upscale_pipeline},
+	{"post pipelines", build_post_pipelines},
+	{"cctv pipeline", build_cctv_pipeline},
+	{"sdf pipelines", build_sdf_pipelines},
+	{"decal pipelines", build_decal_pipelines},
+	{"fog pipelines", build_fog_pipelines},
+};
+
+static void build_startup_pipelines(void *user, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	AppState *app = user;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		uint32_t phase = startup_phase_begin(app, startup_pipelines[i]._name, true);
+		if (startup_pipelines[i]._build(app) != SUCCESS) SDL_SetAtomicInt(&app->_load_failed, 1);
+		startup_phase_end(app, phase);
+	};
+};
+
+// Called before every frame until loading is done
+static void poll_loading(AppState *app)
+{
+	app->_loading_frames++;
+	if (SDL_GetAtomicInt(&app->_loading._pending) > 0) return;
+
+	if (SDL_GetAtomicInt(&app->_load_failed) != 0)
+	{
+		// Stays on the loading screen until the frame ends, then the app quits through SDL_AppQuit
+		if (!app->_failed) SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to build startup pipelines\n");
+		app->_failed = true;
+		return;
+	};
+	app->_loaded = true;
+	// Reloads swap pipelines that must exist already
+	if (app->_hot_reload) start_hot_reload(app);
+};
+
+// Window independent, runs on a worker while the window is created
+static void create_instance_job(void *user, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	AppState *app = user;
+	uint32_t phase = startup_phase_begin(app, "vulkan instance", true);
+	if (create_vulkan_instance(&app->_vk) != SUCCESS) SDL_SetAtomicInt(&app->_init_failed, 1);
+	startup_phase_end(app, phase);
+};
+
+// Only needs the device, overlaps with the swapchain setup
+static void create_buffers_job(void *user, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	AppState *app = user;
+	uint32_t phase = startup_phase_begin(app, "particle and sprite buffers", true);
+	if (particles_init(&app->_particles, &app->_vk) != SUCCESS || sprites_init(&app->_sprites, &app->_vk) != SUCCESS)
+		SDL_SetAtomicInt(&app->_init_failed, 1);
+	else
+	{
+		particles_add_emitter(&app->_particles, PARTICLE_DUST, (float2){0.0f, 0.0f}, (float2){1.6f, 1.6f}, 400.0f);
+		// Dust in every room, as many as there are emitters, paused while nobody sees the room
+		for (uint32_t r = 0; app->_house && r < app->_level._rooms_count; r++)
+		{
+			const Room *room = &app->_level._rooms[r];
+			float2 center = {(room->_min[0] + room->_max[0]) * 0.5f, (room->_min[1] + room->_max[1]) * 0.5f};
+			if (particles_add_emitter(&app->_particles, PARTICLE_DUST, center, (float2){2.0f, 2.0f}, 200.0f) == UINT32_MAX) break;
+		};
+	};
+	startup_phase_end(app, phase);
+};
+
+static void vulkan_prepare(AppState *app)
+{
+	jobs_submit(&app->_jobs, create_instance_job, app, 0, 1, &app->_init_jobs);
+};
+
+// Wait for the init jobs, helping with them meanwhile
+static Result join_init_jobs(AppState *app)
+{
+	jobs_wait(&app->_jobs, &app->_init_jobs);
+	return SDL_GetAtomicInt(&app->_init_failed) == 0 ? SUCCESS : FAILURE;
+};
+
+// Cameras on a grid over the --sprites field or the house, monitors in rows of 4 at the top right of the screen
+static void place_cctv(AppState *app)
+{
+	uint32_t grid = 1;
+	while (grid * grid < app->_cctv_cameras) grid++;
+	float2 lo = {-2.0f, -2.0f}, size = {4.0f, 4.0f};
+	if (app->_house)
+	{
+		lo[0] = app->_level._min[0];
+		lo[1] = app->_level._min[1];
+		size[0] = app->_level._max[0] - lo[0];
+		size[1] = app->_level._max[1] - lo[1];
+	};
+	float2 cell = {size[0] / (float)grid, size[1] / (float)grid};
+	for (uint32_t i = 0; i < app->_cctv_cameras; i++)
+	{
+		float2 center = {lo[0] + ((float)(i % grid) + 0.5f) * cell[0], lo[1] + ((float)(i / grid) + 0.5f) * cell[1]};
+		// Tiles are 16:9, world squares stay square
+		float4 view = {2.0f / cell[0], 2.0f / cell[0] * 16.0f / 9.0f, 0.0f, 0.0f};
+		view[2] = -center[0] * view[0];
+		view[3] = -center[1] * view[1];
+		uint32_t camera = cctv_add_camera(&app->_cctv, view);
+
+		float2 position = {0.2f + (float)(i % 4) * 0.2f, -0.88f + (float)(i / 4) * 0.2f};
+		float2 half_size = {0.09f, 0.09f};
+		cctv_add_monitor(&app->_cctv, camera, position, half_size);
+	};
+	if (app->_cctv_cameras > 0)
+		SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "%u security cameras, %u rendered per frame\n",
+				app->_cctv._cameras_count, app->_cctv._updates_per_frame);
+};
+
+// Room lamps never move: baked on the workers at load, only dynamic lights go through the ring.
+// Without a house the lightmap is black
+static Result bake_lighting(AppState *app)
+{
+	if (!app->_house) return lightmap_bake(&app->_lightmap, nullptr, nullptr, nullptr, 0);
+	FrameLight *lamps = malloc(app->_level._rooms_count * sizeof(FrameLight));
+	if (!lamps) return FAILURE;
+	for (uint32_t r = 0; r < app->_level._rooms_count; r++)
+	{
+		const Room *room = &app->_level._rooms[r];
+		lamps[r] = (FrameLight){
+			._position = {(room->_min[0] + room->_max[0]) * 0.5f, (room->_min[1] + room->_max[1]) * 0.5f},
+			._radius = (room->_max[0] - room->_min[0]) * 0.6f,
+			._intensity = 1.0f,
+			._color = {1.0f, 0.85f, 0.6f, 1.0f},
+		};
+	};
+	Result result = lightmap_bake(&app->_lightmap, &app->_level, &app->_jobs, lamps, app->_level._rooms_count);
+	free(lamps);
+	return result;
+};
+
+// Startup graph, main thread on the top row:
+//   SDL init -> window ----------> surface, device -> swapchain, command buffers -> frames (loading)
+//         \-> instance (worker) -/               \-> buffers (worker) -----/  \-> pipelines (workers)
+static Result vulkan_init(AppState *app)
+{
+	if (join_init_jobs(app) != SUCCESS) return FAILURE;
+
+	uint32_t phase = startup_phase_begin(app, "surface and device", false);
 	if (create_vulkan_surface(app) != SUCCESS) return FAILURE;
 	if (pick_physical_device(&app->_vk) != SUCCESS) return FAILURE;
 	if (create_logical_device(&app->_vk) != SUCCESS) return FAILURE;
+	startup_phase_end(app, phase);
 
-	if (create_swapchain(&app->_vk, app->_window) != SUCCESS) return FAILURE;
-	// Get swapchain images count
-	vkGetSwapchainImagesKHR(app->_vk._device, app->_vk._swapchain, &app->_vk._swapchain_images_count, nullptr);
-	
-	// Allocate swapchain images and imageviews
-	app->_vk._swapchain_images = calloc(app->_vk._swapchain_images_count, sizeof(VkImage));
-	app->_vk._swapchain_imageviews = calloc(app->_vk._swapchain_images_count, sizeof(VkImageView));
+	jobs_submit(&app->_jobs, create_buffers_job, app, 0, 1, &app->_init_jobs);
 
-	vkGetSwapchainImagesKHR(app->_vk._device, app->_vk._swapchain, &app->_vk._swapchain_images_count, app->_vk._swapchain_images);
+	phase = startup_phase_begin(app, "light bake", false);
+	if (bake_lighting(app) != SUCCESS) return FAILURE;
+	startup_phase_end(app, phase);
 
+	phase = startup_phase_begin(app, "swapchain and command buffers", false);
+	if (create_swapchain(&app->_vk, app->_window) != SUCCESS) return FAILURE;
+	if (get_swapchain_images(&app->_vk) != SUCCESS) return FAILURE;
 	if (create_image_view(&app->_vk) != SUCCESS) return FAILURE;
-	if (create_graphics_pipeline(&app->_vk, "shader/slang_compiled.spv") != SUCCESS) return FAILURE;
+	if (create_pipeline_cache(&app->_vk) != SUCCESS) return FAILURE;
+	if (frame_ring_init(&app->_ring, &app->_vk) != SUCCESS) return FAILURE;
+	if (resolution_init(&app->_resolution, &app->_vk, app->_window, app->_gpu_budget_ms, app->_resolution_scale) != SUCCESS)
+		return FAILURE;
+	if (post_init(&app->_post, &app->_vk) != SUCCESS || resize_post(app) != SUCCESS) return FAILURE;
+	if (cctv_init(&app->_cctv, &app->_vk, app->_cctv_updates) != SUCCESS) return FAILURE;
+	place_cctv(app);
+	if (lightmap_init(&app->_lightmap, &app->_vk) != SUCCESS) return FAILURE;
+	if (app->_house && sdf_init(&app->_sdf, &app->_vk, &app->_level) != SUCCESS) return FAILURE;
+	if (app->_house && decals_init(&app->_decals, &app->_vk, &app->_level) != SUCCESS) return FAILURE;
+	if (app->_house && fog_init(&app->_fog, &app->_vk, &app->_level) != SUCCESS) return FAILURE;
+	// Lamp over the triangle until levels bring their own lights
+	app->_lights[0] = (FrameLight){._position = {0.0f, 0.17f}, ._radius = 1.2f, ._intensity = 1.0f, ._color = {1.0f, 1.0f, 1.0f, 1.0f}};
+	app->_lights_count = 1;
+	if (app->_house)
+	{
+		app->_lights[FLASHLIGHT_LIGHT] = (FrameLight){._radius = 4.0f, ._intensity = 1.0f, ._color = {0.8f, 0.9f, 1.0f, 1.0f}};
+		app->_lights_count = FLASHLIGHT_LIGHT + 1;
+	};
+	if (create_graphics_pipeline(app, "slang_compiled.spv") != SUCCESS) return FAILURE;
 	if (create_command_pool(&app->_vk) != SUCCESS) return FAILURE;
 	if (create_command_buffer(&app->_vk) != SUCCESS) return FAILURE;
 	if (create_sync_objects(&app->_vk) != SUCCESS) return FAILURE;
+	if (create_gpu_times(&app->_vk) != SUCCESS) return FAILURE;
+	if (pacing_init(&app->_pacer, &app->_vk, app->_window, app->_frame_pacing, app->_pacing_csv) != SUCCESS) return FAILURE;
+	startup_phase_end(app, phase);
+	if (join_init_jobs(app) != SUCCESS) return FAILURE;
+
+	// Pipeline compiles are most of the startup time, don't hold the window on them
+	for (uint32_t i = 0; i < SDL_arraysize(startup_pipelines); i++)
+	{
+		jobs_submit(&app->_jobs, build_startup_pipelines, app, i, i + 1, &app->_loading);
+	};
 
 	app->_vk._current_frame = 0;
 	return SUCCESS;
 };
 
-static void draw(AppState *app)
+static void vulkan_begin_frame(AppState *app)
+{
+	VulkanState *vk = &app->_vk;
+	// Before anything of the frame samples input
+	pacing_begin_frame(&app->_pacer);
+	// This slot's command buffers and per frame regions were last used MAX_FRAMES_IN_FLIGHT frames ago.
+	// Its graphics submit waited on its compute submit, the fence covers both
+	vkWaitForFences(vk->_device, 1, &vk->_fences_draw[vk->_current_frame], VK_TRUE, UINT64_MAX);
+	read_gpu_times(vk);
+	sdf_readback(&app->_sdf, vk->_current_frame);
+	capture_collect(&app->_capture, vk->_current_frame);
+	resolution_update(&app->_resolution, vk->_gpu_times._scene_ns);
+	frame_ring_begin(&app->_ring, vk->_current_frame);
+	// Known before recording so visibility can take the security cameras into account
+	if (app->_loaded) cctv_schedule(&app->_cctv, app->_sprites._view);
+	else app->_cctv._scheduled_count = 0;
+	// Gameplay pushes this frame's sprites between begin and recording
+	sprites_begin(&app->_sprites, vk);
+};
+
+static bool vulkan_push_sprite(AppState *app, uint32_t layer, const float2 position, const float2 half_size, const float4 color)
+{
+	return sprites_push(&app->_sprites, layer, position, half_size, color);
+};
+
+static bool stamp_random_decal(AppState *app, DecalKind kind, const float2 position)
+{
+	static const float4 colors[] = {
+		[DECAL_FOOTPRINT] = {0.12f, 0.08f, 0.06f, 0.5f},
+		[DECAL_BLOOD] = {0.35f, 0.01f, 0.02f, 0.9f},
+		[DECAL_SCORCH] = {0.03f, 0.025f, 0.02f, 0.85f},
+	};
+	uint64_t *rng = &app->_decal_rng;
+	float size = kind == DECAL_SCORCH ? random_range(rng, 0.6f, 1.2f) : random_range(rng, 0.3f, 0.7f);
+	float2 half_size = {size, size};
+	return decals_stamp(&app->_decals, kind, position, half_size, random_range(rng, 0.0f, 6.2831853f), colors[kind]);
+};
+
+// This frame's decals: a footprint every FOOTSTEP units the mouse walks, alternating feet, and
+// the --decals queue
+static void stamp_decals(AppState *app)
+{
+	constexpr float FOOTSTEP = 0.6f;
+	if (!app->_house) return;
+	float2 step = {app->_eye[0] - app->_last_footprint[0], app->_eye[1] - app->_last_footprint[1]};
+	float distance = SDL_sqrtf(step[0] * step[0] + step[1] * step[1]);
+	// The mouse jumped (left the window and came back), a new trail starts
+	if (distance > 4.0f)
+	{
+		app->_last_footprint[0] = app->_eye[0];
+		app->_last_footprint[1] = app->_eye[1];
+	}
+	else if (distance >= FOOTSTEP)
+	{
+		float2 dir = {step[0] / distance, step[1] / distance};
+		float side = app->_footprints % 2 ? 0.15f : -0.15f;
+		app->_last_footprint[0] += dir[0] * FOOTSTEP;
+		app->_last_footprint[1] += dir[1] * FOOTSTEP;
+		float2 position = {app->_last_footprint[0] - dir[1] * side, app->_last_footprint[1] + dir[0] * side};
+		float2 half_size = {0.12f, 0.25f};
+		float4 color = {0.12f, 0.08f, 0.06f, 0.5f};
+		// Toes along the walk
+		if (decals_stamp(&app->_decals, DECAL_FOOTPRINT, position, half_size, SDL_atan2f(dir[0], -dir[1]), color))
+			app->_footprints++;
+	};
+
+	// Decals smaller than a room are split into 4 stamps at most
+	while (app->_stress_decals_left > 0 && app->_decals._queued_count + 4 <= DECALS_MAX_STAMPS)
+	{
+		uint64_t *rng = &app->_decal_rng;
+		float2 position = {random_range(rng, app->_level._min[0], app->_level._max[0]),
+			random_range(rng, app->_level._min[1], app->_level._max[1])};
+		stamp_random_decal(app, (DecalKind)(app->_stress_decals_left % 3), position);
+		if (--app->_stress_decals_left == 0) SDL_Log("%u decals stamped\n", app->_stress_decals);
+	};
+};
+
+static void vulkan_draw(AppState *app, float dt)
 {
 	VulkanState *vk = &app->_vk;
 
-	vkQueueWaitIdle(vk->_graphics_queue);
-	
 	VkSemaphore smp_present = vk->_smps_present_complete[vk->_current_frame];
-	VkSemaphore smp_render = vk->_smps_render_complete[vk->_current_frame];
 	VkFence fence = vk->_fences_draw[vk->_current_frame];
-	VkCommandBuffer cmdbuffer = vk->_commandbuffers[vk->_current_frame];
+
+	// vulkan_begin_frame waited on this slot's fence already
+	if (!app->_loaded) poll_loading(app);
+	// Pipelines rebuilt in the background can only replace the live ones once nothing is in flight
+	if (app->_hot_reload && hotreload_ready(&app->_hotreload))
+	{
+		vkDeviceWaitIdle(vk->_device);
+		hotreload_apply(&app->_hotreload);
+	};
 	
 	VkAcquireNextImageInfoKHR acquire_next_image_info = {};
 	acquire_next_image_info.sType = VK_STRUCTURE_TYPE_ACQUIRE_NEXT_IMAGE_INFO_KHR;
@@ -996,7 +1861,7 @@ static void draw(AppState *app)
 	VkResult acquire_image_result = vkAcquireNextImage2KHR(vk->_device, &acquire_next_image_info, &img_idx);
 	if (acquire_image_result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
-		recreate_swapchain(&app->_vk, app->_window);
+		recreate_swapchain(app);
 		return;
 	}
 	else if (acquire_image_result != VK_SUCCESS && acquire_image_result != VK_SUBOPTIMAL_KHR)
@@ -1008,47 +1873,69 @@ static void draw(AppState *app)
 	// Put fence in unsignal state to pass to queue_summit, then we can use
 	// vkWaitForFences() to know when gpu is done
 	vkResetFences(vk->_device, 1, &fence);
-	
-	record_command_buffer(vk, img_idx);
-	VkPipelineStageFlagBits2 pipeline_stage_flag = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkSemaphore smp_render = vk->_smps_render_complete[img_idx];
+
+	// Submitted first, the graphics work before the particle draw runs next to it
+	bool compute = app->_loaded && vk->_async_compute;
+	if (compute) submit_compute(app, dt);
+	stamp_decals(app);
+	if (app->_loaded) fog_update(&app->_fog, app->_eye, vk->_current_frame);
+	record_command_buffer(app, dt);
+	record_output_command_buffer(app, img_idx);
 	
 	// Wait semamphore submit info
-	VkSemaphoreSubmitInfo wait_smps_submit_info = {};
-	wait_smps_submit_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-	wait_smps_submit_info.semaphore = smp_present;
+	VkSemaphoreSubmitInfo wait_smps_submit_info[2] = {};
+	wait_smps_submit_info[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	wait_smps_submit_info[0].semaphore = smp_present;
 	// For binary semaphore, this is ignore. Otherwise (timeline semaphore),
 	// value is either the value used to signal semaphore
 	// or the value waited on by semaphore
-	wait_smps_submit_info.value = 0;
-	wait_smps_submit_info.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	wait_smps_submit_info[0].value = 0;
+	wait_smps_submit_info[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	// Only the particle draw needs this frame's compute
+	wait_smps_submit_info[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	wait_smps_submit_info[1].semaphore = vk->_compute_timeline;
+	wait_smps_submit_info[1].value = vk->_compute_value;
+	wait_smps_submit_info[1].stageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
 	
-	// Wait semamphore submit info
-	VkSemaphoreSubmitInfo signal_smps_submit_info = {};
-	signal_smps_submit_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-	signal_smps_submit_info.semaphore = smp_render;
-	signal_smps_submit_info.value = 0;
-	signal_smps_submit_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	// Signal semamphore submit info
+	VkSemaphoreSubmitInfo signal_smps_submit_info[2] = {};
+	signal_smps_submit_info[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	signal_smps_submit_info[0].semaphore = smp_render;
+	signal_smps_submit_info[0].value = 0;
+	signal_smps_submit_info[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	// The next compute submit waits for this frame to be done with the particles
+	signal_smps_submit_info[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	signal_smps_submit_info[1].semaphore = vk->_graphics_timeline;
+	signal_smps_submit_info[1].value = ++vk->_graphics_value;
+	signal_smps_submit_info[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 	
 	//Command buffer submit info
 
-	VkCommandBufferSubmitInfo cmd_submit_info = {};
-	cmd_submit_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-	cmd_submit_info.commandBuffer = cmdbuffer;
-
-	VkSubmitInfo2 submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-	submit_info.waitSemaphoreInfoCount = 1;
-	submit_info.pWaitSemaphoreInfos = &wait_smps_submit_info;
-	submit_info.signalSemaphoreInfoCount = 1;
-	submit_info.pSignalSemaphoreInfos = &signal_smps_submit_info;
-	submit_info.commandBufferInfoCount = 1;
-	submit_info.pCommandBufferInfos = &cmd_submit_info;
-	
-	// Submit the queue.
-	vkQueueSubmit2(vk->_graphics_queue, 1, &submit_info, fence);
+	VkCommandBufferSubmitInfo cmd_submit_info[2] = {};
+	cmd_submit_info[0].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	cmd_submit_info[0].commandBuffer = vk->_commandbuffers[vk->_current_frame];
+	cmd_submit_info[1].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	cmd_submit_info[1].commandBuffer = vk->_output_commandbuffers[vk->_current_frame];
+
+	// Scene first, waiting only for compute. The output waits for the swapchain image and signals
+	// everything, its signals cover the scene batch submitted before it
+	VkSubmitInfo2 submit_info[2] = {};
+	submit_info[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submit_info[0].waitSemaphoreInfoCount = compute ? 1 : 0;
+	submit_info[0].pWaitSemaphoreInfos = &wait_smps_submit_info[1];
+	submit_info[0].commandBufferInfoCount = 1;
+	submit_info[0].pCommandBufferInfos = &cmd_submit_info[0];
+	submit_info[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submit_info[1].waitSemaphoreInfoCount = 1;
+	submit_info[1].pWaitSemaphoreInfos = &wait_smps_submit_info[0];
+	submit_info[1].signalSemaphoreInfoCount = 2;
+	submit_info[1].pSignalSemaphoreInfos = signal_smps_submit_info;
+	submit_info[1].commandBufferInfoCount = 1;
+	submit_info[1].pCommandBufferInfos = &cmd_submit_info[1];
 	
-	// Wait for the gpu to done work
-	vkWaitForFences(vk->_device, 1, &fence, VK_TRUE, UINT64_MAX);
+	// Submit the queue. No wait here, the fence is waited on when this frame slot comes around again
+	vkQueueSubmit2(vk->_graphics_queue, 2, submit_info, fence);
 	
 	VkPresentInfoKHR present_info = {};
 	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1057,23 +1944,31 @@ static void draw(AppState *app)
 	present_info.swapchainCount = 1;
 	present_info.pSwapchains = &vk->_swapchain;
 	present_info.pImageIndices = &img_idx;
+	// The pacing thread waits on this id to see the frame displayed
+	uint64_t present_id = pacing_present(&app->_pacer, vk->_gpu_times._frame_ns);
+	VkPresentIdKHR present_id_info = {};
+	present_id_info.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	present_id_info.swapchainCount = 1;
+	present_id_info.pPresentIds = &present_id;
+	if (present_id != 0) present_info.pNext = &present_id_info;
 	
 	VkResult present_result = vkQueuePresentKHR(vk->_graphics_queue, &present_info);
 	if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR)
 	{
-		recreate_swapchain(&app->_vk, app->_window);
+		recreate_swapchain(app);
 	};
 	
 	vk->_current_frame = (vk->_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
 };
-Result app_mainloop(AppState *app)
-{
-	draw(app);
-    return SUCCESS;
-};
-void app_quit(AppState *app)
+static void vulkan_quit(AppState *app)
 {
+	hotreload_quit(&app->_hotreload);
+	// Quitting while still loading, let the compiles finish before tearing the device down
+	jobs_wait(&app->_jobs, &app->_loading);
 	vkDeviceWaitIdle(app->_vk._device);
+	pacing_quit(&app->_pacer);
+	vkDestroyPipeline(app->_vk._device, app->_pending_graphics_pipeline, nullptr);
+	vkDestroyShaderModule(app->_vk._device, app->_pending_shader_module, nullptr);
 #ifndef NDEBUG
 	destroy_debug_messenter_util(app->_vk._instance, app->_vk._debug_messenger, nullptr);
 #endif
@@ -1084,17 +1979,272 @@ void app_quit(AppState *app)
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		vkDestroySemaphore(app->_vk._device, app->_vk._smps_present_complete[i], nullptr);
-		vkDestroySemaphore(app->_vk._device, app->_vk._smps_render_complete[i], nullptr);
 		vkDestroyFence(app->_vk._device, app->_vk._fences_draw[i], nullptr);
 	};
+	destroy_render_semaphores(&app->_vk);
+	vkDestroySemaphore(app->_vk._device, app->_vk._graphics_timeline, nullptr);
+	vkDestroySemaphore(app->_vk._device, app->_vk._compute_timeline, nullptr);
+	vkDestroyQueryPool(app->_vk._device, app->_vk._gpu_times._pool, nullptr);
+	particles_quit(&app->_particles, &app->_vk);
+	sprites_quit(&app->_sprites, &app->_vk);
 	vkFreeCommandBuffers(app->_vk._device, app->_vk._commandpool, MAX_FRAMES_IN_FLIGHT, app->_vk._commandbuffers);
+	vkFreeCommandBuffers(app->_vk._device, app->_vk._commandpool, MAX_FRAMES_IN_FLIGHT, app->_vk._output_commandbuffers);
 	vkDestroyCommandPool(app->_vk._device, app->_vk._commandpool, nullptr);
+	if (app->_vk._async_compute)
+	{
+		vkFreeCommandBuffers(app->_vk._device, app->_vk._compute_commandpool, MAX_FRAMES_IN_FLIGHT, app->_vk._compute_commandbuffers);
+		vkDestroyCommandPool(app->_vk._device, app->_vk._compute_commandpool, nullptr);
+	};
 	vkDestroyPipelineLayout(app->_vk._device, app->_vk._pipeline_layout, nullptr);
+	frame_ring_quit(&app->_ring, &app->_vk);
+	resolution_quit(&app->_resolution, &app->_vk);
+	post_quit(&app->_post, &app->_vk);
+	cctv_quit(&app->_cctv, &app->_vk);
+	lightmap_quit(&app->_lightmap, &app->_vk);
+	sdf_quit(&app->_sdf, &app->_vk);
+	decals_quit(&app->_decals, &app->_vk);
+	fog_quit(&app->_fog, &app->_vk);
+	capture_flush(&app->_capture, &app->_vk);
+	pipeline_variants_quit(&app->_variants);
+	vkDestroyPipelineCache(app->_vk._device, app->_vk._pipeline_cache, nullptr);
 	vkDestroyShaderModule(app->_vk._device, app->_vk._shader_module, nullptr);
-	vkDestroyPipeline(app->_vk._device, app->_vk._graphics_pipeline, nullptr);
 	vkDestroyDevice(app->_vk._device, nullptr);
 	vkDestroySurfaceKHR(app->_vk._instance, app->_vk._surface, nullptr);
     vkDestroyInstance(app->_vk._instance, nullptr);
+};
+
+const Renderer vulkan_renderer = {
+	._name = "vulkan",
+	._window_flags = SDL_WINDOW_VULKAN,
+	._prepare = vulkan_prepare,
+	._init = vulkan_init,
+	._begin_frame = vulkan_begin_frame,
+	._push_sprite = vulkan_push_sprite,
+	._draw = vulkan_draw,
+	._quit = vulkan_quit,
+};
+
+const Renderer *renderer_find(const char *name)
+{
+	if (SDL_strcmp(name, vulkan_renderer._name) == 0) return &vulkan_renderer;
+	if (SDL_strcmp(name, gles_renderer._name) == 0) return &gles_renderer;
+	return nullptr;
+};
+
+// Fit the house to the window, for every renderer and the visibility pass
+static void set_camera(AppState *app)
+{
+	int width, height;
+	SDL_GetWindowSize(app->_window, &width, &height);
+	float aspect = (float)width / (float)SDL_max(height, 1);
+	float2 size = {app->_level._max[0] - app->_level._min[0], app->_level._max[1] - app->_level._min[1]};
+	float scale = 0.95f * SDL_min(2.0f / size[0], 2.0f / (size[1] * aspect));
+	float4 view = {scale, scale * aspect, 0.0f, 0.0f};
+	view[2] = -(app->_level._min[0] + size[0] * 0.5f) * view[0];
+	view[3] = -(app->_level._min[1] + size[1] * 0.5f) * view[1];
+	SDL_memcpy(app->_camera, view, sizeof(float4));
+	SDL_memcpy(app->_sprites._view, view, sizeof(float4));
+	SDL_memcpy(app->_particles._view, view, sizeof(float4));
+	SDL_memcpy(app->_gles._view, view, sizeof(float4));
+};
+
+Result app_init(AppState *app)
+{
+	app->_start_ns = SDL_GetTicksNS();
+	if (app->_renderer == nullptr) app->_renderer = &vulkan_renderer;
+	uint32_t phase = startup_phase_begin(app, "SDL init", false);
+	if (init_sdl(app) != SUCCESS) return FAILURE;
+	if (jobs_init(&app->_jobs, 0) != SUCCESS) return FAILURE;
+	capture_init(&app->_capture, &app->_jobs, "capture");
+	// The 50 room house of the benchmarks
+	if (app->_house && (level_generate_house(&app->_level, 10, 5, 8.0f, 1234) != SUCCESS
+				|| portals_init(&app->_portals, &app->_level) != SUCCESS))
+		return FAILURE;
+	startup_phase_end(app, phase);
+
+	// Window independent work goes to the workers before the window blocks the main thread
+	if (app->_renderer->_prepare != nullptr) app->_renderer->_prepare(app);
+	phase = startup_phase_begin(app, "window", false);
+	Result result = create_window(app);
+	startup_phase_end(app, phase);
+	if (result == SUCCESS) result = app->_renderer->_init(app);
+	if (result != SUCCESS)
+	{
+		// Nothing may still be running on app once we return
+		jobs_wait(&app->_jobs, &app->_init_jobs);
+		return FAILURE;
+	};
+
+	if (app->_house) set_camera(app);
+	app->_stress_decals_left = app->_stress_decals;
+	app->_decal_rng = 0x2545F4914F6CDD1Dull;
+	app->_last_frame_ns = SDL_GetTicksNS();
+	app->_stats_start_ns = app->_last_frame_ns;
+	return SUCCESS;
+};
+
+// Rooms the main view and this frame's security cameras see through the doors, then the lights
+// and emitters that matter to them. Sprites are checked as they are pushed
+static void update_visibility(AppState *app)
+{
+	PortalGraph *pg = &app->_portals;
+	if (app->_house)
+	{
+		float mouse[2];
+		int width, height;
+		SDL_GetMouseState(&mouse[0], &mouse[1]);
+		SDL_GetWindowSize(app->_window, &width, &height);
+		float2 eye = {(mouse[0] / (float)width * 2.0f - 1.0f - app->_camera[2]) / app->_camera[0],
+			(mouse[1] / (float)height * 2.0f - 1.0f - app->_camera[3]) / app->_camera[1]};
+		app->_eye[0] = eye[0];
+		app->_eye[1] = eye[1];
+		if (app->_lights_count > FLASHLIGHT_LIGHT)
+		{
+			app->_lights[FLASHLIGHT_LIGHT]._position[0] = eye[0];
+			app->_lights[FLASHLIGHT_LIGHT]._position[1] = eye[1];
+		};
+		portals_begin(pg);
+		portals_add_view(pg, eye, app->_camera);
+		for (uint32_t i = 0; i < app->_cctv._scheduled_count; i++)
+		{
+			const float *view = app->_cctv._cameras[app->_cctv._scheduled[i]]._view;
+			float2 camera = {-view[2] / view[0], -view[3] / view[1]};
+			portals_add_view(pg, camera, view);
+		};
+		for (uint32_t i = 0; i < app->_particles._emitters_count; i++)
+		{
+			ParticleEmitter *emitter = &app->_particles._emitters[i];
+			emitter->_paused = !portals_point_visible(pg, emitter->_request._position);
+		};
+	};
+
+	app->_frame_lights_count = 0;
+	for (uint32_t i = 0; i < app->_lights_count; i++)
+	{
+		const FrameLight *light = &app->_lights[i];
+		if (app->_house && !portals_circle_visible(pg, light->_position, light->_radius)) continue;
+		app->_frame_lights[app->_frame_lights_count++] = *light;
+	};
+};
+
+static void push_stress_sprites(AppState *app)
+{
+	uint64_t rng = 0x9E3779B97F4A7C15ull;
+	float2 lo = {-2.0f, -2.0f}, hi = {2.0f, 2.0f};
+	if (app->_house)
+	{
+		lo[0] = app->_level._min[0];
+		lo[1] = app->_level._min[1];
+		hi[0] = app->_level._max[0];
+		hi[1] = app->_level._max[1];
+	};
+	for (uint32_t i = 0; i < app->_stress_sprites; i++)
+	{
+		// Spread over twice the screen so about a quarter gets culled, or over the house
+		float2 position = {random_range(&rng, lo[0], hi[0]), random_range(&rng, lo[1], hi[1])};
+		if (app->_house && !portals_point_visible(&app->_portals, position)) continue;
+		float2 half_size = {app->_house ? 0.1f : 0.01f, app->_house ? 0.1f : 0.01f};
+		float4 color = {random_range(&rng, 0.2f, 1.0f), random_range(&rng, 0.2f, 1.0f), random_range(&rng, 0.2f, 1.0f), 0.8f};
+		app->_renderer->_push_sprite(app, i % SPRITE_LAYERS, position, half_size, color);
+	};
+};
+
+Result app_mainloop(AppState *app)
+{
+	uint64_t now = SDL_GetTicksNS();
+	float dt = (float)(now - app->_last_frame_ns) / (float)SDL_NS_PER_SECOND;
+	app->_last_frame_ns = now;
+
+	app->_renderer->_begin_frame(app);
+	update_visibility(app);
+	push_stress_sprites(app);
+	// Don't let a stall (window drag, breakpoint) dump a huge step on the simulation
+	app->_renderer->_draw(app, SDL_min(dt, 0.1f));
+	if (app->_first_frame_ns == 0) app->_first_frame_ns = SDL_GetTicksNS();
+	if (app->_loaded && app->_ready_ns == 0)
+	{
+		app->_ready_ns = SDL_GetTicksNS();
+		report_startup(app);
+	};
+
+	app->_stats_frames++;
+	if (app->_stress_sprites > 0 && now - app->_stats_start_ns >= 5 * SDL_NS_PER_SECOND)
+	{
+		double ms = (double)(now - app->_stats_start_ns) / (double)SDL_NS_PER_MS / app->_stats_frames;
+		SDL_Log("%s: %u sprites, %.3f ms/frame\n", app->_renderer->_name, app->_stress_sprites, ms);
+		app->_stats_start_ns = now;
+		app->_stats_frames = 0;
+	};
+    return app->_failed ? FAILURE : SUCCESS;
+};
+
+void app_toggle_door(AppState *app)
+{
+	if (!app->_house) return;
+	// Within reach, 2 units of the door's middle
+	uint32_t nearest = UINT32_MAX;
+	float nearest_distance = 4.0f;
+	for (uint32_t d = 0; d < app->_level._doors_count; d++)
+	{
+		const Door *door = &app->_level._doors[d];
+		float dx = (door->_a[0] + door->_b[0]) * 0.5f - app->_eye[0], dy = (door->_a[1] + door->_b[1]) * 0.5f - app->_eye[1];
+		if (dx * dx + dy * dy >= nearest_distance) continue;
+		nearest_distance = dx * dx + dy * dy;
+		nearest = d;
+	};
+	if (nearest != UINT32_MAX) level_set_door(&app->_level, nearest, !app->_level._doors[nearest]._open);
+};
+
+void app_stamp_decal(AppState *app, DecalKind kind)
+{
+	if (app->_house) stamp_random_decal(app, kind, app->_eye);
+};
+
+void app_quit(AppState *app)
+{
+	app->_renderer->_quit(app);
+	jobs_quit(&app->_jobs);
+	if (app->_house)
+	{
+		portals_quit(&app->_portals);
+		level_free(&app->_level);
+	};
     SDL_DestroyWindow(app->_window);
     free(app);
 };
+
+void startup_benchmark(void)
+{
+	constexpr int RUNS = 3;
+	for (int run = 0; run < RUNS; run++)
+	{
+		AppState *app = calloc(1, sizeof(AppState));
+		Result result = app_init(app);
+		if (result != SUCCESS || app->_renderer != &vulkan_renderer)
+		{
+			SDL_Log("startup: skipped, no Vulkan device\n");
+			// A failed init leaves the renderer half built, only undo what app_init itself did
+			if (result == SUCCESS) app_quit(app);
+			else
+			{
+				jobs_quit(&app->_jobs);
+				SDL_DestroyWindow(app->_window);
+				free(app);
+			};
+			SDL_Quit();
+			return;
+		};
+		result = SUCCESS;
+		while (app->_ready_ns == 0 && result == SUCCESS)
+		{
+			SDL_PumpEvents();
+			result = app_mainloop(app);
+		};
+		if (result == SUCCESS)
+			SDL_Log("startup run %d: first frame %.1f ms, ready %.1f ms, %u loading frames\n", run,
+					startup_ms(app, app->_first_frame_ns), startup_ms(app, app->_ready_ns), app->_loading_frames);
+		app_quit(app);
+		SDL_Quit();
+		if (result != SUCCESS) return;
+	};
+};
@@ -1,17 +1,128 @@
 #pragma once
 #include <SDL3/SDL.h>
 #include "vk.h"
+#include "capture.h"
+#include "cctv.h"
+#include "decals.h"
+#include "fog.h"
+#include "octopus.h"
+#include "renderer.h"
+#include "gles.h"
+#include "hotreload.h"
+#include "jobs.h"
+#include "level.h"
+#include "lightmap.h"
+#include "pacing.h"
+#include "particles.h"
+#include "pipelines.h"
+#include "portals.h"
+#include "post.h"
+#include "resolution.h"
+#include "ring.h"
+#include "sdf.h"
+#include "sprites.h"
+constexpr uint32_t STARTUP_MAX_PHASES = 32;
+
 typedef struct
+{
+	const char *_name;
+	uint64_t _begin_ns, _end_ns;
+	bool _worker;
+} StartupPhase;
+
+struct AppState
 {
     SDL_Window* _window;
+    const Renderer *_renderer;
     VulkanState _vk;
-} AppState;
+    ParticleSystem _particles;
+    SpriteRenderer _sprites;
+    GlesState _gles;
+    PipelineVariants _variants;
+    // The triangle's material, _features is toggled at runtime
+    PipelineDesc _triangle_desc;
+    // Per frame camera, lights and draw data, uploaded through the ring every frame.
+    // _lights are the scene's, _frame_lights the ones some view of this frame can see
+    FrameRing _ring;
+    uint32_t _lights_count, _frame_lights_count;
+    FrameLight _lights[FRAME_MAX_LIGHTS];
+    FrameLight _frame_lights[FRAME_MAX_LIGHTS];
+    // Static lights, baked at load. _lights only holds the dynamic ones
+    Lightmap _lightmap;
+    uint64_t _last_frame_ns;
+    // Scene resolution follows the GPU time. --gpu-budget <ms>, --resolution-scale <s> fixes it
+    ResolutionScaler _resolution;
+    float _gpu_budget_ms, _resolution_scale;
+    PostStack _post;
+    // --cctv N: N security cameras over the sprite field and a wall of monitors showing them,
+    // --cctv-updates K of them rendered per frame
+    Cctv _cctv;
+    uint32_t _cctv_cameras, _cctv_updates;
+    // F12 screenshot, F10 and F9 record PNG or raw frames (--record png|raw from the start).
+    // Vulkan only, the copies ride on the output command buffer
+    Capture _capture;
+    // When frames reach the display (VK_KHR_present_wait). --frame-pacing starts frames just in
+    // time for their vblank, --pacing-csv <path> writes the interval and latency histograms at quit
+    FramePacer _pacer;
+    bool _frame_pacing;
+    const char *_pacing_csv;
+    // --house: a generated house filling the screen, seen from the mouse. Sprites, lights and
+    // emitters in rooms no view sees through the doors are dropped every frame
+    bool _house;
+    Level _level;
+    PortalGraph _portals;
+    float4 _camera;
+    // World position under the mouse
+    float2 _eye;
+    // Distance to the walls and closed doors, follows the doors
+    Sdf _sdf;
+    // Footprints follow the mouse, clicks leave blood and scorch marks. --decals N stamps N random
+    // ones over the house, a frame's queue at a time
+    Decals _decals;
+    uint32_t _stress_decals, _stress_decals_left;
+    uint64_t _decal_rng;
+    float2 _last_footprint;
+    uint32_t _footprints;
+    // Fog of war from the mouse: what its visibility polygon doesn't reach is darkened
+    Fog _fog;
+
+    // Startup pipeline compiles run on _jobs, frames show a loading screen until _loading drains
+    uint64_t _start_ns;
+    JobSystem _jobs;
+    JobCounter _loading;
+    SDL_AtomicInt _load_failed;
+    bool _loaded;
+    // The loading screen found a failed build, app_mainloop returns FAILURE
+    bool _failed;
+    uint32_t _loading_frames;
+
+    // Startup timeline, reported once the first frame with everything loaded is drawn
+    SDL_AtomicInt _phases_count;
+    StartupPhase _phases[STARTUP_MAX_PHASES];
+    // Init work overlapped on the workers, before the loading screen
+    JobCounter _init_jobs;
+    SDL_AtomicInt _init_failed;
+    uint64_t _first_frame_ns, _ready_ns;
+
+    // --hot-reload: rebuild pipelines when shader sources change
+    bool _hot_reload;
+    HotReload _hotreload;
+    VkShaderModule _pending_shader_module;
+    VkPipeline _pending_graphics_pipeline;
+
+    // --sprites N: random sprites every frame, and a frame time log, to compare backends
+    uint32_t _stress_sprites;
+    uint64_t _stats_start_ns;
+    uint32_t _stats_frames;
+};
 
-typedef enum
-{
-	SUCCESS,
-	FAILURE
-} Result;
 Result app_init(AppState *app);
 Result app_mainloop(AppState *app);
+// --house: open or close the door nearest to the mouse
+void app_toggle_door(AppState *app);
+// --house: a decal of kind under the mouse
+void app_stamp_decal(AppState *app, DecalKind kind);
 void app_quit(AppState *app);
+
+// homeinvasion --bench startup: time to first frame and to pipelines ready, over a few cold starts
+void startup_benchmark(void);
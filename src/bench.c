@@ -0,0 +1,230 @@
+#include "bench.h"
+#include "app.h"
+#include "capture.h"
+#include "collision.h"
+#include "decals.h"
+#include "lightmap.h"
+#include "nav.h"
+#include "pipelines.h"
+#include "portals.h"
+#include "post.h"
+#include "sdf.h"
+#include "visibility.h"
+
+typedef struct
+{
+	const char *_name;
+	void (*_run)(void);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+	{"capture", capture_benchmark},
+	{"collision", collision_benchmark},
+	{"decals", decals_benchmark},
+	{"lightmap", lightmap_benchmark},
+	{"nav", nav_benchmark},
+	{"pipelines", pipeline_benchmark},
+	{"portals", portals_benchmark},
+	{"post", post_benchmark},
+	{"sdf", sdf_benchmark},
+	{"startup", startup_benchmark},
+	{"vis", vis_benchmark},
+};
+
+bool create_bench_device(BenchDevice *bd)
+{
+	VkApplicationInfo app_info = {};
+	app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	app_info.pApplicationName = "homeinvasion bench";
+	app_info.apiVersion = VK_API_VERSION_1_3;
+	VkInstanceCreateInfo instance_create_info = {};
+	instance_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instance_create_info.pApplicationInfo = &app_info;
+	if (vk_load_loader() != SUCCESS) return false;
+	if (vkCreateInstance(&instance_create_info, nullptr, &bd->_instance) != VK_SUCCESS) return false;
+	vk_load_instance(bd->_instance);
+
+	uint32_t count = 1;
+	VkResult result = vkEnumeratePhysicalDevices(bd->_instance, &count, &bd->_physical_device);
+	if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || count == 0) return false;
+
+	uint32_t families_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(bd->_physical_device, &families_count, nullptr);
+	VkQueueFamilyProperties families[families_count];
+	vkGetPhysicalDeviceQueueFamilyProperties(bd->_physical_device, &families_count, families);
+	uint32_t family = 0;
+	while (family < families_count && !(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) family++;
+	if (family == families_count) return false;
+	bd->_family = family;
+
+	uint32_t extensions_count = 0;
+	vkEnumerateDeviceExtensionProperties(bd->_physical_device, nullptr, &extensions_count, nullptr);
+	VkExtensionProperties extensions[extensions_count];
+	vkEnumerateDeviceExtensionProperties(bd->_physical_device, nullptr, &extensions_count, extensions);
+	const char *library_extensions[] = {VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME};
+	uint32_t found = 0;
+	for (uint32_t i = 0; i < extensions_count; i++)
+	{
+		for (uint32_t j = 0; j < 2; j++)
+		{
+			if (SDL_strcmp(extensions[i].extensionName, library_extensions[j]) == 0) found++;
+		};
+	};
+
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT library_features = {};
+	library_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	if (found == 2)
+	{
+		VkPhysicalDeviceFeatures2 supported = {};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported.pNext = &library_features;
+		vkGetPhysicalDeviceFeatures2(bd->_physical_device, &supported);
+	};
+	bd->_pipeline_library = library_features.graphicsPipelineLibrary == VK_TRUE;
+
+	VkPhysicalDeviceVulkan13Features v13_features = {};
+	v13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	v13_features.dynamicRendering = VK_TRUE;
+	v13_features.synchronization2 = VK_TRUE;
+	if (bd->_pipeline_library) v13_features.pNext = &library_features;
+
+	float priority = 1.0f;
+	VkDeviceQueueCreateInfo queue_create_info = {};
+	queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queue_create_info.queueFamilyIndex = family;
+	queue_create_info.queueCount = 1;
+	queue_create_info.pQueuePriorities = &priority;
+
+	VkDeviceCreateInfo device_create_info = {};
+	device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	device_create_info.pNext = &v13_features;
+	device_create_info.queueCreateInfoCount = 1;
+	device_create_info.pQueueCreateInfos = &queue_create_info;
+	device_create_info.enabledExtensionCount = bd->_pipeline_library ? 2 : 0;
+	device_create_info.ppEnabledExtensionNames = library_extensions;
+	if (vkCreateDevice(bd->_physical_device, &device_create_info, nullptr, &bd->_device) != VK_SUCCESS) return false;
+	if (vk_load_device(bd->_device) != SUCCESS) return false;
+	vkGetDeviceQueue(bd->_device, family, 0, &bd->_queue);
+
+	VkCommandPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_create_info.queueFamilyIndex = family;
+	return vkCreateCommandPool(bd->_device, &pool_create_info, nullptr, &bd->_pool) == VK_SUCCESS;
+};
+
+void destroy_bench_device(BenchDevice *bd)
+{
+	if (bd->_pool != VK_NULL_HANDLE) vkDestroyCommandPool(bd->_device, bd->_pool, nullptr);
+	if (bd->_device != VK_NULL_HANDLE) vkDestroyDevice(bd->_device, nullptr);
+	if (bd->_instance != VK_NULL_HANDLE) vkDestroyInstance(bd->_instance, nullptr);
+};
+
+VulkanState bench_vulkan_state(const BenchDevice *bd)
+{
+	return (VulkanState){._physical_device = bd->_physical_device, ._device = bd->_device};
+};
+
+bool bench_allocate_command_buffers(BenchDevice *bd, uint32_t count, VkCommandBuffer *cmdbuffers)
+{
+	VkCommandBufferAllocateInfo cmdbuffer_allocate_info = {};
+	cmdbuffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cmdbuffer_allocate_info.commandPool = bd->_pool;
+	cmdbuffer_allocate_info.commandBufferCount = count;
+	cmdbuffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	return vkAllocateCommandBuffers(bd->_device, &cmdbuffer_allocate_info, cmdbuffers) == VK_SUCCESS;
+};
+
+void bench_begin(VkCommandBuffer cmdbuffer)
+{
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(cmdbuffer, &begin_info);
+};
+
+void bench_submit(BenchDevice *bd, VkCommandBuffer cmdbuffer, VkFence fence)
+{
+	vkEndCommandBuffer(cmdbuffer);
+	VkCommandBufferSubmitInfo cmd_submit_info = {};
+	cmd_submit_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	cmd_submit_info.commandBuffer = cmdbuffer;
+	VkSubmitInfo2 submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submit_info.commandBufferInfoCount = 1;
+	submit_info.pCommandBufferInfos = &cmd_submit_info;
+	vkQueueSubmit2(bd->_queue, 1, &submit_info, fence);
+	if (fence == VK_NULL_HANDLE) vkQueueWaitIdle(bd->_queue);
+};
+
+bool create_bench_timer(BenchTimer *timer, BenchDevice *bd)
+{
+	*timer = (BenchTimer){._bd = bd};
+	uint32_t families_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(bd->_physical_device, &families_count, nullptr);
+	VkQueueFamilyProperties families[families_count];
+	vkGetPhysicalDeviceQueueFamilyProperties(bd->_physical_device, &families_count, families);
+	if (families[bd->_family].timestampValidBits == 0)
+	{
+		SDL_Log("No timestamp support on the bench queue\n");
+		return false;
+	};
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(bd->_physical_device, &properties);
+	timer->_timestamp_period = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo query_create_info = {};
+	query_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_create_info.queryCount = 2;
+	return vkCreateQueryPool(bd->_device, &query_create_info, nullptr, &timer->_queries) == VK_SUCCESS
+		&& bench_allocate_command_buffers(bd, 1, &timer->_cmdbuffer);
+};
+
+void destroy_bench_timer(BenchTimer *timer)
+{
+	if (timer->_bd == nullptr) return;
+	if (timer->_cmdbuffer != VK_NULL_HANDLE) vkFreeCommandBuffers(timer->_bd->_device, timer->_bd->_pool, 1, &timer->_cmdbuffer);
+	if (timer->_queries != VK_NULL_HANDLE) vkDestroyQueryPool(timer->_bd->_device, timer->_queries, nullptr);
+	*timer = (BenchTimer){};
+};
+
+VkCommandBuffer bench_timer_begin(BenchTimer *timer)
+{
+	bench_begin(timer->_cmdbuffer);
+	vkCmdResetQueryPool(timer->_cmdbuffer, timer->_queries, 0, 2);
+	return timer->_cmdbuffer;
+};
+
+void bench_timer_mark(BenchTimer *timer, uint32_t query)
+{
+	vkCmdWriteTimestamp2(timer->_cmdbuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, timer->_queries, query);
+};
+
+double bench_timer_end(BenchTimer *timer)
+{
+	bench_submit(timer->_bd, timer->_cmdbuffer, VK_NULL_HANDLE);
+	uint64_t stamps[2];
+	vkGetQueryPoolResults(timer->_bd->_device, timer->_queries, 0, 2, sizeof(stamps), stamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+	return (double)(stamps[1] - stamps[0]) * timer->_timestamp_period / (double)SDL_NS_PER_MS;
+};
+
+double bench_now_ms(void)
+{
+	return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+};
+
+bool bench_run(const char *name)
+{
+	bool found = false;
+	for (size_t i = 0; i < SDL_arraysize(benchmarks); i++)
+	{
+		if (strcmp(name, "all") != 0 && strcmp(name, benchmarks[i]._name) != 0) continue;
+		SDL_Log("# Benchmark %s\n", benchmarks[i]._name);
+		benchmarks[i]._run();
+		found = true;
+	};
+	if (!found) SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unknown benchmark %s\n", name);
+	return found;
+};
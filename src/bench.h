@@ -0,0 +1,54 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "vk.h"
+
+// Benchmarks run from the command line: homeinvasion --bench <name|all>
+// Each subsystem exposes a void xxx_benchmark(void) that logs its own numbers.
+
+typedef struct
+{
+	VkInstance _instance;
+	VkPhysicalDevice _physical_device;
+	VkDevice _device;
+	// Graphics (and compute) family, queue 0 of it
+	uint32_t _family;
+	VkQueue _queue;
+	// Resettable command buffers of _family
+	VkCommandPool _pool;
+	bool _pipeline_library;
+} BenchDevice;
+
+// No window and no swapchain. Vulkan 1.3 with dynamic rendering and synchronization2, plus
+// graphics pipeline libraries when supported. Destroy it even when creation failed
+bool create_bench_device(BenchDevice *bd);
+void destroy_bench_device(BenchDevice *bd);
+// Just enough of a VulkanState for the helpers taking one
+VulkanState bench_vulkan_state(const BenchDevice *bd);
+bool bench_allocate_command_buffers(BenchDevice *bd, uint32_t count, VkCommandBuffer *cmdbuffers);
+// One time submit
+void bench_begin(VkCommandBuffer cmdbuffer);
+// Ends cmdbuffer and submits it on its own: signals fence, or waits for the queue to idle
+// when fence is VK_NULL_HANDLE
+void bench_submit(BenchDevice *bd, VkCommandBuffer cmdbuffer, VkFence fence);
+
+// GPU time of a pass: one command buffer, a timestamp before and after the part that counts
+typedef struct
+{
+	BenchDevice *_bd;
+	VkCommandBuffer _cmdbuffer;
+	VkQueryPool _queries;
+	// Nanoseconds per tick
+	double _timestamp_period;
+} BenchTimer;
+
+// False when the queue has no timestamps or creation failed. Destroy it either way
+bool create_bench_timer(BenchTimer *timer, BenchDevice *bd);
+void destroy_bench_timer(BenchTimer *timer);
+// Begun with the queries reset. bench_timer_mark 0 before the timed part, 1 after it
+VkCommandBuffer bench_timer_begin(BenchTimer *timer);
+void bench_timer_mark(BenchTimer *timer, uint32_t query);
+// Submits and waits for the queue, returns the ms between the two marks
+double bench_timer_end(BenchTimer *timer);
+
+double bench_now_ms(void);
+bool bench_run(const char *name);
@@ -0,0 +1,360 @@
+#include "capture.h"
+#include "bench.h"
+#include <SDL3_image/SDL_image.h>
+
+// 4 byte formats only, alpha is whatever the scene left there
+static SDL_PixelFormat pixel_format(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB: return SDL_PIXELFORMAT_BGRX32;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+	case VK_FORMAT_A8B8G8R8_SRGB_PACK32: return SDL_PIXELFORMAT_RGBX32;
+	default: return SDL_PIXELFORMAT_UNKNOWN;
+	};
+};
+
+static void encode_job(void *user, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	CaptureSlot *slot = user;
+	int width = (int)slot->_extent.width, height = (int)slot->_extent.height;
+	bool saved = false;
+	if (slot->_format == CAPTURE_PNG)
+	{
+		SDL_Surface *surface = SDL_CreateSurfaceFrom(width, height, slot->_pixel_format, slot->_mapped, width * 4);
+		if (surface != nullptr)
+		{
+			saved = IMG_SavePNG(surface, slot->_path);
+			SDL_DestroySurface(surface);
+		};
+	}
+	else
+	{
+		size_t size = (size_t)width * (size_t)height * 4;
+		SDL_IOStream *io = SDL_IOFromFile(slot->_path, "wb");
+		if (io != nullptr)
+		{
+			saved = SDL_WriteIO(io, slot->_mapped, size) == size;
+			saved = SDL_CloseIO(io) && saved;
+		};
+	};
+	if (!saved) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to save %s: %s\n", slot->_path, SDL_GetError());
+	SDL_SetAtomicInt(&slot->_state, CAPTURE_SLOT_FREE);
+};
+
+static Result create_slots(Capture *cap, VulkanState *vk, VkExtent2D extent)
+{
+	if (!SDL_CreateDirectory(cap->_directory))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create capture directory: %s\n", SDL_GetError());
+		return FAILURE;
+	};
+	// Cached memory is much faster to read on the CPU, when there is a coherent one
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	if (find_memory_type(vk->_physical_device, UINT32_MAX, properties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != UINT32_MAX)
+		properties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	VkDeviceSize size = (VkDeviceSize)extent.width * extent.height * 4;
+	for (uint32_t i = 0; i < CAPTURE_BUFFERS; i++)
+	{
+		CaptureSlot *slot = &cap->_slots[i];
+		if (create_buffer(vk, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties, &slot->_buffer, &slot->_memory) != SUCCESS)
+			return FAILURE;
+		if (vkMapMemory(vk->_device, slot->_memory, 0, VK_WHOLE_SIZE, 0, (void **)&slot->_mapped) != VK_SUCCESS)
+		{
+			slot->_mapped = nullptr;
+			SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map capture buffer\n");
+			return FAILURE;
+		};
+		SDL_SetAtomicInt(&slot->_state, CAPTURE_SLOT_FREE);
+	};
+	cap->_extent = extent;
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Capture ring of %u buffers, %.1f MiB each\n", CAPTURE_BUFFERS,
+			(double)size / (1024.0 * 1024.0));
+	return SUCCESS;
+};
+
+void capture_init(Capture *cap, JobSystem *jobs, const char *directory)
+{
+	*cap = (Capture){._jobs = jobs, ._directory = directory};
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) cap->_pending[i] = UINT32_MAX;
+};
+
+void capture_collect(Capture *cap, uint32_t frame)
+{
+	uint32_t index = cap->_pending[frame];
+	if (index == UINT32_MAX) return;
+	cap->_pending[frame] = UINT32_MAX;
+	SDL_SetAtomicInt(&cap->_slots[index]._state, CAPTURE_SLOT_ENCODING);
+	jobs_submit(cap->_jobs, encode_job, &cap->_slots[index], 0, 1, &cap->_encoding);
+};
+
+void capture_flush(Capture *cap, VulkanState *vk)
+{
+	// The device is idle, copies still pending are done: encode them rather than lose them
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) capture_collect(cap, i);
+	if (cap->_jobs != nullptr) jobs_wait(cap->_jobs, &cap->_encoding);
+	for (uint32_t i = 0; i < CAPTURE_BUFFERS; i++)
+	{
+		CaptureSlot *slot = &cap->_slots[i];
+		if (slot->_buffer == VK_NULL_HANDLE) continue;
+		// A failed create_slots can leave one made but never mapped
+		if (slot->_mapped != nullptr) vkUnmapMemory(vk->_device, slot->_memory);
+		destroy_buffer(vk, slot->_buffer, slot->_memory);
+		slot->_buffer = VK_NULL_HANDLE;
+		slot->_memory = VK_NULL_HANDLE;
+		slot->_mapped = nullptr;
+	};
+	cap->_extent = (VkExtent2D){};
+};
+
+void capture_screenshot(Capture *cap)
+{
+	cap->_screenshot = true;
+};
+
+void capture_toggle_recording(Capture *cap, CaptureFormat format)
+{
+	if (cap->_recording)
+	{
+		SDL_Log("Recording stopped, %u frames, %u dropped\n", cap->_recorded, cap->_dropped);
+		cap->_recording = false;
+		return;
+	};
+	cap->_recording = true;
+	cap->_record_format = format;
+	cap->_recorded = cap->_dropped = 0;
+	SDL_Log("Recording %s frames to %s/\n", format == CAPTURE_PNG ? "PNG" : "raw", cap->_directory);
+};
+
+bool capture_record(Capture *cap, VulkanState *vk, VkCommandBuffer cmdbuffer, VkImage image, VkExtent2D extent,
+		VkFormat format, uint32_t frame)
+{
+	if (!cap->_screenshot && !cap->_recording) return false;
+	SDL_PixelFormat pixels = pixel_format(format);
+	if (pixels == SDL_PIXELFORMAT_UNKNOWN)
+	{
+		if (!cap->_unsupported_logged) SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Can't capture swapchain format %d\n", format);
+		cap->_unsupported_logged = true;
+		cap->_screenshot = cap->_recording = false;
+		return false;
+	};
+	// Buffers of another size were freed by capture_flush
+	if (cap->_extent.width != extent.width || cap->_extent.height != extent.height)
+	{
+		if (create_slots(cap, vk, extent) != SUCCESS)
+		{
+			capture_flush(cap, vk);
+			cap->_screenshot = cap->_recording = false;
+			return false;
+		};
+	};
+
+	uint32_t index = 0;
+	while (index < CAPTURE_BUFFERS && SDL_GetAtomicInt(&cap->_slots[index]._state) != CAPTURE_SLOT_FREE) index++;
+	if (index == CAPTURE_BUFFERS)
+	{
+		// A screenshot waits for the next frame, a recording never makes the game wait
+		if (!cap->_screenshot) cap->_dropped++;
+		return false;
+	};
+	CaptureSlot *slot = &cap->_slots[index];
+	slot->_extent = extent;
+	slot->_pixel_format = pixels;
+	if (cap->_screenshot)
+	{
+		slot->_format = CAPTURE_PNG;
+		SDL_snprintf(slot->_path, sizeof(slot->_path), "%s/screenshot_%u.png", cap->_directory,
+				cap->_screenshots++);
+		SDL_Log("Screenshot %s\n", slot->_path);
+		cap->_screenshot = false;
+		if (cap->_recording) cap->_dropped++;
+	}
+	else
+	{
+		slot->_format = cap->_record_format;
+		SDL_snprintf(slot->_path, sizeof(slot->_path), "%s/frame_%06u.%s", cap->_directory, cap->_recorded++,
+				cap->_record_format == CAPTURE_PNG ? "png" : "raw");
+		if (cap->_recorded == 1 && cap->_record_format == CAPTURE_RAW)
+			SDL_Log("Raw frames are %ux%u, %s\n", extent.width, extent.height, SDL_GetPixelFormatName(pixels));
+	};
+	SDL_SetAtomicInt(&slot->_state, CAPTURE_SLOT_COPYING);
+
+	image_barrier(cmdbuffer, image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = (VkExtent3D){extent.width, extent.height, 1};
+	vkCmdCopyImageToBuffer(cmdbuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->_buffer, 1, &region);
+	memory_barrier(cmdbuffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+	cap->_pending[frame] = index;
+	return true;
+};
+
+typedef struct
+{
+	BenchDevice *_bd;
+	VulkanState *_vk;
+	Capture *_cap;
+	VkExtent2D _extent;
+	VkImage _image;
+	// What the frame is made of, copied into _image each frame
+	VkBuffer _source;
+	VkCommandBuffer _cmdbuffers[MAX_FRAMES_IN_FLIGHT];
+	VkFence _fences[MAX_FRAMES_IN_FLIGHT];
+} CaptureBench;
+
+// A "rendered" frame: the noise copied into the image, then whatever capture_record does
+static void bench_frame(CaptureBench *bench, uint32_t frame, VkFence fence)
+{
+	VkCommandBuffer cmdbuffer = bench->_cmdbuffers[frame];
+	bench_begin(cmdbuffer);
+	image_barrier(cmdbuffer, bench->_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = (VkExtent3D){bench->_extent.width, bench->_extent.height, 1};
+	vkCmdCopyBufferToImage(cmdbuffer, bench->_source, bench->_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	image_barrier(cmdbuffer, bench->_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+	capture_record(bench->_cap, bench->_vk, cmdbuffer, bench->_image, bench->_extent, VK_FORMAT_R8G8B8A8_UNORM, frame);
+	bench_submit(bench->_bd, cmdbuffer, fence);
+};
+
+// Records FRAMES frames at 60 Hz, returns the main thread's busy time per frame. In line: wait
+// for the queue after each frame and encode right there, like a naive screenshot would
+static double bench_record(CaptureBench *bench, CaptureFormat format, bool in_line)
+{
+	constexpr uint32_t FRAMES = 60;
+	constexpr double INTERVAL_MS = 1000.0 / 60.0;
+	Capture *cap = bench->_cap;
+	capture_toggle_recording(cap, format);
+	double busy_ms = 0.0;
+	bool in_flight[MAX_FRAMES_IN_FLIGHT] = {};
+	for (uint32_t f = 0; f < FRAMES + MAX_FRAMES_IN_FLIGHT; f++)
+	{
+		uint32_t frame = f % MAX_FRAMES_IN_FLIGHT;
+		double begin = bench_now_ms();
+		if (in_line)
+		{
+			if (f >= FRAMES) break;
+			bench_frame(bench, 0, VK_NULL_HANDLE);
+			uint32_t index = cap->_pending[0];
+			cap->_pending[0] = UINT32_MAX;
+			if (index != UINT32_MAX) encode_job(&cap->_slots[index], 0, 1, 0);
+			busy_ms += bench_now_ms() - begin;
+			continue;
+		};
+		// The frame loop's wait on the slot's fence, then the readback is only a job submit
+		if (in_flight[frame])
+		{
+			vkWaitForFences(bench->_bd->_device, 1, &bench->_fences[frame], VK_TRUE, UINT64_MAX);
+			vkResetFences(bench->_bd->_device, 1, &bench->_fences[frame]);
+			capture_collect(cap, frame);
+			in_flight[frame] = false;
+		};
+		if (f < FRAMES)
+		{
+			bench_frame(bench, frame, bench->_fences[frame]);
+			in_flight[frame] = true;
+		};
+		double elapsed = bench_now_ms() - begin;
+		busy_ms += elapsed;
+		if (elapsed < INTERVAL_MS) SDL_DelayNS((uint64_t)((INTERVAL_MS - elapsed) * (double)SDL_NS_PER_MS));
+	};
+	jobs_wait(cap->_jobs, &cap->_encoding);
+	capture_toggle_recording(cap, format);
+	return busy_ms / FRAMES;
+};
+
+void capture_benchmark(void)
+{
+	BenchDevice bd = {};
+	if (!create_bench_device(&bd))
+	{
+		SDL_Log("capture: no Vulkan 1.3 device, skipped\n");
+		destroy_bench_device(&bd);
+		return;
+	};
+	JobSystem jobs = {};
+	if (jobs_init(&jobs, 0) != SUCCESS)
+	{
+		destroy_bench_device(&bd);
+		return;
+	};
+	VulkanState vk = bench_vulkan_state(&bd);
+	Capture cap;
+	// Away from the game's own recordings, which it would overwrite and then delete
+	capture_init(&cap, &jobs, "capture/bench");
+	CaptureBench bench = {._bd = &bd, ._vk = &vk, ._cap = &cap, ._extent = {1920, 1080}};
+	VkDeviceMemory image_memory = VK_NULL_HANDLE, source_memory = VK_NULL_HANDLE;
+	VkImageView image_view = VK_NULL_HANDLE;
+	uint32_t *noise = nullptr;
+
+	VkDeviceSize size = (VkDeviceSize)bench._extent.width * bench._extent.height * 4;
+	if (create_image(&vk, bench._extent, VK_FORMAT_R8G8B8A8_UNORM,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				&bench._image, &image_memory, &image_view) != SUCCESS
+		|| create_buffer(&vk, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &bench._source, &source_memory) != SUCCESS
+		|| vkMapMemory(bd._device, source_memory, 0, VK_WHOLE_SIZE, 0, (void **)&noise) != VK_SUCCESS
+		|| !bench_allocate_command_buffers(&bd, MAX_FRAMES_IN_FLIGHT, bench._cmdbuffers))
+	{
+		SDL_Log("capture: setup failed, skipped\n");
+		goto done;
+	};
+	// A smooth gradient with a few bits of noise, closer to a frame than pure noise
+	uint64_t rng = 11;
+	for (uint32_t y = 0; y < bench._extent.height; y++)
+	{
+		for (uint32_t x = 0; x < bench._extent.width; x++)
+		{
+			uint32_t n = (uint32_t)random_next(&rng) & 0x0f0f0f;
+			noise[y * bench._extent.width + x] = (((x >> 3) & 0xff) | (((y >> 2) & 0xff) << 8) | 0x40 << 16 | 0xffu << 24) ^ n;
+		};
+	};
+	VkFenceCreateInfo fence_create_info = {};
+	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) vkCreateFence(bd._device, &fence_create_info, nullptr, &bench._fences[i]);
+
+	double in_line_ms = bench_record(&bench, CAPTURE_PNG, true);
+	double png_ms = bench_record(&bench, CAPTURE_PNG, false);
+	uint32_t png_recorded = cap._recorded, png_dropped = cap._dropped;
+	double raw_ms = bench_record(&bench, CAPTURE_RAW, false);
+	SDL_Log("capture %ux%u, %u buffers on %u workers\n", bench._extent.width, bench._extent.height, CAPTURE_BUFFERS,
+			jobs._worker_count);
+	SDL_Log("capture in line (queue wait + PNG on the main thread) %.3f ms per frame\n", in_line_ms);
+	SDL_Log("capture ring PNG %.3f ms per frame on the main thread, %u frames saved, %u dropped\n", png_ms, png_recorded, png_dropped);
+	SDL_Log("capture ring raw %.3f ms per frame on the main thread, %u frames saved, %u dropped\n", raw_ms, cap._recorded, cap._dropped);
+
+	// Don't leave the bench frames around
+	for (uint32_t i = 0; i < 60; i++)
+	{
+		char path[64];
+		SDL_snprintf(path, sizeof(path), "%s/frame_%06u.png", cap._directory, i);
+		SDL_RemovePath(path);
+		SDL_snprintf(path, sizeof(path), "%s/frame_%06u.raw", cap._directory, i);
+		SDL_RemovePath(path);
+	};
+	SDL_RemovePath(cap._directory);
+
+done:
+	if (bd._device != VK_NULL_HANDLE) vkDeviceWaitIdle(bd._device);
+	capture_flush(&cap, &vk);
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) vkDestroyFence(bd._device, bench._fences[i], nullptr);
+	if (bench._source != VK_NULL_HANDLE)
+	{
+		if (noise != nullptr) vkUnmapMemory(bd._device, source_memory);
+		destroy_buffer(&vk, bench._source, source_memory);
+	};
+	if (bench._image != VK_NULL_HANDLE) destroy_image(&vk, bench._image, image_memory, image_view);
+	jobs_quit(&jobs);
+	destroy_bench_device(&bd);
+};
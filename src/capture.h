@@ -0,0 +1,81 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "vk.h"
+#include "jobs.h"
+
+// Screenshots and gameplay recording without stalling the frame. The presented image is copied
+// into one of a ring of host visible buffers by the frame's own command buffer, the CPU only looks
+// at it once that frame's fence signaled (MAX_FRAMES_IN_FLIGHT frames later, the wait the frame
+// loop does anyway), and PNG or raw encoding runs on the job system. With every buffer still
+// copying or encoding a recorded frame is dropped, the game never waits for the disk.
+// Files go to the directory given to capture_init: screenshot_<n>.png, frame_<n>.png or frame_<n>.raw (tightly packed
+// 4 bytes per pixel in the swapchain's channel order, the size is logged when recording starts).
+
+constexpr uint32_t CAPTURE_BUFFERS = 6;
+
+typedef enum
+{
+	CAPTURE_PNG,
+	CAPTURE_RAW,
+} CaptureFormat;
+
+typedef enum
+{
+	CAPTURE_SLOT_FREE,
+	// Copy recorded, its frame's fence hasn't been seen yet
+	CAPTURE_SLOT_COPYING,
+	// Handed to a worker, which frees it
+	CAPTURE_SLOT_ENCODING,
+} CaptureSlotState;
+
+typedef struct
+{
+	VkBuffer _buffer;
+	VkDeviceMemory _memory;
+	uint8_t *_mapped;
+	SDL_AtomicInt _state;
+	// What the worker needs: pixels are _extent, SDL format _pixel_format
+	VkExtent2D _extent;
+	SDL_PixelFormat _pixel_format;
+	CaptureFormat _format;
+	char _path[64];
+} CaptureSlot;
+
+typedef struct
+{
+	JobSystem *_jobs;
+	JobCounter _encoding;
+	// Made on the first capture
+	const char *_directory;
+	// Buffers are made on the first capture for this size, freed by capture_flush
+	VkExtent2D _extent;
+	CaptureSlot _slots[CAPTURE_BUFFERS];
+	// Per frame in flight: the slot its command buffer copies into, UINT32_MAX for none
+	uint32_t _pending[MAX_FRAMES_IN_FLIGHT];
+
+	bool _screenshot, _recording;
+	CaptureFormat _record_format;
+	uint32_t _screenshots, _recorded, _dropped;
+	// Warned once about a swapchain format it can't encode
+	bool _unsupported_logged;
+} Capture;
+
+void capture_init(Capture *cap, JobSystem *jobs, const char *directory);
+// Wait for the copies in flight and their encoding, and free the buffers. Before the swapchain
+// changes size and at quit, with the device idle
+void capture_flush(Capture *cap, VulkanState *vk);
+
+// Next presented frame to a PNG
+void capture_screenshot(Capture *cap);
+void capture_toggle_recording(Capture *cap, CaptureFormat format);
+
+// Output command buffer of frame, after the last write to image (COLOR_ATTACHMENT_OPTIMAL). True
+// when it copied: image is left in TRANSFER_SRC_OPTIMAL, last used by the copy stage
+bool capture_record(Capture *cap, VulkanState *vk, VkCommandBuffer cmdbuffer, VkImage image, VkExtent2D extent,
+		VkFormat format, uint32_t frame);
+// Once frame's fence signaled: hand its copy to a worker
+void capture_collect(Capture *cap, uint32_t frame);
+
+// homeinvasion --bench capture: main thread time per recorded 1080p frame, read back and encoded
+// in line after a queue wait against the ring and the workers
+void capture_benchmark(void);
@@ -0,0 +1,244 @@
+#include "cctv.h"
+
+Result cctv_init(Cctv *cctv, VulkanState *vk, uint32_t updates_per_frame)
+{
+	*cctv = (Cctv){};
+	cctv->_updates_per_frame = SDL_clamp(updates_per_frame, 1u, CCTV_MAX_CAMERAS);
+
+	constexpr uint32_t ROWS = (CCTV_MAX_CAMERAS + CCTV_ATLAS_COLUMNS - 1) / CCTV_ATLAS_COLUMNS;
+	cctv->_atlas_extent = (VkExtent2D){CCTV_ATLAS_COLUMNS * CCTV_VIEW_WIDTH, ROWS * CCTV_VIEW_HEIGHT};
+	if (create_image(vk, cctv->_atlas_extent, vk->_swapchain_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				&cctv->_atlas, &cctv->_atlas_memory, &cctv->_atlas_view) != SUCCESS)
+		return FAILURE;
+
+	VkSamplerCreateInfo sampler_create_info = {};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(vk->_device, &sampler_create_info, nullptr, &cctv->_sampler) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create CCTV sampler\n");
+		return FAILURE;
+	};
+
+	VkDescriptorSetLayoutBinding layout_binding = {};
+	layout_binding.binding = 0;
+	layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layout_binding.descriptorCount = 1;
+	layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = 1;
+	layout_create_info.pBindings = &layout_binding;
+	if (vkCreateDescriptorSetLayout(vk->_device, &layout_create_info, nullptr, &cctv->_set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create CCTV set layout\n");
+		return FAILURE;
+	};
+
+	VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes = &pool_size;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &cctv->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create CCTV descriptor pool\n");
+		return FAILURE;
+	};
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = cctv->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &cctv->_set_layout;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, &cctv->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate CCTV descriptor set\n");
+		return FAILURE;
+	};
+
+	VkDescriptorImageInfo image_info = {cctv->_sampler, cctv->_atlas_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = cctv->_set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &image_info;
+	vkUpdateDescriptorSets(vk->_device, 1, &write, 0, nullptr);
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	push_constant_range.size = sizeof(CctvParams);
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &cctv->_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	if (vkCreatePipelineLayout(vk->_device, &pipeline_layout_create_info, nullptr, &cctv->_pipeline_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create CCTV pipeline layout\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+Result cctv_build(Cctv *cctv, VulkanState *vk, const char *shader_name)
+{
+	cctv->_module = load_shader_module(vk->_device, shader_name);
+	if (cctv->_module == VK_NULL_HANDLE) return FAILURE;
+	PipelineDesc desc = {
+		._module = cctv->_module,
+		._vert_entry = "vert_main",
+		._frag_entry = "frag_main",
+		._layout = cctv->_pipeline_layout,
+		._color_format = vk->_swapchain_format,
+		._topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		._cull_mode = VK_CULL_MODE_NONE,
+		._blend = PIPELINE_BLEND_NONE,
+	};
+	return create_graphics_pipeline_desc(vk->_device, vk->_pipeline_cache, &desc, &cctv->_pipeline);
+};
+
+void cctv_quit(Cctv *cctv, VulkanState *vk)
+{
+	if (cctv->_atlas != VK_NULL_HANDLE) destroy_image(vk, cctv->_atlas, cctv->_atlas_memory, cctv->_atlas_view);
+	vkDestroyPipeline(vk->_device, cctv->_pipeline, nullptr);
+	vkDestroyShaderModule(vk->_device, cctv->_module, nullptr);
+	vkDestroyPipelineLayout(vk->_device, cctv->_pipeline_layout, nullptr);
+	vkDestroyDescriptorPool(vk->_device, cctv->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, cctv->_set_layout, nullptr);
+	vkDestroySampler(vk->_device, cctv->_sampler, nullptr);
+	*cctv = (Cctv){};
+};
+
+uint32_t cctv_add_camera(Cctv *cctv, const float4 view)
+{
+	if (cctv->_cameras_count == CCTV_MAX_CAMERAS) return UINT32_MAX;
+	CctvCamera *camera = &cctv->_cameras[cctv->_cameras_count];
+	*camera = (CctvCamera){};
+	SDL_memcpy(camera->_view, view, sizeof(float4));
+	return cctv->_cameras_count++;
+};
+
+bool cctv_add_monitor(Cctv *cctv, uint32_t camera, const float2 position, const float2 half_size)
+{
+	if (cctv->_monitors_count == CCTV_MAX_MONITORS || camera >= cctv->_cameras_count) return false;
+	CctvMonitor *monitor = &cctv->_monitors[cctv->_monitors_count++];
+	monitor->_position[0] = position[0];
+	monitor->_position[1] = position[1];
+	monitor->_half_size[0] = half_size[0];
+	monitor->_half_size[1] = half_size[1];
+	monitor->_camera = camera;
+	return true;
+};
+
+static bool monitor_on_screen(const CctvMonitor *monitor, const float4 view)
+{
+	for (uint32_t axis = 0; axis < 2; axis++)
+	{
+		float center = monitor->_position[axis] * view[axis] + view[axis + 2];
+		float extent = monitor->_half_size[axis] * SDL_fabsf(view[axis]);
+		if (SDL_fabsf(center) > 1.0f + extent) return false;
+	};
+	return true;
+};
+
+uint32_t cctv_schedule(Cctv *cctv, const float4 view)
+{
+	cctv->_frame++;
+	cctv->_scheduled_count = 0;
+	for (uint32_t i = 0; i < cctv->_cameras_count; i++) cctv->_cameras[i]._importance = 0.0f;
+	for (uint32_t i = 0; i < cctv->_monitors_count; i++)
+	{
+		const CctvMonitor *monitor = &cctv->_monitors[i];
+		if (monitor_on_screen(monitor, view)) cctv->_cameras[monitor->_camera]._importance = 1.0f;
+	};
+
+	// Highest (frames since the last update) * importance first, K is small so a few linear scans.
+	// Never rendered cameras are as stale as it gets
+	float scores[CCTV_MAX_CAMERAS];
+	for (uint32_t i = 0; i < cctv->_cameras_count; i++)
+	{
+		const CctvCamera *camera = &cctv->_cameras[i];
+		scores[i] = (float)(cctv->_frame - camera->_updated_frame) * camera->_importance;
+	};
+	while (cctv->_scheduled_count < cctv->_updates_per_frame)
+	{
+		uint32_t best = UINT32_MAX;
+		for (uint32_t i = 0; i < cctv->_cameras_count; i++)
+		{
+			if (scores[i] > 0.0f && (best == UINT32_MAX || scores[i] > scores[best])) best = i;
+		};
+		if (best == UINT32_MAX) break;
+		scores[best] = 0.0f;
+		cctv->_cameras[best]._updated_frame = cctv->_frame;
+		cctv->_scheduled[cctv->_scheduled_count++] = best;
+	};
+	return cctv->_scheduled_count;
+};
+
+VkRect2D cctv_tile(const Cctv *cctv, uint32_t camera)
+{
+	int32_t x = (int32_t)((camera % CCTV_ATLAS_COLUMNS) * CCTV_VIEW_WIDTH);
+	int32_t y = (int32_t)((camera / CCTV_ATLAS_COLUMNS) * CCTV_VIEW_HEIGHT);
+	return (VkRect2D){{x, y}, {CCTV_VIEW_WIDTH, CCTV_VIEW_HEIGHT}};
+};
+
+void cctv_record_begin(Cctv *cctv, VkCommandBuffer cmdbuffer)
+{
+	// Last frame's monitors may still be sampling it. The first time there is nothing to keep
+	image_barrier(cmdbuffer, cctv->_atlas,
+			cctv->_ready ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+};
+
+void cctv_record_end(Cctv *cctv, VkCommandBuffer cmdbuffer)
+{
+	image_barrier(cmdbuffer, cctv->_atlas, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	cctv->_ready = true;
+};
+
+void cctv_record_monitors(Cctv *cctv, VkCommandBuffer cmdbuffer, const float4 view, float time)
+{
+	// Before the first update the atlas isn't in a layout it can be sampled in
+	if (!cctv->_ready || cctv->_monitors_count == 0) return;
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, cctv->_pipeline);
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, cctv->_pipeline_layout, 0, 1, &cctv->_set, 0, nullptr);
+
+	float width = (float)cctv->_atlas_extent.width, height = (float)cctv->_atlas_extent.height;
+	CctvParams params = {};
+	SDL_memcpy(params._view, view, sizeof(float4));
+	params._time = time;
+	for (uint32_t i = 0; i < cctv->_monitors_count; i++)
+	{
+		const CctvMonitor *monitor = &cctv->_monitors[i];
+		if (!monitor_on_screen(monitor, view)) continue;
+		const CctvCamera *camera = &cctv->_cameras[monitor->_camera];
+		VkRect2D tile = cctv_tile(cctv, monitor->_camera);
+		params._rect[0] = monitor->_position[0];
+		params._rect[1] = monitor->_position[1];
+		params._rect[2] = monitor->_half_size[0];
+		params._rect[3] = monitor->_half_size[1];
+		// Half a texel in from the edges, bilinear taps stay inside the tile
+		params._tile[0] = ((float)tile.offset.x + 0.5f) / width;
+		params._tile[1] = ((float)tile.offset.y + 0.5f) / height;
+		params._tile[2] = ((float)tile.extent.width - 1.0f) / width;
+		params._tile[3] = ((float)tile.extent.height - 1.0f) / height;
+		params._age = camera->_updated_frame == 0 ? -1.0f : (float)(cctv->_frame - camera->_updated_frame);
+		vkCmdPushConstants(cmdbuffer, cctv->_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				0, sizeof(CctvParams), &params);
+		vkCmdDraw(cmdbuffer, 6, 1, 0, 0);
+	};
+};
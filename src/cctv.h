@@ -0,0 +1,97 @@
+#pragma once
+#include "vk.h"
+
+// Security cameras: secondary views of the house rendered at reduced resolution into tiles of
+// one atlas, shown on monitors in the main view. Only _updates_per_frame cameras are rendered
+// each frame, the stalest weighted by importance first: with equal importance that is round
+// robin, a camera whose monitors are all off screen isn't rendered at all. A wall of
+// CCTV_MAX_CAMERAS monitors costs about _updates_per_frame small views per frame.
+// Camera views go through the same sprite, triangle and particle path as the main view.
+
+constexpr uint32_t CCTV_MAX_CAMERAS = 16;
+constexpr uint32_t CCTV_MAX_MONITORS = 32;
+constexpr uint32_t CCTV_ATLAS_COLUMNS = 4;
+// Per camera, a quarter of 720p on each axis
+constexpr uint32_t CCTV_VIEW_WIDTH = 320;
+constexpr uint32_t CCTV_VIEW_HEIGHT = 180;
+
+typedef struct
+{
+	// World to clip transform: clip = world * view.xy + view.zw
+	float4 _view;
+	// Scales how soon a stale camera is rendered again, 0 never. Set by cctv_schedule
+	float _importance;
+	// Frame it was last rendered on, 0 never
+	uint64_t _updated_frame;
+} CctvCamera;
+
+typedef struct
+{
+	// World rect the feed is drawn in: center and half size
+	float2 _position, _half_size;
+	uint32_t _camera;
+} CctvMonitor;
+
+// Matches Params in shader/cctv.slang, pushed as push constants, one draw per monitor
+typedef struct
+{
+	float4 _view;
+	// Center, half size
+	float4 _rect;
+	// Atlas uv of the tile: offset, size
+	float4 _tile;
+	float _time;
+	// Frames since the feed was rendered, negative for no signal
+	float _age;
+	float _pad[2];
+} CctvParams;
+
+typedef struct
+{
+	uint32_t _cameras_count, _monitors_count;
+	CctvCamera _cameras[CCTV_MAX_CAMERAS];
+	CctvMonitor _monitors[CCTV_MAX_MONITORS];
+	uint32_t _updates_per_frame;
+	uint64_t _frame;
+	// This frame's cameras, from cctv_schedule
+	uint32_t _scheduled_count;
+	uint32_t _scheduled[CCTV_MAX_CAMERAS];
+
+	// Tiles of every camera, same format as the scene so its pipelines render into it
+	VkExtent2D _atlas_extent;
+	VkImage _atlas;
+	VkDeviceMemory _atlas_memory;
+	VkImageView _atlas_view;
+	// Written at least once, its layout is SHADER_READ_ONLY_OPTIMAL between frames
+	bool _ready;
+
+	VkSampler _sampler;
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	VkPipelineLayout _pipeline_layout;
+	VkShaderModule _module;
+	VkPipeline _pipeline;
+} Cctv;
+
+// updates_per_frame: how many camera views are rendered each frame at most
+Result cctv_init(Cctv *cctv, VulkanState *vk, uint32_t updates_per_frame);
+// Compile the monitor pipeline, may run on a worker thread once init is done
+Result cctv_build(Cctv *cctv, VulkanState *vk, const char *shader_name);
+void cctv_quit(Cctv *cctv, VulkanState *vk);
+
+// Returns the camera index, UINT32_MAX when full
+uint32_t cctv_add_camera(Cctv *cctv, const float4 view);
+bool cctv_add_monitor(Cctv *cctv, uint32_t camera, const float2 position, const float2 half_size);
+
+// Pick the cameras to render this frame into _scheduled. Importance comes from whether their
+// monitors are on screen under the main view
+uint32_t cctv_schedule(Cctv *cctv, const float4 view);
+// Viewport of camera in the atlas
+VkRect2D cctv_tile(const Cctv *cctv, uint32_t camera);
+// Outside of rendering, around the scheduled views: the atlas to COLOR_ATTACHMENT_OPTIMAL keeping
+// the other tiles, then back to SHADER_READ_ONLY_OPTIMAL for the monitors
+void cctv_record_begin(Cctv *cctv, VkCommandBuffer cmdbuffer);
+void cctv_record_end(Cctv *cctv, VkCommandBuffer cmdbuffer);
+// Inside rendering of the main view
+void cctv_record_monitors(Cctv *cctv, VkCommandBuffer cmdbuffer, const float4 view, float time);
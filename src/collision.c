@@ -0,0 +1,430 @@
+#include "collision.h"
+#include "bench.h"
+#include <stdlib.h>
+
+static constexpr float SKIN = 1e-3f;
+
+Result collision_bodies_init(CollisionBodies *bodies, uint32_t capacity)
+{
+	bodies->_count = 0;
+	bodies->_capacity = capacity;
+	bodies->_positions = malloc(capacity * sizeof(float2));
+	bodies->_velocities = calloc(capacity, sizeof(float2));
+	bodies->_radii = malloc(capacity * sizeof(float));
+	if (!bodies->_positions || !bodies->_velocities || !bodies->_radii)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate collision bodies\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+uint32_t collision_bodies_add(CollisionBodies *bodies, const float2 position, float radius)
+{
+	if (bodies->_count == bodies->_capacity) return UINT32_MAX;
+	uint32_t i = bodies->_count++;
+	bodies->_positions[i][0] = position[0];
+	bodies->_positions[i][1] = position[1];
+	bodies->_velocities[i][0] = 0.0f;
+	bodies->_velocities[i][1] = 0.0f;
+	bodies->_radii[i] = SDL_min(radius, COLLISION_HASH_CELL * 0.5f);
+	return i;
+};
+
+void collision_bodies_free(CollisionBodies *bodies)
+{
+	free(bodies->_positions);
+	free(bodies->_velocities);
+	free(bodies->_radii);
+	*bodies = (CollisionBodies){};
+};
+
+static uint32_t static_coord(float v, float origin, uint32_t size)
+{
+	int c = (int)SDL_floorf((v - origin) / COLLISION_STATIC_CELL);
+	return (uint32_t)SDL_clamp(c, 0, (int)size - 1);
+};
+
+static void set_segment(float4 s, float ax, float ay, float bx, float by)
+{
+	s[0] = ax;
+	s[1] = ay;
+	s[2] = bx;
+	s[3] = by;
+};
+
+Result collision_init(CollisionWorld *world, Level *level, uint32_t max_bodies)
+{
+	*world = (CollisionWorld){};
+	world->_level = level;
+	world->_segments_count = level->_walls_count + level->_doors_count + level->_furniture_count * 4;
+	world->_doors_begin = level->_walls_count;
+	world->_doors_end = level->_walls_count + level->_doors_count;
+	world->_segments = malloc(world->_segments_count * sizeof(float4));
+
+	world->_origin[0] = level->_min[0];
+	world->_origin[1] = level->_min[1];
+	world->_width = (uint32_t)SDL_ceilf((level->_max[0] - level->_min[0]) / COLLISION_STATIC_CELL);
+	world->_height = (uint32_t)SDL_ceilf((level->_max[1] - level->_min[1]) / COLLISION_STATIC_CELL);
+	uint32_t cells = world->_width * world->_height;
+	world->_cell_offset = calloc(cells + 1, sizeof(uint32_t));
+
+	world->_hash_size = 64;
+	while (world->_hash_size < max_bodies * 2) world->_hash_size *= 2;
+	world->_hash_offset = malloc((world->_hash_size + 1) * sizeof(uint32_t));
+	world->_hash_sorted = malloc(max_bodies * sizeof(uint32_t) + 1);
+	world->_body_bucket = malloc(max_bodies * sizeof(uint32_t) + 1);
+	world->_push = malloc(max_bodies * sizeof(float2) + 1);
+	if (!world->_segments || !world->_cell_offset || !world->_hash_offset || !world->_hash_sorted
+			|| !world->_body_bucket || !world->_push)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate collision world\n");
+		return FAILURE;
+	};
+
+	uint32_t n = 0;
+	for (uint32_t i = 0; i < level->_walls_count; i++)
+	{
+		const WallSegment *w = &level->_walls[i];
+		set_segment(world->_segments[n++], w->_a[0], w->_a[1], w->_b[0], w->_b[1]);
+	};
+	for (uint32_t i = 0; i < level->_doors_count; i++)
+	{
+		const Door *d = &level->_doors[i];
+		set_segment(world->_segments[n++], d->_a[0], d->_a[1], d->_b[0], d->_b[1]);
+	};
+	for (uint32_t i = 0; i < level->_furniture_count; i++)
+	{
+		const Furniture *f = &level->_furniture[i];
+		set_segment(world->_segments[n++], f->_min[0], f->_min[1], f->_max[0], f->_min[1]);
+		set_segment(world->_segments[n++], f->_max[0], f->_min[1], f->_max[0], f->_max[1]);
+		set_segment(world->_segments[n++], f->_max[0], f->_max[1], f->_min[0], f->_max[1]);
+		set_segment(world->_segments[n++], f->_min[0], f->_max[1], f->_min[0], f->_min[1]);
+	};
+
+	// Segments are binned with their bounds grown by the largest radius so a body only looks at its own cell
+	float grow = COLLISION_HASH_CELL * 0.5f;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		uint32_t *fill = pass ? calloc(cells, sizeof(uint32_t)) : nullptr;
+		for (uint32_t i = 0; i < world->_segments_count; i++)
+		{
+			const float *s = world->_segments[i];
+			uint32_t x0 = static_coord(SDL_min(s[0], s[2]) - grow, world->_origin[0], world->_width);
+			uint32_t x1 = static_coord(SDL_max(s[0], s[2]) + grow, world->_origin[0], world->_width);
+			uint32_t y0 = static_coord(SDL_min(s[1], s[3]) - grow, world->_origin[1], world->_height);
+			uint32_t y1 = static_coord(SDL_max(s[1], s[3]) + grow, world->_origin[1], world->_height);
+			for (uint32_t y = y0; y <= y1; y++)
+			{
+				for (uint32_t x = x0; x <= x1; x++)
+				{
+					uint32_t cell = y * world->_width + x;
+					if (pass == 0) world->_cell_offset[cell + 1]++;
+					else world->_cell_segments[world->_cell_offset[cell] + fill[cell]++] = i;
+				};
+			};
+		};
+		if (pass == 0)
+		{
+			for (uint32_t c = 0; c < cells; c++) world->_cell_offset[c + 1] += world->_cell_offset[c];
+			world->_cell_segments = malloc(world->_cell_offset[cells] * sizeof(uint32_t) + 1);
+			if (!world->_cell_segments) return FAILURE;
+		};
+		free(fill);
+	};
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Collision world: %u static segments, %u hash buckets\n",
+			world->_segments_count, world->_hash_size);
+	return SUCCESS;
+};
+
+void collision_quit(CollisionWorld *world)
+{
+	free(world->_segments);
+	free(world->_cell_offset);
+	free(world->_cell_segments);
+	free(world->_hash_offset);
+	free(world->_hash_sorted);
+	free(world->_body_bucket);
+	free(world->_push);
+	*world = (CollisionWorld){};
+};
+
+static bool solid(const CollisionWorld *world, uint32_t segment)
+{
+	if (segment < world->_doors_begin || segment >= world->_doors_end) return true;
+	return !world->_level->_doors[segment - world->_doors_begin]._open;
+};
+
+// Earliest t in [0, 1] where a circle at p moving by d touches the endpoint c
+static bool sweep_point(const float2 p, const float2 d, const float2 c, float r, float *t_out, float2 normal)
+{
+	float mx = p[0] - c[0], my = p[1] - c[1];
+	float a = d[0] * d[0] + d[1] * d[1];
+	float b = mx * d[0] + my * d[1];
+	float k = mx * mx + my * my - r * r;
+	if (b >= 0.0f || a == 0.0f) return false;
+	float disc = b * b - a * k;
+	if (disc < 0.0f) return false;
+	float t = (-b - SDL_sqrtf(disc)) / a;
+	if (t < 0.0f || t > *t_out) return false;
+	*t_out = t;
+	normal[0] = (mx + d[0] * t) / r;
+	normal[1] = (my + d[1] * t) / r;
+	return true;
+};
+
+// Sweep a circle against a segment inflated by r (a capsule). Keeps the earliest hit in t_out/normal
+static void sweep_segment(const float2 p, const float2 d, const float4 s, float r, float *t_out, float2 normal)
+{
+	float ex = s[2] - s[0], ey = s[3] - s[1];
+	float len = SDL_sqrtf(ex * ex + ey * ey);
+	if (len == 0.0f) return;
+	float nx = -ey / len, ny = ex / len;
+	float dist = (p[0] - s[0]) * nx + (p[1] - s[1]) * ny;
+	if (dist < 0.0f)
+	{
+		nx = -nx;
+		ny = -ny;
+		dist = -dist;
+	};
+
+	float approach = d[0] * nx + d[1] * ny;
+	if (approach < 0.0f && dist >= r)
+	{
+		float t = (r - dist) / approach;
+		float qx = p[0] + d[0] * t - s[0], qy = p[1] + d[1] * t - s[1];
+		float u = (qx * ex + qy * ey) / (len * len);
+		if (u >= 0.0f && u <= 1.0f)
+		{
+			if (t <= *t_out)
+			{
+				*t_out = t;
+				normal[0] = nx;
+				normal[1] = ny;
+			};
+			return;
+		};
+	};
+	sweep_point(p, d, &s[0], r, t_out, normal);
+	sweep_point(p, d, &s[2], r, t_out, normal);
+};
+
+// Push a body out of any static segment it already overlaps (spawned inside, door closed on it)
+static void depenetrate(const CollisionWorld *world, uint32_t cell, float2 p, float r)
+{
+	for (uint32_t i = world->_cell_offset[cell]; i < world->_cell_offset[cell + 1]; i++)
+	{
+		uint32_t segment = world->_cell_segments[i];
+		if (!solid(world, segment)) continue;
+		const float *s = world->_segments[segment];
+		float ex = s[2] - s[0], ey = s[3] - s[1];
+		float len2 = ex * ex + ey * ey;
+		float u = len2 > 0.0f ? ((p[0] - s[0]) * ex + (p[1] - s[1]) * ey) / len2 : 0.0f;
+		u = SDL_clamp(u, 0.0f, 1.0f);
+		float dx = p[0] - (s[0] + ex * u), dy = p[1] - (s[1] + ey * u);
+		float dist2 = dx * dx + dy * dy;
+		if (dist2 >= r * r || dist2 == 0.0f) continue;
+		float dist = SDL_sqrtf(dist2);
+		float push = (r - dist + SKIN) / dist;
+		p[0] += dx * push;
+		p[1] += dy * push;
+	};
+};
+
+static void move_body(const CollisionWorld *world, float2 p, float2 v, float r, float dt)
+{
+	float2 d = {v[0] * dt, v[1] * dt};
+	for (uint32_t iteration = 0; iteration < COLLISION_SLIDE_ITERATIONS; iteration++)
+	{
+		if (d[0] == 0.0f && d[1] == 0.0f) break;
+		// Moves are far shorter than a static cell, checking the cells of both ends covers the sweep
+		uint32_t cells[2] = {
+			static_coord(p[1], world->_origin[1], world->_height) * world->_width + static_coord(p[0], world->_origin[0], world->_width),
+			static_coord(p[1] + d[1], world->_origin[1], world->_height) * world->_width + static_coord(p[0] + d[0], world->_origin[0], world->_width),
+		};
+		float t = 1.0f;
+		float2 normal = {0.0f, 0.0f};
+		for (uint32_t c = 0; c < (cells[0] == cells[1] ? 1u : 2u); c++)
+		{
+			for (uint32_t i = world->_cell_offset[cells[c]]; i < world->_cell_offset[cells[c] + 1]; i++)
+			{
+				uint32_t segment = world->_cell_segments[i];
+				if (solid(world, segment)) sweep_segment(p, d, world->_segments[segment], r, &t, normal);
+			};
+		};
+
+		p[0] += d[0] * t;
+		p[1] += d[1] * t;
+		if (t >= 1.0f) break;
+
+		// Slide: keep the tangential part of what is left, and stop pushing into the surface
+		float rest_x = d[0] * (1.0f - t), rest_y = d[1] * (1.0f - t);
+		float into = rest_x * normal[0] + rest_y * normal[1];
+		d[0] = rest_x - normal[0] * into;
+		d[1] = rest_y - normal[1] * into;
+		float vn = v[0] * normal[0] + v[1] * normal[1];
+		if (vn < 0.0f)
+		{
+			v[0] -= normal[0] * vn;
+			v[1] -= normal[1] * vn;
+		};
+		p[0] += normal[0] * SKIN;
+		p[1] += normal[1] * SKIN;
+	};
+	depenetrate(world, static_coord(p[1], world->_origin[1], world->_height) * world->_width
+			+ static_coord(p[0], world->_origin[0], world->_width), p, r);
+};
+
+static uint32_t hash_cell(const CollisionWorld *world, int x, int y)
+{
+	return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u) & (world->_hash_size - 1);
+};
+
+static void resolve_pair(CollisionWorld *world, const CollisionBodies *bodies, uint32_t a, uint32_t b)
+{
+	const float *pa = bodies->_positions[a], *pb = bodies->_positions[b];
+	float dx = pb[0] - pa[0], dy = pb[1] - pa[1];
+	float r = bodies->_radii[a] + bodies->_radii[b];
+	float dist2 = dx * dx + dy * dy;
+	if (dist2 >= r * r) return;
+	float dist = SDL_sqrtf(dist2);
+	if (dist == 0.0f)
+	{
+		dx = 1.0f;
+		dy = 0.0f;
+		dist = 1.0f;
+	};
+	// Equal masses, each moves half the overlap
+	float push = (r - dist) * 0.5f / dist;
+	world->_push[a][0] -= dx * push;
+	world->_push[a][1] -= dy * push;
+	world->_push[b][0] += dx * push;
+	world->_push[b][1] += dy * push;
+};
+
+void collision_step(CollisionWorld *world, CollisionBodies *bodies, float dt)
+{
+	for (uint32_t i = 0; i < bodies->_count; i++)
+	{
+		move_body(world, bodies->_positions[i], bodies->_velocities[i], bodies->_radii[i], dt);
+	};
+
+	// Counting sort of bodies into hash buckets
+	SDL_memset(world->_hash_offset, 0, (world->_hash_size + 1) * sizeof(uint32_t));
+	for (uint32_t i = 0; i < bodies->_count; i++)
+	{
+		int x = (int)SDL_floorf(bodies->_positions[i][0] / COLLISION_HASH_CELL);
+		int y = (int)SDL_floorf(bodies->_positions[i][1] / COLLISION_HASH_CELL);
+		world->_body_bucket[i] = hash_cell(world, x, y);
+		world->_hash_offset[world->_body_bucket[i]]++;
+	};
+	for (uint32_t b = 1; b < world->_hash_size; b++) world->_hash_offset[b] += world->_hash_offset[b - 1];
+	world->_hash_offset[world->_hash_size] = bodies->_count;
+	for (uint32_t i = 0; i < bodies->_count; i++)
+	{
+		// Offsets hold bucket ends, filling backwards leaves them at bucket starts
+		world->_hash_sorted[--world->_hash_offset[world->_body_bucket[i]]] = i;
+	};
+
+	world->_pairs_count = 0;
+	SDL_memset(world->_push, 0, bodies->_count * sizeof(float2));
+	for (uint32_t i = 0; i < bodies->_count; i++)
+	{
+		int x = (int)SDL_floorf(bodies->_positions[i][0] / COLLISION_HASH_CELL);
+		int y = (int)SDL_floorf(bodies->_positions[i][1] / COLLISION_HASH_CELL);
+		// Two of the 9 cells can hash to the same bucket, walking it twice would push that pair twice
+		uint32_t seen[9];
+		uint32_t seen_count = 0;
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				uint32_t bucket = hash_cell(world, x + dx, y + dy);
+				bool visited = false;
+				for (uint32_t s = 0; s < seen_count; s++) visited = visited || seen[s] == bucket;
+				if (visited) continue;
+				seen[seen_count++] = bucket;
+				for (uint32_t k = world->_hash_offset[bucket]; k < world->_hash_offset[bucket + 1]; k++)
+				{
+					// Each pair once: a body is in one bucket, and only the lower index resolves it
+					uint32_t j = world->_hash_sorted[k];
+					if (j <= i) continue;
+					world->_pairs_count++;
+					resolve_pair(world, bodies, i, j);
+				};
+			};
+		};
+	};
+
+	// Separation is swept like any other move, so a crowd can't push someone through a wall
+	for (uint32_t i = 0; i < bodies->_count; i++)
+	{
+		float2 push = {world->_push[i][0], world->_push[i][1]};
+		if (push[0] != 0.0f || push[1] != 0.0f) move_body(world, bodies->_positions[i], push, bodies->_radii[i], 1.0f);
+	};
+};
+
+// # Benchmark
+// Actors wandering in the 50 room house, crowded in a few rooms so the broadphase has work to do
+
+void collision_benchmark(void)
+{
+	constexpr uint32_t STEPS = 600;
+	constexpr float DT = 1.0f / 60.0f;
+	static const uint32_t counts[] = {100, 300, 1000};
+
+	Level level;
+	if (level_generate_house(&level, 10, 5, 8.0f, 1234) != SUCCESS) return;
+
+	for (size_t c = 0; c < SDL_arraysize(counts); c++)
+	{
+		uint32_t count = counts[c];
+		CollisionWorld world = {};
+		CollisionBodies bodies = {};
+		if (collision_init(&world, &level, count) != SUCCESS || collision_bodies_init(&bodies, count) != SUCCESS)
+		{
+			collision_bodies_free(&bodies);
+			collision_quit(&world);
+			level_free(&level);
+			return;
+		};
+
+		uint64_t rng = 99;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const Room *room = &level._rooms[random_next(&rng) % 8];
+			float2 p = {random_range(&rng, room->_min[0] + 0.5f, room->_max[0] - 0.5f),
+				random_range(&rng, room->_min[1] + 0.5f, room->_max[1] - 0.5f)};
+			uint32_t b = collision_bodies_add(&bodies, p, random_range(&rng, 0.2f, 0.4f));
+			float angle = random_range(&rng, -SDL_PI_F, SDL_PI_F);
+			bodies._velocities[b][0] = SDL_cosf(angle) * 3.0f;
+			bodies._velocities[b][1] = SDL_sinf(angle) * 3.0f;
+		};
+
+		uint64_t pairs = 0;
+		double worst = 0.0;
+		double begin = bench_now_ms();
+		for (uint32_t step = 0; step < STEPS; step++)
+		{
+			double step_begin = bench_now_ms();
+			collision_step(&world, &bodies, DT);
+			double step_time = bench_now_ms() - step_begin;
+			worst = SDL_max(worst, step_time);
+			pairs += world._pairs_count;
+		};
+		double elapsed = bench_now_ms() - begin;
+
+		uint32_t escaped = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (level_room_at(&level, bodies._positions[i]) == UINT32_MAX) escaped++;
+		};
+		SDL_Log("collision %u actors: %.4f ms per step (worst %.4f ms), %.0f candidate pairs per step, %u outside the house\n",
+				count, elapsed / STEPS, worst, (double)pairs / STEPS, escaped);
+
+		collision_bodies_free(&bodies);
+		collision_quit(&world);
+	};
+	level_free(&level);
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "level.h"
+
+// 2D collision for actors moving through the house.
+// Actors are circles stored SoA. Every step they are swept against the static geometry
+// (walls, closed doors and furniture edges, all as segments, bucketed in a uniform grid) and
+// slide along what they hit, then actor/actor overlaps are found through a spatial hash
+// rebuilt each step with a counting sort, and pushed apart.
+
+constexpr float COLLISION_STATIC_CELL = 2.0f;
+// Hash cell must be at least the largest actor diameter
+constexpr float COLLISION_HASH_CELL = 1.0f;
+constexpr uint32_t COLLISION_SLIDE_ITERATIONS = 3;
+
+typedef struct
+{
+	uint32_t _count, _capacity;
+	float2 *_positions;
+	float2 *_velocities;
+	float *_radii;
+} CollisionBodies;
+
+typedef struct
+{
+	Level *_level;
+	// Segments: walls, then doors (solid only while closed), then 4 edges per furniture
+	uint32_t _segments_count, _doors_begin, _doors_end;
+	float4 *_segments;
+	float2 _origin;
+	uint32_t _width, _height;
+	uint32_t *_cell_offset, *_cell_segments;
+
+	// Spatial hash for actors, power of two buckets
+	uint32_t _hash_size;
+	uint32_t *_hash_offset;
+	uint32_t *_hash_sorted;
+	uint32_t *_body_bucket;
+	// Separation accumulated from actor pairs, applied as a swept move
+	float2 *_push;
+	uint32_t _pairs_count;
+} CollisionWorld;
+
+Result collision_bodies_init(CollisionBodies *bodies, uint32_t capacity);
+uint32_t collision_bodies_add(CollisionBodies *bodies, const float2 position, float radius);
+void collision_bodies_free(CollisionBodies *bodies);
+
+Result collision_init(CollisionWorld *world, Level *level, uint32_t max_bodies);
+void collision_quit(CollisionWorld *world);
+// Move every body by velocity * dt and resolve collisions
+void collision_step(CollisionWorld *world, CollisionBodies *bodies, float dt);
+
+void collision_benchmark(void);
@@ -0,0 +1,441 @@
+#include "decals.h"
+#include "bench.h"
+
+enum
+{
+	BINDING_STAMPS,
+	BINDING_ROOMS,
+	BINDING_ATLAS,
+	BINDINGS,
+};
+
+static constexpr VkDeviceSize STAMPS_SIZE = MAX_FRAMES_IN_FLIGHT * DECALS_MAX_STAMPS * sizeof(DecalStamp);
+
+Result decals_init(Decals *decals, VulkanState *vk, const Level *level)
+{
+	*decals = (Decals){};
+	decals->_level = level;
+	decals->_rooms_count = SDL_min(level->_rooms_count, DECALS_MAX_ROOMS);
+	if (decals->_rooms_count < level->_rooms_count)
+		SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "%u rooms without a decal tile\n", level->_rooms_count - decals->_rooms_count);
+	for (uint32_t i = 0; i < decals->_rooms_count; i++)
+	{
+		const Room *room = &level->_rooms[i];
+		DecalRoom *tile = &decals->_rooms[i];
+		float longest = SDL_max(room->_max[0] - room->_min[0], room->_max[1] - room->_min[1]);
+		SDL_memcpy(tile->_min, room->_min, sizeof(float2));
+		SDL_memcpy(tile->_max, room->_max, sizeof(float2));
+		tile->_tile_origin[0] = (float)((i % DECALS_ATLAS_COLUMNS) * DECALS_TILE_SIZE);
+		tile->_tile_origin[1] = (float)((i / DECALS_ATLAS_COLUMNS) * DECALS_TILE_SIZE);
+		tile->_texels_per_unit = (float)DECALS_TILE_SIZE / SDL_max(longest, 1e-3f);
+	};
+
+	uint32_t rows = SDL_max((decals->_rooms_count + DECALS_ATLAS_COLUMNS - 1) / DECALS_ATLAS_COLUMNS, 1u);
+	decals->_atlas_extent = (VkExtent2D){DECALS_ATLAS_COLUMNS * DECALS_TILE_SIZE, rows * DECALS_TILE_SIZE};
+	if (create_image(vk, decals->_atlas_extent, DECALS_ATLAS_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				&decals->_atlas, &decals->_atlas_memory, &decals->_atlas_view) != SUCCESS
+		|| create_buffer(vk, STAMPS_SIZE + DECALS_MAX_ROOMS * sizeof(DecalRoom), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &decals->_buffer, &decals->_buffer_memory) != SUCCESS)
+		return FAILURE;
+	if (vkMapMemory(vk->_device, decals->_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void **)&decals->_mapped_stamps) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map decal buffer\n");
+		return FAILURE;
+	};
+	// Rooms never change, written once after the stamps
+	SDL_memcpy((uint8_t *)decals->_mapped_stamps + STAMPS_SIZE, decals->_rooms, decals->_rooms_count * sizeof(DecalRoom));
+
+	VkSamplerCreateInfo sampler_create_info = {};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(vk->_device, &sampler_create_info, nullptr, &decals->_sampler) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create decal sampler\n");
+		return FAILURE;
+	};
+
+	static const VkDescriptorType types[BINDINGS] = {
+		[BINDING_STAMPS] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		[BINDING_ROOMS] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		[BINDING_ATLAS] = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+	};
+	VkDescriptorSetLayoutBinding layout_bindings[BINDINGS] = {};
+	for (uint32_t i = 0; i < BINDINGS; i++)
+	{
+		layout_bindings[i].binding = i;
+		layout_bindings[i].descriptorType = types[i];
+		layout_bindings[i].descriptorCount = 1;
+		layout_bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	};
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = BINDINGS;
+	layout_create_info.pBindings = layout_bindings;
+	if (vkCreateDescriptorSetLayout(vk->_device, &layout_create_info, nullptr, &decals->_set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create decal set layout\n");
+		return FAILURE;
+	};
+
+	VkDescriptorPoolSize pool_sizes[2] = {
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+	};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &decals->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create decal descriptor pool\n");
+		return FAILURE;
+	};
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = decals->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &decals->_set_layout;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, &decals->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate decal descriptor set\n");
+		return FAILURE;
+	};
+
+	VkDescriptorBufferInfo buffer_infos[2] = {
+		{decals->_buffer, 0, STAMPS_SIZE},
+		{decals->_buffer, STAMPS_SIZE, DECALS_MAX_ROOMS * sizeof(DecalRoom)},
+	};
+	// Sampled by the floor quads only, the stamp pass writes it as an attachment
+	VkDescriptorImageInfo image_info = {decals->_sampler, decals->_atlas_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	VkWriteDescriptorSet writes[BINDINGS] = {};
+	for (uint32_t i = 0; i < BINDINGS; i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = decals->_set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = types[i];
+		if (i == BINDING_ATLAS) writes[i].pImageInfo = &image_info;
+		else writes[i].pBufferInfo = &buffer_infos[i];
+	};
+	vkUpdateDescriptorSets(vk->_device, BINDINGS, writes, 0, nullptr);
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	push_constant_range.size = sizeof(DecalParams);
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &decals->_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	if (vkCreatePipelineLayout(vk->_device, &pipeline_layout_create_info, nullptr, &decals->_pipeline_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create decal pipeline layout\n");
+		return FAILURE;
+	};
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Decal atlas %ux%u, %u room tiles of %u texels\n", decals->_atlas_extent.width,
+			decals->_atlas_extent.height, decals->_rooms_count, DECALS_TILE_SIZE);
+	return SUCCESS;
+};
+
+Result decals_build(Decals *decals, VulkanState *vk, const char *shader_name, VkFormat scene_format)
+{
+	decals->_module = load_shader_module(vk->_device, shader_name);
+	if (decals->_module == VK_NULL_HANDLE) return FAILURE;
+	PipelineDesc stamp_desc = {
+		._module = decals->_module,
+		._vert_entry = "stamp_vert_main",
+		._frag_entry = "stamp_frag_main",
+		._layout = decals->_pipeline_layout,
+		._color_format = DECALS_ATLAS_FORMAT,
+		._topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		._cull_mode = VK_CULL_MODE_NONE,
+		._blend = PIPELINE_BLEND_OVER,
+	};
+	PipelineDesc floor_desc = stamp_desc;
+	floor_desc._vert_entry = "floor_vert_main";
+	floor_desc._frag_entry = "floor_frag_main";
+	floor_desc._color_format = scene_format;
+	floor_desc._blend = PIPELINE_BLEND_MULTIPLY;
+	if (create_graphics_pipeline_desc(vk->_device, vk->_pipeline_cache, &stamp_desc, &decals->_stamp_pipeline) != SUCCESS
+		|| create_graphics_pipeline_desc(vk->_device, vk->_pipeline_cache, &floor_desc, &decals->_floor_pipeline) != SUCCESS)
+		return FAILURE;
+	return SUCCESS;
+};
+
+void decals_quit(Decals *decals, VulkanState *vk)
+{
+	vkDestroyPipeline(vk->_device, decals->_stamp_pipeline, nullptr);
+	vkDestroyPipeline(vk->_device, decals->_floor_pipeline, nullptr);
+	vkDestroyShaderModule(vk->_device, decals->_module, nullptr);
+	vkDestroyPipelineLayout(vk->_device, decals->_pipeline_layout, nullptr);
+	vkDestroyDescriptorPool(vk->_device, decals->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, decals->_set_layout, nullptr);
+	vkDestroySampler(vk->_device, decals->_sampler, nullptr);
+	if (decals->_atlas != VK_NULL_HANDLE) destroy_image(vk, decals->_atlas, decals->_atlas_memory, decals->_atlas_view);
+	if (decals->_buffer != VK_NULL_HANDLE)
+	{
+		vkUnmapMemory(vk->_device, decals->_buffer_memory);
+		destroy_buffer(vk, decals->_buffer, decals->_buffer_memory);
+	};
+	*decals = (Decals){};
+};
+
+bool decals_stamp(Decals *decals, DecalKind kind, const float2 position, const float2 half_size, float rotation,
+		const float4 color)
+{
+	if (decals->_level == nullptr) return false;
+	// Rooms the rotated decal's bounding circle reaches
+	float radius = SDL_sqrtf(half_size[0] * half_size[0] + half_size[1] * half_size[1]);
+	uint32_t rooms[DECALS_MAX_ROOMS];
+	uint32_t rooms_count = 0;
+	for (uint32_t i = 0; i < decals->_rooms_count; i++)
+	{
+		const DecalRoom *room = &decals->_rooms[i];
+		if (position[0] + radius <= room->_min[0] || position[0] - radius >= room->_max[0]
+			|| position[1] + radius <= room->_min[1] || position[1] - radius >= room->_max[1])
+			continue;
+		rooms[rooms_count++] = i;
+	};
+	if (rooms_count == 0 || decals->_queued_count + rooms_count > DECALS_MAX_STAMPS) return false;
+
+	uint32_t seed = (uint32_t)decals->_stamped * 2654435761u;
+	for (uint32_t i = 0; i < rooms_count; i++)
+	{
+		const DecalRoom *room = &decals->_rooms[rooms[i]];
+		float scale = room->_texels_per_unit;
+		DecalStamp *stamp = &decals->_queued[decals->_queued_count++];
+		*stamp = (DecalStamp){._rotation = rotation, ._kind = kind, ._seed = seed};
+		for (uint32_t axis = 0; axis < 2; axis++)
+		{
+			stamp->_center[axis] = room->_tile_origin[axis] + (position[axis] - room->_min[axis]) * scale;
+			stamp->_half_size[axis] = half_size[axis] * scale;
+			stamp->_tile[axis] = room->_tile_origin[axis];
+			stamp->_tile[axis + 2] = room->_tile_origin[axis] + (room->_max[axis] - room->_min[axis]) * scale;
+		};
+		SDL_memcpy(stamp->_color, color, sizeof(float4));
+	};
+	decals->_stamped++;
+	return true;
+};
+
+void decals_record_stamp(Decals *decals, VkCommandBuffer cmdbuffer, uint32_t frame)
+{
+	if (decals->_level == nullptr || decals->_stamp_pipeline == VK_NULL_HANDLE) return;
+	// The first pass clears the atlas even with nothing to stamp, the floor can sample it from then on
+	if (decals->_ready && decals->_queued_count == 0) return;
+	uint32_t base = frame * DECALS_MAX_STAMPS;
+	SDL_memcpy(decals->_mapped_stamps + base, decals->_queued, decals->_queued_count * sizeof(DecalStamp));
+
+	// Last frame's floor may still be sampling it
+	image_barrier(cmdbuffer, decals->_atlas,
+			decals->_ready ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+	VkRenderingAttachmentInfo rendering_attachment_info = {};
+	rendering_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	rendering_attachment_info.imageView = decals->_atlas_view;
+	rendering_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	rendering_attachment_info.loadOp = decals->_ready ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	rendering_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	VkRect2D area = {{0, 0}, decals->_atlas_extent};
+	VkRenderingInfo rendering_info = {};
+	rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	rendering_info.renderArea = area;
+	rendering_info.layerCount = 1;
+	rendering_info.colorAttachmentCount = 1;
+	rendering_info.pColorAttachments = &rendering_attachment_info;
+	vkCmdBeginRendering(cmdbuffer, &rendering_info);
+
+	if (decals->_queued_count > 0)
+	{
+		VkViewport viewport = {0.0f, 0.0f, (float)area.extent.width, (float)area.extent.height, 0.0f, 1.0f};
+		vkCmdSetViewport(cmdbuffer, 0, 1, &viewport);
+		vkCmdSetScissor(cmdbuffer, 0, 1, &area);
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, decals->_stamp_pipeline);
+		vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, decals->_pipeline_layout, 0, 1, &decals->_set, 0, nullptr);
+		DecalParams params = {._atlas_size = {(float)area.extent.width, (float)area.extent.height}, ._stamp_base = base};
+		vkCmdPushConstants(cmdbuffer, decals->_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				0, sizeof(DecalParams), &params);
+		// Every queued decal in one draw, blending keeps them in the order they were queued
+		vkCmdDraw(cmdbuffer, 6, decals->_queued_count, 0, 0);
+	};
+	vkCmdEndRendering(cmdbuffer);
+
+	image_barrier(cmdbuffer, decals->_atlas, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	decals->_ready = true;
+	decals->_queued_count = 0;
+};
+
+void decals_record_draw(Decals *decals, VkCommandBuffer cmdbuffer, const float4 view)
+{
+	if (!decals->_ready || decals->_floor_pipeline == VK_NULL_HANDLE) return;
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, decals->_floor_pipeline);
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, decals->_pipeline_layout, 0, 1, &decals->_set, 0, nullptr);
+	DecalParams params = {._atlas_size = {(float)decals->_atlas_extent.width, (float)decals->_atlas_extent.height}};
+	SDL_memcpy(params._view, view, sizeof(float4));
+	vkCmdPushConstants(cmdbuffer, decals->_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			0, sizeof(DecalParams), &params);
+	// One quad per room, one sample per pixel however many decals its tile holds
+	vkCmdDraw(cmdbuffer, 6, decals->_rooms_count, 0, 0);
+};
+
+typedef struct
+{
+	BenchTimer _timer;
+	// Scene target of the floor pass, and the house fitted to it
+	VkExtent2D _extent;
+	VkImage _target;
+	VkImageView _target_view;
+	float4 _view;
+} DecalsBench;
+
+// The stamp pass, or the floor pass into the target, on its own. Returns its GPU time
+static double bench_pass(DecalsBench *bench, Decals *decals, bool floor_pass)
+{
+	VkCommandBuffer cmdbuffer = bench_timer_begin(&bench->_timer);
+	if (floor_pass)
+	{
+		image_barrier(cmdbuffer, bench->_target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+		VkRenderingAttachmentInfo attachment = {};
+		attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		attachment.imageView = bench->_target_view;
+		attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachment.clearValue.color = (VkClearColorValue){{0.5f, 0.5f, 0.5f, 1.0f}};
+		VkRect2D area = {{0, 0}, bench->_extent};
+		VkRenderingInfo rendering_info = {};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		rendering_info.renderArea = area;
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments = &attachment;
+		vkCmdBeginRendering(cmdbuffer, &rendering_info);
+		VkViewport viewport = {0.0f, 0.0f, (float)area.extent.width, (float)area.extent.height, 0.0f, 1.0f};
+		vkCmdSetViewport(cmdbuffer, 0, 1, &viewport);
+		vkCmdSetScissor(cmdbuffer, 0, 1, &area);
+		// The clear is outside the timed part
+		bench_timer_mark(&bench->_timer, 0);
+		decals_record_draw(decals, cmdbuffer, bench->_view);
+		vkCmdEndRendering(cmdbuffer);
+	}
+	else
+	{
+		bench_timer_mark(&bench->_timer, 0);
+		decals_record_stamp(decals, cmdbuffer, 0);
+	};
+	bench_timer_mark(&bench->_timer, 1);
+	return bench_timer_end(&bench->_timer);
+};
+
+static double bench_floor(DecalsBench *bench, Decals *decals)
+{
+	constexpr uint32_t FRAMES = 16;
+	double ms = 0.0;
+	for (uint32_t i = 0; i < FRAMES; i++) ms += bench_pass(bench, decals, true);
+	return ms / FRAMES;
+};
+
+void decals_benchmark(void)
+{
+	constexpr uint32_t DECALS = 16384;
+
+	BenchDevice bd = {};
+	if (!create_bench_device(&bd))
+	{
+		SDL_Log("decals: no Vulkan 1.3 device, skipped\n");
+		destroy_bench_device(&bd);
+		return;
+	};
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(bd._physical_device, &properties);
+
+	Level level;
+	if (level_generate_house(&level, 10, 5, 8.0f, 1234) != SUCCESS)
+	{
+		destroy_bench_device(&bd);
+		return;
+	};
+	VulkanState vk = bench_vulkan_state(&bd);
+	Decals decals = {};
+	DecalsBench bench = {._extent = {1920, 1080}};
+	VkDeviceMemory target_memory = VK_NULL_HANDLE;
+
+	// The house fitted to 1080p, like the game's camera
+	float aspect = (float)bench._extent.width / (float)bench._extent.height;
+	float2 size = {level._max[0] - level._min[0], level._max[1] - level._min[1]};
+	float scale = 0.95f * SDL_min(2.0f / size[0], 2.0f / (size[1] * aspect));
+	bench._view[0] = scale;
+	bench._view[1] = scale * aspect;
+	bench._view[2] = -(level._min[0] + size[0] * 0.5f) * bench._view[0];
+	bench._view[3] = -(level._min[1] + size[1] * 0.5f) * bench._view[1];
+
+	if (decals_init(&decals, &vk, &level) != SUCCESS
+		|| decals_build(&decals, &vk, "decals.spv", VK_FORMAT_R8G8B8A8_UNORM) != SUCCESS
+		|| create_image(&vk, bench._extent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+				&bench._target, &target_memory, &bench._target_view) != SUCCESS
+		|| !create_bench_timer(&bench._timer, &bd))
+	{
+		SDL_Log("decals: setup failed, skipped\n");
+		goto done;
+	};
+
+	// Clears the atlas
+	bench_pass(&bench, &decals, false);
+	double empty_ms = bench_floor(&bench, &decals);
+
+	// Full queues of random decals until all are stamped, a frame's worth per pass
+	uint64_t rng = 7;
+	double stamp_ms = 0.0, queue_ms = 0.0;
+	uint32_t stamped = 0, passes = 0, stamps = 0;
+	while (stamped < DECALS)
+	{
+		double begin = bench_now_ms();
+		while (stamped < DECALS)
+		{
+			float2 position = {random_range(&rng, level._min[0], level._max[0]), random_range(&rng, level._min[1], level._max[1])};
+			float radius = random_range(&rng, 0.2f, 0.8f);
+			float2 half_size = {radius, radius};
+			float4 color = {random_range(&rng, 0.0f, 0.5f), 0.05f, 0.05f, 0.8f};
+			uint32_t queued = decals._queued_count;
+			if (!decals_stamp(&decals, (DecalKind)(stamped % 3), position, half_size, random_range(&rng, 0.0f, 6.28f), color)) break;
+			stamps += decals._queued_count - queued;
+			stamped++;
+		};
+		queue_ms += bench_now_ms() - begin;
+		stamp_ms += bench_pass(&bench, &decals, false);
+		passes++;
+	};
+	double full_ms = bench_floor(&bench, &decals);
+
+	size_t atlas_bytes = (size_t)decals._atlas_extent.width * decals._atlas_extent.height * 4;
+	SDL_Log("decals on %s, %ux%u atlas, %u texel tile per room, %.0f KiB per room\n", properties.deviceName,
+			decals._atlas_extent.width, decals._atlas_extent.height, DECALS_TILE_SIZE,
+			(double)atlas_bytes / decals._rooms_count / 1024.0);
+	SDL_Log("decals stamped %u (%u stamps after splitting by room) in %u passes, %.3f ms GPU and %.3f ms CPU per pass\n",
+			DECALS, stamps, passes, stamp_ms / passes, queue_ms / passes);
+	SDL_Log("decals floor pass at %ux%u: %.3f ms empty, %.3f ms with %u decals, against %.3f ms GPU to stamp them all once\n",
+			bench._extent.width, bench._extent.height, empty_ms, full_ms, DECALS, stamp_ms);
+
+done:
+	destroy_bench_timer(&bench._timer);
+	if (bench._target != VK_NULL_HANDLE) destroy_image(&vk, bench._target, target_memory, bench._target_view);
+	decals_quit(&decals, &vk);
+	level_free(&level);
+	destroy_bench_device(&bd);
+};
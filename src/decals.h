@@ -0,0 +1,108 @@
+#pragma once
+#include "vk.h"
+#include "level.h"
+
+// Footprints, blood and scorch marks, stamped once into persistent per room accumulation tiles
+// instead of being drawn as sprites every frame. Every room of the level owns one fixed size tile
+// of an atlas, so memory is bounded per room whatever the number of decals. Decals queued during
+// a frame are stamped in a single instanced draw into their rooms' tiles (a decal crossing a wall
+// is split per room), then the scene draws one quad per room that samples its tile once and tints
+// the lit floor. Old decals fade under newer ones, nothing is ever removed.
+
+// Texels per tile side, the longest side of a room maps to it
+constexpr uint32_t DECALS_TILE_SIZE = 128;
+constexpr uint32_t DECALS_ATLAS_COLUMNS = 8;
+// Rooms past this have no tile and take no decals
+constexpr uint32_t DECALS_MAX_ROOMS = 64;
+// Queued per frame, after splitting by room
+constexpr uint32_t DECALS_MAX_STAMPS = 1024;
+constexpr VkFormat DECALS_ATLAS_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+typedef enum
+{
+	DECAL_FOOTPRINT,
+	DECAL_BLOOD,
+	DECAL_SCORCH,
+} DecalKind;
+
+// Matches Stamp in shader/decals.slang (std430), in atlas texels
+typedef struct
+{
+	float2 _center, _half_size;
+	// Texel rect of the room's tile, the stamp is clipped to it: min, max
+	float4 _tile;
+	float4 _color;
+	float _rotation;
+	uint32_t _kind;
+	uint32_t _seed;
+	uint32_t _pad;
+} DecalStamp;
+
+// Matches Room in shader/decals.slang (std430)
+typedef struct
+{
+	float2 _min, _max;
+	// Atlas texel of the room's min corner
+	float2 _tile_origin;
+	float _texels_per_unit;
+	float _pad;
+} DecalRoom;
+
+// Matches Params in shader/decals.slang, pushed as push constants
+typedef struct
+{
+	float4 _view;
+	float2 _atlas_size;
+	uint32_t _stamp_base;
+	uint32_t _pad;
+} DecalParams;
+
+typedef struct
+{
+	const Level *_level;
+	uint32_t _rooms_count;
+	DecalRoom _rooms[DECALS_MAX_ROOMS];
+	uint32_t _queued_count;
+	DecalStamp _queued[DECALS_MAX_STAMPS];
+	uint64_t _stamped;
+
+	VkExtent2D _atlas_extent;
+	VkImage _atlas;
+	VkDeviceMemory _atlas_memory;
+	VkImageView _atlas_view;
+	// Cleared by the first stamp pass, SHADER_READ_ONLY_OPTIMAL between frames from then on
+	bool _ready;
+	// Per frame in flight: DECALS_MAX_STAMPS stamps. Then the rooms
+	VkBuffer _buffer;
+	VkDeviceMemory _buffer_memory;
+	DecalStamp *_mapped_stamps;
+
+	VkSampler _sampler;
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	VkPipelineLayout _pipeline_layout;
+	VkShaderModule _module;
+	VkPipeline _stamp_pipeline, _floor_pipeline;
+} Decals;
+
+// A tile for each room of level
+Result decals_init(Decals *decals, VulkanState *vk, const Level *level);
+// Compile the stamp and floor pipelines, the floor one for scenes of scene_format. May run on a
+// worker thread once init is done
+Result decals_build(Decals *decals, VulkanState *vk, const char *shader_name, VkFormat scene_format);
+void decals_quit(Decals *decals, VulkanState *vk);
+
+// Queue a decal for this frame's stamp pass, rotation in radians, alpha of color is its opacity.
+// False, and nothing queued, when this frame's queue can't take it or it is outside every room
+bool decals_stamp(Decals *decals, DecalKind kind, const float2 position, const float2 half_size, float rotation,
+		const float4 color);
+// Outside of rendering: stamp the queued decals into the atlas, frame is the frame in flight slot.
+// Nothing when nothing was queued
+void decals_record_stamp(Decals *decals, VkCommandBuffer cmdbuffer, uint32_t frame);
+// Inside rendering, over the lit floor
+void decals_record_draw(Decals *decals, VkCommandBuffer cmdbuffer, const float4 view);
+
+// homeinvasion --bench decals: GPU and CPU cost of a stamp pass, the floor pass empty and with
+// thousands of decals stamped, and the one time GPU cost of stamping them all
+void decals_benchmark(void);
@@ -0,0 +1,261 @@
+#include "fog.h"
+#include <stdlib.h>
+
+// The origin, then the polygon
+static constexpr uint32_t FRAME_POINTS = VIS_MAX_POLYGON + 1;
+static constexpr VkDeviceSize POINTS_SIZE = MAX_FRAMES_IN_FLIGHT * FRAME_POINTS * sizeof(float2);
+
+enum
+{
+	BINDING_POINTS,
+	BINDING_MASK,
+	BINDINGS,
+};
+
+Result fog_init(Fog *fog, VulkanState *vk, Level *level)
+{
+	*fog = (Fog){};
+	fog->_level = level;
+	fog->_cache = calloc(1, sizeof(VisCache));
+	if (fog->_cache == nullptr || vis_init(&fog->_vis, level) != SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create fog of war visibility\n");
+		return FAILURE;
+	};
+
+	fog->_mask_extent.width = (uint32_t)SDL_ceilf((level->_max[0] - level->_min[0]) * FOG_TEXELS_PER_UNIT);
+	fog->_mask_extent.height = (uint32_t)SDL_ceilf((level->_max[1] - level->_min[1]) * FOG_TEXELS_PER_UNIT);
+	if (create_image(vk, fog->_mask_extent, FOG_MASK_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				&fog->_mask, &fog->_mask_memory, &fog->_mask_view) != SUCCESS
+		|| create_buffer(vk, POINTS_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &fog->_buffer, &fog->_buffer_memory) != SUCCESS)
+		return FAILURE;
+	if (vkMapMemory(vk->_device, fog->_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void **)&fog->_mapped_points) != VK_SUCCESS)
+	{
+		fog->_mapped_points = nullptr;
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map fog buffer\n");
+		return FAILURE;
+	};
+
+	VkSamplerCreateInfo sampler_create_info = {};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(vk->_device, &sampler_create_info, nullptr, &fog->_sampler) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create fog sampler\n");
+		return FAILURE;
+	};
+
+	static const VkDescriptorType types[BINDINGS] = {
+		[BINDING_POINTS] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		[BINDING_MASK] = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+	};
+	VkDescriptorSetLayoutBinding layout_bindings[BINDINGS] = {};
+	for (uint32_t i = 0; i < BINDINGS; i++)
+	{
+		layout_bindings[i].binding = i;
+		layout_bindings[i].descriptorType = types[i];
+		layout_bindings[i].descriptorCount = 1;
+		layout_bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	};
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = BINDINGS;
+	layout_create_info.pBindings = layout_bindings;
+	if (vkCreateDescriptorSetLayout(vk->_device, &layout_create_info, nullptr, &fog->_set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create fog set layout\n");
+		return FAILURE;
+	};
+
+	VkDescriptorPoolSize pool_sizes[2] = {
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+	};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &fog->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create fog descriptor pool\n");
+		return FAILURE;
+	};
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = fog->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &fog->_set_layout;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, &fog->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate fog descriptor set\n");
+		return FAILURE;
+	};
+
+	VkDescriptorBufferInfo buffer_info = {fog->_buffer, 0, POINTS_SIZE};
+	// Sampled by the scene quad only, the mask pass writes it as an attachment
+	VkDescriptorImageInfo image_info = {fog->_sampler, fog->_mask_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	VkWriteDescriptorSet writes[BINDINGS] = {};
+	for (uint32_t i = 0; i < BINDINGS; i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = fog->_set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = types[i];
+	};
+	writes[BINDING_POINTS].pBufferInfo = &buffer_info;
+	writes[BINDING_MASK].pImageInfo = &image_info;
+	vkUpdateDescriptorSets(vk->_device, BINDINGS, writes, 0, nullptr);
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	push_constant_range.size = sizeof(FogParams);
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &fog->_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	if (vkCreatePipelineLayout(vk->_device, &pipeline_layout_create_info, nullptr, &fog->_pipeline_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create fog pipeline layout\n");
+		return FAILURE;
+	};
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Fog of war mask %ux%u\n", fog->_mask_extent.width, fog->_mask_extent.height);
+	return SUCCESS;
+};
+
+Result fog_build(Fog *fog, VulkanState *vk, const char *shader_name, VkFormat scene_format)
+{
+	fog->_module = load_shader_module(vk->_device, shader_name);
+	if (fog->_module == VK_NULL_HANDLE) return FAILURE;
+	PipelineDesc mask_desc = {
+		._module = fog->_module,
+		._vert_entry = "mask_vert_main",
+		._frag_entry = "mask_frag_main",
+		._layout = fog->_pipeline_layout,
+		._color_format = FOG_MASK_FORMAT,
+		._topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		._cull_mode = VK_CULL_MODE_NONE,
+		._blend = PIPELINE_BLEND_NONE,
+	};
+	PipelineDesc scene_desc = mask_desc;
+	scene_desc._vert_entry = "scene_vert_main";
+	scene_desc._frag_entry = "scene_frag_main";
+	scene_desc._color_format = scene_format;
+	scene_desc._blend = PIPELINE_BLEND_MULTIPLY;
+	if (create_graphics_pipeline_desc(vk->_device, vk->_pipeline_cache, &mask_desc, &fog->_mask_pipeline) != SUCCESS
+		|| create_graphics_pipeline_desc(vk->_device, vk->_pipeline_cache, &scene_desc, &fog->_scene_pipeline) != SUCCESS)
+		return FAILURE;
+	return SUCCESS;
+};
+
+void fog_quit(Fog *fog, VulkanState *vk)
+{
+	vkDestroyPipeline(vk->_device, fog->_mask_pipeline, nullptr);
+	vkDestroyPipeline(vk->_device, fog->_scene_pipeline, nullptr);
+	vkDestroyShaderModule(vk->_device, fog->_module, nullptr);
+	vkDestroyPipelineLayout(vk->_device, fog->_pipeline_layout, nullptr);
+	vkDestroyDescriptorPool(vk->_device, fog->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, fog->_set_layout, nullptr);
+	vkDestroySampler(vk->_device, fog->_sampler, nullptr);
+	if (fog->_mask != VK_NULL_HANDLE) destroy_image(vk, fog->_mask, fog->_mask_memory, fog->_mask_view);
+	if (fog->_buffer != VK_NULL_HANDLE)
+	{
+		if (fog->_mapped_points != nullptr) vkUnmapMemory(vk->_device, fog->_buffer_memory);
+		destroy_buffer(vk, fog->_buffer, fog->_buffer_memory);
+	};
+	vis_quit(&fog->_vis);
+	free(fog->_cache);
+	*fog = (Fog){};
+};
+
+void fog_update(Fog *fog, const float2 eye, uint32_t frame)
+{
+	if (fog->_level == nullptr || fog->_mapped_points == nullptr) return;
+	uint32_t misses = fog->_cache->_misses;
+	const VisPolygon *polygon = vis_polygon(&fog->_vis, fog->_cache, 0, eye, FOG_VIEW_RADIUS);
+	// Cached: the mask already shows it
+	if (fog->_cache->_misses == misses && fog->_ready) return;
+	float2 *points = fog->_mapped_points + frame * FRAME_POINTS;
+	SDL_memcpy(points[0], polygon->_origin, sizeof(float2));
+	SDL_memcpy(points + 1, polygon->_points, polygon->_points_count * sizeof(float2));
+	fog->_points_count = polygon->_points_count;
+	fog->_dirty = true;
+};
+
+void fog_record_mask(Fog *fog, VkCommandBuffer cmdbuffer, uint32_t frame)
+{
+	if (!fog->_dirty || fog->_mask_pipeline == VK_NULL_HANDLE) return;
+	// Last frame's scene quad may still be sampling it
+	image_barrier(cmdbuffer, fog->_mask,
+			fog->_ready ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+	VkRenderingAttachmentInfo rendering_attachment_info = {};
+	rendering_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	rendering_attachment_info.imageView = fog->_mask_view;
+	rendering_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	// Unseen everywhere, the fan marks what the player sees
+	rendering_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	rendering_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	VkRect2D area = {{0, 0}, fog->_mask_extent};
+	VkRenderingInfo rendering_info = {};
+	rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	rendering_info.renderArea = area;
+	rendering_info.layerCount = 1;
+	rendering_info.colorAttachmentCount = 1;
+	rendering_info.pColorAttachments = &rendering_attachment_info;
+	vkCmdBeginRendering(cmdbuffer, &rendering_info);
+
+	if (fog->_points_count > 0)
+	{
+		VkViewport viewport = {0.0f, 0.0f, (float)area.extent.width, (float)area.extent.height, 0.0f, 1.0f};
+		vkCmdSetViewport(cmdbuffer, 0, 1, &viewport);
+		vkCmdSetScissor(cmdbuffer, 0, 1, &area);
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, fog->_mask_pipeline);
+		vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, fog->_pipeline_layout, 0, 1, &fog->_set, 0, nullptr);
+		FogParams params = {
+			._level_min = {fog->_level->_min[0], fog->_level->_min[1]},
+			._level_size = {fog->_level->_max[0] - fog->_level->_min[0], fog->_level->_max[1] - fog->_level->_min[1]},
+			._points_base = frame * FRAME_POINTS,
+			._points_count = fog->_points_count,
+		};
+		vkCmdPushConstants(cmdbuffer, fog->_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				0, sizeof(FogParams), &params);
+		// The fan as a list, one triangle per polygon edge, the last one closing it
+		vkCmdDraw(cmdbuffer, 3 * fog->_points_count, 1, 0, 0);
+	};
+	vkCmdEndRendering(cmdbuffer);
+
+	image_barrier(cmdbuffer, fog->_mask, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	fog->_ready = true;
+	fog->_dirty = false;
+};
+
+void fog_record_draw(Fog *fog, VkCommandBuffer cmdbuffer, const float4 view)
+{
+	if (!fog->_ready || fog->_scene_pipeline == VK_NULL_HANDLE) return;
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, fog->_scene_pipeline);
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, fog->_pipeline_layout, 0, 1, &fog->_set, 0, nullptr);
+	FogParams params = {
+		._level_min = {fog->_level->_min[0], fog->_level->_min[1]},
+		._level_size = {fog->_level->_max[0] - fog->_level->_min[0], fog->_level->_max[1] - fog->_level->_min[1]},
+		._hidden = FOG_HIDDEN,
+	};
+	SDL_memcpy(params._view, view, sizeof(float4));
+	vkCmdPushConstants(cmdbuffer, fog->_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			0, sizeof(FogParams), &params);
+	vkCmdDraw(cmdbuffer, 6, 1, 0, 0);
+};
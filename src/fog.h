@@ -0,0 +1,71 @@
+#pragma once
+#include "vk.h"
+#include "level.h"
+#include "visibility.h"
+
+// Fog of war. The player's visibility polygon comes from a VisCache, so it is only rebuilt when
+// the player moves or a door changes, and only then drawn again as a triangle fan into a world
+// space mask over the level. The main view ends with one quad over the level that samples the
+// mask and darkens what the player can't see, sprites and particles included.
+
+constexpr float FOG_TEXELS_PER_UNIT = 4.0f;
+// How far the player sees through open space
+constexpr float FOG_VIEW_RADIUS = 24.0f;
+// Brightness left where the player can't see
+constexpr float FOG_HIDDEN = 0.2f;
+constexpr VkFormat FOG_MASK_FORMAT = VK_FORMAT_R8_UNORM;
+
+// Matches Params in shader/fog.slang, pushed as push constants
+typedef struct
+{
+	float4 _view;
+	float2 _level_min, _level_size;
+	uint32_t _points_base, _points_count;
+	float _hidden;
+	float _pad;
+} FogParams;
+
+typedef struct
+{
+	Level *_level;
+	Visibility _vis;
+	// One viewer, the player
+	VisCache *_cache;
+	// fog_update copied a new polygon into this frame's slot, the mask is drawn from it
+	bool _dirty;
+	uint32_t _points_count;
+
+	VkExtent2D _mask_extent;
+	VkImage _mask;
+	VkDeviceMemory _mask_memory;
+	VkImageView _mask_view;
+	// Drawn once, SHADER_READ_ONLY_OPTIMAL between frames from then on
+	bool _ready;
+	// Per frame in flight: the polygon's origin then its points
+	VkBuffer _buffer;
+	VkDeviceMemory _buffer_memory;
+	float2 *_mapped_points;
+
+	VkSampler _sampler;
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	VkPipelineLayout _pipeline_layout;
+	VkShaderModule _module;
+	VkPipeline _mask_pipeline, _scene_pipeline;
+} Fog;
+
+// A mask over level, and line of sight over its walls and doors
+Result fog_init(Fog *fog, VulkanState *vk, Level *level);
+// Compile the mask and scene pipelines, the scene one for scenes of scene_format. May run on a
+// worker thread once init is done
+Result fog_build(Fog *fog, VulkanState *vk, const char *shader_name, VkFormat scene_format);
+void fog_quit(Fog *fog, VulkanState *vk);
+
+// Before recording frame (the frame in flight slot): the player's polygon from eye, copied for
+// the mask pass when it was rebuilt
+void fog_update(Fog *fog, const float2 eye, uint32_t frame);
+// Outside of rendering: draw the mask again when fog_update changed the polygon
+void fog_record_mask(Fog *fog, VkCommandBuffer cmdbuffer, uint32_t frame);
+// Inside rendering, after everything the fog covers
+void fog_record_draw(Fog *fog, VkCommandBuffer cmdbuffer, const float4 view);
@@ -0,0 +1,279 @@
+#include "gles.h"
+#include "app.h"
+#include "shaders.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+static GLuint compile_shader(GLenum type, const char *name)
+{
+	const EmbeddedShader *embedded = embedded_shader_find(name);
+	if (embedded == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Shader %s is not embedded\n", name);
+		return 0;
+	};
+
+	// Embedded text is NUL terminated
+	const GLchar *src = (const GLchar *)embedded->_code;
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, nullptr);
+	glCompileShader(shader);
+
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to compile %s: %s\n", name, log);
+		glDeleteShader(shader);
+		return 0;
+	};
+	return shader;
+};
+
+static GLuint create_program(const char *vert_name, const char *frag_name)
+{
+	GLuint vert = compile_shader(GL_VERTEX_SHADER, vert_name);
+	GLuint frag = compile_shader(GL_FRAGMENT_SHADER, frag_name);
+	if (vert == 0 || frag == 0) return 0;
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vert);
+	glAttachShader(program, frag);
+	glLinkProgram(program);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to link program: %s\n", log);
+		glDeleteProgram(program);
+		return 0;
+	};
+	return program;
+};
+
+Result gles_init(GlesState *gl, SDL_Window *window)
+{
+	*gl = (GlesState){};
+	gl->_view[0] = 1.0f;
+	gl->_view[1] = 1.0f;
+
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+	gl->_context = SDL_GL_CreateContext(window);
+	if (gl->_context == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create GLES 3 context: %s\n", SDL_GetError());
+		return FAILURE;
+	};
+	if (gladLoadGLES2((GLADloadfunc)SDL_GL_GetProcAddress) == 0 || !GLAD_GL_ES_VERSION_3_0)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to load GLES 3 functions\n");
+		return FAILURE;
+	};
+	SDL_GL_SetSwapInterval(1);
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "# GLES renderer: %s\n", (const char *)glGetString(GL_RENDERER));
+
+	gl->_sprite_program = create_program("sprite.vert", "sprite.frag");
+	if (gl->_sprite_program == 0) return FAILURE;
+	// ES 3.0 has no layout(binding) for blocks
+	glUniformBlockBinding(gl->_sprite_program, glGetUniformBlockIndex(gl->_sprite_program, "View"), 0);
+
+	gl->_staging = malloc(SPRITES_CAPACITY * sizeof(Sprite));
+	if (gl->_staging == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate sprite staging\n");
+		return FAILURE;
+	};
+
+	glGenBuffers(1, &gl->_view_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, gl->_view_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(float4), nullptr, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &gl->_instance_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, gl->_instance_buffer);
+	glBufferData(GL_ARRAY_BUFFER, GLES_STREAM_REGIONS * SPRITES_CAPACITY * sizeof(Sprite), nullptr, GL_STREAM_DRAW);
+
+	// Quad corners come from gl_VertexID, every attribute is per instance
+	glGenVertexArrays(1, &gl->_vao);
+	glBindVertexArray(gl->_vao);
+	for (GLuint i = 0; i < 3; i++)
+	{
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	};
+	glBindVertexArray(0);
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Created GLES sprite renderer, capacity %u\n", SPRITES_CAPACITY);
+	return SUCCESS;
+};
+
+void gles_quit(GlesState *gl)
+{
+	if (gl->_context == nullptr) return;
+	for (uint32_t i = 0; i < GLES_STREAM_REGIONS; i++)
+	{
+		if (gl->_fences[i] != nullptr) glDeleteSync(gl->_fences[i]);
+	};
+	glDeleteVertexArrays(1, &gl->_vao);
+	glDeleteBuffers(1, &gl->_instance_buffer);
+	glDeleteBuffers(1, &gl->_view_buffer);
+	glDeleteProgram(gl->_sprite_program);
+	free(gl->_staging);
+	SDL_GL_DestroyContext(gl->_context);
+};
+
+void gles_begin_frame(GlesState *gl)
+{
+	gl->_count = 0;
+};
+
+bool gles_push_sprite(GlesState *gl, uint32_t layer, const float2 position, const float2 half_size, const float4 color)
+{
+	if (gl->_count == SPRITES_CAPACITY) return false;
+	Sprite *sprite = &gl->_staging[gl->_count++];
+	sprite->_position[0] = position[0];
+	sprite->_position[1] = position[1];
+	sprite->_half_size[0] = half_size[0];
+	sprite->_half_size[1] = half_size[1];
+	SDL_memcpy(sprite->_color, color, sizeof(float4));
+	sprite->_layer = SDL_min(layer, SPRITE_LAYERS - 1);
+	return true;
+};
+
+static bool sprite_visible(const GlesState *gl, const Sprite *sprite)
+{
+	for (int axis = 0; axis < 2; axis++)
+	{
+		float center = sprite->_position[axis] * gl->_view[axis] + gl->_view[axis + 2];
+		float extent = sprite->_half_size[axis] * SDL_fabsf(gl->_view[axis]);
+		if (SDL_fabsf(center) > 1.0f + extent) return false;
+	};
+	return true;
+};
+
+// Cull and counting sort by layer straight into the mapped region, returns the instance count
+static uint32_t stream_sprites(GlesState *gl, Sprite *out)
+{
+	uint32_t offsets[SPRITE_LAYERS] = {};
+	for (uint32_t i = 0; i < gl->_count; i++)
+	{
+		if (sprite_visible(gl, &gl->_staging[i])) offsets[gl->_staging[i]._layer]++;
+		else gl->_staging[i]._layer = UINT32_MAX;
+	};
+
+	uint32_t total = 0;
+	for (uint32_t layer = 0; layer < SPRITE_LAYERS; layer++)
+	{
+		uint32_t count = offsets[layer];
+		offsets[layer] = total;
+		total += count;
+	};
+
+	for (uint32_t i = 0; i < gl->_count; i++)
+	{
+		uint32_t layer = gl->_staging[i]._layer;
+		if (layer != UINT32_MAX) out[offsets[layer]++] = gl->_staging[i];
+	};
+	return total;
+};
+
+void gles_draw(GlesState *gl, SDL_Window *window)
+{
+	int width, height;
+	SDL_GetWindowSizeInPixels(window, &width, &height);
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// The region was last drawn GLES_STREAM_REGIONS frames ago, normally its fence is long signaled
+	uint32_t region = gl->_region;
+	gl->_region = (gl->_region + 1) % GLES_STREAM_REGIONS;
+	if (gl->_fences[region] != nullptr)
+	{
+		glClientWaitSync(gl->_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+		glDeleteSync(gl->_fences[region]);
+		gl->_fences[region] = nullptr;
+	};
+
+	uint32_t count = 0;
+	GLintptr region_offset = (GLintptr)region * SPRITES_CAPACITY * sizeof(Sprite);
+	glBindBuffer(GL_ARRAY_BUFFER, gl->_instance_buffer);
+	if (gl->_count > 0)
+	{
+		// Unsynchronized is safe, the fence above already covers this region
+		Sprite *mapped = glMapBufferRange(GL_ARRAY_BUFFER, region_offset, gl->_count * sizeof(Sprite),
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (mapped != nullptr)
+		{
+			count = stream_sprites(gl, mapped);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		};
+	};
+
+	if (count > 0)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, gl->_view_buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(float4), gl->_view);
+		glBindBufferBase(GL_UNIFORM_BUFFER, 0, gl->_view_buffer);
+
+		glEnable(GL_BLEND);
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+		glUseProgram(gl->_sprite_program);
+		glBindVertexArray(gl->_vao);
+		// No base instance in ES 3.0, point the attributes at this frame's region instead
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (const void *)(region_offset + offsetof(Sprite, _position)));
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (const void *)(region_offset + offsetof(Sprite, _half_size)));
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), (const void *)(region_offset + offsetof(Sprite, _color)));
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+		glBindVertexArray(0);
+	};
+	gl->_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	SDL_GL_SwapWindow(window);
+};
+
+static Result gles_renderer_init(AppState *app)
+{
+	// Nothing is loaded in the background, the first frame is the real one
+	if (gles_init(&app->_gles, app->_window) != SUCCESS) return FAILURE;
+	app->_loaded = true;
+	return SUCCESS;
+};
+
+static void gles_renderer_begin_frame(AppState *app)
+{
+	gles_begin_frame(&app->_gles);
+};
+
+static bool gles_renderer_push_sprite(AppState *app, uint32_t layer, const float2 position, const float2 half_size, const float4 color)
+{
+	return gles_push_sprite(&app->_gles, layer, position, half_size, color);
+};
+
+static void gles_renderer_draw(AppState *app, float dt)
+{
+	gles_draw(&app->_gles, app->_window);
+};
+
+static void gles_renderer_quit(AppState *app)
+{
+	gles_quit(&app->_gles);
+};
+
+const Renderer gles_renderer = {
+	._name = "gles",
+	._window_flags = SDL_WINDOW_OPENGL,
+	._init = gles_renderer_init,
+	._begin_frame = gles_renderer_begin_frame,
+	._push_sprite = gles_renderer_push_sprite,
+	._draw = gles_renderer_draw,
+	._quit = gles_renderer_quit,
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <glad/gles2.h>
+#include "sprites.h"
+
+// OpenGL ES 3.0 backend, for machines where Vulkan is missing or slower (and to compare both
+// under Mesa's software renderers). Sprites use the same layout as the Vulkan path and are drawn
+// with one instanced draw per frame. Instances are streamed into a ring of buffer regions,
+// each guarded by a fence, so mapping never waits on the GPU unless it is a full ring behind.
+// There is no compute in ES 3.0: culling and layer ordering are done on the CPU at draw time.
+
+constexpr uint32_t GLES_STREAM_REGIONS = 3;
+
+typedef struct
+{
+	SDL_GLContext _context;
+	GLuint _sprite_program;
+	GLuint _vao;
+	GLuint _instance_buffer;
+	GLuint _view_buffer;
+	GLsync _fences[GLES_STREAM_REGIONS];
+	uint32_t _region;
+
+	// Pushed sprites, sorted by layer into the stream at draw time
+	Sprite *_staging;
+	uint32_t _count;
+	// World to clip transform: clip = world * view.xy + view.zw
+	float4 _view;
+} GlesState;
+
+Result gles_init(GlesState *gl, SDL_Window *window);
+void gles_quit(GlesState *gl);
+void gles_begin_frame(GlesState *gl);
+bool gles_push_sprite(GlesState *gl, uint32_t layer, const float2 position, const float2 half_size, const float4 color);
+void gles_draw(GlesState *gl, SDL_Window *window);
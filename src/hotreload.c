@@ -0,0 +1,201 @@
+#include "hotreload.h"
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifndef SLANGC_PATH
+#define SLANGC_PATH "slangc"
+#endif
+
+void hotreload_init(HotReload *hr, const char *shader_dir)
+{
+	*hr = (HotReload){};
+	SDL_strlcpy(hr->_dir, shader_dir, sizeof(hr->_dir));
+};
+
+void hotreload_watch(HotReload *hr, const char *source, const char *output,
+		const char *const *entries, uint32_t entries_count,
+		HotReloadBuild build, HotReloadSwap swap, void *user)
+{
+	if (hr->_shaders_count == HOTRELOAD_MAX_SHADERS) return;
+	HotReloadShader *shader = &hr->_shaders[hr->_shaders_count++];
+	shader->_source = source;
+	shader->_output = output;
+	shader->_entries_count = SDL_min(entries_count, HOTRELOAD_MAX_ENTRIES);
+	for (uint32_t i = 0; i < shader->_entries_count; i++) shader->_entries[i] = entries[i];
+	shader->_build = build;
+	shader->_swap = swap;
+	shader->_user = user;
+	SDL_SetAtomicInt(&shader->_ready, 0);
+
+	char path[512];
+	SDL_snprintf(path, sizeof(path), "%s/%s", hr->_dir, source);
+	SDL_PathInfo info;
+	if (SDL_GetPathInfo(path, &info)) shader->_modified = info.modify_time;
+};
+
+static bool compile(HotReload *hr, HotReloadShader *shader, const char *output_path)
+{
+	char source_path[512];
+	SDL_snprintf(source_path, sizeof(source_path), "%s/%s", hr->_dir, shader->_source);
+
+	// Same flags as add_slang_shader_target
+	const char *args[16 + 2 * HOTRELOAD_MAX_ENTRIES] = {
+		SLANGC_PATH, source_path, "-target", "spirv", "-profile", "spirv_1_5",
+		"-emit-spirv-directly", "-fvk-use-entrypoint-name", "-o", output_path,
+	};
+	uint32_t count = 10;
+	for (uint32_t i = 0; i < shader->_entries_count; i++)
+	{
+		args[count++] = "-entry";
+		args[count++] = shader->_entries[i];
+	};
+	args[count] = nullptr;
+
+	// stdio is inherited, slangc prints its diagnostics to our terminal
+	SDL_Process *process = SDL_CreateProcess(args, false);
+	if (process == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to run %s: %s\n", SLANGC_PATH, SDL_GetError());
+		return false;
+	};
+	int exit_code = -1;
+	SDL_WaitProcess(process, true, &exit_code);
+	SDL_DestroyProcess(process);
+	return exit_code == 0;
+};
+
+static void rebuild(HotReload *hr, HotReloadShader *shader)
+{
+	// The previous build hasn't been swapped in yet, its pending pipelines are still referenced
+	while (SDL_GetAtomicInt(&shader->_ready) != 0)
+	{
+		if (SDL_GetAtomicInt(&hr->_quit) != 0) return;
+		SDL_Delay(10);
+	};
+
+	char output_path[512];
+	SDL_snprintf(output_path, sizeof(output_path), "%s/%s", hr->_dir, shader->_output);
+	uint64_t start = SDL_GetTicksNS();
+	if (!compile(hr, shader, output_path))
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Hot reload: %s failed to compile, keeping the old pipelines\n", shader->_source);
+		return;
+	};
+	if (shader->_build(shader->_user, output_path) != SUCCESS)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Hot reload: failed to build pipelines for %s\n", shader->_source);
+		return;
+	};
+	SDL_SetAtomicInt(&shader->_ready, 1);
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Hot reload: %s rebuilt in %.1f ms\n", shader->_source,
+			(double)(SDL_GetTicksNS() - start) / (double)SDL_NS_PER_MS);
+};
+
+#ifdef __linux__
+static int watch_thread(void *data)
+{
+	HotReload *hr = data;
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// Editors either rewrite the file or rename a temporary over it
+	if (fd < 0 || inotify_add_watch(fd, hr->_dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Hot reload: can't watch %s\n", hr->_dir);
+		if (fd >= 0) close(fd);
+		return 1;
+	};
+
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	while (SDL_GetAtomicInt(&hr->_quit) == 0)
+	{
+		struct pollfd pfd = {fd, POLLIN, 0};
+		if (poll(&pfd, 1, 100) <= 0) continue;
+
+		// One save can produce several events, collect them first then rebuild each shader once
+		bool changed[HOTRELOAD_MAX_SHADERS] = {};
+		ssize_t length;
+		while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char *at = buffer; at < buffer + length;)
+			{
+				const struct inotify_event *event = (const struct inotify_event *)at;
+				for (uint32_t i = 0; event->len > 0 && i < hr->_shaders_count; i++)
+				{
+					if (SDL_strcmp(event->name, hr->_shaders[i]._source) == 0) changed[i] = true;
+				};
+				at += sizeof(struct inotify_event) + event->len;
+			};
+		};
+
+		for (uint32_t i = 0; i < hr->_shaders_count; i++)
+		{
+			if (changed[i]) rebuild(hr, &hr->_shaders[i]);
+		};
+	};
+	close(fd);
+	return 0;
+};
+#else
+static int watch_thread(void *data)
+{
+	HotReload *hr = data;
+	while (SDL_GetAtomicInt(&hr->_quit) == 0)
+	{
+		SDL_Delay(250);
+		for (uint32_t i = 0; i < hr->_shaders_count; i++)
+		{
+			HotReloadShader *shader = &hr->_shaders[i];
+			char path[512];
+			SDL_snprintf(path, sizeof(path), "%s/%s", hr->_dir, shader->_source);
+			SDL_PathInfo info;
+			if (!SDL_GetPathInfo(path, &info) || info.modify_time == shader->_modified) continue;
+			shader->_modified = info.modify_time;
+			rebuild(hr, shader);
+		};
+	};
+	return 0;
+};
+#endif
+
+Result hotreload_start(HotReload *hr)
+{
+	SDL_SetAtomicInt(&hr->_quit, 0);
+	hr->_thread = SDL_CreateThread(watch_thread, "shader hot reload", hr);
+	if (hr->_thread == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to start shader hot reload: %s\n", SDL_GetError());
+		return FAILURE;
+	};
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Watching %s for shader changes\n", hr->_dir);
+	return SUCCESS;
+};
+
+bool hotreload_ready(const HotReload *hr)
+{
+	for (uint32_t i = 0; i < hr->_shaders_count; i++)
+	{
+		if (SDL_GetAtomicInt((SDL_AtomicInt *)&hr->_shaders[i]._ready) != 0) return true;
+	};
+	return false;
+};
+
+void hotreload_apply(HotReload *hr)
+{
+	for (uint32_t i = 0; i < hr->_shaders_count; i++)
+	{
+		HotReloadShader *shader = &hr->_shaders[i];
+		if (SDL_GetAtomicInt(&shader->_ready) == 0) continue;
+		shader->_swap(shader->_user);
+		SDL_SetAtomicInt(&shader->_ready, 0);
+	};
+};
+
+void hotreload_quit(HotReload *hr)
+{
+	if (hr->_thread == nullptr) return;
+	SDL_SetAtomicInt(&hr->_quit, 1);
+	SDL_WaitThread(hr->_thread, nullptr);
+	hr->_thread = nullptr;
+};
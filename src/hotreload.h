@@ -0,0 +1,52 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "octopus.h"
+
+// Development mode shader hot reload (--hot-reload).
+// A background thread watches the shader directory (inotify on Linux, polling elsewhere),
+// recompiles a changed .slang with slangc and calls the shader's build callback, still on that
+// thread, so pipeline creation never stalls a frame. The main thread swaps the new pipelines
+// in between frames with hotreload_apply.
+
+constexpr uint32_t HOTRELOAD_MAX_SHADERS = 16;
+constexpr uint32_t HOTRELOAD_MAX_ENTRIES = 8;
+
+// Background thread: create pending pipelines from the freshly compiled module
+typedef Result (*HotReloadBuild)(void *user, const char *spv_path);
+// Main thread, nothing in flight: replace the live pipelines with the pending ones
+typedef void (*HotReloadSwap)(void *user);
+
+typedef struct
+{
+	// File names inside the shader directory
+	const char *_source, *_output;
+	const char *_entries[HOTRELOAD_MAX_ENTRIES];
+	uint32_t _entries_count;
+	HotReloadBuild _build;
+	HotReloadSwap _swap;
+	void *_user;
+	// Set by the watcher once pending pipelines are built, cleared by hotreload_apply
+	SDL_AtomicInt _ready;
+	SDL_Time _modified;
+} HotReloadShader;
+
+typedef struct
+{
+	char _dir[256];
+	SDL_Thread *_thread;
+	SDL_AtomicInt _quit;
+	uint32_t _shaders_count;
+	HotReloadShader _shaders[HOTRELOAD_MAX_SHADERS];
+} HotReload;
+
+void hotreload_init(HotReload *hr, const char *shader_dir);
+// Register before hotreload_start. Entries are the same as the shader's target in CMakeLists.txt
+void hotreload_watch(HotReload *hr, const char *source, const char *output,
+		const char *const *entries, uint32_t entries_count,
+		HotReloadBuild build, HotReloadSwap swap, void *user);
+Result hotreload_start(HotReload *hr);
+// A rebuilt shader is waiting for hotreload_apply
+bool hotreload_ready(const HotReload *hr);
+// Call between frames, when the GPU no longer uses the current pipelines
+void hotreload_apply(HotReload *hr);
+void hotreload_quit(HotReload *hr);
@@ -0,0 +1,173 @@
+#include "jobs.h"
+
+// Caller must hold the mutex
+static bool pop_job(JobSystem *jobs, Job *job)
+{
+	if (jobs->_head == jobs->_tail) return false;
+	*job = jobs->_queue[jobs->_head % JOBS_QUEUE_SIZE];
+	jobs->_head++;
+	return true;
+};
+
+static void run_job(const Job *job, uint32_t worker)
+{
+	job->_fn(job->_user, job->_begin, job->_end, worker);
+	if (job->_counter) SDL_AddAtomicInt(&job->_counter->_pending, -1);
+};
+
+// UINT32_MAX when every caller slot is taken
+static uint32_t acquire_caller_slot(JobSystem *jobs)
+{
+	for (;;)
+	{
+		int taken = SDL_GetAtomicInt(&jobs->_caller_slots);
+		uint32_t slot = 0;
+		while (slot < JOBS_CALLER_SLOTS && (taken & (1 << slot)) != 0) slot++;
+		if (slot == JOBS_CALLER_SLOTS) return UINT32_MAX;
+		if (SDL_CompareAndSwapAtomicInt(&jobs->_caller_slots, taken, taken | (1 << slot))) return slot;
+	};
+};
+
+static void release_caller_slot(JobSystem *jobs, uint32_t slot)
+{
+	int taken;
+	do taken = SDL_GetAtomicInt(&jobs->_caller_slots);
+	while (!SDL_CompareAndSwapAtomicInt(&jobs->_caller_slots, taken, taken & ~(1 << slot)));
+};
+
+static int worker_main(void *data)
+{
+	JobSystem *jobs = data;
+	uint32_t index = (uint32_t)SDL_AddAtomicInt(&jobs->_started, 1);
+
+	SDL_LockMutex(jobs->_mutex);
+	while (!jobs->_quit)
+	{
+		Job job;
+		if (!pop_job(jobs, &job))
+		{
+			SDL_WaitCondition(jobs->_has_work, jobs->_mutex);
+			continue;
+		};
+		SDL_UnlockMutex(jobs->_mutex);
+		run_job(&job, index);
+		SDL_LockMutex(jobs->_mutex);
+	};
+	SDL_UnlockMutex(jobs->_mutex);
+	return 0;
+};
+
+Result jobs_init(JobSystem *jobs, uint32_t worker_count)
+{
+	if (worker_count == 0)
+	{
+		int cores = SDL_GetNumLogicalCPUCores();
+		worker_count = cores > 1 ? (uint32_t)cores - 1 : 1;
+	};
+	if (worker_count > JOBS_MAX_WORKERS) worker_count = JOBS_MAX_WORKERS;
+
+	jobs->_head = jobs->_tail = 0;
+	jobs->_quit = false;
+	SDL_SetAtomicInt(&jobs->_started, 0);
+	SDL_SetAtomicInt(&jobs->_caller_slots, 0);
+	jobs->_mutex = SDL_CreateMutex();
+	jobs->_has_work = SDL_CreateCondition();
+	if (!jobs->_mutex || !jobs->_has_work)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Failed to create job system mutex\n");
+		return FAILURE;
+	};
+
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		jobs->_threads[i] = SDL_CreateThread(worker_main, "worker", jobs);
+		if (jobs->_threads[i] == nullptr)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Failed to create worker thread\n");
+			jobs->_worker_count = i;
+			return FAILURE;
+		};
+	};
+	jobs->_worker_count = worker_count;
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM, "Started %u worker threads\n", worker_count);
+	return SUCCESS;
+};
+
+void jobs_submit(JobSystem *jobs, JobFn fn, void *user, uint32_t begin, uint32_t end, JobCounter *counter)
+{
+	Job job = {fn, user, begin, end, counter};
+	if (counter) SDL_AddAtomicInt(&counter->_pending, 1);
+
+	SDL_LockMutex(jobs->_mutex);
+	// Queue full, run it here instead of blocking. Not as this thread's worker index, a worker
+	// submitting is in the middle of a job using it
+	if (jobs->_tail - jobs->_head >= JOBS_QUEUE_SIZE)
+	{
+		SDL_UnlockMutex(jobs->_mutex);
+		uint32_t slot;
+		while ((slot = acquire_caller_slot(jobs)) == UINT32_MAX) SDL_DelayNS(0);
+		run_job(&job, jobs->_worker_count + slot);
+		release_caller_slot(jobs, slot);
+		return;
+	};
+	jobs->_queue[jobs->_tail % JOBS_QUEUE_SIZE] = job;
+	jobs->_tail++;
+	SDL_SignalCondition(jobs->_has_work);
+	SDL_UnlockMutex(jobs->_mutex);
+};
+
+void jobs_wait(JobSystem *jobs, JobCounter *counter)
+{
+	while (SDL_GetAtomicInt(&counter->_pending) > 0)
+	{
+		// Only take a job with a slot to run it in
+		uint32_t slot = acquire_caller_slot(jobs);
+		if (slot == UINT32_MAX)
+		{
+			SDL_DelayNS(0);
+			continue;
+		};
+		Job job;
+		SDL_LockMutex(jobs->_mutex);
+		bool found = pop_job(jobs, &job);
+		SDL_UnlockMutex(jobs->_mutex);
+
+		if (found) run_job(&job, jobs->_worker_count + slot);
+		release_caller_slot(jobs, slot);
+		if (!found) SDL_DelayNS(0);
+	};
+};
+
+void jobs_parallel_for(JobSystem *jobs, uint32_t count, uint32_t batch_size, JobFn fn, void *user)
+{
+	if (batch_size == 0) batch_size = 1;
+	JobCounter counter = {};
+	for (uint32_t begin = 0; begin < count; begin += batch_size)
+	{
+		uint32_t end = begin + batch_size < count ? begin + batch_size : count;
+		jobs_submit(jobs, fn, user, begin, end, &counter);
+	};
+	jobs_wait(jobs, &counter);
+};
+
+void jobs_quit(JobSystem *jobs)
+{
+	SDL_LockMutex(jobs->_mutex);
+	jobs->_quit = true;
+	SDL_BroadcastCondition(jobs->_has_work);
+	SDL_UnlockMutex(jobs->_mutex);
+
+	for (uint32_t i = 0; i < jobs->_worker_count; i++)
+	{
+		SDL_WaitThread(jobs->_threads[i], nullptr);
+	};
+	SDL_DestroyCondition(jobs->_has_work);
+	SDL_DestroyMutex(jobs->_mutex);
+	jobs->_worker_count = 0;
+};
+
+uint32_t jobs_slot_count(const JobSystem *jobs)
+{
+	return jobs->_worker_count + JOBS_CALLER_SLOTS;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "octopus.h"
+
+// Small worker pool on SDL threads. Work is split in ranges, every job knows which
+// worker runs it so callers can keep per-worker scratch memory without locking.
+// Workers are indices 0 to _worker_count - 1. A job run by any other thread (the thread in
+// jobs_wait helping, or jobs_submit running it itself on a full queue) gets one of the
+// JOBS_CALLER_SLOTS indices after them, which no other running job has at the same time.
+
+typedef void (*JobFn)(void *user, uint32_t begin, uint32_t end, uint32_t worker);
+
+typedef struct
+{
+	SDL_AtomicInt _pending;
+} JobCounter;
+
+typedef struct
+{
+	JobFn _fn;
+	void *_user;
+	uint32_t _begin, _end;
+	JobCounter *_counter;
+} Job;
+
+constexpr uint32_t JOBS_QUEUE_SIZE = 4096;
+constexpr uint32_t JOBS_MAX_WORKERS = 32;
+constexpr uint32_t JOBS_CALLER_SLOTS = 8;
+
+typedef struct
+{
+	uint32_t _worker_count;
+	SDL_Thread *_threads[JOBS_MAX_WORKERS];
+	// Workers take their index from this when they start
+	SDL_AtomicInt _started;
+	// Bit i: index _worker_count + i is running a job
+	SDL_AtomicInt _caller_slots;
+	SDL_Mutex *_mutex;
+	SDL_Condition *_has_work;
+	Job _queue[JOBS_QUEUE_SIZE];
+	uint32_t _head, _tail;
+	bool _quit;
+} JobSystem;
+
+// worker_count 0 means one worker per logical core minus the calling thread
+Result jobs_init(JobSystem *jobs, uint32_t worker_count);
+void jobs_submit(JobSystem *jobs, JobFn fn, void *user, uint32_t begin, uint32_t end, JobCounter *counter);
+// Block until every job attached to counter is done, running queued jobs meanwhile
+void jobs_wait(JobSystem *jobs, JobCounter *counter);
+// Split [0, count) in batches of batch_size and wait for all of them
+void jobs_parallel_for(JobSystem *jobs, uint32_t count, uint32_t batch_size, JobFn fn, void *user);
+void jobs_quit(JobSystem *jobs);
+// Every worker index a job can get, the size of per-worker scratch arrays
+uint32_t jobs_slot_count(const JobSystem *jobs);
@@ -0,0 +1,197 @@
+#include "level.h"
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+
+static uint32_t find_root(uint32_t *parent, uint32_t i)
+{
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	};
+	return i;
+};
+
+// Emit a wall from a to b along one axis, leaving a gap for the door if there is one
+static void emit_wall(Level *level, float ax, float ay, float bx, float by, const Door *door)
+{
+	if (door == nullptr)
+	{
+		level->_walls[level->_walls_count++] = (WallSegment){{ax, ay}, {bx, by}};
+		return;
+	};
+	level->_walls[level->_walls_count++] = (WallSegment){{ax, ay}, {door->_a[0], door->_a[1]}};
+	level->_walls[level->_walls_count++] = (WallSegment){{door->_b[0], door->_b[1]}, {bx, by}};
+};
+
+Result level_generate_house(Level *level, uint32_t cols, uint32_t rows, float room_size, uint64_t seed)
+{
+	*level = (Level){};
+	uint64_t rng = seed ? seed : 0x9E3779B97F4A7C15ull;
+	uint32_t room_count = cols * rows;
+
+	level->_rooms = calloc(room_count, sizeof(Room));
+	// Candidate doors: one per shared edge. [0, h_edges) are vertical walls between (c, r) and (c + 1, r)
+	uint32_t h_edges = (cols - 1) * rows;
+	uint32_t edge_count = h_edges + cols * (rows - 1);
+	level->_doors = calloc(edge_count, sizeof(Door));
+	int32_t *edge_door = malloc(edge_count * sizeof(int32_t));
+	uint32_t *edge_order = malloc(edge_count * sizeof(uint32_t));
+	uint32_t *parent = malloc(room_count * sizeof(uint32_t));
+	// Worst case both emitted edges of every room are split by a door
+	level->_walls = calloc(room_count * 4 + cols + rows, sizeof(WallSegment));
+	level->_furniture = calloc(room_count * 3, sizeof(Furniture));
+	if (!level->_rooms || !level->_doors || !edge_door || !edge_order || !parent || !level->_walls || !level->_furniture)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate level\n");
+		free(edge_door);
+		free(edge_order);
+		free(parent);
+		level_free(level);
+		return FAILURE;
+	};
+
+	for (uint32_t r = 0; r < rows; r++)
+	{
+		for (uint32_t c = 0; c < cols; c++)
+		{
+			Room *room = &level->_rooms[r * cols + c];
+			room->_min[0] = c * room_size;
+			room->_min[1] = r * room_size;
+			room->_max[0] = (c + 1) * room_size;
+			room->_max[1] = (r + 1) * room_size;
+		};
+	};
+	level->_rooms_count = room_count;
+	level->_min[0] = 0.0f;
+	level->_min[1] = 0.0f;
+	level->_max[0] = cols * room_size;
+	level->_max[1] = rows * room_size;
+
+	// Spanning tree over shuffled edges so every room is reachable, plus some extra doors for loops
+	for (uint32_t i = 0; i < edge_count; i++)
+	{
+		edge_order[i] = i;
+		edge_door[i] = -1;
+	};
+	for (uint32_t i = edge_count; i > 1; i--)
+	{
+		uint32_t j = random_next(&rng) % i;
+		uint32_t tmp = edge_order[i - 1];
+		edge_order[i - 1] = edge_order[j];
+		edge_order[j] = tmp;
+	};
+	for (uint32_t i = 0; i < room_count; i++) parent[i] = i;
+
+	for (uint32_t i = 0; i < edge_count; i++)
+	{
+		uint32_t e = edge_order[i];
+		uint32_t a, b;
+		bool vertical = e < h_edges;
+		if (vertical)
+		{
+			uint32_t r = e / (cols - 1), c = e % (cols - 1);
+			a = r * cols + c;
+			b = a + 1;
+		}
+		else
+		{
+			uint32_t k = e - h_edges;
+			a = k;
+			b = k + cols;
+		};
+
+		uint32_t ra = find_root(parent, a), rb = find_root(parent, b);
+		bool connect = ra != rb;
+		if (connect) parent[ra] = rb;
+		else connect = random_range(&rng, 0.0f, 1.0f) < 0.25f;
+		if (!connect) continue;
+
+		Door *door = &level->_doors[level->_doors_count];
+		door->_rooms[0] = a;
+		door->_rooms[1] = b;
+		door->_open = true;
+		float along = random_range(&rng, 1.0f, room_size - 1.0f - LEVEL_DOOR_WIDTH);
+		const Room *room = &level->_rooms[a];
+		if (vertical)
+		{
+			door->_a[0] = door->_b[0] = room->_max[0];
+			door->_a[1] = room->_min[1] + along;
+			door->_b[1] = door->_a[1] + LEVEL_DOOR_WIDTH;
+		}
+		else
+		{
+			door->_a[1] = door->_b[1] = room->_max[1];
+			door->_a[0] = room->_min[0] + along;
+			door->_b[0] = door->_a[0] + LEVEL_DOOR_WIDTH;
+		};
+		edge_door[e] = (int32_t)level->_doors_count++;
+	};
+
+	// Walls: every room emits its left and top edges, the last column/row also their right/bottom
+	for (uint32_t r = 0; r < rows; r++)
+	{
+		for (uint32_t c = 0; c < cols; c++)
+		{
+			const Room *room = &level->_rooms[r * cols + c];
+			const Door *left = c > 0 && edge_door[r * (cols - 1) + c - 1] >= 0
+				? &level->_doors[edge_door[r * (cols - 1) + c - 1]] : nullptr;
+			const Door *top = r > 0 && edge_door[h_edges + (r - 1) * cols + c] >= 0
+				? &level->_doors[edge_door[h_edges + (r - 1) * cols + c]] : nullptr;
+
+			emit_wall(level, room->_min[0], room->_min[1], room->_min[0], room->_max[1], left);
+			emit_wall(level, room->_min[0], room->_min[1], room->_max[0], room->_min[1], top);
+			if (c == cols - 1) emit_wall(level, room->_max[0], room->_min[1], room->_max[0], room->_max[1], nullptr);
+			if (r == rows - 1) emit_wall(level, room->_min[0], room->_max[1], room->_max[0], room->_max[1], nullptr);
+
+			// Furniture stays 1.5 units away from the walls so it never blocks a door
+			uint32_t pieces = 1 + random_next(&rng) % 3;
+			for (uint32_t i = 0; i < pieces; i++)
+			{
+				Furniture *f = &level->_furniture[level->_furniture_count++];
+				float w = random_range(&rng, 0.6f, 1.6f), h = random_range(&rng, 0.6f, 1.6f);
+				f->_min[0] = random_range(&rng, room->_min[0] + 1.5f, room->_max[0] - 1.5f - w);
+				f->_min[1] = random_range(&rng, room->_min[1] + 1.5f, room->_max[1] - 1.5f - h);
+				f->_max[0] = f->_min[0] + w;
+				f->_max[1] = f->_min[1] + h;
+				f->_room = r * cols + c;
+			};
+		};
+	};
+
+	free(edge_door);
+	free(edge_order);
+	free(parent);
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Generated house: %u rooms, %u doors, %u walls, %u furniture\n",
+			level->_rooms_count, level->_doors_count, level->_walls_count, level->_furniture_count);
+	return SUCCESS;
+};
+
+uint32_t level_room_at(const Level *level, const float2 p)
+{
+	for (uint32_t i = 0; i < level->_rooms_count; i++)
+	{
+		const Room *room = &level->_rooms[i];
+		if (p[0] >= room->_min[0] && p[0] < room->_max[0]
+				&& p[1] >= room->_min[1] && p[1] < room->_max[1])
+			return i;
+	};
+	return UINT32_MAX;
+};
+
+void level_set_door(Level *level, uint32_t door, bool open)
+{
+	if (level->_doors[door]._open == open) return;
+	level->_doors[door]._open = open;
+	level->_doors_version++;
+};
+
+void level_free(Level *level)
+{
+	free(level->_rooms);
+	free(level->_doors);
+	free(level->_walls);
+	free(level->_furniture);
+	*level = (Level){};
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include "octopus.h"
+
+// House layout shared by navigation, collision, visibility and lighting.
+// Units are world units (roughly meters), y grows downward like the screen.
+
+typedef struct
+{
+	float2 _min, _max;
+} Room;
+
+typedef struct
+{
+	// Door is a gap in the wall shared by _rooms[0] and _rooms[1]
+	float2 _a, _b;
+	uint32_t _rooms[2];
+	bool _open;
+} Door;
+
+typedef struct
+{
+	float2 _a, _b;
+} WallSegment;
+
+typedef struct
+{
+	float2 _min, _max;
+	uint32_t _room;
+} Furniture;
+
+typedef struct
+{
+	uint32_t _rooms_count, _doors_count, _walls_count, _furniture_count;
+	Room *_rooms;
+	Door *_doors;
+	WallSegment *_walls;
+	Furniture *_furniture;
+	float2 _min, _max;
+	// Bumped on every door open/close so systems can tell when cached data is stale
+	uint32_t _doors_version;
+} Level;
+
+constexpr float LEVEL_DOOR_WIDTH = 1.2f;
+
+// Generate a cols x rows grid of rooms connected by doors (a spanning tree plus a few loops),
+// with some furniture in each room. Deterministic for a given seed.
+Result level_generate_house(Level *level, uint32_t cols, uint32_t rows, float room_size, uint64_t seed);
+// Returns the room containing p, or UINT32_MAX
+uint32_t level_room_at(const Level *level, const float2 p);
+void level_set_door(Level *level, uint32_t door, bool open);
+void level_free(Level *level);
@@ -0,0 +1,348 @@
+#include "lightmap.h"
+#include "bench.h"
+#include <stdlib.h>
+
+// First texel whose center is at or past offset, along one axis
+static uint32_t texel_begin(float offset)
+{
+	return (uint32_t)SDL_max(SDL_ceilf(offset * LIGHTMAP_TEXELS_PER_UNIT - 0.5f), 0.0f);
+};
+
+// Rooms tile the house, every texel center belongs to exactly one of them
+static void bake_rooms(void *user, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	Lightmap *lm = user;
+	uint32_t *candidates = malloc(SDL_max(lm->_lights_count, 1u) * sizeof(uint32_t));
+	if (!candidates) return;
+	for (uint32_t r = begin; r < end; r++)
+	{
+		const Room *room = &lm->_level->_rooms[r];
+		// Lights spill through doorways, any light reaching the room's rect may light it
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < lm->_lights_count; i++)
+		{
+			const FrameLight *light = &lm->_lights[i];
+			float dx = light->_position[0] - SDL_clamp(light->_position[0], room->_min[0], room->_max[0]);
+			float dy = light->_position[1] - SDL_clamp(light->_position[1], room->_min[1], room->_max[1]);
+			if (dx * dx + dy * dy < light->_radius * light->_radius) candidates[count++] = i;
+		};
+
+		uint32_t x0 = SDL_min(texel_begin(room->_min[0] - lm->_origin[0]), lm->_width);
+		uint32_t x1 = SDL_min(texel_begin(room->_max[0] - lm->_origin[0]), lm->_width);
+		uint32_t y0 = SDL_min(texel_begin(room->_min[1] - lm->_origin[1]), lm->_height);
+		uint32_t y1 = SDL_min(texel_begin(room->_max[1] - lm->_origin[1]), lm->_height);
+		for (uint32_t y = y0; y < y1; y++)
+		{
+			for (uint32_t x = x0; x < x1; x++)
+			{
+				float2 p = {lm->_origin[0] + ((float)x + 0.5f) / LIGHTMAP_TEXELS_PER_UNIT,
+					lm->_origin[1] + ((float)y + 0.5f) / LIGHTMAP_TEXELS_PER_UNIT};
+				float rgb[3] = {};
+				for (uint32_t c = 0; c < count; c++)
+				{
+					const FrameLight *light = &lm->_lights[candidates[c]];
+					float dx = p[0] - light->_position[0], dy = p[1] - light->_position[1];
+					// Same falloff as the dynamic lights in shader/test1.slang
+					float falloff = SDL_clamp(light->_radius - SDL_sqrtf(dx * dx + dy * dy), 0.0f, 1.0f);
+					if (falloff <= 0.0f || !vis_segment_clear(&lm->_vis, light->_position, p)) continue;
+					for (uint32_t k = 0; k < 3; k++) rgb[k] += light->_color[k] * light->_intensity * falloff;
+				};
+				uint8_t *texel = &lm->_texels[(y * lm->_width + x) * 4];
+				for (uint32_t k = 0; k < 3; k++) texel[k] = (uint8_t)SDL_min(rgb[k] / LIGHTMAP_RANGE * 255.0f + 0.5f, 255.0f);
+				texel[3] = 255;
+			};
+		};
+	};
+	free(candidates);
+};
+
+Result lightmap_bake(Lightmap *lm, Level *level, JobSystem *jobs, const FrameLight *lights, uint32_t lights_count)
+{
+	*lm = (Lightmap){};
+	lm->_width = 1;
+	lm->_height = 1;
+	if (level != nullptr)
+	{
+		lm->_origin[0] = level->_min[0];
+		lm->_origin[1] = level->_min[1];
+		lm->_width = SDL_max((uint32_t)SDL_ceilf((level->_max[0] - level->_min[0]) * LIGHTMAP_TEXELS_PER_UNIT), 1u);
+		lm->_height = SDL_max((uint32_t)SDL_ceilf((level->_max[1] - level->_min[1]) * LIGHTMAP_TEXELS_PER_UNIT), 1u);
+	};
+	lm->_texels = calloc((size_t)lm->_width * lm->_height, 4);
+	if (!lm->_texels)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate lightmap\n");
+		return FAILURE;
+	};
+	if (level == nullptr) return SUCCESS;
+
+	uint64_t begin = SDL_GetTicksNS();
+	if (vis_init(&lm->_vis, level) != SUCCESS) return FAILURE;
+	lm->_level = level;
+	lm->_lights = lights;
+	lm->_lights_count = lights_count;
+	if (jobs != nullptr) jobs_parallel_for(jobs, level->_rooms_count, 1, bake_rooms, lm);
+	else bake_rooms(lm, 0, level->_rooms_count, 0);
+	vis_quit(&lm->_vis);
+	lm->_level = nullptr;
+	lm->_lights = nullptr;
+	lm->_lights_count = 0;
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Baked %u static lights into a %ux%u lightmap in %.1f ms\n",
+			lights_count, lm->_width, lm->_height, (double)(SDL_GetTicksNS() - begin) / (double)SDL_NS_PER_MS);
+	return SUCCESS;
+};
+
+Result lightmap_create_set_layout(VkDevice device, VkDescriptorSetLayout *set_layout)
+{
+	VkDescriptorSetLayoutBinding layout_binding = {};
+	layout_binding.binding = 0;
+	layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layout_binding.descriptorCount = 1;
+	layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = 1;
+	layout_create_info.pBindings = &layout_binding;
+	if (vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create lightmap set layout\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+Result lightmap_init(Lightmap *lm, VulkanState *vk)
+{
+	VkDeviceSize size = (VkDeviceSize)lm->_width * lm->_height * 4;
+	if (create_image(vk, (VkExtent2D){lm->_width, lm->_height}, VK_FORMAT_R8G8B8A8_UNORM,
+				VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, &lm->_image, &lm->_image_memory, &lm->_view) != SUCCESS
+		|| create_buffer(vk, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &lm->_staging, &lm->_staging_memory) != SUCCESS)
+		return FAILURE;
+
+	void *mapped = nullptr;
+	if (vkMapMemory(vk->_device, lm->_staging_memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map lightmap staging buffer\n");
+		return FAILURE;
+	};
+	SDL_memcpy(mapped, lm->_texels, size);
+	vkUnmapMemory(vk->_device, lm->_staging_memory);
+
+	VkSamplerCreateInfo sampler_create_info = {};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(vk->_device, &sampler_create_info, nullptr, &lm->_sampler) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create lightmap sampler\n");
+		return FAILURE;
+	};
+	if (lightmap_create_set_layout(vk->_device, &lm->_set_layout) != SUCCESS) return FAILURE;
+
+	VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes = &pool_size;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &lm->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create lightmap descriptor pool\n");
+		return FAILURE;
+	};
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = lm->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &lm->_set_layout;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, &lm->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate lightmap descriptor set\n");
+		return FAILURE;
+	};
+
+	VkDescriptorImageInfo image_info = {lm->_sampler, lm->_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = lm->_set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &image_info;
+	vkUpdateDescriptorSets(vk->_device, 1, &write, 0, nullptr);
+	return SUCCESS;
+};
+
+void lightmap_quit(Lightmap *lm, VulkanState *vk)
+{
+	if (lm->_image != VK_NULL_HANDLE) destroy_image(vk, lm->_image, lm->_image_memory, lm->_view);
+	if (lm->_staging != VK_NULL_HANDLE) destroy_buffer(vk, lm->_staging, lm->_staging_memory);
+	vkDestroyDescriptorPool(vk->_device, lm->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, lm->_set_layout, nullptr);
+	vkDestroySampler(vk->_device, lm->_sampler, nullptr);
+	free(lm->_texels);
+	*lm = (Lightmap){};
+};
+
+void lightmap_record_upload(Lightmap *lm, VkCommandBuffer cmdbuffer)
+{
+	if (lm->_uploaded) return;
+	image_barrier(cmdbuffer, lm->_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = (VkExtent3D){lm->_width, lm->_height, 1};
+	vkCmdCopyBufferToImage(cmdbuffer, lm->_staging, lm->_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	image_barrier(cmdbuffer, lm->_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	lm->_uploaded = true;
+};
+
+void lightmap_transform(const Lightmap *lm, float4 out)
+{
+	out[0] = LIGHTMAP_TEXELS_PER_UNIT / (float)lm->_width;
+	out[1] = LIGHTMAP_TEXELS_PER_UNIT / (float)lm->_height;
+	out[2] = -lm->_origin[0] * out[0];
+	out[3] = -lm->_origin[1] * out[1];
+	// No level: the single black texel everywhere
+	if (lm->_width == 1 && lm->_height == 1)
+	{
+		out[0] = out[1] = 0.0f;
+		out[2] = out[3] = 0.5f;
+	};
+};
+
+// Bilinear fetch, what the sampler does for the shader
+static void sample_lightmap(const Lightmap *lm, const float2 p, float rgb[3])
+{
+	float fx = SDL_clamp((p[0] - lm->_origin[0]) * LIGHTMAP_TEXELS_PER_UNIT - 0.5f, 0.0f, (float)(lm->_width - 1));
+	float fy = SDL_clamp((p[1] - lm->_origin[1]) * LIGHTMAP_TEXELS_PER_UNIT - 0.5f, 0.0f, (float)(lm->_height - 1));
+	uint32_t x0 = (uint32_t)fx, y0 = (uint32_t)fy;
+	uint32_t x1 = SDL_min(x0 + 1, lm->_width - 1), y1 = SDL_min(y0 + 1, lm->_height - 1);
+	float tx = fx - (float)x0, ty = fy - (float)y0;
+	const uint8_t *t00 = &lm->_texels[(y0 * lm->_width + x0) * 4], *t10 = &lm->_texels[(y0 * lm->_width + x1) * 4];
+	const uint8_t *t01 = &lm->_texels[(y1 * lm->_width + x0) * 4], *t11 = &lm->_texels[(y1 * lm->_width + x1) * 4];
+	for (uint32_t k = 0; k < 3; k++)
+	{
+		float top = t00[k] + (t10[k] - t00[k]) * tx, bottom = t01[k] + (t11[k] - t01[k]) * tx;
+		rgb[k] = (top + (bottom - top) * ty) * (LIGHTMAP_RANGE / 255.0f);
+	};
+};
+
+static void add_lights(const FrameLight *lights, uint32_t count, const float2 p, float rgb[3])
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float dx = p[0] - lights[i]._position[0], dy = p[1] - lights[i]._position[1];
+		float falloff = SDL_clamp(lights[i]._radius - SDL_sqrtf(dx * dx + dy * dy), 0.0f, 1.0f);
+		for (uint32_t k = 0; k < 3; k++) rgb[k] += lights[i]._color[k] * lights[i]._intensity * falloff;
+	};
+};
+
+void lightmap_benchmark(void)
+{
+	constexpr uint32_t LAMPS_PER_ROOM = 4;
+	// Flashlight and a muzzle flash
+	constexpr uint32_t DYNAMIC_LIGHTS = 2;
+	// Pixels of the shading proxy, spread over the house
+	constexpr uint32_t SAMPLES_X = 480, SAMPLES_Y = 240;
+
+	Level level;
+	if (level_generate_house(&level, 10, 5, 8.0f, 1234) != SUCCESS) return;
+	uint32_t lights_count = level._rooms_count * LAMPS_PER_ROOM;
+	FrameLight *lights = malloc((lights_count + DYNAMIC_LIGHTS) * sizeof(FrameLight));
+	JobSystem jobs;
+	if (!lights || jobs_init(&jobs, 0) != SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lightmap benchmark setup failed\n");
+		free(lights);
+		level_free(&level);
+		return;
+	};
+	uint64_t rng = 7;
+	for (uint32_t i = 0; i < lights_count; i++)
+	{
+		const Room *room = &level._rooms[i / LAMPS_PER_ROOM];
+		lights[i] = (FrameLight){
+			._position = {random_range(&rng, room->_min[0] + 1.0f, room->_max[0] - 1.0f),
+				random_range(&rng, room->_min[1] + 1.0f, room->_max[1] - 1.0f)},
+			._radius = random_range(&rng, 4.0f, 7.0f),
+			._intensity = random_range(&rng, 0.5f, 1.0f),
+			._color = {1.0f, 0.85f, 0.6f, 1.0f},
+		};
+	};
+	for (uint32_t i = 0; i < DYNAMIC_LIGHTS; i++)
+	{
+		lights[lights_count + i] = (FrameLight){._position = {level._max[0] * 0.5f, level._max[1] * 0.5f}, ._radius = 6.0f,
+			._intensity = 1.0f, ._color = {1.0f, 1.0f, 1.0f, 1.0f}};
+	};
+
+	Lightmap serial, parallel;
+	double begin = bench_now_ms();
+	Result baked = lightmap_bake(&serial, &level, nullptr, lights, lights_count);
+	double serial_ms = bench_now_ms() - begin;
+	begin = bench_now_ms();
+	if (baked == SUCCESS) baked = lightmap_bake(&parallel, &level, &jobs, lights, lights_count);
+	double parallel_ms = bench_now_ms() - begin;
+	if (baked != SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lightmap bake failed\n");
+		jobs_quit(&jobs);
+		free(lights);
+		level_free(&level);
+		return;
+	};
+	bool identical = SDL_memcmp(serial._texels, parallel._texels, (size_t)serial._width * serial._height * 4) == 0;
+	SDL_Log("lightmap %u static lights, %ux%u texels: bake %.1f ms on one thread, %.1f ms with %u workers (%s)\n",
+			lights_count, serial._width, serial._height, serial_ms, parallel_ms, jobs._worker_count,
+			identical ? "same texels" : "texels differ");
+
+	// What the scene's fragment shader does per pixel, on the CPU: every lamp as a dynamic light
+	// (without even their shadows) against the baked texels plus the dynamic lights
+	float sink = 0.0f;
+	begin = bench_now_ms();
+	for (uint32_t y = 0; y < SAMPLES_Y; y++)
+	{
+		for (uint32_t x = 0; x < SAMPLES_X; x++)
+		{
+			float2 p = {level._max[0] * ((float)x + 0.5f) / SAMPLES_X, level._max[1] * ((float)y + 0.5f) / SAMPLES_Y};
+			float rgb[3] = {};
+			add_lights(lights, lights_count + DYNAMIC_LIGHTS, p, rgb);
+			sink += rgb[0] + rgb[1] + rgb[2];
+		};
+	};
+	double dynamic_ms = bench_now_ms() - begin;
+	begin = bench_now_ms();
+	for (uint32_t y = 0; y < SAMPLES_Y; y++)
+	{
+		for (uint32_t x = 0; x < SAMPLES_X; x++)
+		{
+			float2 p = {level._max[0] * ((float)x + 0.5f) / SAMPLES_X, level._max[1] * ((float)y + 0.5f) / SAMPLES_Y};
+			float rgb[3];
+			sample_lightmap(&parallel, p, rgb);
+			add_lights(&lights[lights_count], DYNAMIC_LIGHTS, p, rgb);
+			sink += rgb[0] + rgb[1] + rgb[2];
+		};
+	};
+	double baked_ms = bench_now_ms() - begin;
+	double pixels = (double)SAMPLES_X * SAMPLES_Y;
+	SDL_Log("lightmap shading %ux%u pixels: all dynamic %u lights/pixel %.1f ns/pixel, baked + %u dynamic %.1f ns/pixel (%.0f)\n",
+			SAMPLES_X, SAMPLES_Y, lights_count + DYNAMIC_LIGHTS, dynamic_ms * 1e6 / pixels, DYNAMIC_LIGHTS, baked_ms * 1e6 / pixels,
+			(double)sink);
+
+	free(serial._texels);
+	free(parallel._texels);
+	jobs_quit(&jobs);
+	free(lights);
+	level_free(&level);
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include "vk.h"
+#include "jobs.h"
+#include "level.h"
+#include "ring.h"
+#include "visibility.h"
+
+// Baked lighting for the lamps that never move. At load every room's texels are lit by the static
+// lights that reach them, with wall and door shadows, on the job system one room per job. The scene
+// shader samples the result and only loops over the few dynamic lights (flashlight, muzzle
+// flashes) of the ring, so lighting cost follows the dynamic lights alone.
+// Doors are baked as they are at load.
+
+constexpr float LIGHTMAP_TEXELS_PER_UNIT = 4.0f;
+// Texels are RGBA8 irradiance / LIGHTMAP_RANGE, must match shader/test1.slang
+constexpr float LIGHTMAP_RANGE = 4.0f;
+
+typedef struct
+{
+	// Covers the level's bounds, 1x1 black without a level
+	uint32_t _width, _height;
+	float2 _origin;
+	uint8_t *_texels;
+
+	// Bake inputs, only valid during lightmap_bake
+	Level *_level;
+	const FrameLight *_lights;
+	uint32_t _lights_count;
+	Visibility _vis;
+
+	VkImage _image;
+	VkDeviceMemory _image_memory;
+	VkImageView _view;
+	VkBuffer _staging;
+	VkDeviceMemory _staging_memory;
+	// Copied into _image by the first frame, SHADER_READ_ONLY_OPTIMAL from then on
+	bool _uploaded;
+
+	VkSampler _sampler;
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+} Lightmap;
+
+// CPU only. level may be null, jobs too (bake on the calling thread)
+Result lightmap_bake(Lightmap *lm, Level *level, JobSystem *jobs, const FrameLight *lights, uint32_t lights_count);
+// Image and descriptor set of the baked texels, set 1 of the scene pipeline layout
+Result lightmap_init(Lightmap *lm, VulkanState *vk);
+// Set layout on its own, for pipelines built without a lightmap (benchmarks)
+Result lightmap_create_set_layout(VkDevice device, VkDescriptorSetLayout *set_layout);
+void lightmap_quit(Lightmap *lm, VulkanState *vk);
+// Outside of rendering, before the first draw that samples it. No-op once uploaded
+void lightmap_record_upload(Lightmap *lm, VkCommandBuffer cmdbuffer);
+// World to lightmap uv: uv = world * out.xy + out.zw
+void lightmap_transform(const Lightmap *lm, float4 out);
+
+// homeinvasion --bench lightmap: bake time on the 50 room house, and shading cost baked vs all dynamic
+void lightmap_benchmark(void);
@@ -1,14 +1,91 @@
 #include "app.h"
+#include "bench.h"
 #define SDL_MAIN_USE_CALLBACKS
 #include <SDL3/SDL_main.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
 {
-	AppState *app = malloc(sizeof(AppState));
+	if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+	{
+		*appstate = nullptr;
+		return bench_run(argv[2]) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+	};
+
+	AppState *app = calloc(1, sizeof(AppState));
+	int record = -1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--renderer") == 0 && i + 1 < argc)
+		{
+			app->_renderer = renderer_find(argv[++i]);
+			if (app->_renderer == nullptr) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown renderer %s\n", argv[i]);
+		}
+		else if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc)
+		{
+			app->_stress_sprites = SDL_min((uint32_t)strtoul(argv[++i], nullptr, 10), SPRITES_CAPACITY);
+		}
+		else if (strcmp(argv[i], "--hot-reload") == 0)
+		{
+			app->_hot_reload = true;
+		}
+		else if (strcmp(argv[i], "--gpu") == 0 && i + 1 < argc)
+		{
+			app->_vk._gpu_override = argv[++i];
+		}
+		else if (strcmp(argv[i], "--no-pipeline-library") == 0)
+		{
+			app->_vk._no_pipeline_library = true;
+		}
+		else if (strcmp(argv[i], "--no-async-compute") == 0)
+		{
+			app->_vk._no_async_compute = true;
+		}
+		else if (strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+		{
+			app->_gpu_budget_ms = strtof(argv[++i], nullptr);
+		}
+		else if (strcmp(argv[i], "--resolution-scale") == 0 && i + 1 < argc)
+		{
+			app->_resolution_scale = strtof(argv[++i], nullptr);
+		}
+		else if (strcmp(argv[i], "--cctv") == 0 && i + 1 < argc)
+		{
+			app->_cctv_cameras = SDL_min((uint32_t)strtoul(argv[++i], nullptr, 10), CCTV_MAX_CAMERAS);
+		}
+		else if (strcmp(argv[i], "--cctv-updates") == 0 && i + 1 < argc)
+		{
+			app->_cctv_updates = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--house") == 0)
+		{
+			app->_house = true;
+		}
+		else if (strcmp(argv[i], "--decals") == 0 && i + 1 < argc)
+		{
+			app->_stress_decals = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--frame-pacing") == 0)
+		{
+			app->_frame_pacing = true;
+		}
+		else if (strcmp(argv[i], "--pacing-csv") == 0 && i + 1 < argc)
+		{
+			app->_pacing_csv = argv[++i];
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			i++;
+			if (strcmp(argv[i], "png") == 0) record = CAPTURE_PNG;
+			else if (strcmp(argv[i], "raw") == 0) record = CAPTURE_RAW;
+			else SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown record format %s, png or raw\n", argv[i]);
+		};
+	};
 	app_init(app);
+	if (record >= 0) capture_toggle_recording(&app->_capture, (CaptureFormat)record);
 	*appstate = app;
 	
 	return SDL_APP_CONTINUE;
@@ -16,18 +93,48 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv)
 
 SDL_AppResult SDL_AppIterate(void *appstate)
 {
-	app_mainloop((AppState *)appstate);
+	if (app_mainloop((AppState *)appstate) != SUCCESS) return SDL_APP_FAILURE;
 	return SDL_APP_CONTINUE;
 };
 
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 {
 	if (event->type == SDL_EVENT_QUIT) return SDL_APP_SUCCESS;
+	if (event->type == SDL_EVENT_KEY_DOWN && event->key.key == SDLK_L && !event->key.repeat)
+	{
+		// Material change, the variant was pre-warmed so this doesn't compile anything
+		AppState *app = appstate;
+		app->_triangle_desc._features ^= PIPELINE_FEATURE_LIGHTING;
+	};
+	if (event->type == SDL_EVENT_KEY_DOWN && !event->key.repeat && event->key.key >= SDLK_1 && event->key.key <= SDLK_5)
+	{
+		// 1 vignette, 2 grain, 3 aberration, 4 grade, 5 bloom
+		AppState *app = appstate;
+		app->_post._settings._effects ^= 1u << (event->key.key - SDLK_1);
+	};
+	if (event->type == SDL_EVENT_KEY_DOWN && event->key.key == SDLK_O && !event->key.repeat)
+	{
+		app_toggle_door((AppState *)appstate);
+	};
+	if (event->type == SDL_EVENT_KEY_DOWN && !event->key.repeat
+		&& (event->key.key == SDLK_F12 || event->key.key == SDLK_F10 || event->key.key == SDLK_F9))
+	{
+		// F12 screenshot, F10 record PNG frames, F9 raw ones
+		AppState *app = appstate;
+		if (event->key.key == SDLK_F12) capture_screenshot(&app->_capture);
+		else capture_toggle_recording(&app->_capture, event->key.key == SDLK_F10 ? CAPTURE_PNG : CAPTURE_RAW);
+	};
+	if (event->type == SDL_EVENT_MOUSE_BUTTON_DOWN)
+	{
+		// Left blood, right a scorch mark
+		app_stamp_decal((AppState *)appstate, event->button.button == SDL_BUTTON_RIGHT ? DECAL_SCORCH : DECAL_BLOOD);
+	};
 	
 	return SDL_APP_CONTINUE;
 };
 
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
+	if (appstate == nullptr) return;
 	app_quit((AppState *)appstate);
 };
\ No newline at end of file
@@ -0,0 +1,748 @@
+#include "nav.h"
+#include "bench.h"
+#include <float.h>
+#include <stdlib.h>
+
+static constexpr uint32_t NONE = UINT32_MAX;
+static constexpr float SQRT2 = 1.41421356f;
+
+static float distance(const float2 a, const float2 b)
+{
+	float dx = a[0] - b[0], dy = a[1] - b[1];
+	return SDL_sqrtf(dx * dx + dy * dy);
+};
+
+static float point_segment_distance(const float2 p, const float2 a, const float2 b)
+{
+	float abx = b[0] - a[0], aby = b[1] - a[1];
+	float len2 = abx * abx + aby * aby;
+	float t = len2 > 0.0f ? ((p[0] - a[0]) * abx + (p[1] - a[1]) * aby) / len2 : 0.0f;
+	t = SDL_clamp(t, 0.0f, 1.0f);
+	float2 closest = {a[0] + abx * t, a[1] + aby * t};
+	return distance(p, closest);
+};
+
+static uint32_t cell_of(const Navigator *nav, const float2 p)
+{
+	int x = (int)SDL_floorf((p[0] - nav->_origin[0]) / NAV_CELL_SIZE);
+	int y = (int)SDL_floorf((p[1] - nav->_origin[1]) / NAV_CELL_SIZE);
+	x = SDL_clamp(x, 0, (int)nav->_width - 1);
+	y = SDL_clamp(y, 0, (int)nav->_height - 1);
+	return (uint32_t)y * nav->_width + (uint32_t)x;
+};
+
+static void cell_center(const Navigator *nav, uint32_t cell, float2 out)
+{
+	out[0] = nav->_origin[0] + ((cell % nav->_width) + 0.5f) * NAV_CELL_SIZE;
+	out[1] = nav->_origin[1] + ((cell / nav->_width) + 0.5f) * NAV_CELL_SIZE;
+};
+
+static bool passable(const Navigator *nav, uint32_t cell)
+{
+	if (nav->_blocked[cell]) return false;
+	uint32_t door = nav->_cell_door[cell];
+	return door == 0 || nav->_level->_doors[door - 1]._open;
+};
+
+// Mark every cell whose center is closer than NAV_CLEARANCE to the segment
+static void rasterize_segment(Navigator *nav, const float2 a, const float2 b, uint8_t *blocked, uint32_t *door_cells, uint32_t door)
+{
+	float2 lo = {SDL_min(a[0], b[0]) - NAV_CLEARANCE, SDL_min(a[1], b[1]) - NAV_CLEARANCE};
+	float2 hi = {SDL_max(a[0], b[0]) + NAV_CLEARANCE, SDL_max(a[1], b[1]) + NAV_CLEARANCE};
+	uint32_t c0 = cell_of(nav, lo), c1 = cell_of(nav, hi);
+
+	for (uint32_t y = c0 / nav->_width; y <= c1 / nav->_width; y++)
+	{
+		for (uint32_t x = c0 % nav->_width; x <= c1 % nav->_width; x++)
+		{
+			uint32_t cell = y * nav->_width + x;
+			float2 p;
+			cell_center(nav, cell, p);
+			if (point_segment_distance(p, a, b) >= NAV_CLEARANCE) continue;
+			if (blocked) blocked[cell] = 1;
+			else if (!nav->_blocked[cell]) door_cells[cell] = door + 1;
+		};
+	};
+};
+
+static Result alloc_scratch(NavScratch *s, uint32_t cells)
+{
+	s->_g = malloc(cells * sizeof(float));
+	s->_parent = malloc(cells * sizeof(uint32_t));
+	s->_stamp = calloc(cells, sizeof(uint32_t));
+	s->_heap = malloc(cells * sizeof(uint32_t));
+	s->_heap_f = malloc(cells * sizeof(float));
+	s->_cells = malloc(cells * sizeof(uint32_t));
+	s->_generation = 0;
+	if (!s->_g || !s->_parent || !s->_stamp || !s->_heap || !s->_heap_f || !s->_cells) return FAILURE;
+	return SUCCESS;
+};
+
+static void free_scratch(NavScratch *s)
+{
+	free(s->_g);
+	free(s->_parent);
+	free(s->_stamp);
+	free(s->_heap);
+	free(s->_heap_f);
+	free(s->_cells);
+};
+
+Result nav_init(Navigator *nav, Level *level, uint32_t scratch_count)
+{
+	*nav = (Navigator){};
+	nav->_level = level;
+	nav->_origin[0] = level->_min[0];
+	nav->_origin[1] = level->_min[1];
+	nav->_width = (uint32_t)SDL_ceilf((level->_max[0] - level->_min[0]) / NAV_CELL_SIZE);
+	nav->_height = (uint32_t)SDL_ceilf((level->_max[1] - level->_min[1]) / NAV_CELL_SIZE);
+	uint32_t cells = nav->_width * nav->_height;
+
+	nav->_blocked = calloc(cells, sizeof(uint8_t));
+	nav->_cell_door = calloc(cells, sizeof(uint32_t));
+	nav->_portal_cells = malloc(level->_doors_count * 2 * sizeof(uint32_t) + 1);
+	nav->_room_doors_offset = calloc(level->_rooms_count + 1, sizeof(uint32_t));
+	nav->_room_doors = malloc(level->_doors_count * 2 * sizeof(uint32_t) + 1);
+	nav->_cache = calloc(NAV_CACHE_SIZE, sizeof(NavCacheEntry));
+	nav->_cache_mutex = SDL_CreateMutex();
+	nav->_scratch = calloc(scratch_count, sizeof(NavScratch));
+	nav->_scratch_count = scratch_count;
+	nav->_cache_enabled = true;
+	if (!nav->_blocked || !nav->_cell_door || !nav->_portal_cells || !nav->_room_doors_offset
+			|| !nav->_room_doors || !nav->_cache || !nav->_cache_mutex || !nav->_scratch)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate navigator\n");
+		return FAILURE;
+	};
+	for (uint32_t i = 0; i < scratch_count; i++)
+	{
+		if (alloc_scratch(&nav->_scratch[i], cells) != SUCCESS)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate navigator scratch\n");
+			return FAILURE;
+		};
+	};
+
+	// Static obstacles first, door cells are whatever is left free under a door
+	for (uint32_t i = 0; i < level->_walls_count; i++)
+	{
+		rasterize_segment(nav, level->_walls[i]._a, level->_walls[i]._b, nav->_blocked, nullptr, 0);
+	};
+	for (uint32_t i = 0; i < level->_furniture_count; i++)
+	{
+		const Furniture *f = &level->_furniture[i];
+		float2 lo = {f->_min[0] - NAV_CLEARANCE, f->_min[1] - NAV_CLEARANCE};
+		float2 hi = {f->_max[0] + NAV_CLEARANCE, f->_max[1] + NAV_CLEARANCE};
+		uint32_t c0 = cell_of(nav, lo), c1 = cell_of(nav, hi);
+		for (uint32_t y = c0 / nav->_width; y <= c1 / nav->_width; y++)
+			for (uint32_t x = c0 % nav->_width; x <= c1 % nav->_width; x++)
+				nav->_blocked[y * nav->_width + x] = 1;
+	};
+	for (uint32_t d = 0; d < level->_doors_count; d++)
+	{
+		const Door *door = &level->_doors[d];
+		rasterize_segment(nav, door->_a, door->_b, nullptr, nav->_cell_door, d);
+
+		// Portal cells sit just past the door cells, on the normal through the door middle
+		float2 mid = {(door->_a[0] + door->_b[0]) * 0.5f, (door->_a[1] + door->_b[1]) * 0.5f};
+		bool vertical = door->_a[0] == door->_b[0];
+		for (uint32_t side = 0; side < 2; side++)
+		{
+			const Room *room = &level->_rooms[door->_rooms[side]];
+			float center = vertical ? (room->_min[0] + room->_max[0]) * 0.5f : (room->_min[1] + room->_max[1]) * 0.5f;
+			float sign = center > (vertical ? mid[0] : mid[1]) ? 1.0f : -1.0f;
+			float2 p = {mid[0], mid[1]};
+			p[vertical ? 0 : 1] += sign * (NAV_CLEARANCE + NAV_CELL_SIZE);
+			nav->_portal_cells[d * 2 + side] = cell_of(nav, p);
+		};
+		nav->_room_doors_offset[door->_rooms[0] + 1]++;
+		nav->_room_doors_offset[door->_rooms[1] + 1]++;
+	};
+
+	for (uint32_t r = 0; r < level->_rooms_count; r++)
+	{
+		nav->_room_doors_offset[r + 1] += nav->_room_doors_offset[r];
+	};
+	uint32_t *fill = calloc(level->_rooms_count, sizeof(uint32_t));
+	for (uint32_t d = 0; d < level->_doors_count; d++)
+	{
+		for (uint32_t side = 0; side < 2; side++)
+		{
+			uint32_t r = level->_doors[d]._rooms[side];
+			nav->_room_doors[nav->_room_doors_offset[r] + fill[r]++] = d;
+		};
+	};
+	free(fill);
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Navigation grid %ux%u, %u doors\n",
+			nav->_width, nav->_height, level->_doors_count);
+	return SUCCESS;
+};
+
+void nav_quit(Navigator *nav)
+{
+	for (uint32_t i = 0; i < nav->_scratch_count && nav->_scratch; i++)
+	{
+		free_scratch(&nav->_scratch[i]);
+	};
+	free(nav->_scratch);
+	free(nav->_blocked);
+	free(nav->_cell_door);
+	free(nav->_portal_cells);
+	free(nav->_room_doors_offset);
+	free(nav->_room_doors);
+	free(nav->_cache);
+	if (nav->_cache_mutex) SDL_DestroyMutex(nav->_cache_mutex);
+	*nav = (Navigator){};
+};
+
+// # Open list of both searches: a binary heap on the scratch, by f
+
+static void heap_push(NavScratch *s, uint32_t *size, uint32_t capacity, uint32_t cell, float f)
+{
+	if (*size >= capacity) return;
+	uint32_t i = (*size)++;
+	while (i > 0)
+	{
+		uint32_t up = (i - 1) / 2;
+		if (s->_heap_f[up] <= f) break;
+		s->_heap[i] = s->_heap[up];
+		s->_heap_f[i] = s->_heap_f[up];
+		i = up;
+	};
+	s->_heap[i] = cell;
+	s->_heap_f[i] = f;
+};
+
+static uint32_t heap_pop(NavScratch *s, uint32_t *size, float *f)
+{
+	uint32_t top = s->_heap[0];
+	*f = s->_heap_f[0];
+	uint32_t last = s->_heap[--(*size)];
+	float last_f = s->_heap_f[*size];
+	uint32_t i = 0;
+	for (;;)
+	{
+		uint32_t child = i * 2 + 1;
+		if (child >= *size) break;
+		if (child + 1 < *size && s->_heap_f[child + 1] < s->_heap_f[child]) child++;
+		if (s->_heap_f[child] >= last_f) break;
+		s->_heap[i] = s->_heap[child];
+		s->_heap_f[i] = s->_heap_f[child];
+		i = child;
+	};
+	s->_heap[i] = last;
+	s->_heap_f[i] = last_f;
+	return top;
+};
+
+// # Room level search
+// States are (door, side entered), so a door can be crossed both ways. The goal is state door_count * 2
+
+static void door_mid(const Door *door, float2 out)
+{
+	out[0] = (door->_a[0] + door->_b[0]) * 0.5f;
+	out[1] = (door->_a[1] + door->_b[1]) * 0.5f;
+};
+
+static uint32_t route_search(Navigator *nav, NavScratch *s, uint32_t start_room, const float2 start,
+		uint32_t goal_room, const float2 goal, uint32_t *route)
+{
+	const Level *level = nav->_level;
+	uint32_t goal_state = level->_doors_count * 2;
+	// Reuse the grid scratch, room graph is always much smaller than the grid. Stamps are marked
+	// like grid_search does, a new generation per search
+	float *g = s->_g;
+	uint32_t *parent = s->_parent;
+	s->_generation++;
+	uint32_t open_mark = s->_generation * 2, closed_mark = open_mark + 1;
+	uint32_t heap_size = 0, capacity = nav->_width * nav->_height;
+
+	for (uint32_t i = nav->_room_doors_offset[start_room]; i < nav->_room_doors_offset[start_room + 1]; i++)
+	{
+		uint32_t d = nav->_room_doors[i];
+		const Door *door = &level->_doors[d];
+		if (!door->_open) continue;
+		uint32_t st = d * 2 + (door->_rooms[0] == start_room ? 1 : 0);
+		float2 mid;
+		door_mid(door, mid);
+		g[st] = distance(start, mid);
+		parent[st] = NONE;
+		s->_stamp[st] = open_mark;
+		heap_push(s, &heap_size, capacity, st, g[st] + distance(mid, goal));
+	};
+
+	bool found = false;
+	while (heap_size > 0)
+	{
+		float f;
+		uint32_t best = heap_pop(s, &heap_size, &f);
+		// Stale entry of a state reached again for less
+		if (s->_stamp[best] == closed_mark) continue;
+		s->_stamp[best] = closed_mark;
+		if (best == goal_state)
+		{
+			found = true;
+			break;
+		};
+
+		const Door *door = &level->_doors[best / 2];
+		uint32_t room = door->_rooms[best % 2];
+		float2 mid;
+		door_mid(door, mid);
+
+		if (room == goal_room)
+		{
+			float ng = g[best] + distance(mid, goal);
+			if (s->_stamp[goal_state] != open_mark || ng < g[goal_state])
+			{
+				g[goal_state] = ng;
+				parent[goal_state] = best;
+				s->_stamp[goal_state] = open_mark;
+				heap_push(s, &heap_size, capacity, goal_state, ng);
+			};
+		};
+		for (uint32_t i = nav->_room_doors_offset[room]; i < nav->_room_doors_offset[room + 1]; i++)
+		{
+			uint32_t e = nav->_room_doors[i];
+			const Door *next = &level->_doors[e];
+			if (e == best / 2 || !next->_open) continue;
+			uint32_t st = e * 2 + (next->_rooms[0] == room ? 1 : 0);
+			if (s->_stamp[st] == closed_mark) continue;
+			float2 next_mid;
+			door_mid(next, next_mid);
+			float ng = g[best] + distance(mid, next_mid);
+			if (s->_stamp[st] == open_mark && ng >= g[st]) continue;
+			g[st] = ng;
+			parent[st] = best;
+			s->_stamp[st] = open_mark;
+			heap_push(s, &heap_size, capacity, st, ng + distance(next_mid, goal));
+		};
+	};
+	if (!found) return NONE;
+
+	uint32_t count = 0;
+	for (uint32_t st = parent[goal_state]; st != NONE; st = parent[st]) count++;
+	if (count > NAV_MAX_ROUTE) return NONE;
+	uint32_t i = count;
+	for (uint32_t st = parent[goal_state]; st != NONE; st = parent[st]) route[--i] = st;
+	return count;
+};
+
+// # Grid search bounded to one room
+
+static float octile(const Navigator *nav, uint32_t a, uint32_t b)
+{
+	float dx = SDL_fabsf((float)(a % nav->_width) - (float)(b % nav->_width));
+	float dy = SDL_fabsf((float)(a / nav->_width) - (float)(b / nav->_width));
+	return dx + dy + (SQRT2 - 2.0f) * SDL_min(dx, dy);
+};
+
+// Appends the cells after start up to goal to s->_cells at *count
+static bool grid_search(Navigator *nav, NavScratch *s, const Room *room, uint32_t start, uint32_t goal, uint32_t *count)
+{
+	if (start == goal) return true;
+	uint32_t lo = cell_of(nav, room->_min);
+	float2 max = {room->_max[0] - NAV_CELL_SIZE * 0.5f, room->_max[1] - NAV_CELL_SIZE * 0.5f};
+	uint32_t hi = cell_of(nav, max);
+	int x0 = lo % nav->_width, y0 = lo / nav->_width;
+	int x1 = hi % nav->_width, y1 = hi / nav->_width;
+	uint32_t capacity = nav->_width * nav->_height;
+
+	// Stamp is generation * 2 for open, + 1 for closed
+	s->_generation++;
+	uint32_t open_mark = s->_generation * 2, closed_mark = open_mark + 1;
+	uint32_t heap_size = 0;
+	s->_g[start] = 0.0f;
+	s->_parent[start] = NONE;
+	s->_stamp[start] = open_mark;
+	heap_push(s, &heap_size, capacity, start, octile(nav, start, goal));
+
+	static const int neighbours[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+	bool found = false;
+	while (heap_size > 0)
+	{
+		float f;
+		uint32_t cell = heap_pop(s, &heap_size, &f);
+		if (s->_stamp[cell] == closed_mark) continue;
+		s->_stamp[cell] = closed_mark;
+		if (cell == goal)
+		{
+			found = true;
+			break;
+		};
+
+		int cx = cell % nav->_width, cy = cell / nav->_width;
+		for (int i = 0; i < 8; i++)
+		{
+			int nx = cx + neighbours[i][0], ny = cy + neighbours[i][1];
+			if (nx < x0 || nx > x1 || ny < y0 || ny > y1) continue;
+			uint32_t next = (uint32_t)ny * nav->_width + (uint32_t)nx;
+			if (!passable(nav, next) || s->_stamp[next] == closed_mark) continue;
+			// No corner cutting
+			if (i >= 4 && (!passable(nav, cy * nav->_width + nx) || !passable(nav, ny * nav->_width + cx))) continue;
+
+			float ng = s->_g[cell] + (i >= 4 ? SQRT2 : 1.0f);
+			if (s->_stamp[next] == open_mark && ng >= s->_g[next]) continue;
+			s->_g[next] = ng;
+			s->_parent[next] = cell;
+			s->_stamp[next] = open_mark;
+			heap_push(s, &heap_size, capacity, next, ng + octile(nav, next, goal));
+		};
+	};
+	if (!found) return false;
+
+	uint32_t length = 0;
+	for (uint32_t c = goal; c != start; c = s->_parent[c]) length++;
+	if (*count + length > capacity) return false;
+	uint32_t i = *count + length;
+	for (uint32_t c = goal; c != start; c = s->_parent[c]) s->_cells[--i] = c;
+	*count += length;
+	return true;
+};
+
+// Snap a point lying in a blocked cell (against a wall, in furniture clearance) to a free neighbour
+static uint32_t nearest_passable(const Navigator *nav, uint32_t cell)
+{
+	if (passable(nav, cell)) return cell;
+	int cx = cell % nav->_width, cy = cell / nav->_width;
+	for (int r = 1; r <= 8; r++)
+	{
+		for (int dy = -r; dy <= r; dy++)
+		{
+			for (int dx = -r; dx <= r; dx++)
+			{
+				int x = cx + dx, y = cy + dy;
+				if (x < 0 || y < 0 || x >= (int)nav->_width || y >= (int)nav->_height) continue;
+				uint32_t c = (uint32_t)y * nav->_width + (uint32_t)x;
+				if (passable(nav, c)) return c;
+			};
+		};
+	};
+	return NONE;
+};
+
+static uint32_t cache_slot(uint32_t start, uint32_t goal)
+{
+	uint32_t h = start * 0x9E3779B1u ^ (goal + 0x7F4A7C15u + (start << 6) + (start >> 2));
+	return h % NAV_CACHE_SIZE;
+};
+
+static bool route_is_open(const Navigator *nav, const NavPath *path, uint32_t first)
+{
+	for (uint32_t i = first; i < path->_route_count; i++)
+	{
+		if (!nav->_level->_doors[path->_route[i]]._open) return false;
+	};
+	return true;
+};
+
+static bool cache_lookup(Navigator *nav, uint32_t start, uint32_t goal, NavPath *path)
+{
+	NavCacheEntry *entry = &nav->_cache[cache_slot(start, goal)];
+	bool hit = false;
+	SDL_LockMutex(nav->_cache_mutex);
+	if (entry->_valid && entry->_start_cell == start && entry->_goal_cell == goal
+			&& entry->_path._version == nav->_open_version && route_is_open(nav, &entry->_path, 0))
+	{
+		*path = entry->_path;
+		hit = true;
+	};
+	SDL_UnlockMutex(nav->_cache_mutex);
+	SDL_AddAtomicInt(hit ? &nav->_cache_hits : &nav->_cache_misses, 1);
+	return hit;
+};
+
+static void cache_insert(Navigator *nav, uint32_t start, uint32_t goal, const NavPath *path)
+{
+	NavCacheEntry *entry = &nav->_cache[cache_slot(start, goal)];
+	SDL_LockMutex(nav->_cache_mutex);
+	entry->_start_cell = start;
+	entry->_goal_cell = goal;
+	entry->_path = *path;
+	entry->_valid = true;
+	SDL_UnlockMutex(nav->_cache_mutex);
+};
+
+bool nav_find_path(Navigator *nav, uint32_t worker, const float2 start, const float2 goal, NavPath *path)
+{
+	NavScratch *s = &nav->_scratch[worker];
+	const Level *level = nav->_level;
+	uint32_t start_cell = nearest_passable(nav, cell_of(nav, start));
+	uint32_t goal_cell = nearest_passable(nav, cell_of(nav, goal));
+	uint32_t start_room = level_room_at(level, start);
+	uint32_t goal_room = level_room_at(level, goal);
+	if (start_cell == NONE || goal_cell == NONE || start_room == NONE || goal_room == NONE) return false;
+
+	if (nav->_cache_enabled && cache_lookup(nav, start_cell, goal_cell, path)) return true;
+
+	uint32_t route[NAV_MAX_ROUTE];
+	uint32_t route_count = 0;
+	if (start_room != goal_room)
+	{
+		route_count = route_search(nav, s, start_room, start, goal_room, goal, route);
+		if (route_count == NONE) return false;
+	};
+
+	// Refine room by room, remembering where each door crossing lands in the cell list
+	uint32_t crossing[NAV_MAX_ROUTE];
+	uint32_t count = 0;
+	uint32_t cell = start_cell, room = start_room;
+	for (uint32_t i = 0; i < route_count; i++)
+	{
+		uint32_t d = route[i] / 2, entered = route[i] % 2;
+		uint32_t near = nav->_portal_cells[d * 2 + (1 - entered)];
+		uint32_t far = nav->_portal_cells[d * 2 + entered];
+		if (!grid_search(nav, s, &level->_rooms[room], cell, near, &count)) return false;
+		crossing[i] = count;
+		s->_cells[count++] = far;
+		cell = far;
+		room = level->_doors[d]._rooms[entered];
+	};
+	if (!grid_search(nav, s, &level->_rooms[room], cell, goal_cell, &count)) return false;
+
+	// Keep only the cells where direction changes, plus both sides of every door
+	path->_version = nav->_open_version;
+	path->_waypoints_count = 0;
+	path->_route_count = route_count;
+	path->_partial = false;
+	uint32_t next_crossing = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bool keep = i + 1 == count;
+		bool is_crossing = next_crossing < route_count && crossing[next_crossing] == i;
+		keep |= is_crossing || (next_crossing < route_count && crossing[next_crossing] == i + 1);
+		if (!keep)
+		{
+			uint32_t prev = i > 0 ? s->_cells[i - 1] : start_cell;
+			uint32_t next = s->_cells[i + 1];
+			keep = (int)s->_cells[i] - (int)prev != (int)next - (int)s->_cells[i];
+		};
+		if (!keep) continue;
+
+		if (path->_waypoints_count == NAV_MAX_WAYPOINTS)
+		{
+			path->_partial = true;
+			path->_route_count = next_crossing;
+			break;
+		};
+		if (is_crossing)
+		{
+			path->_route[next_crossing] = route[next_crossing] / 2;
+			path->_route_waypoint[next_crossing] = path->_waypoints_count;
+			next_crossing++;
+		};
+		cell_center(nav, s->_cells[i], path->_waypoints[path->_waypoints_count++]);
+	};
+
+	if (nav->_cache_enabled) cache_insert(nav, start_cell, goal_cell, path);
+	return true;
+};
+
+void nav_set_door(Navigator *nav, uint32_t door, bool open)
+{
+	if (nav->_level->_doors[door]._open == open) return;
+	level_set_door(nav->_level, door, open);
+	if (open) nav->_open_version++;
+};
+
+void nav_check_agents(Navigator *nav, NavAgent *agents, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		NavAgent *agent = &agents[i];
+		if (!agent->_has_path || agent->_needs_replan) continue;
+		if (agent->_path._version != nav->_open_version)
+		{
+			agent->_needs_replan = true;
+			continue;
+		};
+		// Only doors still ahead matter
+		uint32_t first = 0;
+		while (first < agent->_path._route_count && agent->_path._route_waypoint[first] < agent->_next_waypoint) first++;
+		if (!route_is_open(nav, &agent->_path, first)) agent->_needs_replan = true;
+	};
+};
+
+typedef struct
+{
+	Navigator *_nav;
+	NavAgent *_agents;
+} UpdateArgs;
+
+static void update_agents_job(void *user, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	UpdateArgs *args = user;
+	Navigator *nav = args->_nav;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		NavAgent *agent = &args->_agents[i];
+		if (!agent->_needs_replan) continue;
+		agent->_needs_replan = false;
+
+		// A door opened somewhere: if the room route ahead is unchanged the waypoints still hold,
+		// so only the cheap room level search runs
+		NavPath *path = &agent->_path;
+		uint32_t first = 0;
+		while (first < path->_route_count && path->_route_waypoint[first] < agent->_next_waypoint) first++;
+		uint32_t start_room = level_room_at(nav->_level, agent->_position);
+		uint32_t goal_room = level_room_at(nav->_level, agent->_goal);
+		if (agent->_has_path && !path->_partial && start_room != NONE && goal_room != NONE
+				&& route_is_open(nav, path, first))
+		{
+			uint32_t route[NAV_MAX_ROUTE];
+			uint32_t route_count = start_room == goal_room ? 0
+				: route_search(nav, &nav->_scratch[worker], start_room, agent->_position, goal_room, agent->_goal, route);
+			bool same = route_count == path->_route_count - first;
+			for (uint32_t r = 0; same && r < route_count; r++) same = route[r] / 2 == path->_route[first + r];
+			if (same)
+			{
+				path->_version = nav->_open_version;
+				continue;
+			};
+		};
+
+		agent->_has_path = nav_find_path(nav, worker, agent->_position, agent->_goal, path);
+		agent->_next_waypoint = 0;
+	};
+};
+
+void nav_update_agents(Navigator *nav, JobSystem *jobs, NavAgent *agents, uint32_t count)
+{
+	UpdateArgs args = {nav, agents};
+	jobs_parallel_for(jobs, count, 8, update_agents_job, &args);
+};
+
+void nav_agent_advance(NavAgent *agent, float distance_left)
+{
+	NavPath *path = &agent->_path;
+	while (agent->_has_path && distance_left > 0.0f && agent->_next_waypoint < path->_waypoints_count)
+	{
+		const float *target = path->_waypoints[agent->_next_waypoint];
+		float d = distance(agent->_position, target);
+		if (d <= distance_left)
+		{
+			agent->_position[0] = target[0];
+			agent->_position[1] = target[1];
+			agent->_next_waypoint++;
+			distance_left -= d;
+			continue;
+		};
+		agent->_position[0] += (target[0] - agent->_position[0]) * distance_left / d;
+		agent->_position[1] += (target[1] - agent->_position[1]) * distance_left / d;
+		distance_left = 0.0f;
+	};
+	if (agent->_has_path && path->_partial && agent->_next_waypoint == path->_waypoints_count)
+		agent->_needs_replan = true;
+};
+
+// # Benchmark
+// 50 room house, agents planned on every worker. Cold numbers have the cache disabled and random
+// endpoints, warm numbers use a handful of spawn points/targets like intruders entering the house.
+
+static void random_point(const Level *level, uint64_t *rng, float2 out)
+{
+	const Room *room = &level->_rooms[random_next(rng) % level->_rooms_count];
+	out[0] = random_range(rng, room->_min[0] + 0.5f, room->_max[0] - 0.5f);
+	out[1] = random_range(rng, room->_min[1] + 0.5f, room->_max[1] - 0.5f);
+};
+
+void nav_benchmark(void)
+{
+	constexpr uint32_t AGENTS = 256;
+	constexpr uint32_t ROUNDS = 20;
+	Level level;
+	if (level_generate_house(&level, 10, 5, 8.0f, 1234) != SUCCESS) return;
+
+	JobSystem *jobs = calloc(1, sizeof(JobSystem));
+	Navigator nav = {};
+	NavAgent *agents = calloc(AGENTS, sizeof(NavAgent));
+	if (!jobs || jobs_init(jobs, 0) != SUCCESS || !agents || nav_init(&nav, &level, jobs_slot_count(jobs)) != SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "nav benchmark setup failed\n");
+		nav_quit(&nav);
+		// Also stops the workers a failed init had started
+		if (jobs) jobs_quit(jobs);
+		free(jobs);
+		free(agents);
+		level_free(&level);
+		return;
+	};
+
+	uint64_t rng = 42;
+	float2 spawns[8], targets[8];
+	for (int i = 0; i < 8; i++)
+	{
+		random_point(&level, &rng, spawns[i]);
+		random_point(&level, &rng, targets[i]);
+	};
+
+	for (int warm = 0; warm < 2; warm++)
+	{
+		nav._cache_enabled = warm;
+		uint32_t planned = 0, failed = 0;
+		double begin = bench_now_ms();
+		for (uint32_t round = 0; round < ROUNDS; round++)
+		{
+			for (uint32_t i = 0; i < AGENTS; i++)
+			{
+				NavAgent *agent = &agents[i];
+				if (warm)
+				{
+					const float *s = spawns[random_next(&rng) % 8], *t = targets[random_next(&rng) % 8];
+					agent->_position[0] = s[0];
+					agent->_position[1] = s[1];
+					agent->_goal[0] = t[0];
+					agent->_goal[1] = t[1];
+				}
+				else
+				{
+					random_point(&level, &rng, agent->_position);
+					random_point(&level, &rng, agent->_goal);
+				};
+				agent->_has_path = false;
+				agent->_needs_replan = true;
+			};
+			nav_update_agents(&nav, jobs, agents, AGENTS);
+			for (uint32_t i = 0; i < AGENTS; i++)
+			{
+				if (agents[i]._has_path) planned++;
+				else failed++;
+			};
+		};
+		double elapsed = bench_now_ms() - begin;
+		SDL_Log("nav %s: %u paths (%u failed) in %.2f ms, %.0f paths/s, %.3f ms per %u agents\n",
+				warm ? "cached" : "cold", planned, failed, elapsed,
+				(planned + failed) / (elapsed / 1000.0), elapsed / ROUNDS, AGENTS);
+	};
+	SDL_Log("nav cache: %d hits, %d misses\n", SDL_GetAtomicInt(&nav._cache_hits), SDL_GetAtomicInt(&nav._cache_misses));
+
+	// Toggle doors with agents mid-route and replan only what changed
+	for (uint32_t i = 0; i < AGENTS; i++)
+	{
+		random_point(&level, &rng, agents[i]._position);
+		random_point(&level, &rng, agents[i]._goal);
+		agents[i]._needs_replan = true;
+		agents[i]._has_path = false;
+	};
+	nav_update_agents(&nav, jobs, agents, AGENTS);
+
+	uint32_t replans = 0;
+	double begin = bench_now_ms();
+	for (uint32_t round = 0; round < ROUNDS; round++)
+	{
+		uint32_t door = random_next(&rng) % level._doors_count;
+		nav_set_door(&nav, door, !level._doors[door]._open);
+		nav_check_agents(&nav, agents, AGENTS);
+		for (uint32_t i = 0; i < AGENTS; i++) replans += agents[i]._needs_replan;
+		nav_update_agents(&nav, jobs, agents, AGENTS);
+	};
+	double elapsed = bench_now_ms() - begin;
+	SDL_Log("nav door toggles: %u rounds, %u agents flagged, %.3f ms per toggle\n", ROUNDS, replans, elapsed / ROUNDS);
+
+	nav_quit(&nav);
+	jobs_quit(jobs);
+	free(jobs);
+	free(agents);
+	level_free(&level);
+};
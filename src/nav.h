@@ -0,0 +1,98 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "level.h"
+#include "jobs.h"
+
+// Hierarchical navigation over the house.
+// A* first runs on the room graph (nodes are doors), then every room crossed is refined with
+// a grid A* bounded to that room. Paths are cached by (start cell, goal cell) and invalidated
+// per door, so opening/closing a door only replans the agents whose route changes.
+
+constexpr float NAV_CELL_SIZE = 0.25f;
+// Agent radius plus half wall thickness, cells closer than this to a wall are blocked
+constexpr float NAV_CLEARANCE = 0.3f;
+constexpr uint32_t NAV_MAX_WAYPOINTS = 128;
+constexpr uint32_t NAV_MAX_ROUTE = 64;
+constexpr uint32_t NAV_CACHE_SIZE = 1024;
+
+typedef struct
+{
+	// _version is the navigator _open_version this path was planned against
+	uint32_t _version;
+	uint32_t _waypoints_count, _route_count;
+	// Path was cut at NAV_MAX_WAYPOINTS, replan when the last waypoint is reached
+	bool _partial;
+	float2 _waypoints[NAV_MAX_WAYPOINTS];
+	// Doors crossed in order, and the first waypoint past each of them
+	uint32_t _route[NAV_MAX_ROUTE];
+	uint32_t _route_waypoint[NAV_MAX_ROUTE];
+} NavPath;
+
+typedef struct
+{
+	float2 _position, _goal;
+	uint32_t _next_waypoint;
+	bool _has_path, _needs_replan;
+	NavPath _path;
+} NavAgent;
+
+typedef struct
+{
+	uint32_t _start_cell, _goal_cell;
+	bool _valid;
+	NavPath _path;
+} NavCacheEntry;
+
+// Per-worker A* memory. _stamp avoids clearing the whole grid between searches
+typedef struct
+{
+	float *_g;
+	uint32_t *_parent;
+	uint32_t *_stamp;
+	uint32_t _generation;
+	uint32_t *_heap;
+	float *_heap_f;
+	uint32_t *_cells;
+} NavScratch;
+
+typedef struct
+{
+	Level *_level;
+	float2 _origin;
+	uint32_t _width, _height;
+	// Blocked by walls or furniture
+	uint8_t *_blocked;
+	// door index + 1 for cells covered by a door, passable only while the door is open
+	uint32_t *_cell_door;
+	// Cell just inside each side of each door, [door * 2 + side], side matches Door._rooms
+	uint32_t *_portal_cells;
+	// Doors of each room, CSR layout
+	uint32_t *_room_doors_offset, *_room_doors;
+	// Bumped when a door opens: any path planned before may have become suboptimal
+	uint32_t _open_version;
+
+	bool _cache_enabled;
+	NavCacheEntry *_cache;
+	SDL_Mutex *_cache_mutex;
+	SDL_AtomicInt _cache_hits, _cache_misses;
+
+	uint32_t _scratch_count;
+	NavScratch *_scratch;
+} Navigator;
+
+// scratch_count should be jobs_slot_count of the job system running the agents
+Result nav_init(Navigator *nav, Level *level, uint32_t scratch_count);
+void nav_quit(Navigator *nav);
+
+// Plan a path on the calling worker. Returns false if goal is unreachable
+bool nav_find_path(Navigator *nav, uint32_t worker, const float2 start, const float2 goal, NavPath *path);
+void nav_set_door(Navigator *nav, uint32_t door, bool open);
+
+// Flag agents whose path crosses a closed door or was planned before a door opened
+void nav_check_agents(Navigator *nav, NavAgent *agents, uint32_t count);
+// Replan every flagged agent on the worker threads
+void nav_update_agents(Navigator *nav, JobSystem *jobs, NavAgent *agents, uint32_t count);
+// Move along the path, flags the agent for replanning when a partial path runs out
+void nav_agent_advance(NavAgent *agent, float distance);
+
+void nav_benchmark(void);
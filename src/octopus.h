@@ -1,5 +1,6 @@
 #ifndef M_OCTOPUS_H
 #define M_OCTOPUS_H
+#include <stdint.h>
 
 typedef float float2[2];
 typedef float float3[3];
@@ -8,5 +9,28 @@ typedef int int2[2];
 typedef int int3[3];
 typedef int int4[4];
 
+typedef enum
+{
+	SUCCESS,
+	FAILURE
+} Result;
+
+// xorshift64, good enough for level generation and benchmarks. State must be non-zero
+static inline uint64_t random_next(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return x;
+};
+
+// Uniform in [lo, hi)
+static inline float random_range(uint64_t *state, float lo, float hi)
+{
+	return lo + (hi - lo) * (float)(random_next(state) >> 40) * (1.0f / (float)(1 << 24));
+};
+
 
 #endif
\ No newline at end of file
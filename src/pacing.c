@@ -0,0 +1,219 @@
+#include "pacing.h"
+
+constexpr uint32_t PACING_LOG_FRAMES = 600;
+
+static uint32_t bucket(double ms)
+{
+	return (uint32_t)SDL_min(ms / PACING_BUCKET_MS, (double)(PACING_BUCKETS - 1));
+};
+
+// Lower bound of the bucket holding percentile p of the samples
+static double percentile(const uint32_t *histogram, uint64_t count, double p)
+{
+	uint64_t target = (uint64_t)((double)count * p), seen = 0;
+	for (uint32_t i = 0; i < PACING_BUCKETS; i++)
+	{
+		seen += histogram[i];
+		if (seen > target) return (double)i * PACING_BUCKET_MS;
+	};
+	return (double)(PACING_BUCKETS - 1) * PACING_BUCKET_MS;
+};
+
+// Under _mutex, on the pacing thread
+static void record_displayed(FramePacer *pacer, const PacingFrame *frame, uint64_t now)
+{
+	double latency_ms = (double)(now - frame->_begin_ns) / (double)SDL_NS_PER_MS;
+	pacer->_latency_histogram[bucket(latency_ms)]++;
+	pacer->_latency_sum += latency_ms;
+	// Only between consecutive presents, dropped ones would show up as a missed vblank
+	if (pacer->_displayed_ns != 0 && frame->_id == pacer->_displayed_id + 1)
+	{
+		double interval_ms = (double)(now - pacer->_displayed_ns) / (double)SDL_NS_PER_MS;
+		pacer->_interval_histogram[bucket(interval_ms)]++;
+		pacer->_interval_sum += interval_ms;
+		pacer->_interval_squares += interval_ms * interval_ms;
+		if (now - pacer->_displayed_ns > pacer->_refresh_ns * 3 / 2) pacer->_missed++;
+	};
+	pacer->_displayed_id = frame->_id;
+	pacer->_displayed_ns = now;
+	pacer->_frames++;
+
+	if (++pacer->_log_frames < PACING_LOG_FRAMES) return;
+	double frames = (double)pacer->_log_frames;
+	double mean = pacer->_interval_sum / frames;
+	double jitter = SDL_sqrt(SDL_max(pacer->_interval_squares / frames - mean * mean, 0.0));
+	SDL_LogDebug(SDL_LOG_CATEGORY_GPU, "Present: interval %.3f ms (jitter %.3f ms), latency %.3f ms, %llu missed vblanks\n",
+			mean, jitter, pacer->_latency_sum / frames, (unsigned long long)pacer->_missed);
+	pacer->_interval_sum = pacer->_interval_squares = pacer->_latency_sum = 0.0;
+	pacer->_log_frames = 0;
+};
+
+// Waits on the presents in order. vkWaitForPresentKHR blocks, so it can't be a job
+static int pacing_thread(void *data)
+{
+	FramePacer *pacer = data;
+	SDL_LockMutex(pacer->_mutex);
+	while (!pacer->_quit)
+	{
+		if (pacer->_pending_count == 0 || pacer->_swapchain == VK_NULL_HANDLE)
+		{
+			SDL_WaitCondition(pacer->_changed, pacer->_mutex);
+			continue;
+		};
+		PacingFrame frame = pacer->_pending[pacer->_pending_first];
+		VkSwapchainKHR swapchain = pacer->_swapchain;
+		pacer->_waiting = true;
+		SDL_UnlockMutex(pacer->_mutex);
+		// Bounded, pacing_detach and pacing_quit wait for it to return
+		VkResult result = vkWaitForPresentKHR(pacer->_device, swapchain, frame._id, 100 * SDL_NS_PER_MS);
+		uint64_t now = SDL_GetTicksNS();
+		SDL_LockMutex(pacer->_mutex);
+		pacer->_waiting = false;
+		SDL_BroadcastCondition(pacer->_changed);
+		if (result == VK_TIMEOUT) continue;
+		// Dropped meanwhile, by pacing_detach or a full queue
+		if (pacer->_pending_count == 0 || pacer->_pending[pacer->_pending_first]._id != frame._id) continue;
+		pacer->_pending_first = (pacer->_pending_first + 1) % PACING_MAX_PENDING;
+		pacer->_pending_count--;
+		if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) record_displayed(pacer, &frame, now);
+	};
+	SDL_UnlockMutex(pacer->_mutex);
+	return 0;
+};
+
+Result pacing_init(FramePacer *pacer, VulkanState *vk, SDL_Window *window, bool pace, const char *csv_path)
+{
+	*pacer = (FramePacer){._device = vk->_device, ._swapchain = vk->_swapchain, ._enabled = vk->_present_wait,
+		._pace = pace, ._next_id = 1, ._csv_path = csv_path};
+	const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+	float refresh_rate = mode != nullptr && mode->refresh_rate > 0.0f ? mode->refresh_rate : 60.0f;
+	pacer->_refresh_ns = (uint64_t)((double)SDL_NS_PER_SECOND / (double)refresh_rate);
+	// The sleep overshooting and the present itself
+	pacer->_margin_ns = SDL_NS_PER_MS;
+	if (!pacer->_enabled)
+	{
+		if (pace) SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "--frame-pacing needs VK_KHR_present_wait, ignored\n");
+		pacer->_pace = false;
+		return SUCCESS;
+	};
+
+	pacer->_mutex = SDL_CreateMutex();
+	pacer->_changed = SDL_CreateCondition();
+	if (pacer->_mutex == nullptr || pacer->_changed == nullptr
+		|| (pacer->_thread = SDL_CreateThread(pacing_thread, "present wait", pacer)) == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to start present timing: %s\n", SDL_GetError());
+		return FAILURE;
+	};
+	SDL_Log("Present timing at %.2f Hz%s\n", refresh_rate, pace ? ", frames paced just in time" : "");
+	return SUCCESS;
+};
+
+static void write_csv(const FramePacer *pacer)
+{
+	SDL_IOStream *io = SDL_IOFromFile(pacer->_csv_path, "w");
+	if (io == nullptr)
+	{
+		SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to write %s: %s\n", pacer->_csv_path, SDL_GetError());
+		return;
+	};
+	SDL_IOprintf(io, "ms,intervals,latencies\n");
+	for (uint32_t i = 0; i < PACING_BUCKETS; i++)
+	{
+		SDL_IOprintf(io, "%.2f,%u,%u\n", (double)i * PACING_BUCKET_MS, pacer->_interval_histogram[i], pacer->_latency_histogram[i]);
+	};
+	SDL_CloseIO(io);
+	SDL_Log("Pacing histograms written to %s\n", pacer->_csv_path);
+};
+
+void pacing_quit(FramePacer *pacer)
+{
+	if (pacer->_thread != nullptr)
+	{
+		SDL_LockMutex(pacer->_mutex);
+		pacer->_quit = true;
+		SDL_BroadcastCondition(pacer->_changed);
+		SDL_UnlockMutex(pacer->_mutex);
+		SDL_WaitThread(pacer->_thread, nullptr);
+		pacer->_thread = nullptr;
+	};
+	if (pacer->_frames > 0)
+	{
+		uint64_t intervals = 0;
+		for (uint32_t i = 0; i < PACING_BUCKETS; i++) intervals += pacer->_interval_histogram[i];
+		SDL_Log("Presented %llu frames at %.3f ms refresh, interval p50 %.2f p99 %.2f ms, latency p50 %.2f p99 %.2f ms, %llu missed vblanks\n",
+				(unsigned long long)pacer->_frames, (double)pacer->_refresh_ns / (double)SDL_NS_PER_MS,
+				percentile(pacer->_interval_histogram, intervals, 0.5), percentile(pacer->_interval_histogram, intervals, 0.99),
+				percentile(pacer->_latency_histogram, pacer->_frames, 0.5), percentile(pacer->_latency_histogram, pacer->_frames, 0.99),
+				(unsigned long long)pacer->_missed);
+		if (pacer->_csv_path != nullptr) write_csv(pacer);
+	};
+	SDL_DestroyCondition(pacer->_changed);
+	SDL_DestroyMutex(pacer->_mutex);
+	pacer->_changed = nullptr;
+	pacer->_mutex = nullptr;
+};
+
+void pacing_detach(FramePacer *pacer)
+{
+	if (!pacer->_enabled) return;
+	SDL_LockMutex(pacer->_mutex);
+	pacer->_swapchain = VK_NULL_HANDLE;
+	pacer->_pending_count = 0;
+	// Nothing displayed on the new swapchain yet, no prediction either
+	pacer->_displayed_ns = 0;
+	while (pacer->_waiting) SDL_WaitCondition(pacer->_changed, pacer->_mutex);
+	SDL_UnlockMutex(pacer->_mutex);
+};
+
+void pacing_attach(FramePacer *pacer, VkSwapchainKHR swapchain)
+{
+	if (!pacer->_enabled) return;
+	SDL_LockMutex(pacer->_mutex);
+	pacer->_swapchain = swapchain;
+	SDL_BroadcastCondition(pacer->_changed);
+	SDL_UnlockMutex(pacer->_mutex);
+};
+
+void pacing_begin_frame(FramePacer *pacer)
+{
+	if (pacer->_pace)
+	{
+		SDL_LockMutex(pacer->_mutex);
+		uint64_t displayed_id = pacer->_displayed_id, displayed_ns = pacer->_displayed_ns;
+		SDL_UnlockMutex(pacer->_mutex);
+		if (displayed_ns != 0)
+		{
+			// Every frame presented after the last displayed one takes a vblank before this one,
+			// then the first vblank this frame's work can still make
+			uint64_t now = SDL_GetTicksNS();
+			uint64_t lead = pacer->_work_ns + pacer->_margin_ns;
+			uint64_t vblank = displayed_ns + (pacer->_next_id - displayed_id) * pacer->_refresh_ns;
+			if (vblank < now + lead) vblank += (now + lead - vblank + pacer->_refresh_ns - 1) / pacer->_refresh_ns * pacer->_refresh_ns;
+			// A stale prediction (display off, window hidden) holds a frame two refreshes at most
+			if (vblank - lead > now) SDL_DelayPrecise(SDL_min(vblank - lead - now, 2 * pacer->_refresh_ns));
+		};
+	};
+	pacer->_begin_ns = SDL_GetTicksNS();
+};
+
+uint64_t pacing_present(FramePacer *pacer, uint64_t gpu_ns)
+{
+	uint64_t work = SDL_GetTicksNS() - pacer->_begin_ns + gpu_ns;
+	// A heavier frame backs off at once, lighter ones move the start closer over a few frames
+	pacer->_work_ns = work > pacer->_work_ns ? work : pacer->_work_ns - (pacer->_work_ns - work) / 16;
+	if (!pacer->_enabled) return 0;
+
+	uint64_t id = pacer->_next_id++;
+	SDL_LockMutex(pacer->_mutex);
+	if (pacer->_pending_count == PACING_MAX_PENDING)
+	{
+		pacer->_pending_first = (pacer->_pending_first + 1) % PACING_MAX_PENDING;
+		pacer->_pending_count--;
+	};
+	uint32_t slot = (pacer->_pending_first + pacer->_pending_count++) % PACING_MAX_PENDING;
+	pacer->_pending[slot] = (PacingFrame){._id = id, ._begin_ns = pacer->_begin_ns};
+	SDL_BroadcastCondition(pacer->_changed);
+	SDL_UnlockMutex(pacer->_mutex);
+	return id;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "vk.h"
+
+// When frames actually reach the display, with VK_KHR_present_id and VK_KHR_present_wait.
+// Every present gets an id, a thread waits on them in order and timestamps each one as it is
+// displayed: latency is from the start of the frame's CPU work to that, the interval is between
+// two displayed frames and its spread around the refresh interval is the jitter.
+// --frame-pacing also delays the start of a frame just in time: from the last displayed frame and
+// the frames queued after it, it predicts the vblank the new frame can make and starts the CPU work
+// only as much before it as a frame takes (CPU + GPU, plus a margin), so the input it samples is
+// as fresh as it can be instead of waiting in the swapchain queue.
+// Nothing is measured without the extensions, the frame loop then runs as before.
+
+// Histograms: 0.25 ms buckets, the last one also takes everything longer
+constexpr uint32_t PACING_BUCKETS = 256;
+constexpr double PACING_BUCKET_MS = 0.25;
+// Presents the thread hasn't seen displayed yet, the oldest is dropped past this
+constexpr uint32_t PACING_MAX_PENDING = 8;
+
+typedef struct
+{
+	uint64_t _id;
+	// CPU work of the frame started
+	uint64_t _begin_ns;
+} PacingFrame;
+
+typedef struct
+{
+	VkDevice _device;
+	// VK_NULL_HANDLE while the swapchain is recreated
+	VkSwapchainKHR _swapchain;
+	SDL_Thread *_thread;
+	SDL_Mutex *_mutex;
+	// Presents queued, the thread left vkWaitForPresentKHR, or quit
+	SDL_Condition *_changed;
+	bool _quit, _waiting;
+
+	// Guarded by _mutex: presents in flight, and what the thread measured
+	PacingFrame _pending[PACING_MAX_PENDING];
+	uint32_t _pending_first, _pending_count;
+	uint64_t _displayed_id, _displayed_ns;
+	uint32_t _interval_histogram[PACING_BUCKETS], _latency_histogram[PACING_BUCKETS];
+	uint64_t _frames, _missed;
+	// For the debug log, reset every PACING_LOG_FRAMES displayed frames
+	double _interval_sum, _interval_squares, _latency_sum;
+	uint32_t _log_frames;
+
+	// Main thread only
+	bool _enabled, _pace;
+	uint64_t _next_id, _begin_ns;
+	uint64_t _refresh_ns, _margin_ns;
+	// Time a frame takes, CPU until present plus GPU. Follows increases at once, decreases slowly
+	uint64_t _work_ns;
+	const char *_csv_path;
+} FramePacer;
+
+// Refresh rate of window's display. Does nothing but the CPU side bookkeeping unless
+// vk->_present_wait. pace: --frame-pacing, csv_path: histograms written there at quit, or nullptr
+Result pacing_init(FramePacer *pacer, VulkanState *vk, SDL_Window *window, bool pace, const char *csv_path);
+void pacing_quit(FramePacer *pacer);
+// Before the swapchain is destroyed: stop waiting on its presents. pacing_attach once recreated
+void pacing_detach(FramePacer *pacer);
+void pacing_attach(FramePacer *pacer, VkSwapchainKHR swapchain);
+
+// Start of a frame, before input and simulation: with --frame-pacing, sleep until it is time
+void pacing_begin_frame(FramePacer *pacer);
+// Id for the VkPresentIdKHR of this frame's present, 0 (no id) without present wait.
+// gpu_ns: GPU time of a recent frame
+uint64_t pacing_present(FramePacer *pacer, uint64_t gpu_ns);
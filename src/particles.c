@@ -0,0 +1,289 @@
+#include "particles.h"
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+
+// Word offsets in the counters buffer, see shader/particles.slang
+static constexpr uint32_t COUNTER_DISPATCH = 4;
+static constexpr uint32_t COUNTER_DRAW = 8;
+static constexpr uint32_t COUNTERS_SIZE = 12 * sizeof(uint32_t);
+// Particle in shader/particles.slang, must match it
+static constexpr uint32_t PARTICLE_SIZE = 12 * sizeof(float);
+
+static const ParticleEmitRequest presets[] = {
+	[PARTICLE_DUST] = {
+		._area = {1.0f, 1.0f}, ._velocity_spread = {0.05f, 0.05f},
+		._color = {0.8f, 0.75f, 0.6f, 0.25f}, ._life = 6.0f, ._size = 0.01f, ._gravity = 0.0f},
+	[PARTICLE_RAIN] = {
+		._area = {1.0f, 0.0f}, ._velocity = {0.1f, 2.5f}, ._velocity_spread = {0.05f, 0.3f},
+		._color = {0.6f, 0.7f, 0.9f, 0.5f}, ._life = 1.0f, ._size = 0.004f, ._gravity = 1.0f},
+	[PARTICLE_GLASS] = {
+		._area = {0.05f, 0.05f}, ._velocity_spread = {1.5f, 1.5f},
+		._color = {0.8f, 0.9f, 1.0f, 0.9f}, ._life = 1.5f, ._size = 0.006f, ._gravity = 2.0f},
+	[PARTICLE_MUZZLE_FLASH] = {
+		._area = {0.02f, 0.02f}, ._velocity_spread = {2.0f, 2.0f},
+		._color = {1.0f, 0.8f, 0.3f, 1.0f}, ._life = 0.08f, ._size = 0.015f, ._gravity = 0.0f},
+};
+
+// Takes ownership of module
+static Result build_pipelines(ParticleSystem *ps, VulkanState *vk, VkShaderModule module, ParticlePipelines *out)
+{
+	out->_module = module;
+	if (module == VK_NULL_HANDLE) return FAILURE;
+
+	VkPipelineLayout layout = ps->_bindings._pipeline_layout;
+	if (create_compute_pipeline(vk->_device, vk->_pipeline_cache, out->_module, "init_main", layout, &out->_init) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, out->_module, "begin_main", layout, &out->_begin) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, out->_module, "emit_main", layout, &out->_emit) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, out->_module, "prepare_main", layout, &out->_prepare) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, out->_module, "simulate_main", layout, &out->_simulate) != SUCCESS)
+		return FAILURE;
+
+	// Quads are generated in the vertex shader and never back facing, no culling
+	return build_graphics_pipeline(vk->_device, vk->_pipeline_cache, vk->_swapchain_format, out->_module, "vert_main", "frag_main",
+			VK_CULL_MODE_NONE, layout, &out->_draw);
+};
+
+// Destroying null handles is a no-op, works on a partially built set too
+static void destroy_pipelines(VkDevice device, ParticlePipelines *pipelines)
+{
+	vkDestroyPipeline(device, pipelines->_init, nullptr);
+	vkDestroyPipeline(device, pipelines->_begin, nullptr);
+	vkDestroyPipeline(device, pipelines->_emit, nullptr);
+	vkDestroyPipeline(device, pipelines->_prepare, nullptr);
+	vkDestroyPipeline(device, pipelines->_simulate, nullptr);
+	vkDestroyPipeline(device, pipelines->_draw, nullptr);
+	vkDestroyShaderModule(device, pipelines->_module, nullptr);
+	*pipelines = (ParticlePipelines){};
+};
+
+Result particles_init(ParticleSystem *ps, VulkanState *vk)
+{
+	*ps = (ParticleSystem){};
+	ps->_view[0] = 1.0f;
+	ps->_view[1] = 1.0f;
+	ps->_seed = 0x1234567u;
+
+	VkMemoryPropertyFlags device_local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	VkMemoryPropertyFlags host_visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	if (create_buffer(vk, PARTICLES_CAPACITY * PARTICLE_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				device_local, &ps->_particles, &ps->_particles_memory) != SUCCESS
+		|| create_buffer(vk, 2 * PARTICLES_CAPACITY * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				device_local, &ps->_alive, &ps->_alive_memory) != SUCCESS
+		|| create_buffer(vk, PARTICLES_CAPACITY * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				device_local, &ps->_dead, &ps->_dead_memory) != SUCCESS
+		|| create_buffer(vk, COUNTERS_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				device_local, &ps->_counters, &ps->_counters_memory) != SUCCESS
+		|| create_buffer(vk, MAX_FRAMES_IN_FLIGHT * PARTICLES_MAX_REQUESTS * sizeof(ParticleEmitRequest),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host_visible, &ps->_requests, &ps->_requests_memory) != SUCCESS)
+		return FAILURE;
+
+	// Requests are rewritten every frame, keep them mapped
+	if (vkMapMemory(vk->_device, ps->_requests_memory, 0, VK_WHOLE_SIZE, 0, (void **)&ps->_mapped_requests) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map particle requests\n");
+		return FAILURE;
+	};
+
+	VkBuffer buffers[5] = {ps->_particles, ps->_alive, ps->_dead, ps->_counters, ps->_requests};
+	if (create_storage_bindings(vk->_device, buffers, 5, sizeof(ParticleParams), &ps->_bindings) != SUCCESS)
+		return FAILURE;
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Created particle system, capacity %u\n", PARTICLES_CAPACITY);
+	return SUCCESS;
+};
+
+Result particles_build(ParticleSystem *ps, VulkanState *vk, const char *shader_name)
+{
+	return build_pipelines(ps, vk, load_shader_module(vk->_device, shader_name), &ps->_pipelines);
+};
+
+void particles_quit(ParticleSystem *ps, VulkanState *vk)
+{
+	destroy_pipelines(vk->_device, &ps->_pipelines);
+	destroy_pipelines(vk->_device, &ps->_reloaded);
+	destroy_storage_bindings(vk->_device, &ps->_bindings);
+	vkUnmapMemory(vk->_device, ps->_requests_memory);
+	destroy_buffer(vk, ps->_particles, ps->_particles_memory);
+	destroy_buffer(vk, ps->_alive, ps->_alive_memory);
+	destroy_buffer(vk, ps->_dead, ps->_dead_memory);
+	destroy_buffer(vk, ps->_counters, ps->_counters_memory);
+	destroy_buffer(vk, ps->_requests, ps->_requests_memory);
+};
+
+Result particles_reload(ParticleSystem *ps, VulkanState *vk, const char *shader_path)
+{
+	if (build_pipelines(ps, vk, load_shader_module_file(vk->_device, shader_path), &ps->_reloaded) != SUCCESS)
+	{
+		destroy_pipelines(vk->_device, &ps->_reloaded);
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+void particles_swap(ParticleSystem *ps, VulkanState *vk)
+{
+	// Frames are waited on before the next one is recorded, the old pipelines are idle here
+	destroy_pipelines(vk->_device, &ps->_pipelines);
+	ps->_pipelines = ps->_reloaded;
+	ps->_reloaded = (ParticlePipelines){};
+};
+
+static void queue_request(ParticleSystem *ps, const ParticleEmitRequest *request)
+{
+	if (ps->_requests_count == PARTICLES_MAX_REQUESTS || request->_count == 0) return;
+	ps->_pending[ps->_requests_count++] = *request;
+	ps->_emit_total += request->_count;
+};
+
+void particles_burst(ParticleSystem *ps, ParticleKind kind, const float2 position, uint32_t count)
+{
+	ParticleEmitRequest request = presets[kind];
+	request._position[0] = position[0];
+	request._position[1] = position[1];
+	request._count = count;
+	queue_request(ps, &request);
+};
+
+uint32_t particles_add_emitter(ParticleSystem *ps, ParticleKind kind, const float2 position, const float2 area, float rate)
+{
+	if (ps->_emitters_count == PARTICLES_MAX_EMITTERS) return UINT32_MAX;
+	ParticleEmitter *emitter = &ps->_emitters[ps->_emitters_count];
+	emitter->_request = presets[kind];
+	emitter->_request._position[0] = position[0];
+	emitter->_request._position[1] = position[1];
+	emitter->_request._area[0] = area[0];
+	emitter->_request._area[1] = area[1];
+	emitter->_rate = rate;
+	emitter->_accumulated = 0.0f;
+	emitter->_paused = false;
+	return ps->_emitters_count++;
+};
+
+static void push_params(ParticleSystem *ps, VkCommandBuffer cmdbuffer, const ParticleParams *params)
+{
+	vkCmdPushConstants(cmdbuffer, ps->_bindings._pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+			0, sizeof(ParticleParams), params);
+};
+
+void particles_record_update(ParticleSystem *ps, VulkanState *vk, VkCommandBuffer cmdbuffer, float dt)
+{
+	for (uint32_t i = 0; i < ps->_emitters_count; i++)
+	{
+		ParticleEmitter *emitter = &ps->_emitters[i];
+		if (emitter->_paused) continue;
+		emitter->_accumulated += emitter->_rate * dt;
+		emitter->_request._count = (uint32_t)emitter->_accumulated;
+		emitter->_accumulated -= (float)emitter->_request._count;
+		queue_request(ps, &emitter->_request);
+	};
+
+	uint32_t request_base = vk->_current_frame * PARTICLES_MAX_REQUESTS;
+	SDL_memcpy(&ps->_mapped_requests[request_base], ps->_pending, ps->_requests_count * sizeof(ParticleEmitRequest));
+
+	ParticleParams params = {};
+	SDL_memcpy(params._view, ps->_view, sizeof(float4));
+	params._dt = dt;
+	params._capacity = PARTICLES_CAPACITY;
+	params._parity = ps->_parity;
+	params._request_base = request_base;
+	params._request_count = ps->_requests_count;
+	params._emit_total = ps->_emit_total;
+	params._seed = ps->_seed++ * 0x9E3779B9u;
+
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_bindings._pipeline_layout, 0, 1, &ps->_bindings._set, 0, nullptr);
+	push_params(ps, cmdbuffer, &params);
+
+	VkBuffer shared[3] = {ps->_particles, ps->_alive, ps->_counters};
+	// Last frame's draw read the lists and the indirect arguments we are about to rewrite.
+	// On the compute queue the semaphore wait on that frame orders it, the buffers only change family
+	if (!vk->_async_compute)
+		memory_barrier(cmdbuffer,
+				VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	else if (ps->_draw_owns)
+		buffer_ownership_barrier(cmdbuffer, shared, 3, vk->_queue_indicies._graphics, vk->_queue_indicies._compute, false,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	if (!ps->_initialized)
+	{
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._init);
+		vkCmdDispatch(cmdbuffer, (PARTICLES_CAPACITY + 63) / 64, 1, 1);
+		memory_barrier(cmdbuffer,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		ps->_initialized = true;
+	};
+
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._begin);
+	vkCmdDispatch(cmdbuffer, 1, 1, 1);
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	if (ps->_emit_total > 0)
+	{
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._emit);
+		vkCmdDispatch(cmdbuffer, (ps->_emit_total + 63) / 64, 1, 1);
+		memory_barrier(cmdbuffer,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	};
+
+	// Alive count is only known on the GPU, it writes the dispatch size for the simulation
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._prepare);
+	vkCmdDispatch(cmdbuffer, 1, 1, 1);
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._simulate);
+	vkCmdDispatchIndirect(cmdbuffer, ps->_counters, COUNTER_DISPATCH * sizeof(uint32_t));
+
+	// A compute only queue has no vertex stages, the acquire in particles_record_draw_acquire makes the writes visible
+	if (!vk->_async_compute)
+		memory_barrier(cmdbuffer,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+				VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+	else
+		buffer_ownership_barrier(cmdbuffer, shared, 3, vk->_queue_indicies._compute, vk->_queue_indicies._graphics, true,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	// Survivors were compacted into the other list, it is drawn now and simulated next frame
+	ps->_parity = 1 - ps->_parity;
+	ps->_requests_count = 0;
+	ps->_emit_total = 0;
+};
+
+void particles_record_draw_acquire(ParticleSystem *ps, VulkanState *vk, VkCommandBuffer cmdbuffer)
+{
+	if (!vk->_async_compute) return;
+	VkBuffer shared[3] = {ps->_particles, ps->_alive, ps->_counters};
+	buffer_ownership_barrier(cmdbuffer, shared, 3, vk->_queue_indicies._compute, vk->_queue_indicies._graphics, false,
+			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+};
+
+void particles_record_draw_release(ParticleSystem *ps, VulkanState *vk, VkCommandBuffer cmdbuffer)
+{
+	if (!vk->_async_compute) return;
+	VkBuffer shared[3] = {ps->_particles, ps->_alive, ps->_counters};
+	// Reads only, nothing to make available
+	buffer_ownership_barrier(cmdbuffer, shared, 3, vk->_queue_indicies._graphics, vk->_queue_indicies._compute, true,
+			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_NONE);
+	ps->_draw_owns = true;
+};
+
+void particles_record_draw(ParticleSystem *ps, VkCommandBuffer cmdbuffer, const float4 view)
+{
+	ParticleParams params = {};
+	SDL_memcpy(params._view, view, sizeof(float4));
+	params._capacity = PARTICLES_CAPACITY;
+	params._parity = ps->_parity;
+
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ps->_pipelines._draw);
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ps->_bindings._pipeline_layout, 0, 1, &ps->_bindings._set, 0, nullptr);
+	push_params(ps, cmdbuffer, &params);
+	vkCmdDrawIndirect(cmdbuffer, ps->_counters, COUNTER_DRAW * sizeof(uint32_t), 1, sizeof(VkDrawIndirectCommand));
+};
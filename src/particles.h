@@ -0,0 +1,109 @@
+#pragma once
+#include "vk.h"
+
+// GPU particle system: dust, rain through windows, broken glass, muzzle flashes.
+// The CPU only writes a handful of emit requests per frame. Emission, simulation and compaction
+// of the alive list run in compute, the draw count comes from the GPU through vkCmdDrawIndirect.
+
+constexpr uint32_t PARTICLES_CAPACITY = 1 << 18;
+constexpr uint32_t PARTICLES_MAX_REQUESTS = 64;
+constexpr uint32_t PARTICLES_MAX_EMITTERS = 32;
+
+typedef enum
+{
+	PARTICLE_DUST,
+	PARTICLE_RAIN,
+	PARTICLE_GLASS,
+	PARTICLE_MUZZLE_FLASH,
+} ParticleKind;
+
+// Matches EmitRequest in shader/particles.slang (std430)
+typedef struct
+{
+	float2 _position;
+	float2 _area;
+	float2 _velocity;
+	float2 _velocity_spread;
+	float4 _color;
+	float _life;
+	float _size;
+	float _gravity;
+	uint32_t _count;
+} ParticleEmitRequest;
+
+// Matches Params in shader/particles.slang, pushed as push constants
+typedef struct
+{
+	float4 _view;
+	float _dt;
+	uint32_t _capacity;
+	uint32_t _parity;
+	uint32_t _request_base;
+	uint32_t _request_count;
+	uint32_t _emit_total;
+	uint32_t _seed;
+	uint32_t _pad;
+} ParticleParams;
+
+// Continuous emitter, rate in particles per second
+typedef struct
+{
+	ParticleEmitRequest _request;
+	float _rate;
+	float _accumulated;
+	// Nobody can see it, particles already out keep simulating but no new ones are emitted
+	bool _paused;
+} ParticleEmitter;
+
+typedef struct
+{
+	VkShaderModule _module;
+	VkPipeline _init, _begin, _emit, _prepare, _simulate, _draw;
+} ParticlePipelines;
+
+typedef struct
+{
+	VkBuffer _particles, _alive, _dead, _counters, _requests;
+	VkDeviceMemory _particles_memory, _alive_memory, _dead_memory, _counters_memory, _requests_memory;
+	ParticleEmitRequest *_mapped_requests;
+
+	StorageBindings _bindings;
+	// _reloaded is built off the main thread by a shader hot reload, swapped in between frames
+	ParticlePipelines _pipelines, _reloaded;
+
+	bool _initialized;
+	// Async compute: the graphics family owns the shared buffers, the next update takes them back first
+	bool _draw_owns;
+	uint32_t _parity, _seed;
+	// World to clip transform: clip = world * view.xy + view.zw
+	float4 _view;
+
+	uint32_t _requests_count, _emit_total;
+	ParticleEmitRequest _pending[PARTICLES_MAX_REQUESTS];
+	uint32_t _emitters_count;
+	ParticleEmitter _emitters[PARTICLES_MAX_EMITTERS];
+} ParticleSystem;
+
+Result particles_init(ParticleSystem *ps, VulkanState *vk);
+// Compile the pipelines, may run on a worker thread once init is done.
+// shader_name is the embedded module, e.g. "particles.spv"
+Result particles_build(ParticleSystem *ps, VulkanState *vk, const char *shader_name);
+void particles_quit(ParticleSystem *ps, VulkanState *vk);
+// Shader hot reload: build from a new module on any thread, then swap on the main thread between frames
+Result particles_reload(ParticleSystem *ps, VulkanState *vk, const char *shader_path);
+void particles_swap(ParticleSystem *ps, VulkanState *vk);
+
+// One shot burst (glass shards, muzzle flash), emitted on the next update
+void particles_burst(ParticleSystem *ps, ParticleKind kind, const float2 position, uint32_t count);
+// Continuous emitter (dust in a light beam, rain behind a window). Returns its index
+uint32_t particles_add_emitter(ParticleSystem *ps, ParticleKind kind, const float2 position, const float2 area, float rate);
+
+// Record the compute passes, outside of rendering. With vk->_async_compute, cmdbuffer goes to
+// the compute queue and the graphics submit must wait for it before the draw
+void particles_record_update(ParticleSystem *ps, VulkanState *vk, VkCommandBuffer cmdbuffer, float dt);
+// Async compute only, on the graphics queue outside of rendering: take the buffers the draw reads
+// from the compute family, then hand them back once the draw is recorded. No-op otherwise
+void particles_record_draw_acquire(ParticleSystem *ps, VulkanState *vk, VkCommandBuffer cmdbuffer);
+void particles_record_draw_release(ParticleSystem *ps, VulkanState *vk, VkCommandBuffer cmdbuffer);
+// Record the indirect draw seen through view, inside dynamic rendering
+void particles_record_draw(ParticleSystem *ps, VkCommandBuffer cmdbuffer, const float4 view);
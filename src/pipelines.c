@@ -0,0 +1,374 @@
+#include "pipelines.h"
+#include "bench.h"
+#include "lightmap.h"
+#include "ring.h"
+
+static const VkGraphicsPipelineLibraryFlagsEXT library_parts[4] = {
+	VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+	VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+	VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+	VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+};
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	};
+	return hash;
+};
+
+// Field by field, struct padding is never hashed and entry names are hashed by content
+uint64_t pipeline_desc_hash(const PipelineDesc *desc)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = fnv1a(hash, &desc->_module, sizeof(desc->_module));
+	hash = fnv1a(hash, desc->_vert_entry, SDL_strlen(desc->_vert_entry));
+	hash = fnv1a(hash, desc->_frag_entry, SDL_strlen(desc->_frag_entry));
+	hash = fnv1a(hash, &desc->_layout, sizeof(desc->_layout));
+	hash = fnv1a(hash, &desc->_color_format, sizeof(desc->_color_format));
+	hash = fnv1a(hash, &desc->_topology, sizeof(desc->_topology));
+	hash = fnv1a(hash, &desc->_cull_mode, sizeof(desc->_cull_mode));
+	hash = fnv1a(hash, &desc->_blend, sizeof(desc->_blend));
+	hash = fnv1a(hash, &desc->_features, sizeof(desc->_features));
+	return hash;
+};
+
+bool pipeline_desc_equal(const PipelineDesc *a, const PipelineDesc *b)
+{
+	return a->_module == b->_module
+		&& SDL_strcmp(a->_vert_entry, b->_vert_entry) == 0
+		&& SDL_strcmp(a->_frag_entry, b->_frag_entry) == 0
+		&& a->_layout == b->_layout
+		&& a->_color_format == b->_color_format
+		&& a->_topology == b->_topology
+		&& a->_cull_mode == b->_cull_mode
+		&& a->_blend == b->_blend
+		&& a->_features == b->_features;
+};
+
+// Only the fields a library part depends on, variants that agree on them share the part
+static PipelineDesc library_key(const PipelineDesc *desc, VkGraphicsPipelineLibraryFlagsEXT part)
+{
+	PipelineDesc key = {._vert_entry = "", ._frag_entry = ""};
+	switch (part)
+	{
+	case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+		key._topology = desc->_topology;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+		key._module = desc->_module;
+		key._vert_entry = desc->_vert_entry;
+		key._layout = desc->_layout;
+		key._cull_mode = desc->_cull_mode;
+		key._features = desc->_features;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+		key._module = desc->_module;
+		key._frag_entry = desc->_frag_entry;
+		key._layout = desc->_layout;
+		key._features = desc->_features;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+		key._color_format = desc->_color_format;
+		key._blend = desc->_blend;
+		break;
+	default:
+		break;
+	};
+	return key;
+};
+
+static uint64_t part_hash(const PipelineDesc *key, uint32_t part)
+{
+	return fnv1a(pipeline_desc_hash(key), &part, sizeof(part));
+};
+
+Result pipeline_variants_init(PipelineVariants *pv, VkDevice device, VkPipelineCache cache, bool use_libraries)
+{
+	SDL_memset(pv, 0, sizeof(*pv));
+	pv->_device = device;
+	pv->_cache = cache;
+	pv->_use_libraries = use_libraries;
+	pv->_mutex = SDL_CreateMutex();
+	if (pv->_mutex == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline variants mutex\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+void pipeline_variants_quit(PipelineVariants *pv)
+{
+	for (uint32_t i = 0; i < PIPELINE_VARIANTS_CAPACITY; i++)
+	{
+		vkDestroyPipeline(pv->_device, pv->_variants._entries[i]._pipeline, nullptr);
+		vkDestroyPipeline(pv->_device, pv->_libraries._entries[i]._pipeline, nullptr);
+	};
+	SDL_DestroyMutex(pv->_mutex);
+	SDL_memset(pv, 0, sizeof(*pv));
+};
+
+// Slot holding desc, or the empty slot where it belongs. Called with the mutex held
+static PipelineVariant *find_slot(PipelineTable *table, const PipelineDesc *desc, uint32_t part, uint64_t hash)
+{
+	for (uint32_t probe = 0; probe < PIPELINE_VARIANTS_CAPACITY; probe++)
+	{
+		PipelineVariant *variant = &table->_entries[(hash + probe) & (PIPELINE_VARIANTS_CAPACITY - 1)];
+		if (variant->_pipeline == VK_NULL_HANDLE) return variant;
+		if (variant->_hash == hash && variant->_part == part && pipeline_desc_equal(&variant->_desc, desc)) return variant;
+	};
+	return nullptr;
+};
+
+static void insert_locked(PipelineVariants *pv, PipelineTable *table, const PipelineDesc *desc, uint32_t part,
+		uint64_t hash, VkPipeline *pipeline)
+{
+	PipelineVariant *slot = find_slot(table, desc, part, hash);
+	if (slot != nullptr && slot->_pipeline != VK_NULL_HANDLE)
+	{
+		// Someone else built the same variant meanwhile, keep theirs
+		vkDestroyPipeline(pv->_device, *pipeline, nullptr);
+		*pipeline = slot->_pipeline;
+		return;
+	};
+	if (slot == nullptr || table->_count + 1 > PIPELINE_VARIANTS_CAPACITY * 3 / 4)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Pipeline variant table is full\n");
+		vkDestroyPipeline(pv->_device, *pipeline, nullptr);
+		*pipeline = VK_NULL_HANDLE;
+		return;
+	};
+	slot->_hash = hash;
+	slot->_desc = *desc;
+	slot->_part = part;
+	slot->_pipeline = *pipeline;
+	table->_count++;
+};
+
+static VkPipeline lookup(PipelineVariants *pv, PipelineTable *table, const PipelineDesc *desc, uint32_t part, uint64_t hash)
+{
+	SDL_LockMutex(pv->_mutex);
+	PipelineVariant *slot = find_slot(table, desc, part, hash);
+	VkPipeline pipeline = slot != nullptr ? slot->_pipeline : VK_NULL_HANDLE;
+	SDL_UnlockMutex(pv->_mutex);
+	return pipeline;
+};
+
+static VkPipeline get_library(PipelineVariants *pv, const PipelineDesc *desc, VkGraphicsPipelineLibraryFlagsEXT part)
+{
+	PipelineDesc key = library_key(desc, part);
+	uint64_t hash = part_hash(&key, part);
+	VkPipeline library = lookup(pv, &pv->_libraries, &key, part, hash);
+	if (library != VK_NULL_HANDLE) return library;
+
+	if (create_graphics_pipeline_part(pv->_device, pv->_cache, desc, part, &library) != SUCCESS) return VK_NULL_HANDLE;
+	SDL_LockMutex(pv->_mutex);
+	insert_locked(pv, &pv->_libraries, &key, part, hash, &library);
+	SDL_UnlockMutex(pv->_mutex);
+	return library;
+};
+
+static Result create_variant(PipelineVariants *pv, const PipelineDesc *desc, VkPipeline *pipeline)
+{
+	if (!pv->_use_libraries) return create_graphics_pipeline_desc(pv->_device, pv->_cache, desc, pipeline);
+
+	VkPipeline parts[4];
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		parts[i] = get_library(pv, desc, library_parts[i]);
+		if (parts[i] == VK_NULL_HANDLE) return FAILURE;
+	};
+	return link_graphics_pipeline(pv->_device, pv->_cache, parts, 4, desc->_layout, pipeline);
+};
+
+VkPipeline pipeline_variant_get(PipelineVariants *pv, const PipelineDesc *desc)
+{
+	uint64_t hash = pipeline_desc_hash(desc);
+	VkPipeline pipeline = lookup(pv, &pv->_variants, desc, 0, hash);
+	if (pipeline != VK_NULL_HANDLE) return pipeline;
+
+	// Compile without holding the lock, other threads keep hitting the table
+	if (pv->_warmed)
+	{
+		pv->_late_compiles++;
+		SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Pipeline variant %016llx (features %x) compiled after pre-warm\n",
+				(unsigned long long)hash, desc->_features);
+	};
+	if (create_variant(pv, desc, &pipeline) != SUCCESS) return VK_NULL_HANDLE;
+
+	SDL_LockMutex(pv->_mutex);
+	insert_locked(pv, &pv->_variants, desc, 0, hash, &pipeline);
+	SDL_UnlockMutex(pv->_mutex);
+	return pipeline;
+};
+
+void pipeline_variant_insert(PipelineVariants *pv, const PipelineDesc *desc, VkPipeline pipeline)
+{
+	SDL_LockMutex(pv->_mutex);
+	insert_locked(pv, &pv->_variants, desc, 0, pipeline_desc_hash(desc), &pipeline);
+	SDL_UnlockMutex(pv->_mutex);
+};
+
+Result pipeline_variants_prewarm(PipelineVariants *pv, const PipelineDesc *descs, uint32_t count)
+{
+	uint64_t start = SDL_GetTicksNS();
+	Result result = SUCCESS;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (pipeline_variant_get(pv, &descs[i]) == VK_NULL_HANDLE) result = FAILURE;
+	};
+	pv->_warmed = true;
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Pre-warmed %u pipeline variants in %.2f ms%s\n", count,
+			(double)(SDL_GetTicksNS() - start) / (double)SDL_NS_PER_MS, pv->_use_libraries ? " (linked)" : "");
+	return result;
+};
+
+// Removing from a linear probed table breaks probe chains, rebuild it from the survivors
+static void evict_locked(PipelineVariants *pv, PipelineTable *table, VkShaderModule module)
+{
+	PipelineVariant *kept = SDL_malloc(table->_count * sizeof(PipelineVariant));
+	uint32_t kept_count = 0;
+	for (uint32_t i = 0; i < PIPELINE_VARIANTS_CAPACITY; i++)
+	{
+		PipelineVariant *variant = &table->_entries[i];
+		if (variant->_pipeline == VK_NULL_HANDLE) continue;
+		if (variant->_desc._module == module) vkDestroyPipeline(pv->_device, variant->_pipeline, nullptr);
+		else kept[kept_count++] = *variant;
+	};
+
+	SDL_memset(table, 0, sizeof(*table));
+	for (uint32_t i = 0; i < kept_count; i++)
+	{
+		insert_locked(pv, table, &kept[i]._desc, kept[i]._part, kept[i]._hash, &kept[i]._pipeline);
+	};
+	SDL_free(kept);
+};
+
+void pipeline_variants_evict_module(PipelineVariants *pv, VkShaderModule module)
+{
+	SDL_LockMutex(pv->_mutex);
+	evict_locked(pv, &pv->_variants, module);
+	evict_locked(pv, &pv->_libraries, module);
+	SDL_UnlockMutex(pv->_mutex);
+};
+
+// Every state combination a material could ask for: 2 topologies x 3 cull modes x 3 blends x 2 features
+static constexpr uint32_t BENCH_DESCS = 36;
+
+static void bench_descs(VkShaderModule module, VkPipelineLayout layout, PipelineDesc *descs)
+{
+	static const VkPrimitiveTopology topologies[] = {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP};
+	static const VkCullModeFlags culls[] = {VK_CULL_MODE_NONE, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT};
+	static const PipelineBlend blends[] = {PIPELINE_BLEND_NONE, PIPELINE_BLEND_ALPHA, PIPELINE_BLEND_ADDITIVE};
+	for (uint32_t i = 0; i < BENCH_DESCS; i++)
+	{
+		descs[i] = (PipelineDesc){
+			._module = module, ._vert_entry = "vert_main", ._frag_entry = "frag_main", ._layout = layout,
+			._color_format = VK_FORMAT_B8G8R8A8_SRGB, ._topology = topologies[i / 18], ._cull_mode = culls[i / 6 % 3],
+			._blend = blends[i / 2 % 3], ._features = i % 2 ? PIPELINE_FEATURE_LIGHTING : 0,
+		};
+	};
+};
+
+// Complete pipelines, returns the worst single creation
+static double bench_complete(VkDevice device, VkPipelineCache cache, const PipelineDesc *descs, uint32_t count, double *total)
+{
+	double worst = 0.0;
+	*total = 0.0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		double begin = bench_now_ms();
+		create_graphics_pipeline_desc(device, cache, &descs[i], &pipeline);
+		double elapsed = bench_now_ms() - begin;
+		vkDestroyPipeline(device, pipeline, nullptr);
+		*total += elapsed;
+		worst = SDL_max(worst, elapsed);
+	};
+	return worst;
+};
+
+void pipeline_benchmark(void)
+{
+	BenchDevice bd = {};
+	if (!create_bench_device(&bd))
+	{
+		SDL_Log("pipelines: no Vulkan 1.3 device, skipped\n");
+		destroy_bench_device(&bd);
+		return;
+	};
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(bd._physical_device, &properties);
+
+	VkShaderModule module = load_shader_module(bd._device, "slang_compiled.spv");
+	// Same layout as the game's triangle, the shader reads the frame ring and the lightmap
+	VkDescriptorSetLayout set_layouts[2] = {};
+	frame_ring_create_set_layout(bd._device, &set_layouts[0]);
+	lightmap_create_set_layout(bd._device, &set_layouts[1]);
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkPipelineLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layout_create_info.setLayoutCount = 2;
+	layout_create_info.pSetLayouts = set_layouts;
+	vkCreatePipelineLayout(bd._device, &layout_create_info, nullptr, &layout);
+
+	PipelineDesc descs[BENCH_DESCS];
+	uint32_t count = BENCH_DESCS;
+	bench_descs(module, layout, descs);
+	SDL_Log("pipelines on %s, %u state combinations\n", properties.deviceName, count);
+
+	// Drivers keep their own on-disk caches, numbers past the first run of a build are warmer than a player's first launch
+	double total;
+	double worst = bench_complete(bd._device, VK_NULL_HANDLE, descs, count, &total);
+	SDL_Log("complete, no cache: %.3f ms per pipeline (worst %.3f ms)\n", total / count, worst);
+
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	VkPipelineCacheCreateInfo cache_create_info = {};
+	cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	vkCreatePipelineCache(bd._device, &cache_create_info, nullptr, &cache);
+	bench_complete(bd._device, cache, descs, count, &total);
+	worst = bench_complete(bd._device, cache, descs, count, &total);
+	SDL_Log("complete, warm cache: %.3f ms per pipeline (worst %.3f ms)\n", total / count, worst);
+
+	if (bd._pipeline_library)
+	{
+		// Parts are compiled once per distinct key, after that a new combination is only a link
+		PipelineVariants pv;
+		pipeline_variants_init(&pv, bd._device, VK_NULL_HANDLE, true);
+		double begin = bench_now_ms();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			for (uint32_t p = 0; p < 4; p++) get_library(&pv, &descs[i], library_parts[p]);
+		};
+		double parts_ms = bench_now_ms() - begin;
+
+		double link_total = 0.0, link_worst = 0.0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			VkPipeline parts[4], pipeline = VK_NULL_HANDLE;
+			for (uint32_t p = 0; p < 4; p++) parts[p] = get_library(&pv, &descs[i], library_parts[p]);
+			double link_begin = bench_now_ms();
+			link_graphics_pipeline(bd._device, VK_NULL_HANDLE, parts, 4, layout, &pipeline);
+			double elapsed = bench_now_ms() - link_begin;
+			vkDestroyPipeline(bd._device, pipeline, nullptr);
+			link_total += elapsed;
+			link_worst = SDL_max(link_worst, elapsed);
+		};
+		SDL_Log("library: %u parts in %.3f ms, then %.3f ms per link (worst %.3f ms)\n",
+				pv._libraries._count, parts_ms, link_total / count, link_worst);
+		pipeline_variants_quit(&pv);
+	}
+	else SDL_Log("library: VK_EXT_graphics_pipeline_library not supported\n");
+
+	vkDestroyPipelineCache(bd._device, cache, nullptr);
+	vkDestroyPipelineLayout(bd._device, layout, nullptr);
+	vkDestroyDescriptorSetLayout(bd._device, set_layouts[0], nullptr);
+	vkDestroyDescriptorSetLayout(bd._device, set_layouts[1], nullptr);
+	vkDestroyShaderModule(bd._device, module, nullptr);
+	destroy_bench_device(&bd);
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "vk.h"
+
+// Graphics pipeline variants, keyed by a hash of their PipelineDesc. Variants are created on
+// first use and shared afterwards. Known variants are pre-warmed at load so a material change
+// is a table lookup, not a pipeline compile in the middle of a frame.
+// With VK_EXT_graphics_pipeline_library a variant is linked from four cached parts instead, a new
+// state combination only compiles the parts it doesn't share with existing variants.
+
+constexpr uint32_t PIPELINE_VARIANTS_CAPACITY = 256;
+
+typedef struct
+{
+	uint64_t _hash;
+	PipelineDesc _desc;
+	// 0 for complete pipelines, the VkGraphicsPipelineLibraryFlagsEXT bit of a library part
+	uint32_t _part;
+	// VK_NULL_HANDLE: empty slot
+	VkPipeline _pipeline;
+} PipelineVariant;
+
+// Open addressing, linear probing
+typedef struct
+{
+	uint32_t _count;
+	PipelineVariant _entries[PIPELINE_VARIANTS_CAPACITY];
+} PipelineTable;
+
+typedef struct
+{
+	VkDevice _device;
+	VkPipelineCache _cache;
+	SDL_Mutex *_mutex;
+	bool _use_libraries;
+	PipelineTable _variants, _libraries;
+	// Set once pre-warming is done, later misses are hitches and get logged
+	bool _warmed;
+	uint32_t _late_compiles;
+} PipelineVariants;
+
+// cache is shared with the other pipelines and stays owned by the caller.
+// use_libraries needs VK_EXT_graphics_pipeline_library enabled on device
+Result pipeline_variants_init(PipelineVariants *pv, VkDevice device, VkPipelineCache cache, bool use_libraries);
+void pipeline_variants_quit(PipelineVariants *pv);
+
+// Create every variant up front, then treat later misses as hitches
+Result pipeline_variants_prewarm(PipelineVariants *pv, const PipelineDesc *descs, uint32_t count);
+// Existing variant or a freshly compiled one. VK_NULL_HANDLE if creation failed. Thread safe
+VkPipeline pipeline_variant_get(PipelineVariants *pv, const PipelineDesc *desc);
+// Take ownership of a pipeline built elsewhere (hot reload)
+void pipeline_variant_insert(PipelineVariants *pv, const PipelineDesc *desc, VkPipeline pipeline);
+// Destroy every variant built from module, before the module itself goes away
+void pipeline_variants_evict_module(PipelineVariants *pv, VkShaderModule module);
+
+uint64_t pipeline_desc_hash(const PipelineDesc *desc);
+bool pipeline_desc_equal(const PipelineDesc *a, const PipelineDesc *b);
+
+// homeinvasion --bench pipelines: creation latency of complete and linked pipelines, on a headless device
+void pipeline_benchmark(void);
@@ -0,0 +1,379 @@
+#include "portals.h"
+#include "bench.h"
+#include "visibility.h"
+#include <stdlib.h>
+
+// Closer than this to a door's line the eye is standing in the doorway
+static constexpr float DOORWAY_EPSILON = 1e-3f;
+
+// Directions from the eye, _left counterclockwise from _right and less than 180 degrees apart.
+// _full: the eye's own room, every direction
+typedef struct
+{
+	float2 _right, _left;
+	bool _full;
+} PortalCone;
+
+typedef struct
+{
+	uint32_t _room, _from_door;
+	PortalCone _cone;
+} PortalStep;
+
+static float cross2(const float2 a, const float2 b)
+{
+	return a[0] * b[1] - a[1] * b[0];
+};
+
+static bool cone_contains(const PortalCone *cone, const float2 d)
+{
+	return cone->_full || (cross2(cone->_right, d) >= 0.0f && cross2(d, cone->_left) >= 0.0f);
+};
+
+// Both under 180 degrees, so each edge of the intersection is an edge of one inside the other
+static bool cone_clip(const PortalCone *cone, const PortalCone *door, PortalCone *out)
+{
+	if (cone->_full)
+	{
+		*out = *door;
+		return true;
+	};
+	const float *right = cone_contains(door, cone->_right) ? cone->_right
+		: cone_contains(cone, door->_right) ? door->_right : nullptr;
+	const float *left = cone_contains(door, cone->_left) ? cone->_left
+		: cone_contains(cone, door->_left) ? door->_left : nullptr;
+	if (right == nullptr || left == nullptr || cross2(right, left) <= 0.0f) return false;
+	*out = (PortalCone){{right[0], right[1]}, {left[0], left[1]}, false};
+	return true;
+};
+
+static bool rect_overlap(const float2 a_min, const float2 a_max, const float2 b_min, const float2 b_max)
+{
+	return a_min[0] <= b_max[0] && b_min[0] <= a_max[0] && a_min[1] <= b_max[1] && b_min[1] <= a_max[1];
+};
+
+Result portals_init(PortalGraph *pg, Level *level)
+{
+	*pg = (PortalGraph){};
+	pg->_level = level;
+	pg->_origin[0] = level->_min[0];
+	pg->_origin[1] = level->_min[1];
+	pg->_width = (uint32_t)SDL_ceilf((level->_max[0] - level->_min[0]) / PORTALS_CELL_SIZE);
+	pg->_height = (uint32_t)SDL_ceilf((level->_max[1] - level->_min[1]) / PORTALS_CELL_SIZE);
+	uint32_t cells = pg->_width * pg->_height;
+
+	pg->_room_doors_offset = calloc(level->_rooms_count + 1, sizeof(uint32_t));
+	pg->_room_doors = malloc((level->_doors_count * 2 + 1) * sizeof(uint32_t));
+	pg->_cell_room = malloc(cells * sizeof(uint32_t));
+	pg->_visible = calloc(level->_rooms_count, sizeof(uint8_t));
+	pg->_visible_rooms = malloc((level->_rooms_count + 1) * sizeof(uint32_t));
+	if (!pg->_room_doors_offset || !pg->_room_doors || !pg->_cell_room || !pg->_visible || !pg->_visible_rooms)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate portal graph\n");
+		return FAILURE;
+	};
+
+	for (uint32_t d = 0; d < level->_doors_count; d++)
+	{
+		pg->_room_doors_offset[level->_doors[d]._rooms[0] + 1]++;
+		pg->_room_doors_offset[level->_doors[d]._rooms[1] + 1]++;
+	};
+	for (uint32_t r = 0; r < level->_rooms_count; r++) pg->_room_doors_offset[r + 1] += pg->_room_doors_offset[r];
+	uint32_t *fill = calloc(level->_rooms_count + 1, sizeof(uint32_t));
+	if (!fill) return FAILURE;
+	for (uint32_t d = 0; d < level->_doors_count; d++)
+	{
+		for (uint32_t side = 0; side < 2; side++)
+		{
+			uint32_t room = level->_doors[d]._rooms[side];
+			pg->_room_doors[pg->_room_doors_offset[room] + fill[room]++] = d;
+		};
+	};
+	free(fill);
+
+	for (uint32_t y = 0; y < pg->_height; y++)
+	{
+		for (uint32_t x = 0; x < pg->_width; x++)
+		{
+			float2 center = {pg->_origin[0] + ((float)x + 0.5f) * PORTALS_CELL_SIZE, pg->_origin[1] + ((float)y + 0.5f) * PORTALS_CELL_SIZE};
+			pg->_cell_room[y * pg->_width + x] = level_room_at(level, center);
+		};
+	};
+	return SUCCESS;
+};
+
+void portals_quit(PortalGraph *pg)
+{
+	free(pg->_room_doors_offset);
+	free(pg->_room_doors);
+	free(pg->_cell_room);
+	free(pg->_visible);
+	free(pg->_visible_rooms);
+	*pg = (PortalGraph){};
+};
+
+uint32_t portals_room_at(const PortalGraph *pg, const float2 p)
+{
+	int x = (int)SDL_floorf((p[0] - pg->_origin[0]) / PORTALS_CELL_SIZE);
+	int y = (int)SDL_floorf((p[1] - pg->_origin[1]) / PORTALS_CELL_SIZE);
+	if (x < 0 || y < 0 || x >= (int)pg->_width || y >= (int)pg->_height) return UINT32_MAX;
+	// Cells are classified by their center, near a room edge p may be in the neighbour
+	uint32_t room = pg->_cell_room[(uint32_t)y * pg->_width + (uint32_t)x];
+	if (room != UINT32_MAX)
+	{
+		const Room *r = &pg->_level->_rooms[room];
+		if (p[0] >= r->_min[0] && p[0] < r->_max[0] && p[1] >= r->_min[1] && p[1] < r->_max[1]) return room;
+	};
+	return level_room_at(pg->_level, p);
+};
+
+void portals_begin(PortalGraph *pg)
+{
+	for (uint32_t i = 0; i < pg->_visible_count; i++) pg->_visible[pg->_visible_rooms[i]] = 0;
+	pg->_visible_count = 0;
+	pg->_steps = 0;
+};
+
+static void mark_visible(PortalGraph *pg, uint32_t room, const float2 view_min, const float2 view_max)
+{
+	const Room *r = &pg->_level->_rooms[room];
+	if (pg->_visible[room] || !rect_overlap(r->_min, r->_max, view_min, view_max)) return;
+	pg->_visible[room] = 1;
+	pg->_visible_rooms[pg->_visible_count++] = room;
+};
+
+void portals_add_view(PortalGraph *pg, const float2 eye, const float4 view)
+{
+	const Level *level = pg->_level;
+	float2 view_min, view_max;
+	for (uint32_t axis = 0; axis < 2; axis++)
+	{
+		float a = (-1.0f - view[axis + 2]) / view[axis], b = (1.0f - view[axis + 2]) / view[axis];
+		view_min[axis] = SDL_min(a, b);
+		view_max[axis] = SDL_max(a, b);
+	};
+
+	uint32_t start = portals_room_at(pg, eye);
+	if (start == UINT32_MAX)
+	{
+		for (uint32_t r = 0; r < level->_rooms_count; r++) mark_visible(pg, r, view_min, view_max);
+		return;
+	};
+	bool eye_in_view = eye[0] >= view_min[0] && eye[0] <= view_max[0] && eye[1] >= view_min[1] && eye[1] <= view_max[1];
+
+	// Depth first, a room reached again through another door is walked again with that window
+	PortalStep stack[64];
+	uint32_t stack_count = 0, first_step = pg->_steps;
+	bool truncated = false;
+	stack[stack_count++] = (PortalStep){._room = start, ._from_door = UINT32_MAX, ._cone = {._full = true}};
+	while (stack_count > 0)
+	{
+		if (pg->_steps - first_step >= PORTALS_MAX_STEPS)
+		{
+			truncated = true;
+			break;
+		};
+		PortalStep step = stack[--stack_count];
+		mark_visible(pg, step._room, view_min, view_max);
+		for (uint32_t i = pg->_room_doors_offset[step._room]; i < pg->_room_doors_offset[step._room + 1]; i++)
+		{
+			uint32_t d = pg->_room_doors[i];
+			const Door *door = &level->_doors[d];
+			if (!door->_open || d == step._from_door) continue;
+			// Past a door outside the rect is outside the rect too, the rect is convex and holds the eye
+			float2 door_min = {SDL_min(door->_a[0], door->_b[0]), SDL_min(door->_a[1], door->_b[1])};
+			float2 door_max = {SDL_max(door->_a[0], door->_b[0]), SDL_max(door->_a[1], door->_b[1])};
+			if (eye_in_view && !rect_overlap(door_min, door_max, view_min, view_max)) continue;
+
+			float2 da = {door->_a[0] - eye[0], door->_a[1] - eye[1]};
+			float2 db = {door->_b[0] - eye[0], door->_b[1] - eye[1]};
+			float side = cross2(da, db);
+			float length = SDL_sqrtf((db[0] - da[0]) * (db[0] - da[0]) + (db[1] - da[1]) * (db[1] - da[1]));
+			PortalCone next;
+			if (SDL_fabsf(side) <= DOORWAY_EPSILON * length)
+			{
+				// In the doorway everything goes through, seen edge on nothing does
+				if (da[0] * db[0] + da[1] * db[1] > 0.0f) continue;
+				next = step._cone;
+			}
+			else
+			{
+				PortalCone door_cone = side > 0.0f ? (PortalCone){{da[0], da[1]}, {db[0], db[1]}, false}
+					: (PortalCone){{db[0], db[1]}, {da[0], da[1]}, false};
+				if (!cone_clip(&step._cone, &door_cone, &next)) continue;
+			};
+
+			pg->_steps++;
+			if (stack_count == SDL_arraysize(stack))
+			{
+				truncated = true;
+				continue;
+			};
+			uint32_t room = door->_rooms[0] == step._room ? door->_rooms[1] : door->_rooms[0];
+			stack[stack_count++] = (PortalStep){._room = room, ._from_door = d, ._cone = next};
+		};
+	};
+	// Some windows were never walked, culling rooms they reach would make things pop out of view
+	if (truncated)
+	{
+		for (uint32_t r = 0; r < level->_rooms_count; r++) mark_visible(pg, r, view_min, view_max);
+	};
+};
+
+bool portals_room_visible(const PortalGraph *pg, uint32_t room)
+{
+	return room == UINT32_MAX || pg->_visible[room];
+};
+
+bool portals_point_visible(const PortalGraph *pg, const float2 p)
+{
+	return portals_room_visible(pg, portals_room_at(pg, p));
+};
+
+bool portals_circle_visible(const PortalGraph *pg, const float2 center, float radius)
+{
+	if (portals_point_visible(pg, center)) return true;
+	for (uint32_t i = 0; i < pg->_visible_count; i++)
+	{
+		const Room *r = &pg->_level->_rooms[pg->_visible_rooms[i]];
+		float dx = center[0] - SDL_clamp(center[0], r->_min[0], r->_max[0]);
+		float dy = center[1] - SDL_clamp(center[1], r->_min[1], r->_max[1]);
+		if (dx * dx + dy * dy <= radius * radius) return true;
+	};
+	return false;
+};
+
+bool portals_should_tick(const PortalGraph *pg, const float2 p, uint32_t agent, uint64_t tick)
+{
+	return portals_point_visible(pg, p) || (tick + agent) % PORTALS_UNSEEN_TICK == 0;
+};
+
+typedef struct
+{
+	float2 _position, _facing;
+} BenchAgent;
+
+void portals_benchmark(void)
+{
+	constexpr uint32_t FRAMES = 1000;
+	constexpr uint32_t SPRITES = 20000;
+	constexpr uint32_t LIGHTS = 200;
+	constexpr uint32_t EMITTERS = 32;
+	constexpr uint32_t AGENTS = 256;
+	// About 3x2 rooms on screen, like the game camera
+	constexpr float VIEW_WIDTH = 24.0f, VIEW_HEIGHT = 13.5f;
+
+	Level level;
+	if (level_generate_house(&level, 10, 5, 8.0f, 1234) != SUCCESS) return;
+	uint64_t rng = 11;
+	// A lived in house: some doors are shut
+	for (uint32_t d = 0; d < level._doors_count; d++)
+	{
+		if (random_range(&rng, 0.0f, 1.0f) < 0.3f) level_set_door(&level, d, false);
+	};
+
+	PortalGraph pg = {};
+	Visibility vis = {};
+	float2 *sprites = malloc(SPRITES * sizeof(float2));
+	float2 *lights = malloc(LIGHTS * sizeof(float2));
+	float2 *emitters = malloc(EMITTERS * sizeof(float2));
+	BenchAgent *agents = malloc(AGENTS * sizeof(BenchAgent));
+	if (!sprites || !lights || !emitters || !agents || portals_init(&pg, &level) != SUCCESS || vis_init(&vis, &level) != SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "portals benchmark setup failed\n");
+		vis_quit(&vis);
+		portals_quit(&pg);
+		free(sprites);
+		free(lights);
+		free(emitters);
+		free(agents);
+		level_free(&level);
+		return;
+	};
+	float2 *points[3] = {sprites, lights, emitters};
+	uint32_t counts[3] = {SPRITES, LIGHTS, EMITTERS};
+	for (uint32_t k = 0; k < 3; k++)
+	{
+		for (uint32_t i = 0; i < counts[k]; i++)
+		{
+			points[k][i][0] = random_range(&rng, level._min[0], level._max[0]);
+			points[k][i][1] = random_range(&rng, level._min[1], level._max[1]);
+		};
+	};
+	for (uint32_t i = 0; i < AGENTS; i++)
+	{
+		agents[i]._position[0] = random_range(&rng, level._min[0] + 0.5f, level._max[0] - 0.5f);
+		agents[i]._position[1] = random_range(&rng, level._min[1] + 0.5f, level._max[1] - 0.5f);
+		float angle = random_range(&rng, 0.0f, 2.0f * SDL_PI_F);
+		agents[i]._facing[0] = SDL_cosf(angle);
+		agents[i]._facing[1] = SDL_sinf(angle);
+	};
+
+	double traverse_ms = 0.0, sprites_ms = 0.0, full_ai_ms = 0.0, lod_ai_ms = 0.0;
+	uint64_t visible_rooms = 0, rect_rooms = 0, kept_sprites = 0, rect_sprites = 0, kept_lights = 0, kept_emitters = 0;
+	uint64_t full_ticks = 0, lod_ticks = 0, sightings = 0, steps = 0;
+	for (uint32_t frame = 0; frame < FRAMES; frame++)
+	{
+		float2 eye = {random_range(&rng, level._min[0] + 0.5f, level._max[0] - 0.5f),
+			random_range(&rng, level._min[1] + 0.5f, level._max[1] - 0.5f)};
+		float4 view = {2.0f / VIEW_WIDTH, 2.0f / VIEW_HEIGHT, 0.0f, 0.0f};
+		view[2] = -eye[0] * view[0];
+		view[3] = -eye[1] * view[1];
+		float2 view_min = {eye[0] - VIEW_WIDTH * 0.5f, eye[1] - VIEW_HEIGHT * 0.5f};
+		float2 view_max = {eye[0] + VIEW_WIDTH * 0.5f, eye[1] + VIEW_HEIGHT * 0.5f};
+
+		double begin = bench_now_ms();
+		portals_begin(&pg);
+		portals_add_view(&pg, eye, view);
+		traverse_ms += bench_now_ms() - begin;
+		steps += pg._steps;
+		visible_rooms += pg._visible_count;
+		for (uint32_t r = 0; r < level._rooms_count; r++) rect_rooms += rect_overlap(level._rooms[r]._min, level._rooms[r]._max, view_min, view_max);
+
+		begin = bench_now_ms();
+		for (uint32_t i = 0; i < SPRITES; i++) kept_sprites += portals_point_visible(&pg, sprites[i]);
+		sprites_ms += bench_now_ms() - begin;
+		for (uint32_t i = 0; i < SPRITES; i++)
+		{
+			rect_sprites += sprites[i][0] >= view_min[0] && sprites[i][0] <= view_max[0]
+				&& sprites[i][1] >= view_min[1] && sprites[i][1] <= view_max[1];
+		};
+		for (uint32_t i = 0; i < LIGHTS; i++) kept_lights += portals_circle_visible(&pg, lights[i], 3.0f);
+		for (uint32_t i = 0; i < EMITTERS; i++) kept_emitters += portals_point_visible(&pg, emitters[i]);
+
+		// An AI tick is a perception check against the player
+		begin = bench_now_ms();
+		for (uint32_t i = 0; i < AGENTS; i++)
+		{
+			sightings += vis_can_see(&vis, agents[i]._position, agents[i]._facing, 0.5f, 12.0f, eye);
+			full_ticks++;
+		};
+		full_ai_ms += bench_now_ms() - begin;
+		begin = bench_now_ms();
+		for (uint32_t i = 0; i < AGENTS; i++)
+		{
+			if (!portals_should_tick(&pg, agents[i]._position, i, frame)) continue;
+			sightings += vis_can_see(&vis, agents[i]._position, agents[i]._facing, 0.5f, 12.0f, eye);
+			lod_ticks++;
+		};
+		lod_ai_ms += bench_now_ms() - begin;
+	};
+
+	SDL_Log("portals %u rooms, %u doors: traversal %.4f ms/frame (%.1f door crossings), %.1f rooms visible of %.1f in the camera rect\n",
+			level._rooms_count, level._doors_count, traverse_ms / FRAMES, (double)steps / FRAMES, (double)visible_rooms / FRAMES,
+			(double)rect_rooms / FRAMES);
+	SDL_Log("portals culling: sprites %.1f%% kept (%.1f%% with the camera rect alone) in %.3f ms for %u, lights %.1f%%, emitters %.1f%%\n",
+			100.0 * kept_sprites / ((double)SPRITES * FRAMES), 100.0 * rect_sprites / ((double)SPRITES * FRAMES), sprites_ms / FRAMES,
+			SPRITES, 100.0 * kept_lights / ((double)LIGHTS * FRAMES), 100.0 * kept_emitters / ((double)EMITTERS * FRAMES));
+	SDL_Log("portals AI: %u agents, every tick %.3f ms (%.0f ticks), unseen rooms every %u ticks %.3f ms (%.0f ticks), %llu sightings\n",
+			AGENTS, full_ai_ms / FRAMES, (double)full_ticks / FRAMES, PORTALS_UNSEEN_TICK, lod_ai_ms / FRAMES,
+			(double)lod_ticks / FRAMES, (unsigned long long)sightings);
+
+	vis_quit(&vis);
+	portals_quit(&pg);
+	free(sprites);
+	free(lights);
+	free(emitters);
+	free(agents);
+	level_free(&level);
+};
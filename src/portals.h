@@ -0,0 +1,57 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "level.h"
+
+// Room/portal graph over the house: rooms are the nodes, open doors the portals between them.
+// Every frame the graph is walked from the eye's room through open doors, narrowing the angular
+// window at every door, and only rooms that window reaches and the camera rect overlaps are
+// visible. Sprites, lights and particle emitters in the other rooms are dropped before they
+// reach a renderer, and AI there ticks less often.
+
+// Room lookup grid
+constexpr float PORTALS_CELL_SIZE = 1.0f;
+// Door crossings per view, bounds the walk around loops of rooms. A view that hits it, or
+// overflows the walk's stack, sees every room in its rect
+constexpr uint32_t PORTALS_MAX_STEPS = 1024;
+// AI in rooms nobody sees thinks every this many ticks, staggered over the agents
+constexpr uint32_t PORTALS_UNSEEN_TICK = 4;
+
+typedef struct
+{
+	Level *_level;
+	// Doors of each room, CSR layout
+	uint32_t *_room_doors_offset, *_room_doors;
+	float2 _origin;
+	uint32_t _width, _height;
+	// Room at the center of each cell, UINT32_MAX outside the house
+	uint32_t *_cell_room;
+
+	// Union of the views added since portals_begin
+	uint8_t *_visible;
+	uint32_t _visible_count;
+	uint32_t *_visible_rooms;
+	uint32_t _steps;
+} PortalGraph;
+
+Result portals_init(PortalGraph *pg, Level *level);
+void portals_quit(PortalGraph *pg);
+// Returns the room containing p, or UINT32_MAX. Grid lookup, level_room_at is a linear scan
+uint32_t portals_room_at(const PortalGraph *pg, const float2 p);
+
+// Clear the visible set, then add every view of the frame (main camera, security cameras)
+void portals_begin(PortalGraph *pg);
+// Rooms seen from eye through open doors, within the world rect of view (world to clip,
+// clip = world * view.xy + view.zw). An eye outside the house sees every room in the rect
+void portals_add_view(PortalGraph *pg, const float2 eye, const float4 view);
+
+bool portals_room_visible(const PortalGraph *pg, uint32_t room);
+// By the room of p, points outside the house are always visible
+bool portals_point_visible(const PortalGraph *pg, const float2 p);
+// Conservative: the circle touches a visible room (lights spill through doorways)
+bool portals_circle_visible(const PortalGraph *pg, const float2 center, float radius);
+// AI level of detail: agents in visible rooms tick every tick, the others every
+// PORTALS_UNSEEN_TICK ticks, agent spreads them so they don't all tick together
+bool portals_should_tick(const PortalGraph *pg, const float2 p, uint32_t agent, uint64_t tick);
+
+// homeinvasion --bench portals: traversal cost and what it culls on a 50 room house
+void portals_benchmark(void);
@@ -0,0 +1,448 @@
+#include "post.h"
+#include "bench.h"
+
+enum
+{
+	BINDING_SOURCE,
+	BINDING_DESTINATION,
+	BINDING_BLOOM,
+	BINDING_LUT,
+	BINDING_LUT_OUTPUT,
+	BINDINGS,
+};
+
+static constexpr VkFormat POST_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+static const PostSettings default_settings = {
+	._effects = POST_ALL,
+	._vignette = 0.55f,
+	._grain = 0.035f,
+	._aberration = 2.0f,
+	._grade = 1.0f,
+	._bloom_threshold = 0.7f,
+	._bloom_intensity = 0.6f,
+};
+
+static VkExtent2D level_extent(VkExtent2D extent, uint32_t level)
+{
+	return (VkExtent2D){SDL_max(extent.width >> (level + 1), 1u), SDL_max(extent.height >> (level + 1), 1u)};
+};
+
+static Result create_lut(PostStack *ps, VulkanState *vk)
+{
+	VkImageCreateInfo image_create_info = {};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_3D;
+	image_create_info.format = POST_FORMAT;
+	image_create_info.extent = (VkExtent3D){POST_LUT_SIZE, POST_LUT_SIZE, POST_LUT_SIZE};
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(vk->_device, &image_create_info, nullptr, &ps->_lut) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create color grade LUT\n");
+		return FAILURE;
+	};
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(vk->_device, ps->_lut, &requirements);
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = find_memory_type(vk->_physical_device, requirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (allocate_info.memoryTypeIndex == UINT32_MAX
+		|| vkAllocateMemory(vk->_device, &allocate_info, nullptr, &ps->_lut_memory) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate color grade LUT\n");
+		return FAILURE;
+	};
+	vkBindImageMemory(vk->_device, ps->_lut, ps->_lut_memory, 0);
+
+	VkImageViewCreateInfo view_create_info = {};
+	view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image = ps->_lut;
+	view_create_info.viewType = VK_IMAGE_VIEW_TYPE_3D;
+	view_create_info.format = POST_FORMAT;
+	view_create_info.subresourceRange = (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	if (vkCreateImageView(vk->_device, &view_create_info, nullptr, &ps->_lut_view) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create color grade LUT view\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+static void destroy_images(PostStack *ps, VulkanState *vk)
+{
+	if (ps->_output != VK_NULL_HANDLE) destroy_image(vk, ps->_output, ps->_output_memory, ps->_output_view);
+	ps->_output = VK_NULL_HANDLE;
+	ps->_output_view = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < POST_BLOOM_LEVELS; i++)
+	{
+		if (ps->_bloom[i] != VK_NULL_HANDLE) destroy_image(vk, ps->_bloom[i], ps->_bloom_memory[i], ps->_bloom_views[i]);
+		ps->_bloom[i] = VK_NULL_HANDLE;
+	};
+};
+
+Result post_init(PostStack *ps, VulkanState *vk)
+{
+	*ps = (PostStack){};
+	ps->_settings = default_settings;
+
+	VkSamplerCreateInfo sampler_create_info = {};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(vk->_device, &sampler_create_info, nullptr, &ps->_sampler) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create post sampler\n");
+		return FAILURE;
+	};
+
+	static const VkDescriptorType types[BINDINGS] = {
+		[BINDING_SOURCE] = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		[BINDING_DESTINATION] = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		[BINDING_BLOOM] = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		[BINDING_LUT] = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		[BINDING_LUT_OUTPUT] = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+	};
+	VkDescriptorSetLayoutBinding layout_bindings[BINDINGS] = {};
+	for (uint32_t i = 0; i < BINDINGS; i++)
+	{
+		layout_bindings[i].binding = i;
+		layout_bindings[i].descriptorType = types[i];
+		layout_bindings[i].descriptorCount = 1;
+		layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	};
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = BINDINGS;
+	layout_create_info.pBindings = layout_bindings;
+	if (vkCreateDescriptorSetLayout(vk->_device, &layout_create_info, nullptr, &ps->_set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create post set layout\n");
+		return FAILURE;
+	};
+
+	VkDescriptorPoolSize pool_sizes[2] = {
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3 * POST_PASSES},
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * POST_PASSES},
+	};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = POST_PASSES;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &ps->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create post descriptor pool\n");
+		return FAILURE;
+	};
+
+	VkDescriptorSetLayout set_layouts[POST_PASSES];
+	for (uint32_t i = 0; i < POST_PASSES; i++) set_layouts[i] = ps->_set_layout;
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = ps->_pool;
+	allocate_info.descriptorSetCount = POST_PASSES;
+	allocate_info.pSetLayouts = set_layouts;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, ps->_sets) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate post descriptor sets\n");
+		return FAILURE;
+	};
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	push_constant_range.size = sizeof(PostParams);
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &ps->_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	if (vkCreatePipelineLayout(vk->_device, &pipeline_layout_create_info, nullptr, &ps->_pipeline_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create post pipeline layout\n");
+		return FAILURE;
+	};
+
+	return create_lut(ps, vk);
+};
+
+Result post_build(PostStack *ps, VulkanState *vk, const char *shader_name)
+{
+	PostPipelines *p = &ps->_pipelines;
+	p->_module = load_shader_module(vk->_device, shader_name);
+	if (p->_module == VK_NULL_HANDLE) return FAILURE;
+	VkPipelineLayout layout = ps->_pipeline_layout;
+	if (create_compute_pipeline(vk->_device, vk->_pipeline_cache, p->_module, "bloom_down_main", layout, &p->_bloom_down) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, p->_module, "bloom_up_main", layout, &p->_bloom_up) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, p->_module, "fused_main", layout, &p->_fused) != SUCCESS)
+		return FAILURE;
+	return create_compute_pipeline(vk->_device, vk->_pipeline_cache, p->_module, "lut_main", layout, &p->_lut);
+};
+
+Result post_resize(PostStack *ps, VulkanState *vk, VkExtent2D extent, VkImageView scene_view)
+{
+	destroy_images(ps, vk);
+	ps->_target_extent = extent;
+	if (extent.width == 0 || extent.height == 0) return SUCCESS;
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	if (create_image(vk, extent, POST_FORMAT, usage, &ps->_output, &ps->_output_memory, &ps->_output_view) != SUCCESS)
+		return FAILURE;
+	for (uint32_t i = 0; i < POST_BLOOM_LEVELS; i++)
+	{
+		if (create_image(vk, level_extent(extent, i), POST_FORMAT, usage,
+					&ps->_bloom[i], &ps->_bloom_memory[i], &ps->_bloom_views[i]) != SUCCESS)
+			return FAILURE;
+	};
+
+	// Source and destination of every pass. Post images stay in GENERAL, the scene is read only
+	VkImageView sources[POST_PASSES], destinations[POST_PASSES];
+	for (uint32_t i = 0; i < POST_BLOOM_LEVELS; i++)
+	{
+		sources[POST_PASS_DOWN + i] = i == 0 ? scene_view : ps->_bloom_views[i - 1];
+		destinations[POST_PASS_DOWN + i] = ps->_bloom_views[i];
+	};
+	for (uint32_t i = 0; i + 1 < POST_BLOOM_LEVELS; i++)
+	{
+		sources[POST_PASS_UP + i] = ps->_bloom_views[POST_BLOOM_LEVELS - 1 - i];
+		destinations[POST_PASS_UP + i] = ps->_bloom_views[POST_BLOOM_LEVELS - 2 - i];
+	};
+	sources[POST_PASS_FUSED] = scene_view;
+	destinations[POST_PASS_FUSED] = ps->_output_view;
+
+	VkDescriptorImageInfo image_infos[POST_PASSES][BINDINGS];
+	VkWriteDescriptorSet writes[POST_PASSES * BINDINGS] = {};
+	for (uint32_t pass = 0; pass < POST_PASSES; pass++)
+	{
+		VkImageLayout source_layout = sources[pass] == scene_view ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+		image_infos[pass][BINDING_SOURCE] = (VkDescriptorImageInfo){ps->_sampler, sources[pass], source_layout};
+		image_infos[pass][BINDING_DESTINATION] = (VkDescriptorImageInfo){VK_NULL_HANDLE, destinations[pass], VK_IMAGE_LAYOUT_GENERAL};
+		image_infos[pass][BINDING_BLOOM] = (VkDescriptorImageInfo){ps->_sampler, ps->_bloom_views[0], VK_IMAGE_LAYOUT_GENERAL};
+		image_infos[pass][BINDING_LUT] = (VkDescriptorImageInfo){ps->_sampler, ps->_lut_view, VK_IMAGE_LAYOUT_GENERAL};
+		image_infos[pass][BINDING_LUT_OUTPUT] = (VkDescriptorImageInfo){VK_NULL_HANDLE, ps->_lut_view, VK_IMAGE_LAYOUT_GENERAL};
+		for (uint32_t b = 0; b < BINDINGS; b++)
+		{
+			VkWriteDescriptorSet *write = &writes[pass * BINDINGS + b];
+			write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write->dstSet = ps->_sets[pass];
+			write->dstBinding = b;
+			write->descriptorCount = 1;
+			write->descriptorType = b == BINDING_DESTINATION || b == BINDING_LUT_OUTPUT
+				? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write->pImageInfo = &image_infos[pass][b];
+		};
+	};
+	vkUpdateDescriptorSets(vk->_device, POST_PASSES * BINDINGS, writes, 0, nullptr);
+	return SUCCESS;
+};
+
+void post_quit(PostStack *ps, VulkanState *vk)
+{
+	destroy_images(ps, vk);
+	PostPipelines *p = &ps->_pipelines;
+	vkDestroyPipeline(vk->_device, p->_bloom_down, nullptr);
+	vkDestroyPipeline(vk->_device, p->_bloom_up, nullptr);
+	vkDestroyPipeline(vk->_device, p->_fused, nullptr);
+	vkDestroyPipeline(vk->_device, p->_lut, nullptr);
+	vkDestroyShaderModule(vk->_device, p->_module, nullptr);
+	vkDestroyImageView(vk->_device, ps->_lut_view, nullptr);
+	vkDestroyImage(vk->_device, ps->_lut, nullptr);
+	vkFreeMemory(vk->_device, ps->_lut_memory, nullptr);
+	vkDestroyPipelineLayout(vk->_device, ps->_pipeline_layout, nullptr);
+	vkDestroyDescriptorPool(vk->_device, ps->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, ps->_set_layout, nullptr);
+	vkDestroySampler(vk->_device, ps->_sampler, nullptr);
+	*ps = (PostStack){};
+};
+
+// From the rendered part of a source image to the rendered part of the destination
+static void dispatch_pass(PostStack *ps, VkCommandBuffer cmdbuffer, PostPass pass, PostParams *params,
+		VkExtent2D src_size, VkExtent2D src_image, VkExtent2D dst_size)
+{
+	params->_src_scale[0] = (float)src_size.width / (float)dst_size.width / (float)src_image.width;
+	params->_src_scale[1] = (float)src_size.height / (float)dst_size.height / (float)src_image.height;
+	params->_src_max[0] = ((float)src_size.width - 0.5f) / (float)src_image.width;
+	params->_src_max[1] = ((float)src_size.height - 0.5f) / (float)src_image.height;
+	params->_src_texel[0] = 1.0f / (float)src_image.width;
+	params->_src_texel[1] = 1.0f / (float)src_image.height;
+	params->_dst_size[0] = dst_size.width;
+	params->_dst_size[1] = dst_size.height;
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipeline_layout, 0, 1, &ps->_sets[pass], 0, nullptr);
+	vkCmdPushConstants(cmdbuffer, ps->_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PostParams), params);
+	vkCmdDispatch(cmdbuffer, (dst_size.width + 7) / 8, (dst_size.height + 7) / 8, 1);
+};
+
+static void compute_barrier(VkCommandBuffer cmdbuffer)
+{
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+				| VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+};
+
+void post_record(PostStack *ps, VkCommandBuffer cmdbuffer, VkExtent2D extent, float time)
+{
+	if (ps->_output == VK_NULL_HANDLE) return;
+	const PostSettings *settings = &ps->_settings;
+	PostParams params = {};
+	params._effects = settings->_effects;
+	params._time = time;
+	params._bloom_intensity = settings->_bloom_intensity;
+	params._vignette = settings->_vignette;
+	params._grain = settings->_grain;
+	params._aberration = settings->_aberration;
+	params._grade = settings->_grade;
+
+	if (!ps->_lut_ready)
+	{
+		image_barrier(cmdbuffer, ps->_lut, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+				VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._lut);
+		vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipeline_layout, 0, 1,
+				&ps->_sets[POST_PASS_FUSED], 0, nullptr);
+		vkCmdDispatch(cmdbuffer, POST_LUT_SIZE / 4, POST_LUT_SIZE / 4, POST_LUT_SIZE / 4);
+		compute_barrier(cmdbuffer);
+		ps->_lut_ready = true;
+	};
+
+	// Last frame's upscale may still read the output, the bloom chain is rebuilt from scratch
+	image_barrier(cmdbuffer, ps->_output, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	if (settings->_effects & POST_BLOOM)
+	{
+		for (uint32_t i = 0; i < POST_BLOOM_LEVELS; i++)
+		{
+			image_barrier(cmdbuffer, ps->_bloom[i], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+					VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+					VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		};
+
+		// Only the first downsample thresholds
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._bloom_down);
+		for (uint32_t i = 0; i < POST_BLOOM_LEVELS; i++)
+		{
+			params._bloom_threshold = i == 0 ? settings->_bloom_threshold : 0.0f;
+			VkExtent2D src_size = i == 0 ? extent : level_extent(extent, i - 1);
+			VkExtent2D src_image = i == 0 ? ps->_target_extent : level_extent(ps->_target_extent, i - 1);
+			dispatch_pass(ps, cmdbuffer, POST_PASS_DOWN + i, &params, src_size, src_image, level_extent(extent, i));
+			compute_barrier(cmdbuffer);
+		};
+
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._bloom_up);
+		for (uint32_t i = 0; i + 1 < POST_BLOOM_LEVELS; i++)
+		{
+			uint32_t src = POST_BLOOM_LEVELS - 1 - i, dst = src - 1;
+			dispatch_pass(ps, cmdbuffer, POST_PASS_UP + i, &params, level_extent(extent, src),
+					level_extent(ps->_target_extent, src), level_extent(extent, dst));
+			compute_barrier(cmdbuffer);
+		};
+	};
+
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ps->_pipelines._fused);
+	dispatch_pass(ps, cmdbuffer, POST_PASS_FUSED, &params, extent, ps->_target_extent, extent);
+	image_barrier(cmdbuffer, ps->_output, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+};
+
+typedef struct
+{
+	const char *_name;
+	uint32_t _effects;
+} PostBenchConfig;
+
+void post_benchmark(void)
+{
+	constexpr uint32_t RUNS = 32;
+	constexpr VkExtent2D EXTENT = {2560, 1440};
+	static const PostBenchConfig configs[] = {
+		{"copy", 0},
+		{"vignette", POST_VIGNETTE},
+		{"grain", POST_GRAIN},
+		{"aberration", POST_ABERRATION},
+		{"grade", POST_GRADE},
+		{"bloom", POST_BLOOM},
+		{"stack", POST_ALL},
+	};
+
+	BenchDevice bd = {};
+	if (!create_bench_device(&bd))
+	{
+		SDL_Log("post: no Vulkan 1.3 device, skipped\n");
+		destroy_bench_device(&bd);
+		return;
+	};
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(bd._physical_device, &properties);
+
+	VulkanState vk = bench_vulkan_state(&bd);
+	PostStack ps;
+	VkImage scene = VK_NULL_HANDLE;
+	VkDeviceMemory scene_memory = VK_NULL_HANDLE;
+	VkImageView scene_view = VK_NULL_HANDLE;
+	BenchTimer timer = {};
+
+	if (post_init(&ps, &vk) != SUCCESS || post_build(&ps, &vk, "post.spv") != SUCCESS
+		|| create_image(&vk, EXTENT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			&scene, &scene_memory, &scene_view) != SUCCESS
+		|| post_resize(&ps, &vk, EXTENT, scene_view) != SUCCESS
+		|| !create_bench_timer(&timer, &bd))
+	{
+		SDL_Log("post: setup failed, skipped\n");
+		goto done;
+	};
+	SDL_Log("post on %s, %ux%u, %u runs per configuration\n", properties.deviceName, EXTENT.width, EXTENT.height, RUNS);
+
+	double copy_ms = 0.0, stack_ms = 0.0;
+	// Config -1 is the warm up: scene contents, the LUT, first use of every pipeline
+	for (int32_t c = -1; c < (int32_t)SDL_arraysize(configs); c++)
+	{
+		VkCommandBuffer cmdbuffer = bench_timer_begin(&timer);
+		if (c < 0)
+		{
+			// A dim room with a few lamps over the bloom threshold
+			image_barrier(cmdbuffer, scene, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+			VkClearColorValue dim = {{0.08f, 0.07f, 0.06f, 1.0f}};
+			VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+			vkCmdClearColorImage(cmdbuffer, scene, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &dim, 1, &range);
+			image_barrier(cmdbuffer, scene, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+					VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+		};
+		ps._settings._effects = c < 0 ? POST_ALL : configs[c]._effects;
+		bench_timer_mark(&timer, 0);
+		for (uint32_t run = 0; run < RUNS; run++)
+		{
+			post_record(&ps, cmdbuffer, EXTENT, (float)run / 60.0f);
+		};
+		bench_timer_mark(&timer, 1);
+		double ms = bench_timer_end(&timer) / RUNS;
+		if (c < 0) continue;
+		if (configs[c]._effects == 0) copy_ms = ms;
+		if (configs[c]._effects == POST_ALL) stack_ms = ms;
+		SDL_Log("%-12s %.3f ms (+%.3f ms over the copy)\n", configs[c]._name, ms, ms - copy_ms);
+	};
+	SDL_Log("stack %.3f ms, budget %.3f ms: %s\n", stack_ms, POST_BUDGET_MS, stack_ms <= POST_BUDGET_MS ? "ok" : "OVER");
+
+done:
+	destroy_bench_timer(&timer);
+	if (scene != VK_NULL_HANDLE) destroy_image(&vk, scene, scene_memory, scene_view);
+	post_quit(&ps, &vk);
+	destroy_bench_device(&bd);
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include "vk.h"
+
+// Post-processing in compute, at scene resolution (before the dynamic resolution upscale).
+// Bloom is its own chain: a thresholded downsample into POST_BLOOM_LEVELS half sized images, then
+// tent upsamples back up, one dispatch per level. Everything per pixel (aberration, bloom
+// composite, color grade, vignette, grain) is fused into a single dispatch over the frame that
+// reads the scene once and writes the output once. Effects are toggled at runtime with push
+// constant bits, the fused pass branches on them uniformly, no pipeline per combination.
+
+constexpr uint32_t POST_BLOOM_LEVELS = 5;
+// Color grade LUT edge, generated on the GPU the first frame
+constexpr uint32_t POST_LUT_SIZE = 16;
+// Whole stack at 2560x1440, checked by --bench post
+constexpr double POST_BUDGET_MS = 1.0;
+
+typedef enum
+{
+	POST_VIGNETTE = 1 << 0,
+	POST_GRAIN = 1 << 1,
+	POST_ABERRATION = 1 << 2,
+	POST_GRADE = 1 << 3,
+	POST_BLOOM = 1 << 4,
+	POST_ALL = (1 << 5) - 1,
+} PostEffect;
+
+typedef struct
+{
+	uint32_t _effects;
+	float _vignette;
+	// Grain amplitude, in output color units
+	float _grain;
+	// Red/blue split at the screen corners, in pixels
+	float _aberration;
+	// 0 ungraded, 1 fully graded
+	float _grade;
+	float _bloom_threshold, _bloom_intensity;
+} PostSettings;
+
+// Matches Params in shader/post.slang, pushed as push constants
+typedef struct
+{
+	// Destination pixel to source uv: (pixel + 0.5) * src_scale, clamped to src_max
+	float2 _src_scale;
+	float2 _src_max;
+	float2 _src_texel;
+	uint32_t _dst_size[2];
+	uint32_t _effects;
+	float _time;
+	float _bloom_threshold, _bloom_intensity;
+	float _vignette, _grain, _aberration, _grade;
+} PostParams;
+
+typedef enum
+{
+	POST_PASS_DOWN,
+	POST_PASS_UP = POST_PASS_DOWN + POST_BLOOM_LEVELS,
+	POST_PASS_FUSED = POST_PASS_UP + POST_BLOOM_LEVELS - 1,
+	POST_PASSES,
+} PostPass;
+
+typedef struct
+{
+	VkShaderModule _module;
+	VkPipeline _bloom_down, _bloom_up, _fused, _lut;
+} PostPipelines;
+
+typedef struct
+{
+	PostSettings _settings;
+
+	VkSampler _sampler;
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	// One per pass: its source, destination, and the bloom and LUT images the fused pass reads
+	VkDescriptorSet _sets[POST_PASSES];
+	VkPipelineLayout _pipeline_layout;
+	PostPipelines _pipelines;
+
+	// Sized for the full target, passes only cover the part the scene rendered to
+	VkExtent2D _target_extent;
+	VkImage _output, _bloom[POST_BLOOM_LEVELS];
+	VkDeviceMemory _output_memory, _bloom_memory[POST_BLOOM_LEVELS];
+	VkImageView _output_view, _bloom_views[POST_BLOOM_LEVELS];
+	VkImage _lut;
+	VkDeviceMemory _lut_memory;
+	VkImageView _lut_view;
+	bool _lut_ready;
+} PostStack;
+
+Result post_init(PostStack *ps, VulkanState *vk);
+// Compile the pipelines, may run on a worker thread once init is done
+Result post_build(PostStack *ps, VulkanState *vk, const char *shader_name);
+// (Re)create the images for a scene target of extent, sampled through scene_view. Nothing may use
+// the old ones anymore
+Result post_resize(PostStack *ps, VulkanState *vk, VkExtent2D extent, VkImageView scene_view);
+void post_quit(PostStack *ps, VulkanState *vk);
+
+// Outside of rendering. The scene is SHADER_READ_ONLY_OPTIMAL and covers extent of the target,
+// _output ends SHADER_READ_ONLY_OPTIMAL for the fragment stage. time drives the grain
+void post_record(PostStack *ps, VkCommandBuffer cmdbuffer, VkExtent2D extent, float time);
+
+// homeinvasion --bench post: GPU time of every effect alone and of the whole stack at 1440p
+void post_benchmark(void);
@@ -0,0 +1,26 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "octopus.h"
+
+typedef struct AppState AppState;
+
+// What the game needs from a rendering backend. Vulkan lives in app.c, GLES 3 in gles.c.
+// A frame is: begin_frame, gameplay pushes sprites, draw.
+typedef struct
+{
+	const char *_name;
+	SDL_WindowFlags _window_flags;
+	// Optional, starts window independent init on app->_jobs while the window is created
+	void (*_prepare)(AppState *app);
+	Result (*_init)(AppState *app);
+	void (*_begin_frame)(AppState *app);
+	bool (*_push_sprite)(AppState *app, uint32_t layer, const float2 position, const float2 half_size, const float4 color);
+	void (*_draw)(AppState *app, float dt);
+	void (*_quit)(AppState *app);
+} Renderer;
+
+extern const Renderer vulkan_renderer;
+extern const Renderer gles_renderer;
+
+// nullptr if no backend has this name
+const Renderer *renderer_find(const char *name);
@@ -0,0 +1,226 @@
+#include "resolution.h"
+
+// Keep the scene between these fractions of the budget, no change inside the band
+static constexpr float BUDGET_HIGH = 1.0f;
+static constexpr float BUDGET_LOW = 0.8f;
+// Largest scale change per adjustment, down reacts faster than up so a spike doesn't drop frames
+static constexpr float MAX_STEP_DOWN = 0.75f;
+static constexpr float MAX_STEP_UP = 1.05f;
+
+static void update_extent(ResolutionScaler *rs)
+{
+	rs->_extent.width = SDL_max((uint32_t)((float)rs->_target_extent.width * rs->_scale + 0.5f), 1u);
+	rs->_extent.height = SDL_max((uint32_t)((float)rs->_target_extent.height * rs->_scale + 0.5f), 1u);
+};
+
+Result resolution_init(ResolutionScaler *rs, VulkanState *vk, SDL_Window *window, float budget_ms, float scale)
+{
+	*rs = (ResolutionScaler){};
+	rs->_fixed = scale > 0.0f;
+	rs->_scale = rs->_fixed ? SDL_clamp(scale, RESOLUTION_MIN_SCALE, 1.0f) : 1.0f;
+	rs->_budget_ms = budget_ms;
+	if (rs->_budget_ms <= 0.0f)
+	{
+		// The GPU also has to fit the upscale and whatever the compositor does in the frame
+		const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+		float refresh_rate = mode != nullptr && mode->refresh_rate > 0.0f ? mode->refresh_rate : 60.0f;
+		rs->_budget_ms = 0.9f * 1000.0f / refresh_rate;
+	};
+
+	VkSamplerCreateInfo sampler_create_info = {};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(vk->_device, &sampler_create_info, nullptr, &rs->_sampler) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create upscale sampler\n");
+		return FAILURE;
+	};
+
+	VkDescriptorSetLayoutBinding layout_binding = {};
+	layout_binding.binding = 0;
+	layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layout_binding.descriptorCount = 1;
+	layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = 1;
+	layout_create_info.pBindings = &layout_binding;
+	if (vkCreateDescriptorSetLayout(vk->_device, &layout_create_info, nullptr, &rs->_set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create upscale set layout\n");
+		return FAILURE;
+	};
+
+	VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes = &pool_size;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &rs->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create upscale descriptor pool\n");
+		return FAILURE;
+	};
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = rs->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &rs->_set_layout;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, &rs->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate upscale descriptor set\n");
+		return FAILURE;
+	};
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	push_constant_range.size = sizeof(UpscaleParams);
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &rs->_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	if (vkCreatePipelineLayout(vk->_device, &pipeline_layout_create_info, nullptr, &rs->_pipeline_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create upscale pipeline layout\n");
+		return FAILURE;
+	};
+
+	if (resolution_resize(rs, vk) != SUCCESS) return FAILURE;
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Dynamic resolution: %s, GPU budget %.2f ms\n",
+			rs->_fixed ? "fixed scale" : "on", rs->_budget_ms);
+	return SUCCESS;
+};
+
+Result resolution_build(ResolutionScaler *rs, VulkanState *vk, const char *shader_name)
+{
+	rs->_module = load_shader_module(vk->_device, shader_name);
+	if (rs->_module == VK_NULL_HANDLE) return FAILURE;
+	PipelineDesc desc = {
+		._module = rs->_module,
+		._vert_entry = "vert_main",
+		._frag_entry = "frag_main",
+		._layout = rs->_pipeline_layout,
+		._color_format = vk->_swapchain_format,
+		._topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		._cull_mode = VK_CULL_MODE_NONE,
+		._blend = PIPELINE_BLEND_NONE,
+	};
+	return create_graphics_pipeline_desc(vk->_device, vk->_pipeline_cache, &desc, &rs->_pipeline);
+};
+
+Result resolution_resize(ResolutionScaler *rs, VulkanState *vk)
+{
+	if (rs->_image != VK_NULL_HANDLE) destroy_image(vk, rs->_image, rs->_memory, rs->_view);
+	rs->_image = VK_NULL_HANDLE;
+	rs->_target_extent = vk->_swapchain_extent;
+	rs->_format = vk->_swapchain_format;
+	update_extent(rs);
+	// Minimized window, nothing is drawn until the swapchain is back
+	if (rs->_target_extent.width == 0 || rs->_target_extent.height == 0) return SUCCESS;
+
+	// Same format as the swapchain, so every scene pipeline renders into either
+	if (create_image(vk, rs->_target_extent, rs->_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				&rs->_image, &rs->_memory, &rs->_view) != SUCCESS)
+		return FAILURE;
+	resolution_set_source(rs, vk, rs->_view);
+	return SUCCESS;
+};
+
+void resolution_set_source(ResolutionScaler *rs, VulkanState *vk, VkImageView view)
+{
+	if (view == VK_NULL_HANDLE) return;
+	VkDescriptorImageInfo image_info = {rs->_sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = rs->_set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &image_info;
+	vkUpdateDescriptorSets(vk->_device, 1, &write, 0, nullptr);
+};
+
+void resolution_quit(ResolutionScaler *rs, VulkanState *vk)
+{
+	if (rs->_image != VK_NULL_HANDLE) destroy_image(vk, rs->_image, rs->_memory, rs->_view);
+	vkDestroyPipeline(vk->_device, rs->_pipeline, nullptr);
+	vkDestroyShaderModule(vk->_device, rs->_module, nullptr);
+	vkDestroyPipelineLayout(vk->_device, rs->_pipeline_layout, nullptr);
+	vkDestroyDescriptorPool(vk->_device, rs->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, rs->_set_layout, nullptr);
+	vkDestroySampler(vk->_device, rs->_sampler, nullptr);
+	*rs = (ResolutionScaler){};
+};
+
+void resolution_update(ResolutionScaler *rs, uint64_t scene_ns)
+{
+	if (rs->_fixed || scene_ns == 0) return;
+	rs->_sum_ms += (double)scene_ns / (double)SDL_NS_PER_MS;
+	if (++rs->_samples < RESOLUTION_ADJUST_FRAMES) return;
+
+	float average_ms = (float)(rs->_sum_ms / rs->_samples);
+	rs->_sum_ms = 0.0;
+	rs->_samples = 0;
+	if (average_ms <= rs->_budget_ms * BUDGET_HIGH && average_ms >= rs->_budget_ms * BUDGET_LOW) return;
+
+	// Scene cost goes with the pixel count, the square of the scale. Aim for the middle of the band
+	float target_ms = rs->_budget_ms * (BUDGET_HIGH + BUDGET_LOW) * 0.5f;
+	float step = SDL_clamp(SDL_sqrtf(target_ms / SDL_max(average_ms, 0.001f)), MAX_STEP_DOWN, MAX_STEP_UP);
+	float scale = SDL_clamp(rs->_scale * step, RESOLUTION_MIN_SCALE, 1.0f);
+	if (scale == rs->_scale) return;
+	rs->_scale = scale;
+	update_extent(rs);
+	SDL_LogDebug(SDL_LOG_CATEGORY_GPU, "Scene %.2f ms for a %.2f ms budget, rendering at %ux%u (%.0f%%)\n",
+			average_ms, rs->_budget_ms, rs->_extent.width, rs->_extent.height, rs->_scale * 100.0f);
+};
+
+void resolution_record_upscale(ResolutionScaler *rs, VkCommandBuffer cmdbuffer, VkImageView view, VkExtent2D extent)
+{
+	// Every pixel is written, nothing to load
+	VkRenderingAttachmentInfo rendering_attachment_info = {};
+	rendering_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	rendering_attachment_info.imageView = view;
+	rendering_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	rendering_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	rendering_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+	VkRenderingInfo rendering_info = {};
+	rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	rendering_info.renderArea = (VkRect2D){.offset = {0, 0}, .extent = extent};
+	rendering_info.layerCount = 1;
+	rendering_info.colorAttachmentCount = 1;
+	rendering_info.pColorAttachments = &rendering_attachment_info;
+	vkCmdBeginRendering(cmdbuffer, &rendering_info);
+
+	VkViewport viewport = {0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f};
+	VkRect2D scissor = {{0, 0}, extent};
+	vkCmdSetViewport(cmdbuffer, 0, 1, &viewport);
+	vkCmdSetScissor(cmdbuffer, 0, 1, &scissor);
+
+	float width = (float)rs->_target_extent.width, height = (float)rs->_target_extent.height;
+	UpscaleParams params = {};
+	params._uv_scale[0] = (float)rs->_extent.width / width;
+	params._uv_scale[1] = (float)rs->_extent.height / height;
+	// Bilinear taps past the rendered area would pull in last frame's pixels
+	params._uv_max[0] = ((float)rs->_extent.width - 0.5f) / width;
+	params._uv_max[1] = ((float)rs->_extent.height - 0.5f) / height;
+	params._texel[0] = 1.0f / width;
+	params._texel[1] = 1.0f / height;
+	// Only sharpen what was actually stretched, more the further below native
+	params._sharpness = SDL_min((1.0f - rs->_scale) * 2.0f, 1.0f);
+
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, rs->_pipeline);
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, rs->_pipeline_layout, 0, 1, &rs->_set, 0, nullptr);
+	vkCmdPushConstants(cmdbuffer, rs->_pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscaleParams), &params);
+	vkCmdDraw(cmdbuffer, 3, 1, 0, 0);
+	vkCmdEndRendering(cmdbuffer);
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "vk.h"
+
+// Dynamic resolution. The scene renders into the top left _extent of an offscreen target the
+// size of the swapchain, an upscale pass (bilinear + sharpen) stretches it over the swapchain
+// image. Every RESOLUTION_ADJUST_FRAMES frames the controller compares the measured GPU scene
+// time with the budget and moves the scale, so weak GPUs and software rasterizers hold their
+// framerate by dropping pixels. Resizing never reallocates, only the viewport changes.
+
+constexpr uint32_t RESOLUTION_ADJUST_FRAMES = 8;
+constexpr float RESOLUTION_MIN_SCALE = 0.5f;
+
+// Matches Params in shader/upscale.slang, pushed as push constants
+typedef struct
+{
+	// Output uv to source uv, and the last source uv that was rendered to
+	float2 _uv_scale;
+	float2 _uv_max;
+	float2 _texel;
+	float _sharpness;
+	float _pad;
+} UpscaleParams;
+
+typedef struct
+{
+	VkImage _image;
+	VkDeviceMemory _memory;
+	VkImageView _view;
+	VkExtent2D _target_extent;
+	VkFormat _format;
+
+	VkSampler _sampler;
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	VkPipelineLayout _pipeline_layout;
+	VkShaderModule _module;
+	VkPipeline _pipeline;
+
+	// Scene resolution this frame, _scale of the target on each axis
+	VkExtent2D _extent;
+	float _scale;
+	// GPU scene time to hold, in ms. _fixed: --resolution-scale, the controller is off
+	float _budget_ms;
+	bool _fixed;
+	double _sum_ms;
+	uint32_t _samples;
+} ResolutionScaler;
+
+// budget_ms <= 0: from the refresh rate of the window's display. scale > 0 fixes the scale
+Result resolution_init(ResolutionScaler *rs, VulkanState *vk, SDL_Window *window, float budget_ms, float scale);
+// Compile the upscale pipeline, may run on a worker thread once init is done
+Result resolution_build(ResolutionScaler *rs, VulkanState *vk, const char *shader_name);
+// (Re)create the target at the swapchain size, nothing may use the old one anymore
+Result resolution_resize(ResolutionScaler *rs, VulkanState *vk);
+// Upscale from view instead of the target, an image of the target's size (post-processing output).
+// resolution_resize points it back at the target
+void resolution_set_source(ResolutionScaler *rs, VulkanState *vk, VkImageView view);
+void resolution_quit(ResolutionScaler *rs, VulkanState *vk);
+
+// GPU scene time of a finished frame, 0 when it wasn't measured
+void resolution_update(ResolutionScaler *rs, uint64_t scene_ns);
+// Outside of rendering: sample the target (already SHADER_READ_ONLY_OPTIMAL) into view, which
+// must be COLOR_ATTACHMENT_OPTIMAL and extent sized
+void resolution_record_upscale(ResolutionScaler *rs, VkCommandBuffer cmdbuffer, VkImageView view, VkExtent2D extent);
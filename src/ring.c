@@ -0,0 +1,148 @@
+#include "ring.h"
+#include <SDL3/SDL.h>
+
+static const VkDescriptorType types[FRAME_RING_BINDINGS] = {
+	[FRAME_RING_FRAME] = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+	[FRAME_RING_LISTS] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+	[FRAME_RING_DRAW] = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+};
+static const uint32_t ranges[FRAME_RING_BINDINGS] = {
+	[FRAME_RING_FRAME] = FRAME_RING_UNIFORM_RANGE,
+	[FRAME_RING_LISTS] = FRAME_RING_STORAGE_RANGE,
+	[FRAME_RING_DRAW] = FRAME_RING_UNIFORM_RANGE,
+};
+
+Result frame_ring_create_set_layout(VkDevice device, VkDescriptorSetLayout *set_layout)
+{
+	VkDescriptorSetLayoutBinding layout_bindings[FRAME_RING_BINDINGS] = {};
+	for (uint32_t i = 0; i < FRAME_RING_BINDINGS; i++)
+	{
+		layout_bindings[i].binding = i;
+		layout_bindings[i].descriptorType = types[i];
+		layout_bindings[i].descriptorCount = 1;
+		layout_bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	};
+
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = FRAME_RING_BINDINGS;
+	layout_create_info.pBindings = layout_bindings;
+	if (vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create frame ring set layout\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+Result frame_ring_init(FrameRing *ring, VulkanState *vk)
+{
+	*ring = (FrameRing){};
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(vk->_physical_device, &properties);
+	ring->_alignment = SDL_max(properties.limits.minUniformBufferOffsetAlignment,
+			properties.limits.minStorageBufferOffsetAlignment);
+
+	// The tail keeps the fixed descriptor ranges inside the buffer for allocations at the end of the last region
+	VkDeviceSize size = MAX_FRAMES_IN_FLIGHT * FRAME_RING_SIZE + FRAME_RING_STORAGE_RANGE;
+	if (create_buffer(vk, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&ring->_buffer, &ring->_memory) != SUCCESS)
+		return FAILURE;
+	if (vkMapMemory(vk->_device, ring->_memory, 0, VK_WHOLE_SIZE, 0, (void **)&ring->_mapped) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map frame ring\n");
+		return FAILURE;
+	};
+
+	if (frame_ring_create_set_layout(vk->_device, &ring->_set_layout) != SUCCESS) return FAILURE;
+
+	VkDescriptorPoolSize pool_sizes[2] = {
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1},
+	};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &ring->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create frame ring descriptor pool\n");
+		return FAILURE;
+	};
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = ring->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &ring->_set_layout;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, &ring->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate frame ring descriptor set\n");
+		return FAILURE;
+	};
+
+	// Written once, every binding starts at 0 and moves with its dynamic offset
+	VkDescriptorBufferInfo buffer_infos[FRAME_RING_BINDINGS];
+	VkWriteDescriptorSet writes[FRAME_RING_BINDINGS] = {};
+	for (uint32_t i = 0; i < FRAME_RING_BINDINGS; i++)
+	{
+		buffer_infos[i] = (VkDescriptorBufferInfo){ring->_buffer, 0, ranges[i]};
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = ring->_set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = types[i];
+		writes[i].pBufferInfo = &buffer_infos[i];
+	};
+	vkUpdateDescriptorSets(vk->_device, FRAME_RING_BINDINGS, writes, 0, nullptr);
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Created frame ring, %u KiB per frame, alignment %u\n",
+			(uint32_t)(FRAME_RING_SIZE >> 10), (uint32_t)ring->_alignment);
+	return SUCCESS;
+};
+
+void frame_ring_quit(FrameRing *ring, VulkanState *vk)
+{
+	if (ring->_buffer == VK_NULL_HANDLE) return;
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Frame ring peak: %u of %u KiB\n",
+			(uint32_t)(ring->_peak >> 10), (uint32_t)(FRAME_RING_SIZE >> 10));
+	vkDestroyDescriptorPool(vk->_device, ring->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, ring->_set_layout, nullptr);
+	vkUnmapMemory(vk->_device, ring->_memory);
+	destroy_buffer(vk, ring->_buffer, ring->_memory);
+	*ring = (FrameRing){};
+};
+
+void frame_ring_begin(FrameRing *ring, uint32_t frame)
+{
+	ring->_peak = SDL_max(ring->_peak, ring->_head);
+	ring->_frame = frame;
+	ring->_head = 0;
+};
+
+uint32_t frame_ring_alloc(FrameRing *ring, VkDeviceSize size, void **data)
+{
+	VkDeviceSize offset = (ring->_head + ring->_alignment - 1) & ~(ring->_alignment - 1);
+	if (offset + size > FRAME_RING_SIZE)
+	{
+		if (!ring->_overflowed) SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Frame ring full, raise FRAME_RING_SIZE\n");
+		ring->_overflowed = true;
+		*data = nullptr;
+		return UINT32_MAX;
+	};
+	ring->_head = offset + size;
+	offset += ring->_frame * FRAME_RING_SIZE;
+	*data = ring->_mapped + offset;
+	return (uint32_t)offset;
+};
+
+uint32_t frame_ring_push(FrameRing *ring, const void *data, VkDeviceSize size)
+{
+	void *out;
+	uint32_t offset = frame_ring_alloc(ring, size, &out);
+	if (out != nullptr) SDL_memcpy(out, data, size);
+	return offset;
+};
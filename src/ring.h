@@ -0,0 +1,88 @@
+#pragma once
+#include "vk.h"
+
+// Per frame transient data: camera, light lists, per draw parameters. One persistently mapped
+// buffer with a region per frame in flight, rewritten once the frame's fence has signaled.
+// A single descriptor set of dynamic buffers points into it, uploads are a memcpy and drawing
+// only changes the dynamic offsets, never the descriptors.
+//
+// Set layout, shared by every pipeline that reads the ring (see shader/test1.slang):
+//   binding 0: uniform buffer, per frame data
+//   binding 1: storage buffer, lists (lights, ...)
+//   binding 2: uniform buffer, per draw data
+
+// Bytes per frame in flight
+constexpr VkDeviceSize FRAME_RING_SIZE = 1 << 20;
+// Fixed descriptor ranges, an allocation read through a binding must fit in it
+constexpr uint32_t FRAME_RING_UNIFORM_RANGE = 1024;
+constexpr uint32_t FRAME_RING_STORAGE_RANGE = 64 * 1024;
+
+typedef enum
+{
+	FRAME_RING_FRAME,
+	FRAME_RING_LISTS,
+	FRAME_RING_DRAW,
+	FRAME_RING_BINDINGS,
+} FrameRingBinding;
+
+// Ring contents read by the scene shaders, std140/std430 compatible
+constexpr uint32_t FRAME_MAX_LIGHTS = FRAME_RING_STORAGE_RANGE / 32;
+
+// Matches Frame in shader/test1.slang
+typedef struct
+{
+	// World to clip transform: clip = world * view.xy + view.zw
+	float4 _view;
+	float _time;
+	uint32_t _lights_count;
+	uint32_t _pad[2];
+	// World to lightmap uv, see lightmap.h
+	float4 _lightmap;
+} FrameData;
+
+// Matches Light in shader/test1.slang
+typedef struct
+{
+	float2 _position;
+	float _radius;
+	float _intensity;
+	float4 _color;
+} FrameLight;
+
+// Matches Draw in shader/test1.slang
+typedef struct
+{
+	// local * transform.zw + transform.xy
+	float4 _transform;
+	float4 _tint;
+} DrawData;
+
+typedef struct
+{
+	VkBuffer _buffer;
+	VkDeviceMemory _memory;
+	uint8_t *_mapped;
+	// Satisfies both uniform and storage offset alignment
+	VkDeviceSize _alignment;
+
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+
+	// Next free byte, relative to the region of _frame
+	uint32_t _frame;
+	VkDeviceSize _head, _peak;
+	bool _overflowed;
+} FrameRing;
+
+Result frame_ring_init(FrameRing *ring, VulkanState *vk);
+// The ring's set layout on its own, for pipelines built without a ring (benchmarks)
+Result frame_ring_create_set_layout(VkDevice device, VkDescriptorSetLayout *set_layout);
+void frame_ring_quit(FrameRing *ring, VulkanState *vk);
+// Start filling the region of frame, the GPU must be done with it
+void frame_ring_begin(FrameRing *ring, uint32_t frame);
+// size bytes of the current region, returns their dynamic offset and *data to write them through.
+// UINT32_MAX and nullptr once the region is full
+uint32_t frame_ring_alloc(FrameRing *ring, VkDeviceSize size, void **data);
+// Copy data into the ring, returns the dynamic offset or UINT32_MAX
+uint32_t frame_ring_push(FrameRing *ring, const void *data, VkDeviceSize size);
@@ -0,0 +1,574 @@
+#include "sdf.h"
+#include "bench.h"
+#include <stdlib.h>
+
+enum
+{
+	BINDING_SEEDS0,
+	BINDING_SEEDS1,
+	BINDING_DISTANCE,
+	BINDING_SEGMENTS,
+	BINDINGS,
+};
+
+// Value of texels no occluder is near
+static constexpr float FAR_DISTANCE = SDF_MAX_DISTANCE - SDF_WALL_HALF_THICKNESS;
+
+// Distance range in texels, and the first jump: seeds up to twice as far are still found
+static int32_t range_texels(void)
+{
+	return (int32_t)SDL_ceilf(SDF_MAX_DISTANCE * SDF_TEXELS_PER_UNIT);
+};
+
+static uint32_t first_step(void)
+{
+	uint32_t step = 1;
+	while ((int32_t)step < range_texels()) step <<= 1;
+	return step;
+};
+
+static SdfRect grow_rect(const Sdf *sdf, SdfRect rect, int32_t grow)
+{
+	rect._min[0] = SDL_max(rect._min[0] - grow, 0);
+	rect._min[1] = SDL_max(rect._min[1] - grow, 0);
+	rect._max[0] = SDL_min(rect._max[0] + grow, (int32_t)sdf->_width);
+	rect._max[1] = SDL_min(rect._max[1] + grow, (int32_t)sdf->_height);
+	return rect;
+};
+
+static SdfRect world_rect(const Sdf *sdf, const float2 min, const float2 max)
+{
+	SdfRect rect = {
+		{(int32_t)SDL_floorf((min[0] - sdf->_origin[0]) * SDF_TEXELS_PER_UNIT),
+			(int32_t)SDL_floorf((min[1] - sdf->_origin[1]) * SDF_TEXELS_PER_UNIT)},
+		{(int32_t)SDL_ceilf((max[0] - sdf->_origin[0]) * SDF_TEXELS_PER_UNIT),
+			(int32_t)SDL_ceilf((max[1] - sdf->_origin[1]) * SDF_TEXELS_PER_UNIT)},
+	};
+	return grow_rect(sdf, rect, 0);
+};
+
+// rect is the changed box, every texel within the distance range of it may change
+static void add_dirty(Sdf *sdf, SdfRect rect)
+{
+	rect = grow_rect(sdf, rect, range_texels());
+	if (rect._min[0] >= rect._max[0] || rect._min[1] >= rect._max[1]) return;
+	if (sdf->_dirty_count < SDF_MAX_REGIONS)
+	{
+		sdf->_dirty[sdf->_dirty_count++] = rect;
+		return;
+	};
+	SdfRect *last = &sdf->_dirty[SDF_MAX_REGIONS - 1];
+	for (uint32_t axis = 0; axis < 2; axis++)
+	{
+		last->_min[axis] = SDL_min(last->_min[axis], rect._min[axis]);
+		last->_max[axis] = SDL_max(last->_max[axis], rect._max[axis]);
+	};
+};
+
+static void pick_up_doors(Sdf *sdf)
+{
+	const Level *level = sdf->_level;
+	if (level->_doors_version == sdf->_doors_version) return;
+	for (uint32_t d = 0; d < level->_doors_count; d++)
+	{
+		const Door *door = &level->_doors[d];
+		if (door->_open == sdf->_doors_open[d]) continue;
+		float2 min = {SDL_min(door->_a[0], door->_b[0]), SDL_min(door->_a[1], door->_b[1])};
+		float2 max = {SDL_max(door->_a[0], door->_b[0]), SDL_max(door->_a[1], door->_b[1])};
+		add_dirty(sdf, world_rect(sdf, min, max));
+		sdf->_doors_open[d] = door->_open;
+	};
+	sdf->_doors_version = level->_doors_version;
+};
+
+static bool segment_near(const float2 a, const float2 b, const float2 min, const float2 max)
+{
+	return SDL_min(a[0], b[0]) <= max[0] && SDL_max(a[0], b[0]) >= min[0]
+		&& SDL_min(a[1], b[1]) <= max[1] && SDL_max(a[1], b[1]) >= min[1];
+};
+
+// Walls and closed doors that can seed a texel of region
+static uint32_t gather_segments(const Sdf *sdf, SdfRect region, SdfSegment *out, uint32_t capacity)
+{
+	const Level *level = sdf->_level;
+	float margin = 1.0f / SDF_TEXELS_PER_UNIT;
+	float2 min = {sdf->_origin[0] + (float)region._min[0] / SDF_TEXELS_PER_UNIT - margin,
+		sdf->_origin[1] + (float)region._min[1] / SDF_TEXELS_PER_UNIT - margin};
+	float2 max = {sdf->_origin[0] + (float)region._max[0] / SDF_TEXELS_PER_UNIT + margin,
+		sdf->_origin[1] + (float)region._max[1] / SDF_TEXELS_PER_UNIT + margin};
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < level->_walls_count && count < capacity; i++)
+	{
+		const WallSegment *wall = &level->_walls[i];
+		if (!segment_near(wall->_a, wall->_b, min, max)) continue;
+		out[count++] = (SdfSegment){{wall->_a[0], wall->_a[1]}, {wall->_b[0], wall->_b[1]}};
+	};
+	for (uint32_t i = 0; i < level->_doors_count && count < capacity; i++)
+	{
+		const Door *door = &level->_doors[i];
+		if (door->_open || !segment_near(door->_a, door->_b, min, max)) continue;
+		out[count++] = (SdfSegment){{door->_a[0], door->_a[1]}, {door->_b[0], door->_b[1]}};
+	};
+	return count;
+};
+
+Result sdf_init(Sdf *sdf, VulkanState *vk, const Level *level)
+{
+	*sdf = (Sdf){};
+	sdf->_level = level;
+	sdf->_doors_version = level->_doors_version;
+	sdf->_origin[0] = level->_min[0];
+	sdf->_origin[1] = level->_min[1];
+	sdf->_width = (uint32_t)SDL_ceilf((level->_max[0] - level->_min[0]) * SDF_TEXELS_PER_UNIT);
+	sdf->_height = (uint32_t)SDL_ceilf((level->_max[1] - level->_min[1]) * SDF_TEXELS_PER_UNIT);
+	if (sdf->_width > 0xffff || sdf->_height > 0xffff)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Level too large for a distance field, %ux%u texels\n", sdf->_width, sdf->_height);
+		return FAILURE;
+	};
+
+	size_t texels = (size_t)sdf->_width * sdf->_height;
+	sdf->_doors_open = malloc(SDL_max(level->_doors_count, 1u) * sizeof(bool));
+	sdf->_cpu = malloc(texels * sizeof(float));
+	if (!sdf->_doors_open || !sdf->_cpu)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate distance field\n");
+		return FAILURE;
+	};
+	for (uint32_t d = 0; d < level->_doors_count; d++) sdf->_doors_open[d] = level->_doors[d]._open;
+	for (size_t i = 0; i < texels; i++) sdf->_cpu[i] = FAR_DISTANCE;
+
+	VkExtent2D extent = {sdf->_width, sdf->_height};
+	VkMemoryPropertyFlags host_visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		if (create_image(vk, extent, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_STORAGE_BIT,
+					&sdf->_seeds[i], &sdf->_seeds_memory[i], &sdf->_seeds_views[i]) != SUCCESS)
+			return FAILURE;
+	};
+	if (create_image(vk, extent, VK_FORMAT_R32_SFLOAT,
+				VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				&sdf->_image, &sdf->_image_memory, &sdf->_view) != SUCCESS
+		|| create_buffer(vk, MAX_FRAMES_IN_FLIGHT * SDF_MAX_SEGMENTS * sizeof(SdfSegment), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				host_visible, &sdf->_segments, &sdf->_segments_memory) != SUCCESS)
+		return FAILURE;
+	if (vkMapMemory(vk->_device, sdf->_segments_memory, 0, VK_WHOLE_SIZE, 0, (void **)&sdf->_mapped_segments) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map distance field segments\n");
+		return FAILURE;
+	};
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (create_buffer(vk, texels * sizeof(float), VK_BUFFER_USAGE_TRANSFER_DST_BIT, host_visible,
+					&sdf->_readback[i], &sdf->_readback_memory[i]) != SUCCESS)
+			return FAILURE;
+		if (vkMapMemory(vk->_device, sdf->_readback_memory[i], 0, VK_WHOLE_SIZE, 0, (void **)&sdf->_mapped_readback[i]) != VK_SUCCESS)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map distance field readback\n");
+			return FAILURE;
+		};
+	};
+
+	// 32 bit float filtering is optional
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(vk->_physical_device, VK_FORMAT_R32_SFLOAT, &format_properties);
+	VkFilter filter = (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+		? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+	VkSamplerCreateInfo sampler_create_info = {};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = filter;
+	sampler_create_info.minFilter = filter;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(vk->_device, &sampler_create_info, nullptr, &sdf->_sampler) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create distance field sampler\n");
+		return FAILURE;
+	};
+
+	static const VkDescriptorType types[BINDINGS] = {
+		[BINDING_SEEDS0] = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		[BINDING_SEEDS1] = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		[BINDING_DISTANCE] = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		[BINDING_SEGMENTS] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	};
+	VkDescriptorSetLayoutBinding layout_bindings[BINDINGS] = {};
+	for (uint32_t i = 0; i < BINDINGS; i++)
+	{
+		layout_bindings[i].binding = i;
+		layout_bindings[i].descriptorType = types[i];
+		layout_bindings[i].descriptorCount = 1;
+		layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	};
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = BINDINGS;
+	layout_create_info.pBindings = layout_bindings;
+	if (vkCreateDescriptorSetLayout(vk->_device, &layout_create_info, nullptr, &sdf->_set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create distance field set layout\n");
+		return FAILURE;
+	};
+
+	VkDescriptorPoolSize pool_sizes[2] = {
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+	};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 2;
+	pool_create_info.pPoolSizes = pool_sizes;
+	if (vkCreateDescriptorPool(vk->_device, &pool_create_info, nullptr, &sdf->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create distance field descriptor pool\n");
+		return FAILURE;
+	};
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = sdf->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &sdf->_set_layout;
+	if (vkAllocateDescriptorSets(vk->_device, &allocate_info, &sdf->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate distance field descriptor set\n");
+		return FAILURE;
+	};
+
+	VkDescriptorImageInfo image_infos[3] = {
+		{VK_NULL_HANDLE, sdf->_seeds_views[0], VK_IMAGE_LAYOUT_GENERAL},
+		{VK_NULL_HANDLE, sdf->_seeds_views[1], VK_IMAGE_LAYOUT_GENERAL},
+		{VK_NULL_HANDLE, sdf->_view, VK_IMAGE_LAYOUT_GENERAL},
+	};
+	VkDescriptorBufferInfo buffer_info = {sdf->_segments, 0, VK_WHOLE_SIZE};
+	VkWriteDescriptorSet writes[BINDINGS] = {};
+	for (uint32_t i = 0; i < BINDINGS; i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = sdf->_set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = types[i];
+		if (i == BINDING_SEGMENTS) writes[i].pBufferInfo = &buffer_info;
+		else writes[i].pImageInfo = &image_infos[i];
+	};
+	vkUpdateDescriptorSets(vk->_device, BINDINGS, writes, 0, nullptr);
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	push_constant_range.size = sizeof(SdfParams);
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &sdf->_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	if (vkCreatePipelineLayout(vk->_device, &pipeline_layout_create_info, nullptr, &sdf->_pipeline_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create distance field pipeline layout\n");
+		return FAILURE;
+	};
+
+	// Built from scratch by the first record
+	sdf->_dirty[0] = (SdfRect){{0, 0}, {(int32_t)sdf->_width, (int32_t)sdf->_height}};
+	sdf->_dirty_count = 1;
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Distance field %ux%u, %.1f texels per unit\n", sdf->_width, sdf->_height,
+			(double)SDF_TEXELS_PER_UNIT);
+	return SUCCESS;
+};
+
+Result sdf_build(Sdf *sdf, VulkanState *vk, const char *shader_name)
+{
+	SdfPipelines *p = &sdf->_pipelines;
+	p->_module = load_shader_module(vk->_device, shader_name);
+	if (p->_module == VK_NULL_HANDLE) return FAILURE;
+	if (create_compute_pipeline(vk->_device, vk->_pipeline_cache, p->_module, "seed_main", sdf->_pipeline_layout, &p->_seed) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, p->_module, "flood_main", sdf->_pipeline_layout, &p->_flood) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, p->_module, "resolve_main", sdf->_pipeline_layout, &p->_resolve) != SUCCESS)
+		return FAILURE;
+	return SUCCESS;
+};
+
+void sdf_quit(Sdf *sdf, VulkanState *vk)
+{
+	vkDestroyPipeline(vk->_device, sdf->_pipelines._seed, nullptr);
+	vkDestroyPipeline(vk->_device, sdf->_pipelines._flood, nullptr);
+	vkDestroyPipeline(vk->_device, sdf->_pipelines._resolve, nullptr);
+	vkDestroyShaderModule(vk->_device, sdf->_pipelines._module, nullptr);
+	vkDestroyPipelineLayout(vk->_device, sdf->_pipeline_layout, nullptr);
+	vkDestroyDescriptorPool(vk->_device, sdf->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(vk->_device, sdf->_set_layout, nullptr);
+	vkDestroySampler(vk->_device, sdf->_sampler, nullptr);
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		if (sdf->_seeds[i] != VK_NULL_HANDLE) destroy_image(vk, sdf->_seeds[i], sdf->_seeds_memory[i], sdf->_seeds_views[i]);
+	};
+	if (sdf->_image != VK_NULL_HANDLE) destroy_image(vk, sdf->_image, sdf->_image_memory, sdf->_view);
+	if (sdf->_segments != VK_NULL_HANDLE)
+	{
+		vkUnmapMemory(vk->_device, sdf->_segments_memory);
+		destroy_buffer(vk, sdf->_segments, sdf->_segments_memory);
+	};
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (sdf->_readback[i] == VK_NULL_HANDLE) continue;
+		vkUnmapMemory(vk->_device, sdf->_readback_memory[i]);
+		destroy_buffer(vk, sdf->_readback[i], sdf->_readback_memory[i]);
+	};
+	free(sdf->_doors_open);
+	free(sdf->_cpu);
+	*sdf = (Sdf){};
+};
+
+void sdf_invalidate(Sdf *sdf, const float2 min, const float2 max)
+{
+	if (sdf->_level != nullptr) add_dirty(sdf, world_rect(sdf, min, max));
+};
+
+static void dispatch(VkCommandBuffer cmdbuffer, VkPipeline pipeline, const VkPipelineLayout layout, const SdfParams *params,
+		const int32_t min[2], const int32_t max[2])
+{
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdPushConstants(cmdbuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SdfParams), params);
+	vkCmdDispatch(cmdbuffer, (uint32_t)(max[0] - min[0] + 7) / 8, (uint32_t)(max[1] - min[1] + 7) / 8, 1);
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+};
+
+void sdf_record(Sdf *sdf, VkCommandBuffer cmdbuffer, uint32_t frame)
+{
+	sdf->_readback_count[frame] = 0;
+	if (sdf->_level == nullptr || sdf->_pipelines._resolve == VK_NULL_HANDLE) return;
+	pick_up_doors(sdf);
+	if (sdf->_dirty_count == 0) return;
+
+	if (!sdf->_initialized)
+	{
+		VkImage images[3] = {sdf->_seeds[0], sdf->_seeds[1], sdf->_image};
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			image_barrier(cmdbuffer, images[i], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+					VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+					VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		};
+		sdf->_initialized = true;
+	}
+	else
+	{
+		// Last frame's shaders and copy may still read the field
+		memory_barrier(cmdbuffer,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+				VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE);
+	};
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sdf->_pipeline_layout, 0, 1, &sdf->_set, 0, nullptr);
+
+	uint32_t segment_base = frame * SDF_MAX_SEGMENTS, segments_used = 0;
+	VkBufferImageCopy copies[SDF_MAX_REGIONS] = {};
+	for (uint32_t i = 0; i < sdf->_dirty_count; i++)
+	{
+		// Texels within range of the change get new distances, their nearest occluder is within range of them
+		SdfRect resolve = sdf->_dirty[i];
+		SdfRect region = grow_rect(sdf, resolve, range_texels());
+		uint32_t count = gather_segments(sdf, region, &sdf->_mapped_segments[segment_base + segments_used],
+				SDF_MAX_SEGMENTS - segments_used);
+		if (segments_used + count == SDF_MAX_SEGMENTS)
+			SDL_LogWarn(SDL_LOG_CATEGORY_GPU, "Distance field segments full, some occluders are missing\n");
+
+		SdfParams params = {
+			._region_min = {region._min[0], region._min[1]},
+			._region_max = {region._max[0], region._max[1]},
+			._resolve_min = {resolve._min[0], resolve._min[1]},
+			._resolve_max = {resolve._max[0], resolve._max[1]},
+			._origin = {sdf->_origin[0], sdf->_origin[1]},
+			._texels_per_unit = SDF_TEXELS_PER_UNIT,
+			._max_distance = SDF_MAX_DISTANCE,
+			._half_thickness = SDF_WALL_HALF_THICKNESS,
+			._segment_base = segment_base + segments_used,
+			._segment_count = count,
+		};
+		segments_used += count;
+		dispatch(cmdbuffer, sdf->_pipelines._seed, sdf->_pipeline_layout, &params, region._min, region._max);
+		// JFA+1: the halving steps, then one more step of 1 for the seeds the coarse steps skipped
+		for (uint32_t step = first_step(); ; step >>= 1)
+		{
+			params._step = SDL_max(step, 1u);
+			dispatch(cmdbuffer, sdf->_pipelines._flood, sdf->_pipeline_layout, &params, region._min, region._max);
+			params._parity ^= 1;
+			if (step == 0) break;
+		};
+		dispatch(cmdbuffer, sdf->_pipelines._resolve, sdf->_pipeline_layout, &params, resolve._min, resolve._max);
+
+		VkBufferImageCopy *copy = &copies[i];
+		copy->bufferOffset = ((VkDeviceSize)resolve._min[1] * sdf->_width + (VkDeviceSize)resolve._min[0]) * sizeof(float);
+		copy->bufferRowLength = sdf->_width;
+		copy->imageSubresource = (VkImageSubresourceLayers){VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+		copy->imageOffset = (VkOffset3D){resolve._min[0], resolve._min[1], 0};
+		copy->imageExtent = (VkExtent3D){(uint32_t)(resolve._max[0] - resolve._min[0]), (uint32_t)(resolve._max[1] - resolve._min[1]), 1};
+		sdf->_readback_rects[frame][i] = resolve;
+	};
+
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT);
+	vkCmdCopyImageToBuffer(cmdbuffer, sdf->_image, VK_IMAGE_LAYOUT_GENERAL, sdf->_readback[frame], sdf->_dirty_count, copies);
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+	sdf->_readback_count[frame] = sdf->_dirty_count;
+	sdf->_dirty_count = 0;
+};
+
+void sdf_readback(Sdf *sdf, uint32_t frame)
+{
+	for (uint32_t i = 0; i < sdf->_readback_count[frame]; i++)
+	{
+		const SdfRect *rect = &sdf->_readback_rects[frame][i];
+		size_t row = (size_t)(rect->_max[0] - rect->_min[0]) * sizeof(float);
+		for (int32_t y = rect->_min[1]; y < rect->_max[1]; y++)
+		{
+			size_t offset = (size_t)y * sdf->_width + (size_t)rect->_min[0];
+			SDL_memcpy(&sdf->_cpu[offset], &sdf->_mapped_readback[frame][offset], row);
+		};
+	};
+	sdf->_readback_count[frame] = 0;
+};
+
+float sdf_distance(const Sdf *sdf, const float2 p)
+{
+	if (sdf->_cpu == nullptr) return FAR_DISTANCE;
+	float fx = (p[0] - sdf->_origin[0]) * SDF_TEXELS_PER_UNIT - 0.5f;
+	float fy = (p[1] - sdf->_origin[1]) * SDF_TEXELS_PER_UNIT - 0.5f;
+	if (fx < -0.5f || fy < -0.5f || fx > (float)sdf->_width - 0.5f || fy > (float)sdf->_height - 0.5f) return FAR_DISTANCE;
+	fx = SDL_clamp(fx, 0.0f, (float)(sdf->_width - 1));
+	fy = SDL_clamp(fy, 0.0f, (float)(sdf->_height - 1));
+	uint32_t x0 = (uint32_t)fx, y0 = (uint32_t)fy;
+	uint32_t x1 = SDL_min(x0 + 1, sdf->_width - 1), y1 = SDL_min(y0 + 1, sdf->_height - 1);
+	float tx = fx - (float)x0, ty = fy - (float)y0;
+	const float *row0 = &sdf->_cpu[y0 * sdf->_width], *row1 = &sdf->_cpu[y1 * sdf->_width];
+	float top = row0[x0] + (row0[x1] - row0[x0]) * tx, bottom = row1[x0] + (row1[x1] - row1[x0]) * tx;
+	return top + (bottom - top) * ty;
+};
+
+void sdf_transform(const Sdf *sdf, float4 out)
+{
+	out[0] = SDF_TEXELS_PER_UNIT / (float)sdf->_width;
+	out[1] = SDF_TEXELS_PER_UNIT / (float)sdf->_height;
+	out[2] = -sdf->_origin[0] * out[0];
+	out[3] = -sdf->_origin[1] * out[1];
+};
+
+static float segment_distance(const float2 p, const float2 a, const float2 b)
+{
+	float abx = b[0] - a[0], aby = b[1] - a[1];
+	float t = ((p[0] - a[0]) * abx + (p[1] - a[1]) * aby) / SDL_max(abx * abx + aby * aby, 1e-8f);
+	t = SDL_clamp(t, 0.0f, 1.0f);
+	float dx = p[0] - (a[0] + abx * t), dy = p[1] - (a[1] + aby * t);
+	return SDL_sqrtf(dx * dx + dy * dy);
+};
+
+// Brute force over every occluder, what the field approximates
+static float exact_distance(const Level *level, const float2 p)
+{
+	float d = SDF_MAX_DISTANCE;
+	for (uint32_t i = 0; i < level->_walls_count; i++) d = SDL_min(d, segment_distance(p, level->_walls[i]._a, level->_walls[i]._b));
+	for (uint32_t i = 0; i < level->_doors_count; i++)
+	{
+		if (!level->_doors[i]._open) d = SDL_min(d, segment_distance(p, level->_doors[i]._a, level->_doors[i]._b));
+	};
+	return d - SDF_WALL_HALF_THICKNESS;
+};
+
+// One sdf_record on its own, returns its GPU time
+static double bench_record(BenchTimer *timer, Sdf *sdf)
+{
+	VkCommandBuffer cmdbuffer = bench_timer_begin(timer);
+	bench_timer_mark(timer, 0);
+	sdf_record(sdf, cmdbuffer, 0);
+	bench_timer_mark(timer, 1);
+	double ms = bench_timer_end(timer);
+	sdf_readback(sdf, 0);
+	return ms;
+};
+
+void sdf_benchmark(void)
+{
+	constexpr uint32_t TOGGLES = 32;
+
+	BenchDevice bd = {};
+	if (!create_bench_device(&bd))
+	{
+		SDL_Log("sdf: no Vulkan 1.3 device, skipped\n");
+		destroy_bench_device(&bd);
+		return;
+	};
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(bd._physical_device, &properties);
+
+	Level level;
+	if (level_generate_house(&level, 10, 5, 8.0f, 1234) != SUCCESS)
+	{
+		destroy_bench_device(&bd);
+		return;
+	};
+	VulkanState vk = bench_vulkan_state(&bd);
+	Sdf sdf = {};
+	BenchTimer timer = {};
+	if (sdf_init(&sdf, &vk, &level) != SUCCESS || sdf_build(&sdf, &vk, "sdf.spv") != SUCCESS
+		|| !create_bench_timer(&timer, &bd))
+	{
+		SDL_Log("sdf: setup failed, skipped\n");
+		goto done;
+	};
+
+	double full_ms = bench_record(&timer, &sdf);
+	// The first build also transitions the images, time a second one
+	sdf_invalidate(&sdf, level._min, level._max);
+	full_ms = bench_record(&timer, &sdf);
+
+	double error_sum = 0.0, error_max = 0.0;
+	for (uint32_t y = 0; y < sdf._height; y++)
+	{
+		for (uint32_t x = 0; x < sdf._width; x++)
+		{
+			float2 p = {sdf._origin[0] + ((float)x + 0.5f) / SDF_TEXELS_PER_UNIT, sdf._origin[1] + ((float)y + 0.5f) / SDF_TEXELS_PER_UNIT};
+			double error = SDL_fabs((double)(sdf._cpu[y * sdf._width + x] - exact_distance(&level, p)));
+			error_sum += error;
+			error_max = SDL_max(error_max, error);
+		};
+	};
+
+	// Doors opening and closing one at a time, the field follows them region by region
+	uint64_t rng = 5;
+	double door_ms = 0.0, door_cpu_ms = 0.0;
+	uint64_t door_texels = 0;
+	for (uint32_t i = 0; i < TOGGLES; i++)
+	{
+		uint32_t d = (uint32_t)(random_next(&rng) % level._doors_count);
+		level_set_door(&level, d, !level._doors[d]._open);
+		double begin = bench_now_ms();
+		door_ms += bench_record(&timer, &sdf);
+		door_cpu_ms += bench_now_ms() - begin;
+		const SdfRect *rect = &sdf._readback_rects[0][0];
+		door_texels += (uint64_t)(rect->_max[0] - rect->_min[0]) * (uint64_t)(rect->_max[1] - rect->_min[1]);
+	};
+
+	float2 probe = {level._rooms[0]._min[0] + 1.0f, level._rooms[0]._min[1] + 1.0f};
+	SDL_Log("sdf on %s, %ux%u texels, %.0f units range\n", properties.deviceName, sdf._width, sdf._height, (double)SDF_MAX_DISTANCE);
+	SDL_Log("sdf full build %.3f ms, mean error %.3f max %.3f units (texel %.3f)\n", full_ms, error_sum / ((double)sdf._width * sdf._height),
+			error_max, 1.0 / SDF_TEXELS_PER_UNIT);
+	SDL_Log("sdf door toggle %.3f ms GPU, %.3f ms submit to readback, %.0f texels resolved (%.1f%% of the field)\n",
+			door_ms / TOGGLES, door_cpu_ms / TOGGLES, (double)door_texels / TOGGLES,
+			100.0 * (double)door_texels / TOGGLES / ((double)sdf._width * sdf._height));
+	SDL_Log("sdf CPU query at a room corner %.3f units, exact %.3f\n", (double)sdf_distance(&sdf, probe),
+			(double)exact_distance(&level, probe));
+
+done:
+	destroy_bench_timer(&timer);
+	sdf_quit(&sdf, &vk);
+	level_free(&level);
+	destroy_bench_device(&bd);
+};
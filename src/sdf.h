@@ -0,0 +1,114 @@
+#pragma once
+#include "vk.h"
+#include "level.h"
+
+// Signed distance to the walls and closed doors, built on the GPU by jump flooding: texels an
+// occluder crosses seed themselves, log2 passes spread the nearest seed, a last pass turns seeds
+// into distances. Only dirty regions are rebuilt: a door that opens or closes (or anything
+// passed to sdf_invalidate) reseeds and refloods its box grown by the distance range, the rest
+// of the field stays. Distances are clamped to SDF_MAX_DISTANCE, which is what makes a bounded
+// region enough.
+// The field is a sampled texture for the lighting shaders (soft shadows, fog of war) and is read
+// back to the CPU, a frame or two late, for AI queries.
+
+constexpr float SDF_TEXELS_PER_UNIT = 4.0f;
+constexpr float SDF_MAX_DISTANCE = 4.0f;
+// Walls are segments, the field is the distance to them minus this
+constexpr float SDF_WALL_HALF_THICKNESS = 0.1f;
+// Occluder segments uploaded per frame, over all regions
+constexpr uint32_t SDF_MAX_SEGMENTS = 2048;
+// More dirty boxes in one frame are merged into one
+constexpr uint32_t SDF_MAX_REGIONS = 8;
+
+typedef struct
+{
+	float2 _a, _b;
+} SdfSegment;
+
+// Texel rect
+typedef struct
+{
+	int32_t _min[2], _max[2];
+} SdfRect;
+
+// Matches Params in shader/sdf.slang, pushed as push constants
+typedef struct
+{
+	// Texels seeded and flooded, and the ones whose distance is written
+	int32_t _region_min[2], _region_max[2];
+	int32_t _resolve_min[2], _resolve_max[2];
+	float2 _origin;
+	float _texels_per_unit;
+	float _max_distance;
+	float _half_thickness;
+	uint32_t _step;
+	// Flood reads seeds[_parity] and writes the other one
+	uint32_t _parity;
+	uint32_t _segment_base, _segment_count;
+} SdfParams;
+
+typedef struct
+{
+	VkShaderModule _module;
+	VkPipeline _seed, _flood, _resolve;
+} SdfPipelines;
+
+typedef struct
+{
+	const Level *_level;
+	uint32_t _doors_version;
+	// Door states the field was built with
+	bool *_doors_open;
+	uint32_t _width, _height;
+	float2 _origin;
+
+	uint32_t _dirty_count;
+	SdfRect _dirty[SDF_MAX_REGIONS];
+
+	// Seeds ping-pong, packed texel coordinates. All three images stay in GENERAL
+	VkImage _seeds[2], _image;
+	VkDeviceMemory _seeds_memory[2], _image_memory;
+	VkImageView _seeds_views[2], _view;
+	bool _initialized;
+	VkSampler _sampler;
+	VkBuffer _segments;
+	VkDeviceMemory _segments_memory;
+	SdfSegment *_mapped_segments;
+
+	// Per frame in flight: rects copied into its readback buffer, picked up once its fence signaled
+	VkBuffer _readback[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory _readback_memory[MAX_FRAMES_IN_FLIGHT];
+	float *_mapped_readback[MAX_FRAMES_IN_FLIGHT];
+	uint32_t _readback_count[MAX_FRAMES_IN_FLIGHT];
+	SdfRect _readback_rects[MAX_FRAMES_IN_FLIGHT][SDF_MAX_REGIONS];
+	// CPU copy of the field, far from everything until the first readback
+	float *_cpu;
+
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	VkPipelineLayout _pipeline_layout;
+	SdfPipelines _pipelines;
+} Sdf;
+
+// Over the bounds of level, the whole field is dirty
+Result sdf_init(Sdf *sdf, VulkanState *vk, const Level *level);
+// Compile the pipelines, may run on a worker thread once init is done
+Result sdf_build(Sdf *sdf, VulkanState *vk, const char *shader_name);
+void sdf_quit(Sdf *sdf, VulkanState *vk);
+
+// Occluders in the world box changed (destructible walls). Door changes are picked up on their own
+void sdf_invalidate(Sdf *sdf, const float2 min, const float2 max);
+// Outside of rendering: rebuild the dirty regions and copy them out for the CPU, nothing when
+// nothing changed. frame is the frame in flight slot
+void sdf_record(Sdf *sdf, VkCommandBuffer cmdbuffer, uint32_t frame);
+// Once frame's fence signaled: take its readback into the CPU copy
+void sdf_readback(Sdf *sdf, uint32_t frame);
+// CPU query, bilinear. SDF_MAX_DISTANCE - SDF_WALL_HALF_THICKNESS far from occluders and outside the level
+float sdf_distance(const Sdf *sdf, const float2 p);
+// World to texture uv: uv = world * out.xy + out.zw
+void sdf_transform(const Sdf *sdf, float4 out);
+
+// homeinvasion --bench sdf: full build vs a door's incremental update on the 50 room house, and
+// the error against the exact distance
+void sdf_benchmark(void);
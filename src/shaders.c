@@ -0,0 +1,11 @@
+#include "shaders.h"
+#include <string.h>
+
+const EmbeddedShader *embedded_shader_find(const char *name)
+{
+	for (uint32_t i = 0; i < embedded_shaders_count; i++)
+	{
+		if (strcmp(embedded_shaders[i]._name, name) == 0) return &embedded_shaders[i];
+	};
+	return nullptr;
+};
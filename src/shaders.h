@@ -0,0 +1,18 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Shaders compiled into the executable (generated shaders_embedded.c, see cmake/embed_shaders.cmake).
+// SPIR-V goes straight to vkCreateShaderModule, GLSL text is NUL terminated.
+typedef struct
+{
+	const char *_name;
+	const uint32_t *_code;
+	size_t _size;
+} EmbeddedShader;
+
+extern const EmbeddedShader embedded_shaders[];
+extern const uint32_t embedded_shaders_count;
+
+// By file name, e.g. "particles.spv". nullptr if it wasn't embedded
+const EmbeddedShader *embedded_shader_find(const char *name);
@@ -0,0 +1,165 @@
+#include "sprites.h"
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+
+// Word offsets in the draws buffer, see shader/sprites.slang
+static constexpr uint32_t DRAWS_COUNT = SPRITE_LAYERS * 5;
+static constexpr uint32_t DRAWS_SIZE = (DRAWS_COUNT + 1) * sizeof(uint32_t);
+
+// Takes ownership of module
+static Result build_pipelines(SpriteRenderer *sr, VulkanState *vk, VkShaderModule module, SpritePipelines *out)
+{
+	out->_module = module;
+	if (module == VK_NULL_HANDLE) return FAILURE;
+
+	VkPipelineLayout layout = sr->_bindings._pipeline_layout;
+	if (create_compute_pipeline(vk->_device, vk->_pipeline_cache, out->_module, "cull_main", layout, &out->_cull) != SUCCESS
+		|| create_compute_pipeline(vk->_device, vk->_pipeline_cache, out->_module, "build_main", layout, &out->_build) != SUCCESS)
+		return FAILURE;
+	return build_graphics_pipeline(vk->_device, vk->_pipeline_cache, vk->_swapchain_format, out->_module, "vert_main", "frag_main",
+			VK_CULL_MODE_NONE, layout, &out->_draw);
+};
+
+static void destroy_pipelines(VkDevice device, SpritePipelines *pipelines)
+{
+	vkDestroyPipeline(device, pipelines->_cull, nullptr);
+	vkDestroyPipeline(device, pipelines->_build, nullptr);
+	vkDestroyPipeline(device, pipelines->_draw, nullptr);
+	vkDestroyShaderModule(device, pipelines->_module, nullptr);
+	*pipelines = (SpritePipelines){};
+};
+
+Result sprites_init(SpriteRenderer *sr, VulkanState *vk)
+{
+	*sr = (SpriteRenderer){};
+	sr->_view[0] = 1.0f;
+	sr->_view[1] = 1.0f;
+
+	VkMemoryPropertyFlags device_local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	VkMemoryPropertyFlags host_visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	if (create_buffer(vk, MAX_FRAMES_IN_FLIGHT * SPRITES_CAPACITY * sizeof(Sprite), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				host_visible, &sr->_instances, &sr->_instances_memory) != SUCCESS
+		|| create_buffer(vk, SPRITE_LAYERS * SPRITES_CAPACITY * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				device_local, &sr->_visible, &sr->_visible_memory) != SUCCESS
+		|| create_buffer(vk, DRAWS_SIZE,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				device_local, &sr->_draws, &sr->_draws_memory) != SUCCESS)
+		return FAILURE;
+
+	if (vkMapMemory(vk->_device, sr->_instances_memory, 0, VK_WHOLE_SIZE, 0, (void **)&sr->_mapped_instances) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to map sprite instances\n");
+		return FAILURE;
+	};
+
+	VkBuffer buffers[3] = {sr->_instances, sr->_visible, sr->_draws};
+	if (create_storage_bindings(vk->_device, buffers, 3, sizeof(SpriteParams), &sr->_bindings) != SUCCESS)
+		return FAILURE;
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_GPU, "Created sprite renderer, capacity %u\n", SPRITES_CAPACITY);
+	return SUCCESS;
+};
+
+Result sprites_build(SpriteRenderer *sr, VulkanState *vk, const char *shader_name)
+{
+	return build_pipelines(sr, vk, load_shader_module(vk->_device, shader_name), &sr->_pipelines);
+};
+
+void sprites_quit(SpriteRenderer *sr, VulkanState *vk)
+{
+	destroy_pipelines(vk->_device, &sr->_pipelines);
+	destroy_pipelines(vk->_device, &sr->_pending);
+	destroy_storage_bindings(vk->_device, &sr->_bindings);
+	vkUnmapMemory(vk->_device, sr->_instances_memory);
+	destroy_buffer(vk, sr->_instances, sr->_instances_memory);
+	destroy_buffer(vk, sr->_visible, sr->_visible_memory);
+	destroy_buffer(vk, sr->_draws, sr->_draws_memory);
+};
+
+Result sprites_reload(SpriteRenderer *sr, VulkanState *vk, const char *shader_path)
+{
+	if (build_pipelines(sr, vk, load_shader_module_file(vk->_device, shader_path), &sr->_pending) != SUCCESS)
+	{
+		destroy_pipelines(vk->_device, &sr->_pending);
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+void sprites_swap(SpriteRenderer *sr, VulkanState *vk)
+{
+	destroy_pipelines(vk->_device, &sr->_pipelines);
+	sr->_pipelines = sr->_pending;
+	sr->_pending = (SpritePipelines){};
+};
+
+void sprites_begin(SpriteRenderer *sr, VulkanState *vk)
+{
+	sr->_frame = vk->_current_frame;
+	sr->_count = 0;
+};
+
+bool sprites_push(SpriteRenderer *sr, uint32_t layer, const float2 position, const float2 half_size, const float4 color)
+{
+	if (sr->_count == SPRITES_CAPACITY) return false;
+	Sprite *sprite = &sr->_mapped_instances[sr->_frame * SPRITES_CAPACITY + sr->_count++];
+	sprite->_position[0] = position[0];
+	sprite->_position[1] = position[1];
+	sprite->_half_size[0] = half_size[0];
+	sprite->_half_size[1] = half_size[1];
+	SDL_memcpy(sprite->_color, color, sizeof(float4));
+	sprite->_layer = layer;
+	return true;
+};
+
+static void push_params(SpriteRenderer *sr, VkCommandBuffer cmdbuffer, const float4 view)
+{
+	SpriteParams params = {};
+	SDL_memcpy(params._view, view, sizeof(float4));
+	params._instance_base = sr->_frame * SPRITES_CAPACITY;
+	params._instance_count = sr->_count;
+	params._layer_capacity = SPRITES_CAPACITY;
+	vkCmdPushConstants(cmdbuffer, sr->_bindings._pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+			0, sizeof(SpriteParams), &params);
+};
+
+void sprites_record_cull(SpriteRenderer *sr, VkCommandBuffer cmdbuffer, const float4 view)
+{
+	// Last frame's draw, or the last view's, still reads the commands and visible lists
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE);
+	vkCmdFillBuffer(cmdbuffer, sr->_draws, 0, VK_WHOLE_SIZE, 0);
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sr->_bindings._pipeline_layout, 0, 1, &sr->_bindings._set, 0, nullptr);
+	push_params(sr, cmdbuffer, view);
+
+	if (sr->_count > 0)
+	{
+		vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sr->_pipelines._cull);
+		vkCmdDispatch(cmdbuffer, (sr->_count + 63) / 64, 1, 1);
+		memory_barrier(cmdbuffer,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	};
+
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sr->_pipelines._build);
+	vkCmdDispatch(cmdbuffer, 1, 1, 1);
+	memory_barrier(cmdbuffer,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+};
+
+void sprites_record_draw(SpriteRenderer *sr, VkCommandBuffer cmdbuffer, const float4 view)
+{
+	vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, sr->_pipelines._draw);
+	vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, sr->_bindings._pipeline_layout, 0, 1, &sr->_bindings._set, 0, nullptr);
+	push_params(sr, cmdbuffer, view);
+	// Commands start at offset 0, the GPU wrote how many of them are valid
+	vkCmdDrawIndirectCount(cmdbuffer, sr->_draws, 0, sr->_draws, DRAWS_COUNT * sizeof(uint32_t),
+			SPRITE_LAYERS, sizeof(VkDrawIndirectCommand));
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "vk.h"
+
+// GPU driven sprite renderer. Sprites are pushed into a per frame instance buffer, a compute
+// pass culls them against the camera and bins the visible ones by layer, then a single
+// vkCmdDrawIndirectCount draws every non empty layer. Submission cost doesn't depend on
+// how many sprites are in the house.
+
+constexpr uint32_t SPRITES_CAPACITY = 1 << 16;
+// Drawn in order, 0 first (floor, furniture, actors, ...)
+constexpr uint32_t SPRITE_LAYERS = 8;
+
+// Matches Sprite in shader/sprites.slang (std430)
+typedef struct
+{
+	float2 _position;
+	float2 _half_size;
+	float4 _color;
+	uint32_t _layer;
+	uint32_t _pad[3];
+} Sprite;
+
+// Matches Params in shader/sprites.slang, pushed as push constants
+typedef struct
+{
+	float4 _view;
+	uint32_t _instance_base;
+	uint32_t _instance_count;
+	uint32_t _layer_capacity;
+	uint32_t _pad;
+} SpriteParams;
+
+typedef struct
+{
+	VkShaderModule _module;
+	VkPipeline _cull, _build, _draw;
+} SpritePipelines;
+
+typedef struct
+{
+	// Instances are written by the CPU every frame, one region per frame in flight
+	VkBuffer _instances, _visible, _draws;
+	VkDeviceMemory _instances_memory, _visible_memory, _draws_memory;
+	Sprite *_mapped_instances;
+
+	StorageBindings _bindings;
+	// _pending is built off the main thread by a shader hot reload, swapped in between frames
+	SpritePipelines _pipelines, _pending;
+
+	// Main camera, world to clip transform: clip = world * view.xy + view.zw
+	float4 _view;
+	uint32_t _frame, _count;
+} SpriteRenderer;
+
+Result sprites_init(SpriteRenderer *sr, VulkanState *vk);
+// Compile the pipelines, may run on a worker thread once init is done.
+// shader_name is the embedded module, e.g. "sprites.spv"
+Result sprites_build(SpriteRenderer *sr, VulkanState *vk, const char *shader_name);
+void sprites_quit(SpriteRenderer *sr, VulkanState *vk);
+// Shader hot reload: build from a new module on any thread, then swap on the main thread between frames
+Result sprites_reload(SpriteRenderer *sr, VulkanState *vk, const char *shader_path);
+void sprites_swap(SpriteRenderer *sr, VulkanState *vk);
+
+// Start filling the instances of the frame about to be recorded
+void sprites_begin(SpriteRenderer *sr, VulkanState *vk);
+bool sprites_push(SpriteRenderer *sr, uint32_t layer, const float2 position, const float2 half_size, const float4 color);
+
+// Record the culling passes for view, outside of rendering. Every view (main camera, security
+// cameras) culls again and is drawn before the next one is culled, they share the output buffers
+void sprites_record_cull(SpriteRenderer *sr, VkCommandBuffer cmdbuffer, const float4 view);
+// Record the indirect draws of the last culled view, inside dynamic rendering
+void sprites_record_draw(SpriteRenderer *sr, VkCommandBuffer cmdbuffer, const float4 view);
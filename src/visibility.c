@@ -0,0 +1,364 @@
+#include "visibility.h"
+#include "bench.h"
+#include <float.h>
+#include <stdlib.h>
+
+static constexpr float HIT_EPSILON = 1e-4f;
+// Rays are cast slightly to both sides of every wall corner so the polygon wraps around it
+static constexpr float CORNER_EPSILON = 1e-3f;
+static constexpr uint32_t RING_RAYS = 32;
+
+static uint32_t cell_coord(float v, float origin, uint32_t size)
+{
+	int c = (int)SDL_floorf((v - origin) / VIS_CELL_SIZE);
+	return (uint32_t)SDL_clamp(c, 0, (int)size - 1);
+};
+
+Result vis_init(Visibility *vis, Level *level)
+{
+	*vis = (Visibility){};
+	vis->_level = level;
+	vis->_origin[0] = level->_min[0];
+	vis->_origin[1] = level->_min[1];
+	vis->_width = (uint32_t)SDL_ceilf((level->_max[0] - level->_min[0]) / VIS_CELL_SIZE);
+	vis->_height = (uint32_t)SDL_ceilf((level->_max[1] - level->_min[1]) / VIS_CELL_SIZE);
+	uint32_t cells = vis->_width * vis->_height;
+
+	vis->_segments_count = level->_walls_count + level->_doors_count;
+	vis->_segments = malloc(vis->_segments_count * sizeof(float4));
+	vis->_cell_offset = calloc(cells + 1, sizeof(uint32_t));
+	if (!vis->_segments || !vis->_cell_offset)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to allocate visibility grid\n");
+		return FAILURE;
+	};
+
+	for (uint32_t i = 0; i < vis->_segments_count; i++)
+	{
+		const float *a, *b;
+		if (i < level->_walls_count)
+		{
+			a = level->_walls[i]._a;
+			b = level->_walls[i]._b;
+		}
+		else
+		{
+			a = level->_doors[i - level->_walls_count]._a;
+			b = level->_doors[i - level->_walls_count]._b;
+		};
+		vis->_segments[i][0] = a[0];
+		vis->_segments[i][1] = a[1];
+		vis->_segments[i][2] = b[0];
+		vis->_segments[i][3] = b[1];
+	};
+
+	// Two passes: count segments per cell, then fill. Walls are axis aligned so their bounds are tight
+	for (int pass = 0; pass < 2; pass++)
+	{
+		uint32_t *fill = pass ? calloc(cells, sizeof(uint32_t)) : nullptr;
+		for (uint32_t i = 0; i < vis->_segments_count; i++)
+		{
+			const float *s = vis->_segments[i];
+			uint32_t x0 = cell_coord(SDL_min(s[0], s[2]), vis->_origin[0], vis->_width);
+			uint32_t x1 = cell_coord(SDL_max(s[0], s[2]), vis->_origin[0], vis->_width);
+			uint32_t y0 = cell_coord(SDL_min(s[1], s[3]), vis->_origin[1], vis->_height);
+			uint32_t y1 = cell_coord(SDL_max(s[1], s[3]), vis->_origin[1], vis->_height);
+			for (uint32_t y = y0; y <= y1; y++)
+			{
+				for (uint32_t x = x0; x <= x1; x++)
+				{
+					uint32_t cell = y * vis->_width + x;
+					if (pass == 0) vis->_cell_offset[cell + 1]++;
+					else vis->_cell_segments[vis->_cell_offset[cell] + fill[cell]++] = i;
+				};
+			};
+		};
+		if (pass == 0)
+		{
+			for (uint32_t c = 0; c < cells; c++) vis->_cell_offset[c + 1] += vis->_cell_offset[c];
+			vis->_cell_segments = malloc(vis->_cell_offset[cells] * sizeof(uint32_t) + 1);
+			if (!vis->_cell_segments) return FAILURE;
+		};
+		free(fill);
+	};
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Visibility grid %ux%u, %u segments, %u references\n",
+			vis->_width, vis->_height, vis->_segments_count, vis->_cell_offset[cells]);
+	return SUCCESS;
+};
+
+void vis_quit(Visibility *vis)
+{
+	free(vis->_segments);
+	free(vis->_cell_offset);
+	free(vis->_cell_segments);
+	*vis = (Visibility){};
+};
+
+// Ray o + t * d against segment s, returns t or a negative value on miss
+static float intersect(const float2 o, const float2 d, const float4 s)
+{
+	float ex = s[2] - s[0], ey = s[3] - s[1];
+	float denom = d[0] * ey - d[1] * ex;
+	if (SDL_fabsf(denom) < 1e-12f) return -1.0f;
+	float ox = s[0] - o[0], oy = s[1] - o[1];
+	float t = (ox * ey - oy * ex) / denom;
+	float u = (ox * d[1] - oy * d[0]) / denom;
+	if (u < 0.0f || u > 1.0f) return -1.0f;
+	return t;
+};
+
+static bool occludes(const Visibility *vis, uint32_t segment)
+{
+	if (segment < vis->_level->_walls_count) return true;
+	return !vis->_level->_doors[segment - vis->_level->_walls_count]._open;
+};
+
+// Walk the grid cells along o + t * d for t in [0, max_t]. Returns the first hit t, or max_t.
+// any_hit stops at the first occluder found instead of the closest one
+static float trace(const Visibility *vis, const float2 o, const float2 d, float max_t, bool any_hit)
+{
+	int x = (int)cell_coord(o[0], vis->_origin[0], vis->_width);
+	int y = (int)cell_coord(o[1], vis->_origin[1], vis->_height);
+	int step_x = d[0] > 0.0f ? 1 : -1, step_y = d[1] > 0.0f ? 1 : -1;
+	float next_x = vis->_origin[0] + (x + (step_x > 0)) * VIS_CELL_SIZE;
+	float next_y = vis->_origin[1] + (y + (step_y > 0)) * VIS_CELL_SIZE;
+	float t_max_x = d[0] != 0.0f ? (next_x - o[0]) / d[0] : FLT_MAX;
+	float t_max_y = d[1] != 0.0f ? (next_y - o[1]) / d[1] : FLT_MAX;
+	float t_delta_x = d[0] != 0.0f ? VIS_CELL_SIZE / SDL_fabsf(d[0]) : FLT_MAX;
+	float t_delta_y = d[1] != 0.0f ? VIS_CELL_SIZE / SDL_fabsf(d[1]) : FLT_MAX;
+
+	float best = max_t;
+	for (;;)
+	{
+		uint32_t cell = (uint32_t)y * vis->_width + (uint32_t)x;
+		for (uint32_t i = vis->_cell_offset[cell]; i < vis->_cell_offset[cell + 1]; i++)
+		{
+			uint32_t segment = vis->_cell_segments[i];
+			if (!occludes(vis, segment)) continue;
+			float t = intersect(o, d, vis->_segments[segment]);
+			if (t < HIT_EPSILON || t >= best) continue;
+			best = t;
+			if (any_hit) return best;
+		};
+
+		// A closer hit can't be in a later cell
+		float exit = SDL_min(t_max_x, t_max_y);
+		if (best <= exit || exit >= max_t) return best;
+		if (t_max_x < t_max_y)
+		{
+			x += step_x;
+			t_max_x += t_delta_x;
+		}
+		else
+		{
+			y += step_y;
+			t_max_y += t_delta_y;
+		};
+		if (x < 0 || y < 0 || x >= (int)vis->_width || y >= (int)vis->_height) return best;
+	};
+};
+
+bool vis_segment_clear(const Visibility *vis, const float2 from, const float2 to)
+{
+	float2 d = {to[0] - from[0], to[1] - from[1]};
+	return trace(vis, from, d, 1.0f - HIT_EPSILON, true) >= 1.0f - HIT_EPSILON;
+};
+
+float vis_raycast(const Visibility *vis, const float2 origin, const float2 dir, float max_distance)
+{
+	return trace(vis, origin, dir, max_distance, false);
+};
+
+bool vis_can_see(const Visibility *vis, const float2 eye, const float2 facing, float fov_cos, float range, const float2 target)
+{
+	float dx = target[0] - eye[0], dy = target[1] - eye[1];
+	float dist2 = dx * dx + dy * dy;
+	if (dist2 > range * range) return false;
+	// Compare against the cone without a sqrt: dot >= cos * |d|
+	float dot = dx * facing[0] + dy * facing[1];
+	if (dot * SDL_fabsf(dot) < fov_cos * SDL_fabsf(fov_cos) * dist2) return false;
+	return vis_segment_clear(vis, eye, target);
+};
+
+typedef struct
+{
+	const Visibility *_vis;
+	const VisQuery *_queries;
+	uint8_t *_results;
+} BatchArgs;
+
+static void batch_job(void *user, uint32_t begin, uint32_t end, uint32_t worker)
+{
+	BatchArgs *args = user;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		args->_results[i] = vis_segment_clear(args->_vis, args->_queries[i]._from, args->_queries[i]._to);
+	};
+};
+
+void vis_batch(const Visibility *vis, JobSystem *jobs, const VisQuery *queries, uint32_t count, uint8_t *results)
+{
+	BatchArgs args = {vis, queries, results};
+	jobs_parallel_for(jobs, count, 256, batch_job, &args);
+};
+
+// # Visibility polygons
+
+static int compare_angles(const void *a, const void *b)
+{
+	float fa = *(const float *)a, fb = *(const float *)b;
+	return (fa > fb) - (fa < fb);
+};
+
+void vis_build_polygon(const Visibility *vis, const float2 origin, float radius, VisPolygon *polygon)
+{
+	float angles[VIS_MAX_POLYGON];
+	uint32_t count = 0;
+
+	for (uint32_t i = 0; i < RING_RAYS; i++)
+	{
+		angles[count++] = (2.0f * SDL_PI_F * i) / RING_RAYS - SDL_PI_F;
+	};
+
+	uint32_t x0 = cell_coord(origin[0] - radius, vis->_origin[0], vis->_width);
+	uint32_t x1 = cell_coord(origin[0] + radius, vis->_origin[0], vis->_width);
+	uint32_t y0 = cell_coord(origin[1] - radius, vis->_origin[1], vis->_height);
+	uint32_t y1 = cell_coord(origin[1] + radius, vis->_origin[1], vis->_height);
+	for (uint32_t y = y0; y <= y1; y++)
+	{
+		for (uint32_t x = x0; x <= x1; x++)
+		{
+			uint32_t cell = y * vis->_width + x;
+			for (uint32_t i = vis->_cell_offset[cell]; i < vis->_cell_offset[cell + 1]; i++)
+			{
+				const float *s = vis->_segments[vis->_cell_segments[i]];
+				for (int e = 0; e < 2; e++)
+				{
+					float dx = s[e * 2] - origin[0], dy = s[e * 2 + 1] - origin[1];
+					if (dx * dx + dy * dy > radius * radius || count + 2 > VIS_MAX_POLYGON) continue;
+					float angle = SDL_atan2f(dy, dx);
+					angles[count++] = angle - CORNER_EPSILON;
+					angles[count++] = angle + CORNER_EPSILON;
+				};
+			};
+		};
+	};
+
+	// Segments shared by several cells produce the same corners, drop them after sorting
+	qsort(angles, count, sizeof(float), compare_angles);
+	polygon->_points_count = 0;
+	float last = -FLT_MAX;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (angles[i] - last < CORNER_EPSILON * 0.5f) continue;
+		last = angles[i];
+		float2 dir = {SDL_cosf(angles[i]), SDL_sinf(angles[i])};
+		float t = trace(vis, origin, dir, radius, false);
+		float *p = polygon->_points[polygon->_points_count++];
+		p[0] = origin[0] + dir[0] * t;
+		p[1] = origin[1] + dir[1] * t;
+	};
+
+	polygon->_origin[0] = origin[0];
+	polygon->_origin[1] = origin[1];
+	polygon->_radius = radius;
+	polygon->_doors_version = vis->_level->_doors_version;
+	polygon->_valid = true;
+};
+
+const VisPolygon *vis_polygon(const Visibility *vis, VisCache *cache, uint32_t viewer, const float2 origin, float radius)
+{
+	VisPolygon *polygon = &cache->_polygons[viewer % VIS_MAX_VIEWERS];
+	if (polygon->_valid && polygon->_origin[0] == origin[0] && polygon->_origin[1] == origin[1]
+			&& polygon->_radius == radius && polygon->_doors_version == vis->_level->_doors_version)
+	{
+		cache->_hits++;
+		return polygon;
+	};
+	cache->_misses++;
+	vis_build_polygon(vis, origin, radius, polygon);
+	return polygon;
+};
+
+// # Benchmark
+// 10k line of sight queries per tick over the 50 room house, most of them short range like
+// guards checking nearby intruders, then visibility polygons for 64 viewers.
+
+void vis_benchmark(void)
+{
+	constexpr uint32_t QUERIES = 10000;
+	constexpr uint32_t TICKS = 20;
+	Level level;
+	if (level_generate_house(&level, 10, 5, 8.0f, 1234) != SUCCESS) return;
+
+	Visibility vis = {};
+	JobSystem *jobs = calloc(1, sizeof(JobSystem));
+	VisQuery *queries = malloc(QUERIES * sizeof(VisQuery));
+	uint8_t *results = malloc(QUERIES);
+	VisCache *cache = calloc(1, sizeof(VisCache));
+	if (!jobs || jobs_init(jobs, 0) != SUCCESS || !queries || !results || !cache || vis_init(&vis, &level) != SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "vis benchmark setup failed\n");
+		vis_quit(&vis);
+		// Also stops the workers a failed init had started
+		if (jobs) jobs_quit(jobs);
+		free(jobs);
+		free(queries);
+		free(results);
+		free(cache);
+		level_free(&level);
+		return;
+	};
+
+	uint64_t rng = 7;
+	for (uint32_t i = 0; i < QUERIES; i++)
+	{
+		VisQuery *q = &queries[i];
+		q->_from[0] = random_range(&rng, level._min[0], level._max[0]);
+		q->_from[1] = random_range(&rng, level._min[1], level._max[1]);
+		q->_to[0] = SDL_clamp(q->_from[0] + random_range(&rng, -12.0f, 12.0f), level._min[0], level._max[0]);
+		q->_to[1] = SDL_clamp(q->_from[1] + random_range(&rng, -12.0f, 12.0f), level._min[1], level._max[1]);
+	};
+
+	uint32_t visible = 0;
+	double begin = bench_now_ms();
+	for (uint32_t tick = 0; tick < TICKS; tick++)
+	{
+		for (uint32_t i = 0; i < QUERIES; i++) results[i] = vis_segment_clear(&vis, queries[i]._from, queries[i]._to);
+	};
+	double single = (bench_now_ms() - begin) / TICKS;
+	for (uint32_t i = 0; i < QUERIES; i++) visible += results[i];
+
+	begin = bench_now_ms();
+	for (uint32_t tick = 0; tick < TICKS; tick++) vis_batch(&vis, jobs, queries, QUERIES, results);
+	double batched = (bench_now_ms() - begin) / TICKS;
+
+	SDL_Log("vis %u queries/tick (%u visible): single thread %.3f ms (%.1f M/s), batched on %u workers %.3f ms (%.1f M/s)\n",
+			QUERIES, visible, single, QUERIES / single / 1000.0, jobs->_worker_count + 1, batched, QUERIES / batched / 1000.0);
+
+	float2 viewers[VIS_MAX_VIEWERS];
+	for (uint32_t i = 0; i < VIS_MAX_VIEWERS; i++)
+	{
+		viewers[i][0] = random_range(&rng, level._min[0] + 0.5f, level._max[0] - 0.5f);
+		viewers[i][1] = random_range(&rng, level._min[1] + 0.5f, level._max[1] - 0.5f);
+	};
+	uint32_t points = 0;
+	begin = bench_now_ms();
+	for (uint32_t i = 0; i < VIS_MAX_VIEWERS; i++) points += vis_polygon(&vis, cache, i, viewers[i], 10.0f)->_points_count;
+	double build = bench_now_ms() - begin;
+	begin = bench_now_ms();
+	for (uint32_t tick = 0; tick < TICKS; tick++)
+		for (uint32_t i = 0; i < VIS_MAX_VIEWERS; i++) vis_polygon(&vis, cache, i, viewers[i], 10.0f);
+	double cached = (bench_now_ms() - begin) / TICKS;
+	SDL_Log("vis polygons: %u viewers, %u points, build %.3f ms, cached lookup %.4f ms per tick (%u hits, %u misses)\n",
+			VIS_MAX_VIEWERS, points, build, cached, cache->_hits, cache->_misses);
+
+	vis_quit(&vis);
+	jobs_quit(jobs);
+	free(jobs);
+	free(queries);
+	free(results);
+	free(cache);
+	level_free(&level);
+};
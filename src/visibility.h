@@ -0,0 +1,66 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include "level.h"
+#include "jobs.h"
+
+// Line of sight over the house walls.
+// Walls and doors are bucketed in a uniform grid, rays walk the grid (DDA) and only test the
+// segments of the cells they cross. Closed doors occlude, open doors don't.
+// Visibility polygons are cached per viewer (guards, lights, the player for fog of war) and
+// rebuilt only when the viewer moves or a door changes.
+
+constexpr float VIS_CELL_SIZE = 2.0f;
+constexpr uint32_t VIS_MAX_POLYGON = 512;
+constexpr uint32_t VIS_MAX_VIEWERS = 64;
+
+typedef struct
+{
+	Level *_level;
+	float2 _origin;
+	uint32_t _width, _height;
+	// Segments [0, _level->_walls_count) are walls, the rest doors in level order
+	uint32_t _segments_count;
+	float4 *_segments;
+	// Segments of each cell, CSR layout
+	uint32_t *_cell_offset, *_cell_segments;
+} Visibility;
+
+typedef struct
+{
+	float2 _from, _to;
+} VisQuery;
+
+// Points are sorted by angle around _origin, so the polygon is a triangle fan centered on the
+// viewer. That is what the fog-of-war mask is drawn from (fog.h).
+typedef struct
+{
+	float2 _origin;
+	float _radius;
+	uint32_t _doors_version;
+	bool _valid;
+	uint32_t _points_count;
+	float2 _points[VIS_MAX_POLYGON];
+} VisPolygon;
+
+typedef struct
+{
+	VisPolygon _polygons[VIS_MAX_VIEWERS];
+	uint32_t _hits, _misses;
+} VisCache;
+
+Result vis_init(Visibility *vis, Level *level);
+void vis_quit(Visibility *vis);
+
+bool vis_segment_clear(const Visibility *vis, const float2 from, const float2 to);
+// Distance to the first occluder along dir (normalized), or max_distance
+float vis_raycast(const Visibility *vis, const float2 origin, const float2 dir, float max_distance);
+// AI perception: in range, inside the view cone (cos of half angle) and not occluded
+bool vis_can_see(const Visibility *vis, const float2 eye, const float2 facing, float fov_cos, float range, const float2 target);
+// Answer count segment queries on the workers, results[i] is 1 when the segment is clear
+void vis_batch(const Visibility *vis, JobSystem *jobs, const VisQuery *queries, uint32_t count, uint8_t *results);
+
+// Returns the cached polygon of viewer, rebuilding it if the viewer moved or a door changed
+const VisPolygon *vis_polygon(const Visibility *vis, VisCache *cache, uint32_t viewer, const float2 origin, float radius);
+void vis_build_polygon(const Visibility *vis, const float2 origin, float radius, VisPolygon *polygon);
+
+void vis_benchmark(void);
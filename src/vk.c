@@ -0,0 +1,625 @@
+#include "vk.h"
+#include "shaders.h"
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+char *read_shader_file(const char *path, uint32_t *out_size)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Failed to open %s\n", path);
+		return nullptr;
+	};
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char *content = size > 0 ? malloc((size_t)size) : nullptr;
+	if (content == nullptr || fread(content, sizeof(char), (size_t)size, file) != (size_t)size)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Failed to read %s\n", path);
+		free(content);
+		fclose(file);
+		return nullptr;
+	};
+
+	fclose(file);
+	*out_size = (uint32_t)size;
+	return content;
+};
+
+VkShaderModule create_shader_module(VkDevice device, const char *src, size_t size)
+{
+	VkShaderModuleCreateInfo create_info = {};
+	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	create_info.pCode = (const uint32_t *)src;
+	create_info.codeSize = size;
+
+	VkShaderModule shader_module = VK_NULL_HANDLE;
+
+	if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create shader module\n");
+		return VK_NULL_HANDLE;
+	};
+
+	return shader_module;
+};
+
+VkShaderModule load_shader_module(VkDevice device, const char *name)
+{
+	const EmbeddedShader *shader = embedded_shader_find(name);
+	if (shader == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Shader %s is not embedded\n", name);
+		return VK_NULL_HANDLE;
+	};
+	return create_shader_module(device, (const char *)shader->_code, shader->_size);
+};
+
+VkShaderModule load_shader_module_file(VkDevice device, const char *path)
+{
+	uint32_t size;
+	char *src = read_shader_file(path, &size);
+	if (src == nullptr) return VK_NULL_HANDLE;
+	VkShaderModule module = create_shader_module(device, src, size);
+	free(src);
+	return module;
+};
+
+uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_bits, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	{
+		if ((type_bits & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	};
+	return UINT32_MAX;
+};
+
+Result create_buffer(VulkanState *vk, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags properties, VkBuffer *buffer, VkDeviceMemory *memory)
+{
+	VkBufferCreateInfo buffer_create_info = {};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size = size;
+	buffer_create_info.usage = usage;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(vk->_device, &buffer_create_info, nullptr, buffer) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create buffer\n");
+		return FAILURE;
+	};
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(vk->_device, *buffer, &requirements);
+
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = find_memory_type(vk->_physical_device, requirements.memoryTypeBits, properties);
+	if (allocate_info.memoryTypeIndex == UINT32_MAX)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "No suitable memory type for buffer\n");
+		return FAILURE;
+	};
+
+	if (vkAllocateMemory(vk->_device, &allocate_info, nullptr, memory) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate buffer memory\n");
+		return FAILURE;
+	};
+	vkBindBufferMemory(vk->_device, *buffer, *memory, 0);
+	return SUCCESS;
+};
+
+void destroy_buffer(VulkanState *vk, VkBuffer buffer, VkDeviceMemory memory)
+{
+	vkDestroyBuffer(vk->_device, buffer, nullptr);
+	vkFreeMemory(vk->_device, memory, nullptr);
+};
+
+Result create_image(VulkanState *vk, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+		VkImage *image, VkDeviceMemory *memory, VkImageView *view)
+{
+	VkImageCreateInfo image_create_info = {};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = format;
+	image_create_info.extent = (VkExtent3D){extent.width, extent.height, 1};
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = usage;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(vk->_device, &image_create_info, nullptr, image) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create image\n");
+		return FAILURE;
+	};
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(vk->_device, *image, &requirements);
+
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = requirements.size;
+	allocate_info.memoryTypeIndex = find_memory_type(vk->_physical_device, requirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (allocate_info.memoryTypeIndex == UINT32_MAX || vkAllocateMemory(vk->_device, &allocate_info, nullptr, memory) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate image memory\n");
+		return FAILURE;
+	};
+	vkBindImageMemory(vk->_device, *image, *memory, 0);
+
+	VkImageViewCreateInfo view_create_info = {};
+	view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image = *image;
+	view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_create_info.format = format;
+	view_create_info.subresourceRange = (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	if (vkCreateImageView(vk->_device, &view_create_info, nullptr, view) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create image view\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+void destroy_image(VulkanState *vk, VkImage image, VkDeviceMemory memory, VkImageView view)
+{
+	vkDestroyImageView(vk->_device, view, nullptr);
+	vkDestroyImage(vk->_device, image, nullptr);
+	vkFreeMemory(vk->_device, memory, nullptr);
+};
+
+void image_barrier(VkCommandBuffer cmdbuffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+		VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask,
+		VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask)
+{
+	VkImageMemoryBarrier2 barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = src_stage_mask;
+	barrier.srcAccessMask = src_access_mask;
+	barrier.dstStageMask = dst_stage_mask;
+	barrier.dstAccessMask = dst_access_mask;
+	barrier.oldLayout = old_layout;
+	barrier.newLayout = new_layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+	VkDependencyInfo dependency_info = {};
+	dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependency_info.imageMemoryBarrierCount = 1;
+	dependency_info.pImageMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(cmdbuffer, &dependency_info);
+};
+
+// Global memory barrier, enough for buffers shared between passes of the same queue
+void memory_barrier(VkCommandBuffer cmdbuffer,
+		VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask,
+		VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask)
+{
+	VkMemoryBarrier2 barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = src_stage_mask;
+	barrier.srcAccessMask = src_access_mask;
+	barrier.dstStageMask = dst_stage_mask;
+	barrier.dstAccessMask = dst_access_mask;
+
+	VkDependencyInfo dependency_info = {};
+	dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependency_info.memoryBarrierCount = 1;
+	dependency_info.pMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(cmdbuffer, &dependency_info);
+};
+
+void buffer_ownership_barrier(VkCommandBuffer cmdbuffer, const VkBuffer *buffers, uint32_t buffers_count,
+		uint32_t src_family, uint32_t dst_family, bool release,
+		VkPipelineStageFlags2 stage_mask, VkAccessFlags2 access_mask)
+{
+	VkBufferMemoryBarrier2 barriers[buffers_count];
+	for (uint32_t i = 0; i < buffers_count; i++)
+	{
+		barriers[i] = (VkBufferMemoryBarrier2){};
+		barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+		// The other half of the transfer happens on the other queue, ordered by a semaphore
+		barriers[i].srcStageMask = release ? stage_mask : VK_PIPELINE_STAGE_2_NONE;
+		barriers[i].srcAccessMask = release ? access_mask : VK_ACCESS_2_NONE;
+		barriers[i].dstStageMask = release ? VK_PIPELINE_STAGE_2_NONE : stage_mask;
+		barriers[i].dstAccessMask = release ? VK_ACCESS_2_NONE : access_mask;
+		barriers[i].srcQueueFamilyIndex = src_family;
+		barriers[i].dstQueueFamilyIndex = dst_family;
+		barriers[i].buffer = buffers[i];
+		barriers[i].offset = 0;
+		barriers[i].size = VK_WHOLE_SIZE;
+	};
+
+	VkDependencyInfo dependency_info = {};
+	dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependency_info.bufferMemoryBarrierCount = buffers_count;
+	dependency_info.pBufferMemoryBarriers = barriers;
+
+	vkCmdPipelineBarrier2(cmdbuffer, &dependency_info);
+};
+
+Result create_storage_bindings(VkDevice device, const VkBuffer *buffers, uint32_t buffers_count,
+		uint32_t push_constant_size, StorageBindings *bindings)
+{
+	VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+	VkDescriptorSetLayoutBinding *layout_bindings = calloc(buffers_count, sizeof(VkDescriptorSetLayoutBinding));
+	VkDescriptorBufferInfo *buffer_infos = calloc(buffers_count, sizeof(VkDescriptorBufferInfo));
+	VkWriteDescriptorSet *writes = calloc(buffers_count, sizeof(VkWriteDescriptorSet));
+	Result result = FAILURE;
+
+	for (uint32_t i = 0; i < buffers_count; i++)
+	{
+		layout_bindings[i].binding = i;
+		layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		layout_bindings[i].descriptorCount = 1;
+		layout_bindings[i].stageFlags = stages;
+	};
+
+	VkDescriptorSetLayoutCreateInfo layout_create_info = {};
+	layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_create_info.bindingCount = buffers_count;
+	layout_create_info.pBindings = layout_bindings;
+	if (vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &bindings->_set_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create descriptor set layout\n");
+		goto done;
+	};
+
+	VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers_count};
+	VkDescriptorPoolCreateInfo pool_create_info = {};
+	pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets = 1;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes = &pool_size;
+	if (vkCreateDescriptorPool(device, &pool_create_info, nullptr, &bindings->_pool) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create descriptor pool\n");
+		goto done;
+	};
+
+	VkDescriptorSetAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocate_info.descriptorPool = bindings->_pool;
+	allocate_info.descriptorSetCount = 1;
+	allocate_info.pSetLayouts = &bindings->_set_layout;
+	if (vkAllocateDescriptorSets(device, &allocate_info, &bindings->_set) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to allocate descriptor set\n");
+		goto done;
+	};
+
+	for (uint32_t i = 0; i < buffers_count; i++)
+	{
+		buffer_infos[i] = (VkDescriptorBufferInfo){buffers[i], 0, VK_WHOLE_SIZE};
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = bindings->_set;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &buffer_infos[i];
+	};
+	vkUpdateDescriptorSets(device, buffers_count, writes, 0, nullptr);
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = stages;
+	push_constant_range.size = push_constant_size;
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &bindings->_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = push_constant_size > 0 ? 1 : 0;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+	if (vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &bindings->_pipeline_layout) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create pipeline layout\n");
+		goto done;
+	};
+	result = SUCCESS;
+
+done:
+	free(layout_bindings);
+	free(buffer_infos);
+	free(writes);
+	return result;
+};
+
+void destroy_storage_bindings(VkDevice device, StorageBindings *bindings)
+{
+	vkDestroyPipelineLayout(device, bindings->_pipeline_layout, nullptr);
+	vkDestroyDescriptorPool(device, bindings->_pool, nullptr);
+	vkDestroyDescriptorSetLayout(device, bindings->_set_layout, nullptr);
+};
+
+Result create_compute_pipeline(VkDevice device, VkPipelineCache cache, VkShaderModule module, const char *entry,
+		VkPipelineLayout layout, VkPipeline *pipeline)
+{
+	VkComputePipelineCreateInfo create_info = {};
+	create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	create_info.stage.module = module;
+	create_info.stage.pName = entry;
+	create_info.layout = layout;
+	create_info.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(device, cache, 1, &create_info, nullptr, pipeline) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create compute pipeline %s\n", entry);
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+// Every fixed function state of a PipelineDesc. Filled in place, the create infos point at each other
+typedef struct
+{
+	VkBool32 _feature_values[32];
+	VkSpecializationMapEntry _feature_entries[32];
+	VkSpecializationInfo _specialization_info;
+	VkPipelineShaderStageCreateInfo _stages[2];
+	VkPipelineVertexInputStateCreateInfo _vertex_input;
+	VkPipelineInputAssemblyStateCreateInfo _input_assembly;
+	VkDynamicState _dynamic_states[2];
+	VkPipelineDynamicStateCreateInfo _dynamic_state;
+	VkPipelineViewportStateCreateInfo _viewport_state;
+	VkPipelineRasterizationStateCreateInfo _rasterizer;
+	VkPipelineMultisampleStateCreateInfo _multisample;
+	VkPipelineColorBlendAttachmentState _colorblend_attachment;
+	VkPipelineColorBlendStateCreateInfo _colorblend_state;
+	VkPipelineRenderingCreateInfo _rendering;
+} GraphicsState;
+
+static void fill_graphics_state(const PipelineDesc *desc, GraphicsState *state)
+{
+	*state = (GraphicsState){};
+
+	// Every feature bit becomes a VkBool32 constant. Ids the shader doesn't declare are ignored
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		state->_feature_values[i] = (desc->_features >> i) & 1;
+		state->_feature_entries[i] = (VkSpecializationMapEntry){i, i * sizeof(VkBool32), sizeof(VkBool32)};
+	};
+	state->_specialization_info.mapEntryCount = 32;
+	state->_specialization_info.pMapEntries = state->_feature_entries;
+	state->_specialization_info.dataSize = sizeof(state->_feature_values);
+	state->_specialization_info.pData = state->_feature_values;
+
+	state->_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	state->_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	state->_stages[0].module = desc->_module;
+	state->_stages[0].pName = desc->_vert_entry;
+	state->_stages[0].pSpecializationInfo = &state->_specialization_info;
+
+	state->_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	state->_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	state->_stages[1].module = desc->_module;
+	state->_stages[1].pName = desc->_frag_entry;
+	state->_stages[1].pSpecializationInfo = &state->_specialization_info;
+
+	state->_vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	state->_input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	state->_input_assembly.topology = desc->_topology;
+	state->_input_assembly.primitiveRestartEnable = VK_FALSE;
+
+	state->_dynamic_states[0] = VK_DYNAMIC_STATE_SCISSOR;
+	state->_dynamic_states[1] = VK_DYNAMIC_STATE_VIEWPORT;
+	state->_dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	state->_dynamic_state.pDynamicStates = state->_dynamic_states;
+	state->_dynamic_state.dynamicStateCount = 2;
+	
+	// With dynamic state, the actual viewport and scissor will be later set at drawing time
+	// Without dynamic state, they need to be set here, which makes them immutable - any changes needed require
+	// creating a new pipeline
+	// Can create multiple viewport and scissor on some GPU, need to enable in GPU features when creating
+	// logical device
+	state->_viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	state->_viewport_state.scissorCount = 1;
+	state->_viewport_state.viewportCount = 1;
+
+	// # Rasterizer
+	// The rasterizer takes the geometry shaped by the vertices from the vertex shader
+	// and turns it into fragments to be colored by the fragment shader. 
+	// It also performs depth testing, face culling and the scissor test, and it can be
+	// configured to output fragments that fill entire polygons or just the edges (wireframe rendering)
+
+	state->_rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	state->_rasterizer.depthClampEnable = VK_FALSE;
+	state->_rasterizer.depthBiasSlopeFactor = 1.0f;
+	state->_rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	state->_rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	state->_rasterizer.lineWidth = 1.0f;
+	state->_rasterizer.cullMode = desc->_cull_mode;
+	state->_rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	state->_rasterizer.depthBiasEnable = VK_FALSE;
+
+	// # Multisampling
+	// Disable for now
+	state->_multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	state->_multisample.sampleShadingEnable = VK_FALSE;
+	state->_multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// # Color blending
+	
+	// config per attched framebuffer
+	state->_colorblend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT
+		| VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
+		| VK_COLOR_COMPONENT_A_BIT;
+	// if false, new color from fragment shader is passed through unmodified.
+	// below is alpha-blending
+	// `	finalColor.rgb = newAlpha * newColor + (1 - newAlpha) * oldColor;
+	// `	finalColor.a = newAlpha.a
+	state->_colorblend_attachment.blendEnable = desc->_blend != PIPELINE_BLEND_NONE;
+	state->_colorblend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	// Additive: finalColor.rgb = newAlpha * newColor + oldColor, for lights and flashes
+	state->_colorblend_attachment.dstColorBlendFactor = desc->_blend == PIPELINE_BLEND_ADDITIVE
+		? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	state->_colorblend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+	state->_colorblend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	state->_colorblend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	// Over: finalColor.a = newAlpha + (1 - newAlpha) * oldAlpha
+	if (desc->_blend == PIPELINE_BLEND_OVER)
+		state->_colorblend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	// Multiply: finalColor.rgb = newColor * oldColor, alpha kept
+	if (desc->_blend == PIPELINE_BLEND_MULTIPLY)
+	{
+		state->_colorblend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_DST_COLOR;
+		state->_colorblend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+		state->_colorblend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		state->_colorblend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	};
+
+	state->_colorblend_state.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	// If true, use bitwise combination of color, ignore the colorblend attachment above
+	state->_colorblend_state.logicOpEnable = VK_FALSE;
+	state->_colorblend_state.attachmentCount = 1;
+	state->_colorblend_state.pAttachments = &state->_colorblend_attachment;
+
+	// If use dynamic rendering, pass this to pNext of VkGraphicsPipelineCreateInfo and renderpass set to nullptr. This will specify the viewmask and
+	// color attachment info. If use a valid RenderPass, value of this structure is ignored
+	state->_rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	state->_rendering.colorAttachmentCount = 1;
+	state->_rendering.pColorAttachmentFormats = &desc->_color_format;
+};
+
+Result create_graphics_pipeline_desc(VkDevice device, VkPipelineCache cache, const PipelineDesc *desc, VkPipeline *pipeline)
+{
+	GraphicsState state;
+	fill_graphics_state(desc, &state);
+
+	VkGraphicsPipelineCreateInfo graphics_pipeline_create_info = {
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.pNext = &state._rendering,
+		.stageCount = 2,
+		.pStages = state._stages,
+		.pVertexInputState = &state._vertex_input,
+		.pInputAssemblyState = &state._input_assembly,
+		.pRasterizationState = &state._rasterizer,
+		.pColorBlendState = &state._colorblend_state,
+		.pMultisampleState = &state._multisample,
+		.pViewportState = &state._viewport_state,
+		.pDynamicState = &state._dynamic_state,
+		.renderPass = nullptr,
+		.layout = desc->_layout,
+		.basePipelineHandle = VK_NULL_HANDLE,
+		.basePipelineIndex = -1,
+	};
+
+	if (vkCreateGraphicsPipelines(device, cache, 1, &graphics_pipeline_create_info, nullptr, pipeline) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create graphics pipeline\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+Result create_graphics_pipeline_part(VkDevice device, VkPipelineCache cache, const PipelineDesc *desc,
+		VkGraphicsPipelineLibraryFlagsEXT part, VkPipeline *pipeline)
+{
+	GraphicsState state;
+	fill_graphics_state(desc, &state);
+
+	VkGraphicsPipelineLibraryCreateInfoEXT library_create_info = {};
+	library_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+	library_create_info.pNext = &state._rendering;
+	library_create_info.flags = part;
+
+	VkGraphicsPipelineCreateInfo create_info = {};
+	create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	create_info.pNext = &library_create_info;
+	create_info.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+	create_info.basePipelineIndex = -1;
+	// Each part only gets the state it owns
+	switch (part)
+	{
+	case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+		create_info.pVertexInputState = &state._vertex_input;
+		create_info.pInputAssemblyState = &state._input_assembly;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+		create_info.stageCount = 1;
+		create_info.pStages = &state._stages[0];
+		create_info.pViewportState = &state._viewport_state;
+		create_info.pRasterizationState = &state._rasterizer;
+		create_info.pDynamicState = &state._dynamic_state;
+		create_info.layout = desc->_layout;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+		create_info.stageCount = 1;
+		create_info.pStages = &state._stages[1];
+		create_info.pMultisampleState = &state._multisample;
+		create_info.layout = desc->_layout;
+		break;
+	case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+		create_info.pColorBlendState = &state._colorblend_state;
+		create_info.pMultisampleState = &state._multisample;
+		break;
+	default:
+		return FAILURE;
+	};
+
+	if (vkCreateGraphicsPipelines(device, cache, 1, &create_info, nullptr, pipeline) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to create graphics pipeline library %x\n", part);
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+Result link_graphics_pipeline(VkDevice device, VkPipelineCache cache, const VkPipeline *parts, uint32_t parts_count,
+		VkPipelineLayout layout, VkPipeline *pipeline)
+{
+	VkPipelineLibraryCreateInfoKHR library_info = {};
+	library_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	library_info.libraryCount = parts_count;
+	library_info.pLibraries = parts;
+
+	// No VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT: a fast link, the whole point is not to compile here
+	VkGraphicsPipelineCreateInfo create_info = {};
+	create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	create_info.pNext = &library_info;
+	create_info.layout = layout;
+	create_info.basePipelineIndex = -1;
+
+	if (vkCreateGraphicsPipelines(device, cache, 1, &create_info, nullptr, pipeline) != VK_SUCCESS)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Failed to link graphics pipeline\n");
+		return FAILURE;
+	};
+	return SUCCESS;
+};
+
+Result build_graphics_pipeline(VkDevice device, VkPipelineCache cache, VkFormat color_format, VkShaderModule module,
+		const char *vert_entry, const char *frag_entry, VkCullModeFlags cull_mode,
+		VkPipelineLayout layout, VkPipeline *pipeline)
+{
+	PipelineDesc desc = {};
+	desc._module = module;
+	desc._vert_entry = vert_entry;
+	desc._frag_entry = frag_entry;
+	desc._layout = layout;
+	desc._color_format = color_format;
+	desc._topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	desc._cull_mode = cull_mode;
+	desc._blend = PIPELINE_BLEND_ALPHA;
+	return create_graphics_pipeline_desc(device, cache, &desc, pipeline);
+};
@@ -1,14 +1,46 @@
 #pragma once
-#include <vulkan/vulkan.h>
+#include "vkload.h"
+#include "octopus.h"
 typedef struct
 {
 	// Some gpu have queue that support graphic but not present, and vice versa.
 	// Though it's rare. Try to select device that support both
 	uint32_t _graphics;
 	uint32_t _present;
+	// A compute only family when the device has one, _graphics otherwise
+	uint32_t _compute;
 } QueueFamilyIndices;
 
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+
+// Timestamp queries of one frame, see GpuTimes
+typedef enum
+{
+	GPU_TIMESTAMP_GRAPHICS_BEGIN,
+	// Security camera views rendered, the main view starts
+	GPU_TIMESTAMP_CCTV_END,
+	// Scene rendered, before the upscale that needs the swapchain image
+	GPU_TIMESTAMP_SCENE_END,
+	GPU_TIMESTAMP_GRAPHICS_END,
+	GPU_TIMESTAMP_COMPUTE_BEGIN,
+	GPU_TIMESTAMP_COMPUTE_END,
+	GPU_TIMESTAMPS_PER_FRAME,
+} GpuTimestamp;
+
+// Busy time of each queue and how much of it ran at the same time, summed over _frames
+typedef struct
+{
+	VkQueryPool _pool;
+	float _period_ns;
+	// Bit i: query i of that frame was written and can be read back once its fence signals
+	uint32_t _written[MAX_FRAMES_IN_FLIGHT];
+	uint64_t _graphics_ns, _compute_ns, _overlap_ns, _cctv_ns;
+	uint32_t _frames;
+	// Of the last frame read back, 0 when it had no timestamps
+	uint64_t _scene_ns;
+	// Graphics queue time of the last frame that had timestamps
+	uint64_t _frame_ns;
+} GpuTimes;
 typedef struct
 {
 	uint32_t _swapchain_images_count, _current_frame;
@@ -23,15 +55,125 @@ typedef struct
 	VkShaderModule _shader_module;
 	VkPhysicalDevice _physical_device;
 	VkDevice _device;
-	VkQueue _graphics_queue, _present_queue;
+	VkQueue _graphics_queue, _present_queue, _compute_queue;
+	// Particle simulation runs on _compute_queue, overlapping the graphics work that doesn't
+	// need it. Off when the device has no compute only family, or with --no-async-compute
+	bool _async_compute, _no_async_compute;
 	VkPipelineLayout _pipeline_layout;
 	VkSwapchainKHR _swapchain;
 	VkFormat _swapchain_format;
 	VkExtent2D _swapchain_extent;
-	VkPipeline _graphics_pipeline;
-    VkCommandPool _commandpool;
-    VkCommandBuffer _commandbuffers[MAX_FRAMES_IN_FLIGHT];
-	VkSemaphore _smps_present_complete[MAX_FRAMES_IN_FLIGHT],
-				_smps_render_complete[MAX_FRAMES_IN_FLIGHT];
+	// Swapchain images can be copied from, for capture
+	bool _swapchain_transfer_src;
+	// Shared by every pipeline, including the ones compiled on worker threads
+	VkPipelineCache _pipeline_cache;
+	// VK_EXT_graphics_pipeline_library is enabled, unless _no_pipeline_library (--no-pipeline-library)
+	bool _pipeline_library, _no_pipeline_library;
+	// VK_KHR_present_id and VK_KHR_present_wait are enabled, see pacing.h
+	bool _present_wait;
+	// --gpu <index|name>, nullptr to pick the best scoring device
+	const char *_gpu_override;
+    VkCommandPool _commandpool, _compute_commandpool;
+    VkCommandBuffer _commandbuffers[MAX_FRAMES_IN_FLIGHT], _compute_commandbuffers[MAX_FRAMES_IN_FLIGHT];
+	// Swapchain image work of a frame, submitted after its scene so only it waits for the acquire
+	VkCommandBuffer _output_commandbuffers[MAX_FRAMES_IN_FLIGHT];
+	VkSemaphore _smps_present_complete[MAX_FRAMES_IN_FLIGHT];
+	// One per swapchain image, a present may still wait on it when its frame slot comes around again
+	VkSemaphore *_smps_render_complete;
 	VkFence _fences_draw[MAX_FRAMES_IN_FLIGHT];
+	// Timeline semaphores between the queues, each submit signals the next value of its queue.
+	// The graphics fence of a frame also covers its compute submit, graphics waits on it
+	VkSemaphore _graphics_timeline, _compute_timeline;
+	uint64_t _graphics_value, _compute_value;
+	GpuTimes _gpu_times;
 } VulkanState;
+
+typedef enum
+{
+	PIPELINE_BLEND_NONE,
+	PIPELINE_BLEND_ALPHA,
+	PIPELINE_BLEND_ADDITIVE,
+	// Alpha blended, alpha accumulates coverage: the target stays premultiplied and can be
+	// composited later (decal atlas)
+	PIPELINE_BLEND_OVER,
+	// finalColor = newColor * oldColor, tints what is already lit
+	PIPELINE_BLEND_MULTIPLY,
+} PipelineBlend;
+
+// Shader feature toggles. Bit i is boolean specialization constant i, [vk::constant_id(i)] in slang
+typedef enum
+{
+	PIPELINE_FEATURE_LIGHTING = 1 << 0,
+} PipelineFeature;
+
+// Everything that makes one graphics pipeline different from another.
+// Entry names must outlive the pipelines (string literals)
+typedef struct
+{
+	VkShaderModule _module;
+	const char *_vert_entry, *_frag_entry;
+	VkPipelineLayout _layout;
+	VkFormat _color_format;
+	VkPrimitiveTopology _topology;
+	VkCullModeFlags _cull_mode;
+	PipelineBlend _blend;
+	uint32_t _features;
+} PipelineDesc;
+
+// One descriptor set of storage buffers (binding i = buffers[i]) and a push constant range,
+// visible to compute and vertex stages. Used by the GPU driven passes
+typedef struct
+{
+	VkDescriptorSetLayout _set_layout;
+	VkDescriptorPool _pool;
+	VkDescriptorSet _set;
+	VkPipelineLayout _pipeline_layout;
+} StorageBindings;
+
+// Helpers shared by the renderer modules (vk.c)
+// nullptr when the file can't be read, free the rest
+char *read_shader_file(const char *path, uint32_t *out_size);
+// VK_NULL_HANDLE when the SPIR-V is rejected
+VkShaderModule create_shader_module(VkDevice device, const char *src, size_t size);
+// From the SPIR-V embedded in the executable, by file name ("particles.spv"). No file I/O
+VkShaderModule load_shader_module(VkDevice device, const char *name);
+// From a .spv on disk, only used by the shader hot reload
+VkShaderModule load_shader_module_file(VkDevice device, const char *path);
+uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_bits, VkMemoryPropertyFlags properties);
+Result create_buffer(VulkanState *vk, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags properties, VkBuffer *buffer, VkDeviceMemory *memory);
+void destroy_buffer(VulkanState *vk, VkBuffer buffer, VkDeviceMemory memory);
+// 2D color image, one mip, device local, with a view of the whole image
+Result create_image(VulkanState *vk, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+		VkImage *image, VkDeviceMemory *memory, VkImageView *view);
+void destroy_image(VulkanState *vk, VkImage image, VkDeviceMemory memory, VkImageView view);
+// Layout transition of a whole color image
+void image_barrier(VkCommandBuffer cmdbuffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+		VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask,
+		VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask);
+void memory_barrier(VkCommandBuffer cmdbuffer,
+		VkPipelineStageFlags2 src_stage_mask, VkAccessFlags2 src_access_mask,
+		VkPipelineStageFlags2 dst_stage_mask, VkAccessFlags2 dst_access_mask);
+// Queue family ownership transfer of whole buffers. Record the release on the queue giving them up
+// (stage and access of its last use) and the matching acquire on the receiving queue (its first use)
+void buffer_ownership_barrier(VkCommandBuffer cmdbuffer, const VkBuffer *buffers, uint32_t buffers_count,
+		uint32_t src_family, uint32_t dst_family, bool release,
+		VkPipelineStageFlags2 stage_mask, VkAccessFlags2 access_mask);
+Result create_storage_bindings(VkDevice device, const VkBuffer *buffers, uint32_t buffers_count,
+		uint32_t push_constant_size, StorageBindings *bindings);
+void destroy_storage_bindings(VkDevice device, StorageBindings *bindings);
+// cache may be shared, pipeline creation is thread safe
+Result create_compute_pipeline(VkDevice device, VkPipelineCache cache, VkShaderModule module, const char *entry,
+		VkPipelineLayout layout, VkPipeline *pipeline);
+// Vertex + fragment pipeline for dynamic rendering into one color attachment
+Result create_graphics_pipeline_desc(VkDevice device, VkPipelineCache cache, const PipelineDesc *desc, VkPipeline *pipeline);
+// VK_EXT_graphics_pipeline_library: compile one part of desc (vertex input, pre-rasterization,
+// fragment shader or fragment output) on its own, then fast-link parts into complete pipelines
+Result create_graphics_pipeline_part(VkDevice device, VkPipelineCache cache, const PipelineDesc *desc,
+		VkGraphicsPipelineLibraryFlagsEXT part, VkPipeline *pipeline);
+Result link_graphics_pipeline(VkDevice device, VkPipelineCache cache, const VkPipeline *parts, uint32_t parts_count,
+		VkPipelineLayout layout, VkPipeline *pipeline);
+// Triangle list, alpha blended, no features
+Result build_graphics_pipeline(VkDevice device, VkPipelineCache cache, VkFormat color_format, VkShaderModule module,
+		const char *vert_entry, const char *frag_entry, VkCullModeFlags cull_mode,
+		VkPipelineLayout layout, VkPipeline *pipeline);
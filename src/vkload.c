@@ -0,0 +1,64 @@
+#include "vkload.h"
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_vulkan.h>
+
+#define VK_DEFINE_FUNCTION(name) PFN_##name name;
+PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr;
+VK_LOADER_FUNCTIONS(VK_DEFINE_FUNCTION)
+VK_INSTANCE_FUNCTIONS(VK_DEFINE_FUNCTION)
+VK_DEVICE_FUNCTIONS(VK_DEFINE_FUNCTION)
+VK_DEVICE_EXTENSION_FUNCTIONS(VK_DEFINE_FUNCTION)
+#undef VK_DEFINE_FUNCTION
+
+static SDL_SharedObject *system_loader;
+
+Result vk_load_loader(void)
+{
+	// Same library SDL creates surfaces with
+	vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)SDL_Vulkan_GetVkGetInstanceProcAddr();
+	if (vkGetInstanceProcAddr == nullptr)
+	{
+		static const char *names[] = {"libvulkan.so.1", "libvulkan.so", "vulkan-1.dll", "libvulkan.1.dylib", "libMoltenVK.dylib"};
+		for (size_t i = 0; i < SDL_arraysize(names) && system_loader == nullptr; i++)
+		{
+			system_loader = SDL_LoadObject(names[i]);
+		};
+		if (system_loader != nullptr)
+			vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)SDL_LoadFunction(system_loader, "vkGetInstanceProcAddr");
+	};
+	if (vkGetInstanceProcAddr == nullptr)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "No Vulkan loader\n");
+		return FAILURE;
+	};
+
+#define VK_LOAD_FUNCTION(name) name = (PFN_##name)vkGetInstanceProcAddr(nullptr, #name);
+	VK_LOADER_FUNCTIONS(VK_LOAD_FUNCTION)
+#undef VK_LOAD_FUNCTION
+	return vkCreateInstance != nullptr ? SUCCESS : FAILURE;
+};
+
+void vk_load_instance(VkInstance instance)
+{
+#define VK_LOAD_FUNCTION(name) name = (PFN_##name)vkGetInstanceProcAddr(instance, #name);
+	VK_INSTANCE_FUNCTIONS(VK_LOAD_FUNCTION)
+#undef VK_LOAD_FUNCTION
+};
+
+Result vk_load_device(VkDevice device)
+{
+	uint32_t missing = 0;
+#define VK_LOAD_FUNCTION(name) \
+	name = (PFN_##name)vkGetDeviceProcAddr(device, #name); \
+	if (name == nullptr) \
+	{ \
+		SDL_LogError(SDL_LOG_CATEGORY_GPU, "Missing device function %s\n", #name); \
+		missing++; \
+	};
+	VK_DEVICE_FUNCTIONS(VK_LOAD_FUNCTION)
+#undef VK_LOAD_FUNCTION
+#define VK_LOAD_FUNCTION(name) name = (PFN_##name)vkGetDeviceProcAddr(device, #name);
+	VK_DEVICE_EXTENSION_FUNCTIONS(VK_LOAD_FUNCTION)
+#undef VK_LOAD_FUNCTION
+	return missing == 0 ? SUCCESS : FAILURE;
+};
@@ -0,0 +1,135 @@
+#pragma once
+// Vulkan entry points, loaded at runtime instead of linked (the volk approach). The build defines
+// VK_NO_PROTOTYPES, every vk* name below is a function pointer with the same name as the prototype
+// it replaces, so calling code doesn't change.
+// Device functions come straight from vkGetDeviceProcAddr: a vkCmd* call jumps into the driver
+// instead of through the loader's trampoline. They belong to one device, the last one loaded.
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+#include <vulkan/vulkan.h>
+#include "octopus.h"
+
+// Available before any instance exists
+#define VK_LOADER_FUNCTIONS(X) \
+	X(vkCreateInstance) \
+	X(vkEnumerateInstanceExtensionProperties) \
+	X(vkEnumerateInstanceLayerProperties) \
+	X(vkEnumerateInstanceVersion)
+
+// Extension functions stay nullptr when their extension isn't enabled
+#define VK_INSTANCE_FUNCTIONS(X) \
+	X(vkCreateDebugUtilsMessengerEXT) \
+	X(vkCreateDevice) \
+	X(vkDestroyDebugUtilsMessengerEXT) \
+	X(vkDestroyInstance) \
+	X(vkDestroySurfaceKHR) \
+	X(vkEnumerateDeviceExtensionProperties) \
+	X(vkEnumeratePhysicalDevices) \
+	X(vkGetDeviceProcAddr) \
+	X(vkGetPhysicalDeviceFeatures2) \
+	X(vkGetPhysicalDeviceFormatProperties) \
+	X(vkGetPhysicalDeviceMemoryProperties) \
+	X(vkGetPhysicalDeviceProperties) \
+	X(vkGetPhysicalDeviceQueueFamilyProperties) \
+	X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+	X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+	X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+	X(vkGetPhysicalDeviceSurfaceSupportKHR)
+
+#define VK_DEVICE_FUNCTIONS(X) \
+	X(vkAllocateCommandBuffers) \
+	X(vkAllocateDescriptorSets) \
+	X(vkAllocateMemory) \
+	X(vkBeginCommandBuffer) \
+	X(vkBindBufferMemory) \
+	X(vkBindImageMemory) \
+	X(vkCmdBeginRendering) \
+	X(vkCmdBindDescriptorSets) \
+	X(vkCmdBindPipeline) \
+	X(vkCmdClearColorImage) \
+	X(vkCmdCopyBufferToImage) \
+	X(vkCmdCopyImageToBuffer) \
+	X(vkCmdDispatch) \
+	X(vkCmdDispatchIndirect) \
+	X(vkCmdDraw) \
+	X(vkCmdDrawIndirect) \
+	X(vkCmdDrawIndirectCount) \
+	X(vkCmdEndRendering) \
+	X(vkCmdFillBuffer) \
+	X(vkCmdPipelineBarrier2) \
+	X(vkCmdPushConstants) \
+	X(vkCmdResetQueryPool) \
+	X(vkCmdSetScissor) \
+	X(vkCmdSetViewport) \
+	X(vkCmdWriteTimestamp2) \
+	X(vkCreateBuffer) \
+	X(vkCreateCommandPool) \
+	X(vkCreateComputePipelines) \
+	X(vkCreateDescriptorPool) \
+	X(vkCreateDescriptorSetLayout) \
+	X(vkCreateFence) \
+	X(vkCreateGraphicsPipelines) \
+	X(vkCreateImage) \
+	X(vkCreateImageView) \
+	X(vkCreatePipelineCache) \
+	X(vkCreatePipelineLayout) \
+	X(vkCreateQueryPool) \
+	X(vkCreateSampler) \
+	X(vkCreateSemaphore) \
+	X(vkCreateShaderModule) \
+	X(vkDestroyBuffer) \
+	X(vkDestroyCommandPool) \
+	X(vkDestroyDescriptorPool) \
+	X(vkDestroyDescriptorSetLayout) \
+	X(vkDestroyDevice) \
+	X(vkDestroyFence) \
+	X(vkDestroyImage) \
+	X(vkDestroyImageView) \
+	X(vkDestroyPipeline) \
+	X(vkDestroyPipelineCache) \
+	X(vkDestroyPipelineLayout) \
+	X(vkDestroyQueryPool) \
+	X(vkDestroySampler) \
+	X(vkDestroySemaphore) \
+	X(vkDestroyShaderModule) \
+	X(vkDeviceWaitIdle) \
+	X(vkEndCommandBuffer) \
+	X(vkFreeCommandBuffers) \
+	X(vkFreeMemory) \
+	X(vkGetBufferMemoryRequirements) \
+	X(vkGetDeviceQueue) \
+	X(vkGetImageMemoryRequirements) \
+	X(vkGetQueryPoolResults) \
+	X(vkMapMemory) \
+	X(vkQueueSubmit2) \
+	X(vkQueueWaitIdle) \
+	X(vkResetCommandBuffer) \
+	X(vkResetFences) \
+	X(vkUnmapMemory) \
+	X(vkUpdateDescriptorSets) \
+	X(vkWaitForFences)
+
+// Stay nullptr when their extension isn't enabled on the device
+#define VK_DEVICE_EXTENSION_FUNCTIONS(X) \
+	X(vkAcquireNextImage2KHR) \
+	X(vkCreateSwapchainKHR) \
+	X(vkDestroySwapchainKHR) \
+	X(vkGetSwapchainImagesKHR) \
+	X(vkQueuePresentKHR) \
+	X(vkWaitForPresentKHR)
+
+#define VK_DECLARE_FUNCTION(name) extern PFN_##name name;
+extern PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr;
+VK_LOADER_FUNCTIONS(VK_DECLARE_FUNCTION)
+VK_INSTANCE_FUNCTIONS(VK_DECLARE_FUNCTION)
+VK_DEVICE_FUNCTIONS(VK_DECLARE_FUNCTION)
+VK_DEVICE_EXTENSION_FUNCTIONS(VK_DECLARE_FUNCTION)
+#undef VK_DECLARE_FUNCTION
+
+// From the library SDL loaded (SDL_Vulkan_LoadLibrary), or the system loader when the video
+// subsystem isn't up (benchmarks). Call again after SDL_Quit, the library may have been unloaded
+Result vk_load_loader(void);
+// Right after vkCreateInstance / vkCreateDevice
+void vk_load_instance(VkInstance instance);
+Result vk_load_device(VkDevice device);